@@ -0,0 +1,514 @@
+#include "BVH.h"
+
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
+using namespace DirectX;
+
+// ====== Building ===============================================================================
+
+namespace
+{
+	// traversal keeps a fixed stack, past MEDIAN_SPLIT_DEPTH the
+	// builder only halves, which can't add more than 30 levels
+	const unsigned int MAX_DEPTH = 64;
+	const unsigned int MEDIAN_SPLIT_DEPTH = 32;
+
+	struct AABB
+	{
+		float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow(const float p[3])
+		{
+			for (int a = 0; a < 3; a++) {
+				min[a] = std::min(min[a], p[a]);
+				max[a] = std::max(max[a], p[a]);
+			}
+		}
+		void Grow(const AABB& b)
+		{
+			Grow(b.min);
+			Grow(b.max);
+		}
+		// half the surface area, only ever compared
+		float Area() const
+		{
+			if (min[0] > max[0]) return 0;
+			float x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+			return x * y + y * z + z * x;
+		}
+	};
+
+	struct BuildContext
+	{
+		const Vertex* vertices;
+		const unsigned int* indices;
+		std::vector<AABB> triangleBounds;
+		std::vector<XMFLOAT3> centroids;
+		std::vector<uint32_t> order;	// triangles, partitioned in place as nodes split
+		std::vector<BVHNode>* nodes;
+		std::vector<BVHTriangleBlock>* blocks;
+		size_t leaves = 0;
+		size_t maxDepth = 0;
+	};
+
+	void MakeLeaf(BuildContext& ctx, uint32_t nodeIndex, uint32_t first, uint32_t count)
+	{
+		BVHTriangleBlock block = {};
+		for (uint32_t lane = 0; lane < BVH::MAX_LEAF_TRIANGLES; lane++) {
+			if (lane >= count) {
+				block.triangle[lane] = UINT32_MAX;
+				continue;
+			}
+			uint32_t t = ctx.order[first + lane];
+			const XMFLOAT3& p0 = ctx.vertices[ctx.indices[t * 3]].Position;
+			const XMFLOAT3& p1 = ctx.vertices[ctx.indices[t * 3 + 1]].Position;
+			const XMFLOAT3& p2 = ctx.vertices[ctx.indices[t * 3 + 2]].Position;
+			block.v0[0][lane] = p0.x; block.v0[1][lane] = p0.y; block.v0[2][lane] = p0.z;
+			block.edge1[0][lane] = p1.x - p0.x; block.edge1[1][lane] = p1.y - p0.y; block.edge1[2][lane] = p1.z - p0.z;
+			block.edge2[0][lane] = p2.x - p0.x; block.edge2[1][lane] = p2.y - p0.y; block.edge2[2][lane] = p2.z - p0.z;
+			block.triangle[lane] = t;
+		}
+
+		BVHNode& node = (*ctx.nodes)[nodeIndex];
+		node.leftFirst = (uint32_t)ctx.blocks->size();
+		node.triangleCount = count;
+		ctx.blocks->push_back(block);
+		ctx.leaves++;
+	}
+
+	void Subdivide(BuildContext& ctx, uint32_t nodeIndex, uint32_t first, uint32_t count, unsigned int depth)
+	{
+		AABB bounds, centroidBounds;
+		for (uint32_t i = first; i < first + count; i++) {
+			uint32_t t = ctx.order[i];
+			bounds.Grow(ctx.triangleBounds[t]);
+			centroidBounds.Grow(&ctx.centroids[t].x);
+		}
+		BVHNode& node = (*ctx.nodes)[nodeIndex];
+		node.boundsMin = XMFLOAT3(bounds.min[0], bounds.min[1], bounds.min[2]);
+		node.boundsMax = XMFLOAT3(bounds.max[0], bounds.max[1], bounds.max[2]);
+		ctx.maxDepth = std::max(ctx.maxDepth, (size_t)depth);
+
+		// a block costs the same to test with one triangle in it as
+		// with four, so anything that fits is a leaf
+		if (count <= BVH::MAX_LEAF_TRIANGLES) {
+			MakeLeaf(ctx, nodeIndex, first, count);
+			return;
+		}
+
+		// binned SAH: split between two bins of centroids, on the
+		// axis and plane with the lowest area * triangles on each side
+		const unsigned int BINS = BVH::SAH_BINS;
+		float bestCost = FLT_MAX;
+		int bestAxis = -1;
+		unsigned int bestSplit = 0;
+		for (int axis = 0; axis < 3 && depth < MEDIAN_SPLIT_DEPTH; axis++) {
+			float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+			if (!(extent > 0)) continue;
+			float scale = BINS / extent;
+
+			AABB bins[BINS];
+			uint32_t binCounts[BINS] = {};
+			for (uint32_t i = first; i < first + count; i++) {
+				uint32_t t = ctx.order[i];
+				unsigned int b = std::min(BINS - 1, (unsigned int)(((&ctx.centroids[t].x)[axis] - centroidBounds.min[axis]) * scale));
+				bins[b].Grow(ctx.triangleBounds[t]);
+				binCounts[b]++;
+			}
+
+			// left sides swept forwards, right sides backwards
+			float leftArea[BINS - 1];
+			uint32_t leftCount[BINS - 1];
+			AABB left;
+			uint32_t leftSum = 0;
+			for (unsigned int b = 0; b < BINS - 1; b++) {
+				if (binCounts[b]) left.Grow(bins[b]);
+				leftSum += binCounts[b];
+				leftArea[b] = left.Area();
+				leftCount[b] = leftSum;
+			}
+			AABB right;
+			uint32_t rightSum = 0;
+			for (unsigned int b = BINS - 1; b > 0; b--) {
+				if (binCounts[b]) right.Grow(bins[b]);
+				rightSum += binCounts[b];
+				if (leftCount[b - 1] == 0 || rightSum == 0) continue;
+				float cost = leftArea[b - 1] * leftCount[b - 1] + right.Area() * rightSum;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+
+		uint32_t* begin = ctx.order.data() + first;
+		uint32_t* end = begin + count;
+		uint32_t* middle = begin + count / 2;
+		if (bestAxis >= 0) {
+			float min = centroidBounds.min[bestAxis];
+			float scale = BINS / (centroidBounds.max[bestAxis] - min);
+			middle = std::partition(begin, end, [&](uint32_t t) {
+				return std::min(BINS - 1, (unsigned int)(((&ctx.centroids[t].x)[bestAxis] - min) * scale)) < bestSplit;
+			});
+		}
+		else {
+			// identical centroids or too deep, halve along the widest axis
+			int axis = 0;
+			for (int a = 1; a < 3; a++)
+				if (bounds.max[a] - bounds.min[a] > bounds.max[axis] - bounds.min[axis]) axis = a;
+			std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) {
+				return (&ctx.centroids[a].x)[axis] < (&ctx.centroids[b].x)[axis];
+			});
+		}
+		uint32_t leftCount = (uint32_t)(middle - begin);
+		if (leftCount == 0 || leftCount == count) leftCount = count / 2;
+
+		uint32_t leftChild = (uint32_t)ctx.nodes->size();
+		ctx.nodes->emplace_back();
+		ctx.nodes->emplace_back();
+		(*ctx.nodes)[nodeIndex].leftFirst = leftChild;
+		(*ctx.nodes)[nodeIndex].triangleCount = 0;
+
+		Subdivide(ctx, leftChild, first, leftCount, depth + 1);
+		Subdivide(ctx, leftChild + 1, first + leftCount, count - leftCount, depth + 1);
+	}
+}
+
+BVH::BuildStats BVH::Build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	auto start = std::chrono::steady_clock::now();
+	BuildStats stats = {};
+	nodes.clear();
+	blocks.clear();
+
+	uint32_t triCount = (uint32_t)(indexCount / 3);
+	if (triCount == 0 || vertexCount == 0) return stats;
+
+	BuildContext ctx;
+	ctx.vertices = vertices;
+	ctx.indices = indices;
+	ctx.nodes = &nodes;
+	ctx.blocks = &blocks;
+	ctx.triangleBounds.resize(triCount);
+	ctx.centroids.resize(triCount);
+	ctx.order.resize(triCount);
+	for (uint32_t t = 0; t < triCount; t++) {
+		AABB& b = ctx.triangleBounds[t];
+		for (int k = 0; k < 3; k++) b.Grow(&vertices[indices[t * 3 + k]].Position.x);
+		ctx.centroids[t] = XMFLOAT3(
+			(b.min[0] + b.max[0]) * 0.5f,
+			(b.min[1] + b.max[1]) * 0.5f,
+			(b.min[2] + b.max[2]) * 0.5f);
+		ctx.order[t] = t;
+	}
+
+	// a binary tree over n leaves has 2n - 1 nodes
+	nodes.reserve(2 * ((triCount + MAX_LEAF_TRIANGLES - 1) / MAX_LEAF_TRIANGLES));
+	nodes.emplace_back();
+	Subdivide(ctx, 0, 0, triCount, 0);
+
+	stats.nodes = nodes.size();
+	stats.leaves = ctx.leaves;
+	stats.maxDepth = ctx.maxDepth;
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+void BVH::Assign(const BVHNode* nodes, size_t nodeCount, const BVHTriangleBlock* blocks, size_t blockCount)
+{
+	this->nodes.assign(nodes, nodes + nodeCount);
+	this->blocks.assign(blocks, blocks + blockCount);
+}
+
+// ====== Queries ================================================================================
+
+namespace
+{
+	// the ray broadcast to every lane
+	struct RaySSE
+	{
+		__m128 ox, oy, oz;
+		__m128 dx, dy, dz;
+	};
+
+	// entry distance of the ray into a node's box, FLT_MAX if it
+	// misses or only enters past tMax
+	inline float BoxEntry(const BVHNode& node, const float origin[3], const float invDirection[3], float tMax)
+	{
+		const float* min = &node.boundsMin.x;
+		const float* max = &node.boundsMax.x;
+		float t0 = 0, t1 = tMax;
+		for (int a = 0; a < 3; a++) {
+			float tNear = (min[a] - origin[a]) * invDirection[a];
+			float tFar = (max[a] - origin[a]) * invDirection[a];
+			if (tNear > tFar) std::swap(tNear, tFar);
+			t0 = std::max(t0, tNear);
+			t1 = std::min(t1, tFar);
+		}
+		return t0 <= t1 ? t0 : FLT_MAX;
+	}
+
+	// Moller-Trumbore on four triangles at once, updates "hit" with
+	// the nearest one in (0, tMax)
+	inline bool IntersectBlock(const BVHTriangleBlock& b, const RaySSE& r, float tMax, RayHit& hit)
+	{
+		__m128 e1x = _mm_loadu_ps(b.edge1[0]), e1y = _mm_loadu_ps(b.edge1[1]), e1z = _mm_loadu_ps(b.edge1[2]);
+		__m128 e2x = _mm_loadu_ps(b.edge2[0]), e2y = _mm_loadu_ps(b.edge2[1]), e2z = _mm_loadu_ps(b.edge2[2]);
+
+		// p = d x e2
+		__m128 px = _mm_sub_ps(_mm_mul_ps(r.dy, e2z), _mm_mul_ps(r.dz, e2y));
+		__m128 py = _mm_sub_ps(_mm_mul_ps(r.dz, e2x), _mm_mul_ps(r.dx, e2z));
+		__m128 pz = _mm_sub_ps(_mm_mul_ps(r.dx, e2y), _mm_mul_ps(r.dy, e2x));
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+		__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+		// s = o - v0, q = s x e1
+		__m128 sx = _mm_sub_ps(r.ox, _mm_loadu_ps(b.v0[0]));
+		__m128 sy = _mm_sub_ps(r.oy, _mm_loadu_ps(b.v0[1]));
+		__m128 sz = _mm_sub_ps(r.oz, _mm_loadu_ps(b.v0[2]));
+		__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+		__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+		__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+		__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+		__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r.dx, qx), _mm_mul_ps(r.dy, qy)), _mm_mul_ps(r.dz, qz)), invDet);
+		__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+		// NaNs from a zero determinant fail every comparison
+		__m128 zero = _mm_setzero_ps();
+		__m128 mask = _mm_cmpge_ps(u, zero);
+		mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+		mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+		mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+		mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(tMax)));
+		int lanes = _mm_movemask_ps(mask);
+		if (!lanes) return false;
+
+		alignas(16) float ts[4], us[4], vs[4];
+		_mm_store_ps(ts, t);
+		_mm_store_ps(us, u);
+		_mm_store_ps(vs, v);
+		int best = -1;
+		for (int lane = 0; lane < 4; lane++)
+			if ((lanes & (1 << lane)) && (best < 0 || ts[lane] < ts[best])) best = lane;
+
+		hit.t = ts[best];
+		hit.u = us[best];
+		hit.v = vs[best];
+		hit.triangle = b.triangle[best];
+		return true;
+	}
+}
+
+template<bool ANY_HIT>
+bool BVH::Traverse(const XMFLOAT3& origin, const XMFLOAT3& direction, float tMax, RayHit& hit) const
+{
+	if (nodes.empty()) return false;
+
+	const float o[3] = { origin.x, origin.y, origin.z };
+	const float invD[3] = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+	RaySSE ray = {
+		_mm_set1_ps(origin.x), _mm_set1_ps(origin.y), _mm_set1_ps(origin.z),
+		_mm_set1_ps(direction.x), _mm_set1_ps(direction.y), _mm_set1_ps(direction.z),
+	};
+	if (BoxEntry(nodes[0], o, invD, tMax) == FLT_MAX) return false;
+
+	// far children wait here along with their entry distance, so
+	// they can be skipped once something closer has been hit
+	uint32_t stack[MAX_DEPTH];
+	float stackT[MAX_DEPTH];
+	int size = 0;
+
+	float closest = tMax;
+	bool found = false;
+	uint32_t current = 0;
+	for (;;) {
+		const BVHNode& node = nodes[current];
+		if (node.triangleCount) {
+			if (IntersectBlock(blocks[node.leftFirst], ray, closest, hit)) {
+				if (ANY_HIT) return true;
+				closest = hit.t;
+				found = true;
+			}
+		}
+		else {
+			uint32_t nearChild = node.leftFirst, farChild = node.leftFirst + 1;
+			float tNear = BoxEntry(nodes[nearChild], o, invD, closest);
+			float tFar = BoxEntry(nodes[farChild], o, invD, closest);
+			if (tFar < tNear) {
+				std::swap(nearChild, farChild);
+				std::swap(tNear, tFar);
+			}
+			if (tNear != FLT_MAX) {
+				if (tFar != FLT_MAX) {
+					stack[size] = farChild;
+					stackT[size] = tFar;
+					size++;
+				}
+				current = nearChild;
+				continue;
+			}
+		}
+
+		do {
+			if (size == 0) return found;
+			size--;
+		} while (stackT[size] >= closest);
+		current = stack[size];
+	}
+}
+
+bool BVH::ClosestHit(const XMFLOAT3& origin, const XMFLOAT3& direction, float tMax, RayHit& hit) const
+{
+	return Traverse<false>(origin, direction, tMax, hit);
+}
+
+bool BVH::AnyHit(const XMFLOAT3& origin, const XMFLOAT3& direction, float tMax) const
+{
+	RayHit hit;
+	return Traverse<true>(origin, direction, tMax, hit);
+}
+
+// ====== Distance ===============================================================================
+
+namespace
+{
+	// squared distance from a point to a node's box, 0 inside it
+	inline float BoxDistanceSq(const BVHNode& node, const float p[3])
+	{
+		const float* min = &node.boundsMin.x;
+		const float* max = &node.boundsMax.x;
+		float distance = 0;
+		for (int a = 0; a < 3; a++) {
+			float d = std::max({ min[a] - p[a], 0.0f, p[a] - max[a] });
+			distance += d * d;
+		}
+		return distance;
+	}
+
+	inline XMFLOAT3 MultiplyAdd(const XMFLOAT3& a, const XMFLOAT3& b, float t)
+	{
+		return XMFLOAT3(a.x + b.x * t, a.y + b.y * t, a.z + b.z * t);
+	}
+	inline XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+}
+
+// by the feature closest to "p" (Ericson, Real-Time Collision Detection 5.1.5)
+float BVH::TriangleDistanceSq(const XMFLOAT3& p, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+{
+	XMFLOAT3 ab = Sub(b, a), ac = Sub(c, a);
+	XMFLOAT3 ap = Sub(p, a), bp = Sub(p, b), cp = Sub(p, c);
+	float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+	float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+	float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+	float va = d3 * d6 - d5 * d4;
+	float vb = d5 * d2 - d1 * d6;
+	float vc = d1 * d4 - d3 * d2;
+
+	XMFLOAT3 closest;
+	if (d1 <= 0 && d2 <= 0) closest = a;
+	else if (d3 >= 0 && d4 <= d3) closest = b;
+	else if (d6 >= 0 && d5 <= d6) closest = c;
+	else if (vc <= 0 && d1 >= 0 && d3 <= 0) closest = MultiplyAdd(a, ab, d1 / (d1 - d3));
+	else if (vb <= 0 && d2 >= 0 && d6 <= 0) closest = MultiplyAdd(a, ac, d2 / (d2 - d6));
+	else if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) closest = MultiplyAdd(b, Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	else if (va + vb + vc <= 0) closest = a;	// degenerate
+	else closest = MultiplyAdd(MultiplyAdd(a, ab, vb / (va + vb + vc)), ac, vc / (va + vb + vc));
+
+	XMFLOAT3 d = Sub(p, closest);
+	return Dot(d, d);
+}
+
+float BVH::ClosestDistanceSq(const XMFLOAT3& point) const
+{
+	if (nodes.empty()) return FLT_MAX;
+
+	// like Traverse(), nearer box first, the far one waits with its
+	// distance so it can be skipped once something closer is found
+	const float p[3] = { point.x, point.y, point.z };
+	uint32_t stack[MAX_DEPTH];
+	float stackDistance[MAX_DEPTH];
+	int size = 0;
+
+	float closest = FLT_MAX;
+	uint32_t current = 0;
+	for (;;) {
+		const BVHNode& node = nodes[current];
+		if (node.triangleCount) {
+			const BVHTriangleBlock& b = blocks[node.leftFirst];
+			for (uint32_t lane = 0; lane < node.triangleCount; lane++) {
+				XMFLOAT3 v0(b.v0[0][lane], b.v0[1][lane], b.v0[2][lane]);
+				XMFLOAT3 v1(v0.x + b.edge1[0][lane], v0.y + b.edge1[1][lane], v0.z + b.edge1[2][lane]);
+				XMFLOAT3 v2(v0.x + b.edge2[0][lane], v0.y + b.edge2[1][lane], v0.z + b.edge2[2][lane]);
+				closest = std::min(closest, TriangleDistanceSq(point, v0, v1, v2));
+			}
+		}
+		else {
+			uint32_t nearChild = node.leftFirst, farChild = node.leftFirst + 1;
+			float dNear = BoxDistanceSq(nodes[nearChild], p);
+			float dFar = BoxDistanceSq(nodes[farChild], p);
+			if (dFar < dNear) {
+				std::swap(nearChild, farChild);
+				std::swap(dNear, dFar);
+			}
+			if (dNear < closest) {
+				if (dFar < closest) {
+					stack[size] = farChild;
+					stackDistance[size] = dFar;
+					size++;
+				}
+				current = nearChild;
+				continue;
+			}
+		}
+
+		do {
+			if (size == 0) return closest;
+			size--;
+		} while (stackDistance[size] >= closest);
+		current = stack[size];
+	}
+}
+
+bool BVH::ClosestHitBruteForce(const Vertex* vertices, const unsigned int* indices, size_t indexCount,
+	const XMFLOAT3& origin, const XMFLOAT3& direction, float tMax, RayHit& hit)
+{
+	const XMFLOAT3& o = origin;
+	const XMFLOAT3& d = direction;
+	bool found = false;
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		const XMFLOAT3& p0 = vertices[indices[i]].Position;
+		const XMFLOAT3& p1 = vertices[indices[i + 1]].Position;
+		const XMFLOAT3& p2 = vertices[indices[i + 2]].Position;
+		float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+		float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+
+		// same steps as IntersectBlock(), one lane at a time
+		float px = d.y * e2z - d.z * e2y;
+		float py = d.z * e2x - d.x * e2z;
+		float pz = d.x * e2y - d.y * e2x;
+		float det = e1x * px + e1y * py + e1z * pz;
+		float invDet = 1.0f / det;
+		float sx = o.x - p0.x, sy = o.y - p0.y, sz = o.z - p0.z;
+		float u = (sx * px + sy * py + sz * pz) * invDet;
+		float qx = sy * e1z - sz * e1y;
+		float qy = sz * e1x - sx * e1z;
+		float qz = sx * e1y - sy * e1x;
+		float v = (d.x * qx + d.y * qy + d.z * qz) * invDet;
+		float t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+		if (!(u >= 0 && v >= 0 && u + v <= 1 && t > 0 && t < tMax)) continue;
+		tMax = t;
+		hit.t = t;
+		hit.u = u;
+		hit.v = v;
+		hit.triangle = (uint32_t)(i / 3);
+		found = true;
+	}
+	return found;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// one node of a BVH, 32 bytes so two share a cache line
+struct BVHNode
+{
+	DirectX::XMFLOAT3 boundsMin;
+	uint32_t leftFirst;			// interior: left child, right is leftFirst + 1 - leaf: triangle block
+	DirectX::XMFLOAT3 boundsMax;
+	uint32_t triangleCount;		// 0 for interior nodes
+};
+static_assert(sizeof(BVHNode) == 32, "BVHNode is stored in .meshbin files");
+
+// the triangles of one leaf as SoA, for testing all four at once
+// - Unused lanes have zero edges, so they can never be hit
+struct BVHTriangleBlock
+{
+	float v0[3][4];			// [axis][lane]
+	float edge1[3][4];		// v1 - v0
+	float edge2[3][4];		// v2 - v0
+	uint32_t triangle[4];	// index / 3 of the triangle in the mesh's LOD 0
+};
+
+// where a ray hit a triangle, t is in units of the ray's direction
+struct RayHit
+{
+	float t;
+	uint32_t triangle;
+	float u, v;				// barycentrics of v1 and v2
+};
+
+// --------------------------------------------------------
+// Triangle BVH for CPU ray casts against a mesh
+// - Built top down with binned SAH, leaves hold at most one
+//   BVHTriangleBlock and rays test it with SSE
+// - Triangles are double sided, picking shouldn't care which
+//   way a face winds
+// --------------------------------------------------------
+class BVH
+{
+public:
+	static constexpr unsigned int MAX_LEAF_TRIANGLES = 4;
+	static constexpr unsigned int SAH_BINS = 16;
+
+	struct BuildStats
+	{
+		double ms;
+		size_t nodes;
+		size_t leaves;
+		size_t maxDepth;
+	};
+
+	// Builds over the triangles in "indices" (one LOD's worth)
+	BuildStats Build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+	// Takes a finished tree, e.g. straight out of a .meshbin
+	void Assign(const BVHNode* nodes, size_t nodeCount, const BVHTriangleBlock* blocks, size_t blockCount);
+
+	// Nearest hit with t in (0, tMax), false if there isn't one
+	bool ClosestHit(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float tMax, RayHit& hit) const;
+
+	// Any hit with t in (0, tMax), stops at the first one found
+	bool AnyHit(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float tMax) const;
+
+	// Squared distance from "point" to the nearest triangle, FLT_MAX if empty
+	float ClosestDistanceSq(const DirectX::XMFLOAT3& point) const;
+
+	// Squared distance from "p" to triangle abc
+	static float TriangleDistanceSq(const DirectX::XMFLOAT3& p,
+		const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c);
+
+	// Scalar test of every triangle, same hits as ClosestHit()
+	// - Kept as the reference for benchmarking
+	static bool ClosestHitBruteForce(const Vertex* vertices, const unsigned int* indices, size_t indexCount,
+		const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float tMax, RayHit& hit);
+
+	bool IsEmpty() const { return nodes.empty(); }
+	const std::vector<BVHNode>& GetNodes() const { return nodes; }
+	const std::vector<BVHTriangleBlock>& GetBlocks() const { return blocks; }
+
+private:
+	std::vector<BVHNode> nodes;
+	std::vector<BVHTriangleBlock> blocks;
+
+	template<bool ANY_HIT>
+	bool Traverse(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float tMax, RayHit& hit) const;
+};
@@ -7,4 +7,20 @@ struct VertexShaderExternalData
 	DirectX::XMFLOAT4X4 mWorld;
 	DirectX::XMFLOAT4X4 mProj;
 	DirectX::XMFLOAT4X4 mView;
+};
+
+// matches cbuffer PerObject in PerObject.hlsli
+struct PerObjectData
+{
+	DirectX::XMFLOAT4X4 worldViewProj;
+	DirectX::XMFLOAT4X4 lightWorldViewProj;
+};
+
+// one instance of an instanced draw, matches InstanceInput in ShaderStructs.hlsli
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInverseTranspose;
+	DirectX::XMFLOAT4X4 worldViewProj;
+	DirectX::XMFLOAT4X4 lightWorldViewProj;
 };
\ No newline at end of file
@@ -64,12 +64,13 @@ void Camera::UpdateProjectionMatrix(float aspectRatio) {
 	XMStoreFloat4x4(&mProjection, mP);
 }
 void Camera::UpdateViewMatrix() {
-	XMFLOAT3 pos = transform->GetPosition();
-	XMFLOAT3 forward = transform->GetForward();
+	// from the world matrix so a camera follows whatever it's parented to
+	XMFLOAT4X4 world = transform->GetWorldMatrix();
+	XMMATRIX mWorld = XMLoadFloat4x4(&world);
 	XMFLOAT3 up(0, 1, 0);
 	XMMATRIX view = XMMatrixLookToLH(
-		XMLoadFloat3(&pos),
-		XMLoadFloat3(&forward),
+		mWorld.r[3],
+		XMVector3Normalize(mWorld.r[2]),
 		XMLoadFloat3(&up));
 	XMStoreFloat4x4(&mView, view);
 }
@@ -96,17 +97,17 @@ void Camera::Update(float dt) {
 	// mouse input
 	if (Input::MouseLeftDown()) {
 
-		// get mouse input and rotate
+		// get mouse input and rotate - pitch about the camera's own right,
+		// yaw about the world up, straight onto the quaternion
 		int cMoveX = Input::GetMouseXDelta();
 		int cMoveY = Input::GetMouseYDelta();
-		transform->Rotate(cMoveY * lookSpeed, cMoveX * lookSpeed, 0);
 
-		// clamp pitch
-		XMFLOAT3 rot = transform->GetRotation();
-		if (rot.x > XM_PI || rot.x < -XM_PI) {
-			rot.x = std::clamp(rot.x, -XM_PI, XM_PI);
-			transform->SetRotation(rot);
-		}
+		// clamp pitch short of straight up/down where the view would flip,
+		// a camera already past it can only come back
+		float pitch = asinf(std::clamp(-transform->GetForward().y, -1.0f, 1.0f));
+		float newPitch = std::clamp(pitch + cMoveY * lookSpeed, (std::min)(-MAX_PITCH, pitch), (std::max)(MAX_PITCH, pitch));
+		transform->RotateLocalAxisAngle(XMFLOAT3(1, 0, 0), newPitch - pitch);
+		transform->RotateAxisAngle(XMFLOAT3(0, 1, 0), cMoveX * lookSpeed);
 	}
 
 	UpdateViewMatrix();
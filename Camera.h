@@ -57,6 +57,8 @@ public:
 	void Update(float dt);
 
 private:
+	// furthest the mouse can pitch the camera up or down
+	static constexpr float MAX_PITCH = DirectX::XM_PIDIV2 - 0.001f;
 
 	// modifiable member variables
 	float aspectRatio;
@@ -0,0 +1,245 @@
+#include "CommandBuffer.h"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr uint32_t Align8(size_t size)
+	{
+		return (uint32_t)((size + 7) & ~(size_t)7);
+	}
+
+	// what a packet of each type has to hold, updates add their data
+	constexpr size_t PAYLOAD_SIZES[(size_t)CommandType::Count] =
+	{
+		sizeof(CommandBuffer::ShaderData),			// SetVertexShader
+		sizeof(CommandBuffer::ShaderData),			// SetPixelShader
+		sizeof(CommandBuffer::VertexBufferData),	// SetVertexBuffer
+		sizeof(CommandBuffer::BindData),			// SetIndexBuffer
+		sizeof(CommandBuffer::UpdateData),			// UpdateConstants
+		sizeof(CommandBuffer::BindData),			// SetConstantBuffer
+		sizeof(CommandBuffer::BindData),			// SetShaderResource
+		sizeof(CommandBuffer::BindData),			// SetSampler
+		sizeof(CommandBuffer::UpdateData),			// UpdateBuffer
+		sizeof(CommandBuffer::DrawIndexedData),		// DrawIndexed
+		sizeof(CommandBuffer::DrawInstancedData),	// DrawIndexedInstanced
+	};
+}
+
+// ====== Recording ==========
+
+template<typename T>
+void CommandBuffer::Write(CommandType type, ShaderStage stage, uint32_t slot, const T& payload, const void* extra, uint32_t extraSize)
+{
+	Header header = { type, stage, (uint16_t)slot, Align8(sizeof(Header) + sizeof(T) + extraSize) };
+
+	// doubling, so a frame's worth of commands stops growing it quickly
+	if (used + header.size > bytes.size())
+		bytes.resize((std::max)(bytes.size() * 2, (size_t)(used + header.size) + 4096));
+
+	uint8_t* at = bytes.data() + used;
+	memcpy(at, &header, sizeof(Header));
+	memcpy(at + sizeof(Header), &payload, sizeof(T));
+	if (extraSize) memcpy(at + sizeof(Header) + sizeof(T), extra, extraSize);
+	used += header.size;
+	count++;
+}
+
+void CommandBuffer::SetVertexShader(const void* shader, const void* inputLayout)
+{
+	Write(CommandType::SetVertexShader, ShaderStage::Vertex, 0, ShaderData{ shader, inputLayout });
+}
+
+void CommandBuffer::SetPixelShader(const void* shader)
+{
+	Write(CommandType::SetPixelShader, ShaderStage::Pixel, 0, ShaderData{ shader, nullptr });
+}
+
+void CommandBuffer::SetVertexBuffer(uint32_t slot, const void* buffer, uint32_t stride, uint32_t offset)
+{
+	Write(CommandType::SetVertexBuffer, ShaderStage::Vertex, slot, VertexBufferData{ buffer, stride, offset });
+}
+
+void CommandBuffer::SetIndexBuffer(const void* buffer)
+{
+	Write(CommandType::SetIndexBuffer, ShaderStage::Vertex, 0, BindData{ buffer });
+}
+
+void CommandBuffer::UpdateConstants(const void* buffer, const void* data, uint32_t size)
+{
+	Write(CommandType::UpdateConstants, ShaderStage::Vertex, 0, UpdateData{ buffer, size, 0 }, data, size);
+}
+
+void CommandBuffer::SetConstantBuffer(ShaderStage stage, uint32_t slot, const void* buffer)
+{
+	Write(CommandType::SetConstantBuffer, stage, slot, BindData{ buffer });
+}
+
+void CommandBuffer::SetShaderResource(ShaderStage stage, uint32_t slot, const void* view)
+{
+	Write(CommandType::SetShaderResource, stage, slot, BindData{ view });
+}
+
+void CommandBuffer::SetSampler(ShaderStage stage, uint32_t slot, const void* sampler)
+{
+	Write(CommandType::SetSampler, stage, slot, BindData{ sampler });
+}
+
+void CommandBuffer::UpdateBuffer(const void* buffer, const void* data, uint32_t size)
+{
+	Write(CommandType::UpdateBuffer, ShaderStage::Vertex, 0, UpdateData{ buffer, size, 0 }, data, size);
+}
+
+void CommandBuffer::DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+{
+	Write(CommandType::DrawIndexed, ShaderStage::Vertex, 0, DrawIndexedData{ indexCount, firstIndex, baseVertex });
+}
+
+void CommandBuffer::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance)
+{
+	Write(CommandType::DrawIndexedInstanced, ShaderStage::Vertex, 0,
+		DrawInstancedData{ indexCount, instanceCount, firstIndex, baseVertex, firstInstance });
+}
+
+void CommandBuffer::Clear()
+{
+	used = 0;
+	count = 0;
+}
+
+void CommandBuffer::Append(const CommandBuffer& other)
+{
+	if (other.used == 0) return;
+	if (used + other.used > bytes.size())
+		bytes.resize((std::max)(bytes.size() * 2, used + other.used));
+	memcpy(bytes.data() + used, other.bytes.data(), other.used);
+	used += other.used;
+	count += other.count;
+}
+
+// ====== Null ===============
+
+void NullCommandBackend::Execute(const CommandBuffer& commands)
+{
+	commands.ForEach([&](const CommandBuffer::Header& header, const uint8_t*) {
+		if ((size_t)header.type < (size_t)CommandType::Count) counts[(size_t)header.type]++;
+		total++;
+	});
+	bytes += commands.GetSize();
+}
+
+void NullCommandBackend::Reset()
+{
+	*this = NullCommandBackend();
+}
+
+// ====== Validation =========
+
+void ValidationCommandBackend::Execute(const CommandBuffer& buffer)
+{
+	buffer.ForEach([&](const CommandBuffer::Header& header, const uint8_t* payload) {
+		uint64_t command = commands++;
+		if ((size_t)header.type >= (size_t)CommandType::Count) {
+			Error(command, "unknown command type");
+			return;
+		}
+
+		size_t payloadSize = PAYLOAD_SIZES[(size_t)header.type];
+		if (header.type == CommandType::UpdateConstants || header.type == CommandType::UpdateBuffer)
+			payloadSize += CommandBuffer::Read<CommandBuffer::UpdateData>(payload).size;
+		if (header.size != Align8(sizeof(CommandBuffer::Header) + payloadSize)) {
+			Error(command, "packet size doesn't match its type");
+			return;
+		}
+
+		switch (header.type) {
+		case CommandType::SetVertexShader: {
+			auto data = CommandBuffer::Read<CommandBuffer::ShaderData>(payload);
+			vertexShader = data.shader;
+			inputLayout = data.inputLayout;
+			break;
+		}
+		case CommandType::SetPixelShader:
+			pixelShader = CommandBuffer::Read<CommandBuffer::ShaderData>(payload).shader;
+			break;
+		case CommandType::SetVertexBuffer: {
+			auto data = CommandBuffer::Read<CommandBuffer::VertexBufferData>(payload);
+			if (header.slot >= MAX_VERTEX_BUFFERS) { Error(command, "vertex buffer slot out of range"); break; }
+			if (data.buffer && data.stride == 0) Error(command, "vertex buffer with no stride");
+			vertexBuffers[header.slot] = data.buffer;
+			vertexStrides[header.slot] = data.stride;
+			break;
+		}
+		case CommandType::SetIndexBuffer:
+			indexBuffer = CommandBuffer::Read<CommandBuffer::BindData>(payload).resource;
+			break;
+		case CommandType::UpdateConstants: {
+			auto data = CommandBuffer::Read<CommandBuffer::UpdateData>(payload);
+			if (!data.buffer) { Error(command, "constant update with no buffer"); break; }
+			if (data.size == 0 || data.size % 16 != 0) Error(command, "constant update size isn't a multiple of 16");
+			bool known = false;
+			for (auto& [constantBuffer, size] : constantSizes) {
+				if (constantBuffer != data.buffer) continue;
+				if (size != data.size) Error(command, "constant update size changed for a buffer");
+				known = true;
+				break;
+			}
+			if (!known) constantSizes.push_back({ data.buffer, data.size });
+			break;
+		}
+		case CommandType::SetConstantBuffer:
+			if (header.slot >= MAX_CONSTANT_BUFFERS) Error(command, "constant buffer slot out of range");
+			break;
+		case CommandType::SetShaderResource:
+			if (header.slot >= MAX_SHADER_RESOURCES) Error(command, "shader resource slot out of range");
+			break;
+		case CommandType::SetSampler:
+			if (header.slot >= MAX_SAMPLERS) Error(command, "sampler slot out of range");
+			break;
+		case CommandType::UpdateBuffer: {
+			auto data = CommandBuffer::Read<CommandBuffer::UpdateData>(payload);
+			if (!data.buffer || data.size == 0) Error(command, "buffer update with no buffer or data");
+			break;
+		}
+		case CommandType::DrawIndexed: {
+			auto data = CommandBuffer::Read<CommandBuffer::DrawIndexedData>(payload);
+			if (CheckDraw(command, false) && data.indexCount == 0) Error(command, "draw with no indices");
+			draws++;
+			break;
+		}
+		case CommandType::DrawIndexedInstanced: {
+			auto data = CommandBuffer::Read<CommandBuffer::DrawInstancedData>(payload);
+			if (CheckDraw(command, true) && (data.indexCount == 0 || data.instanceCount == 0))
+				Error(command, "instanced draw with no indices or instances");
+			draws++;
+			break;
+		}
+		default:
+			break;
+		}
+	});
+}
+
+bool ValidationCommandBackend::CheckDraw(uint64_t command, bool instanced)
+{
+	const char* missing = nullptr;
+	if (!vertexShader) missing = "draw with no vertex shader";
+	else if (!inputLayout) missing = "draw with no input layout";
+	else if (!pixelShader) missing = "draw with no pixel shader";
+	else if (!vertexBuffers[0]) missing = "draw with no vertex buffer";
+	else if (!indexBuffer) missing = "draw with no index buffer";
+	else if (instanced && !vertexBuffers[1]) missing = "instanced draw with no instance buffer";
+	if (missing) Error(command, missing);
+	return !missing;
+}
+
+void ValidationCommandBackend::Error(uint64_t command, const char* what)
+{
+	errorCount++;
+	if (errors.size() < MAX_ERRORS) errors.push_back("command " + std::to_string(command) + ": " + what);
+}
+
+void ValidationCommandBackend::Reset()
+{
+	*this = ValidationCommandBackend();
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class CommandType : uint8_t
+{
+	SetVertexShader,
+	SetPixelShader,
+	SetVertexBuffer,
+	SetIndexBuffer,
+	UpdateConstants,
+	SetConstantBuffer,
+	SetShaderResource,
+	SetSampler,
+	UpdateBuffer,
+	DrawIndexed,
+	DrawIndexedInstanced,
+	Count
+};
+
+enum class ShaderStage : uint8_t
+{
+	Vertex,
+	Pixel
+};
+
+// --------------------------------------------------------
+// Draw, bind and constant update packets written back to back
+// into one block of memory, kept between frames, so recording
+// a command is an append with no allocation of its own
+// - Handles are whatever the backend binds (ID3D11 objects for
+//   D3D11CommandBackend), the buffer never looks at them
+// - Update packets carry a copy of their data, recording never
+//   touches the buffers it ends up in
+// - Any thread can record into its own buffer, Append() then
+//   joins them in order for a backend to Execute()
+// --------------------------------------------------------
+class CommandBuffer
+{
+public:
+	// every packet starts with one, "size" covers the header and
+	// payload and keeps the next packet 8 byte aligned
+	struct Header
+	{
+		CommandType type;
+		ShaderStage stage;		// binds to a shader stage
+		uint16_t slot;			// binds to a slot
+		uint32_t size;
+	};
+
+	// payloads, after the header
+	struct ShaderData { const void* shader; const void* inputLayout; };		// pixel shaders have no layout
+	struct VertexBufferData { const void* buffer; uint32_t stride; uint32_t offset; };
+	struct BindData { const void* resource; };								// index, constant buffers, SRVs, samplers
+	struct UpdateData { const void* buffer; uint32_t size; uint32_t padding; };	// "size" bytes follow
+	struct DrawIndexedData { uint32_t indexCount; uint32_t firstIndex; int32_t baseVertex; };
+	struct DrawInstancedData { uint32_t indexCount; uint32_t instanceCount; uint32_t firstIndex; int32_t baseVertex; uint32_t firstInstance; };
+
+	void SetVertexShader(const void* shader, const void* inputLayout);
+	void SetPixelShader(const void* shader);
+	void SetVertexBuffer(uint32_t slot, const void* buffer, uint32_t stride, uint32_t offset = 0);
+	void SetIndexBuffer(const void* buffer);	// 32 bit indices
+
+	// copies "data" into a constant buffer, all of it
+	void UpdateConstants(const void* buffer, const void* data, uint32_t size);
+	void SetConstantBuffer(ShaderStage stage, uint32_t slot, const void* buffer);
+	void SetShaderResource(ShaderStage stage, uint32_t slot, const void* view);
+	void SetSampler(ShaderStage stage, uint32_t slot, const void* sampler);
+
+	// replaces the start of a dynamic buffer, the rest is undefined after
+	void UpdateBuffer(const void* buffer, const void* data, uint32_t size);
+
+	void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance);
+
+	// Empties the buffer, keeping its memory
+	void Clear();
+
+	// Adds a copy of "other"'s commands after these
+	void Append(const CommandBuffer& other);
+
+	uint32_t GetCount() const { return count; }
+	size_t GetSize() const { return used; }
+	const uint8_t* GetData() const { return bytes.data(); }
+
+	// Calls fn(header, payload) for each command in order
+	template<typename Fn>
+	void ForEach(Fn fn) const
+	{
+		for (size_t at = 0; at < used;) {
+			Header header;
+			memcpy(&header, bytes.data() + at, sizeof(Header));
+			fn(header, bytes.data() + at + sizeof(Header));
+			at += header.size;
+		}
+	}
+
+	// A payload as its struct, wherever it sits
+	template<typename T>
+	static T Read(const uint8_t* payload)
+	{
+		T value;
+		memcpy(&value, payload, sizeof(T));
+		return value;
+	}
+
+private:
+	std::vector<uint8_t> bytes;	// grows, never shrinks
+	size_t used = 0;
+	uint32_t count = 0;
+
+	template<typename T>
+	void Write(CommandType type, ShaderStage stage, uint32_t slot, const T& payload, const void* extra = nullptr, uint32_t extraSize = 0);
+};
+
+// --------------------------------------------------------
+// Something that runs a CommandBuffer
+// --------------------------------------------------------
+class CommandBackend
+{
+public:
+	virtual ~CommandBackend() = default;
+	virtual const char* GetName() const = 0;
+	virtual void Execute(const CommandBuffer& commands) = 0;
+};
+
+// --------------------------------------------------------
+// Runs nothing, only counts, to time recording on its own
+// --------------------------------------------------------
+class NullCommandBackend : public CommandBackend
+{
+public:
+	const char* GetName() const override { return "Null"; }
+	void Execute(const CommandBuffer& commands) override;
+
+	void Reset();
+	uint64_t GetCount(CommandType type) const { return counts[(size_t)type]; }
+	uint64_t GetTotal() const { return total; }
+	uint64_t GetBytes() const { return bytes; }
+
+private:
+	uint64_t counts[(size_t)CommandType::Count] = {};
+	uint64_t total = 0;
+	uint64_t bytes = 0;
+};
+
+// --------------------------------------------------------
+// Tracks what's bound the way a device would and reports
+// commands that would go wrong, without a device
+// - Draws need shaders, an input layout and the vertex and
+//   index buffers, instanced ones a buffer in slot 1 too
+// - Constant updates need a size that's a multiple of 16 and
+//   the same every time for one buffer
+// - Packets have to be the size their type says
+// - State carries over between Execute() calls until Reset()
+// --------------------------------------------------------
+class ValidationCommandBackend : public CommandBackend
+{
+public:
+	static constexpr uint32_t MAX_VERTEX_BUFFERS = 32;
+	static constexpr uint32_t MAX_CONSTANT_BUFFERS = 14;
+	static constexpr uint32_t MAX_SHADER_RESOURCES = 128;
+	static constexpr uint32_t MAX_SAMPLERS = 16;
+	static constexpr size_t MAX_ERRORS = 100;	// more are counted, not kept
+
+	const char* GetName() const override { return "Validation"; }
+	void Execute(const CommandBuffer& commands) override;
+
+	void Reset();
+	uint64_t GetCommands() const { return commands; }
+	uint64_t GetDraws() const { return draws; }
+	uint64_t GetErrorCount() const { return errorCount; }
+	const std::vector<std::string>& GetErrors() const { return errors; }
+
+private:
+	const void* vertexShader = nullptr;
+	const void* inputLayout = nullptr;
+	const void* pixelShader = nullptr;
+	const void* indexBuffer = nullptr;
+	const void* vertexBuffers[MAX_VERTEX_BUFFERS] = {};
+	uint32_t vertexStrides[MAX_VERTEX_BUFFERS] = {};
+	std::vector<std::pair<const void*, uint32_t>> constantSizes;
+
+	uint64_t commands = 0;
+	uint64_t draws = 0;
+	uint64_t errorCount = 0;
+	std::vector<std::string> errors;
+
+	void Error(uint64_t command, const char* what);
+	bool CheckDraw(uint64_t command, bool instanced);
+};
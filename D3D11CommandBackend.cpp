@@ -0,0 +1,78 @@
+#include "D3D11CommandBackend.h"
+#include "Graphics.h"
+#include "StateCache.h"
+
+#include <cstring>
+
+namespace
+{
+	// handles back to what the commands were recorded with
+	template<typename T>
+	T* As(const void* handle)
+	{
+		return static_cast<T*>(const_cast<void*>(handle));
+	}
+}
+
+void D3D11CommandBackend::Execute(const CommandBuffer& commands)
+{
+	ID3D11DeviceContext* context = Graphics::Context.Get();
+
+	commands.ForEach([&](const CommandBuffer::Header& header, const uint8_t* payload) {
+		switch (header.type) {
+		case CommandType::SetVertexShader: {
+			auto data = CommandBuffer::Read<CommandBuffer::ShaderData>(payload);
+			StateCache::SetVertexShader(As<ID3D11VertexShader>(data.shader), As<ID3D11InputLayout>(data.inputLayout));
+			break;
+		}
+		case CommandType::SetPixelShader:
+			StateCache::SetPixelShader(As<ID3D11PixelShader>(CommandBuffer::Read<CommandBuffer::ShaderData>(payload).shader));
+			break;
+		case CommandType::SetVertexBuffer: {
+			auto data = CommandBuffer::Read<CommandBuffer::VertexBufferData>(payload);
+			StateCache::SetVertexBuffer(header.slot, As<ID3D11Buffer>(data.buffer), data.stride, data.offset);
+			break;
+		}
+		case CommandType::SetIndexBuffer:
+			StateCache::SetIndexBuffer(As<ID3D11Buffer>(CommandBuffer::Read<CommandBuffer::BindData>(payload).resource));
+			break;
+		case CommandType::UpdateConstants: {
+			auto data = CommandBuffer::Read<CommandBuffer::UpdateData>(payload);
+			context->UpdateSubresource(As<ID3D11Buffer>(data.buffer), 0, 0, payload + sizeof(data), 0, 0);
+			break;
+		}
+		case CommandType::SetConstantBuffer:
+			StateCache::SetConstantBuffer(header.stage, header.slot, As<ID3D11Buffer>(CommandBuffer::Read<CommandBuffer::BindData>(payload).resource));
+			break;
+		case CommandType::SetShaderResource:
+			StateCache::SetShaderResource(header.stage, header.slot,
+				As<ID3D11ShaderResourceView>(CommandBuffer::Read<CommandBuffer::BindData>(payload).resource));
+			break;
+		case CommandType::SetSampler:
+			StateCache::SetSampler(header.stage, header.slot, As<ID3D11SamplerState>(CommandBuffer::Read<CommandBuffer::BindData>(payload).resource));
+			break;
+		case CommandType::UpdateBuffer: {
+			auto data = CommandBuffer::Read<CommandBuffer::UpdateData>(payload);
+			ID3D11Buffer* buffer = As<ID3D11Buffer>(data.buffer);
+			D3D11_MAPPED_SUBRESOURCE mapped = {};
+			if (SUCCEEDED(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+				memcpy(mapped.pData, payload + sizeof(data), data.size);
+				context->Unmap(buffer, 0);
+			}
+			break;
+		}
+		case CommandType::DrawIndexed: {
+			auto data = CommandBuffer::Read<CommandBuffer::DrawIndexedData>(payload);
+			context->DrawIndexed(data.indexCount, data.firstIndex, data.baseVertex);
+			break;
+		}
+		case CommandType::DrawIndexedInstanced: {
+			auto data = CommandBuffer::Read<CommandBuffer::DrawInstancedData>(payload);
+			context->DrawIndexedInstanced(data.indexCount, data.instanceCount, data.firstIndex, data.baseVertex, data.firstInstance);
+			break;
+		}
+		default:
+			break;
+		}
+	});
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "CommandBuffer.h"
+
+// --------------------------------------------------------
+// Runs a CommandBuffer on Graphics::Context, reading each
+// handle as the ID3D11 object its command binds
+// - Binds go through the StateCache, so ones that match what's
+//   bound are dropped
+// - Constant updates go through UpdateSubresource() the way
+//   SimpleShader's do, buffer updates Map() with discard
+// --------------------------------------------------------
+class D3D11CommandBackend : public CommandBackend
+{
+public:
+	const char* GetName() const override { return "D3D11"; }
+	void Execute(const CommandBuffer& commands) override;
+};
@@ -0,0 +1,127 @@
+#include "EntityLights.h"
+
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// a light's reach, worked out once rather than per entity
+	struct Reach
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 direction;		// spot lights, normalized
+		float range;
+		float cosAngle;
+		float sinAngle;
+		float brightness;		// intensity times the color's luminance
+		int type;
+	};
+
+	Reach MakeReach(const Light& light)
+	{
+		Reach reach = {};
+		reach.position = light.Position;
+		reach.range = light.Range;
+		reach.type = light.Type;
+		reach.brightness = light.Intensity *
+			(0.2126f * light.Color.x + 0.7152f * light.Color.y + 0.0722f * light.Color.z);
+		if (light.Type == LIGHT_TYPE_SPOT) {
+			XMStoreFloat3(&reach.direction, XMVector3Normalize(XMLoadFloat3(&light.Direction)));
+			float angle = fminf(light.SpotOuterAngle, XM_PIDIV2);
+			reach.cosAngle = cosf(angle);
+			reach.sinAngle = sinf(angle);
+		}
+		return reach;
+	}
+
+	float EstimateReach(const Reach& reach, const XMFLOAT3& center, float radius)
+	{
+		if (reach.brightness <= 0) return 0;
+		if (reach.type == LIGHT_TYPE_DIRECTIONAL) return reach.brightness;
+
+		float vx = center.x - reach.position.x;
+		float vy = center.y - reach.position.y;
+		float vz = center.z - reach.position.z;
+		float lengthSq = vx * vx + vy * vy + vz * vz;
+		float reachSq = (reach.range + radius) * (reach.range + radius);
+		if (lengthSq >= reachSq) return 0;
+		float length = sqrtf(lengthSq);
+
+		// cone against the sphere (Wronski, "Cull that cone!")
+		if (reach.type == LIGHT_TYPE_SPOT) {
+			float along = vx * reach.direction.x + vy * reach.direction.y + vz * reach.direction.z;
+			float closest = reach.cosAngle * sqrtf(fmaxf(lengthSq - along * along, 0.0f)) - along * reach.sinAngle;
+			if (closest > radius || along < -radius) return 0;
+		}
+
+		// Attenuate() from Lighting.hlsli at the sphere's nearest point
+		float distance = fmaxf(length - radius, 0.0f);
+		float falloff = 1.0f - distance * distance / (reach.range * reach.range);
+		falloff = fmaxf(falloff, 0.0f);
+		return reach.brightness * falloff * falloff;
+	}
+}
+
+float EntityLights::Estimate(const Light& light, const XMFLOAT3& center, float radius)
+{
+	return EstimateReach(MakeReach(light), center, radius);
+}
+
+EntityLights::Stats EntityLights::Assign(const FrustumCulling::Spheres& bounds, const std::vector<uint32_t>& entities,
+	const Light* lights, size_t lightCount, uint32_t maxPerEntity, uint32_t pinned, Lists& out)
+{
+	auto start = std::chrono::steady_clock::now();
+	Stats stats = {};
+	stats.entities = (uint32_t)entities.size();
+	stats.lights = (uint32_t)lightCount;
+
+	std::vector<Reach> reaches(lightCount);
+	for (size_t l = 0; l < lightCount; l++) reaches[l] = MakeReach(lights[l]);
+
+	out.stride = maxPerEntity;
+	out.counts.assign(bounds.Size(), 0);
+	out.indices.resize(bounds.Size() * maxPerEntity);
+
+	// the brightest so far, kept sorted by insertion - lists are short
+	std::vector<float> best(maxPerEntity);
+	for (uint32_t e : entities) {
+		XMFLOAT3 center(bounds.x[e], bounds.y[e], bounds.z[e]);
+		float radius = bounds.radius[e];
+		uint32_t* list = out.indices.data() + (size_t)e * maxPerEntity;
+		uint32_t count = 0;
+		if (pinned < lightCount && maxPerEntity > 0) {
+			best[0] = FLT_MAX;
+			list[count++] = pinned;
+		}
+
+		for (uint32_t l = 0; l < (uint32_t)lightCount; l++) {
+			if (l == pinned) continue;
+			float estimate = EstimateReach(reaches[l], center, radius);
+			if (estimate <= 0) continue;
+
+			// ties keep index order
+			if (count == maxPerEntity) {
+				stats.dropped++;
+				if (maxPerEntity == 0 || estimate <= best[count - 1]) continue;
+				count--;
+			}
+			uint32_t slot = count++;
+			for (; slot > 0 && best[slot - 1] < estimate; slot--) {
+				best[slot] = best[slot - 1];
+				list[slot] = list[slot - 1];
+			}
+			best[slot] = estimate;
+			list[slot] = l;
+		}
+
+		out.counts[e] = count;
+		stats.assigned += count;
+	}
+
+	stats.tests = (uint64_t)entities.size() * lightCount;
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "FrustumCulling.h"
+#include "Lights.h"
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Per entity light lists - each entity's bounding sphere is
+// tested against every light's reach (a sphere for point
+// lights, a cone for spot lights, everything for directional
+// ones) and keeps the brightest few, so its draw only passes
+// those to the pixel shader
+// - Brightness is an estimate at the sphere's nearest point,
+//   with the shaders' range falloff and no angle or normal
+// --------------------------------------------------------
+namespace EntityLights
+{
+	struct Lists
+	{
+		uint32_t stride = 0;			// most lights one entity gets
+		std::vector<uint32_t> counts;	// per entity, 0 for any not assigned
+		std::vector<uint32_t> indices;	// into the lights, entity i's start at i * stride
+
+		const uint32_t* Get(size_t entity) const { return indices.data() + entity * stride; }
+	};
+
+	struct Stats
+	{
+		uint32_t entities;
+		uint32_t lights;
+		uint64_t tests;			// entity and light pairs looked at
+		uint32_t assigned;		// lights across every list
+		uint32_t dropped;		// reached an entity whose list was full
+		double ms;
+	};
+
+	// How much of "light" could reach a sphere, 0 when none can
+	float Estimate(const Light& light, const DirectX::XMFLOAT3& center, float radius);
+
+	// Lists for "entities" (indices into "bounds", and into the lists),
+	// brightest estimate first and at most "maxPerEntity" long
+	// - "pinned" always goes first, reaching or not, for the shadow casting
+	//   light the shaders expect in slot 0 (UINT32_MAX for none)
+	Stats Assign(const FrustumCulling::Spheres& bounds, const std::vector<uint32_t>& entities,
+		const Light* lights, size_t lightCount, uint32_t maxPerEntity, uint32_t pinned, Lists& out);
+}
@@ -0,0 +1,116 @@
+#include "FrustumCulling.h"
+#include "SimdLanes.h"
+
+#include <bit>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// whole blocks of spheres, returns how many it got through
+	template<class Lanes>
+	size_t CullBlocks(const FrustumCulling::Planes& planes, const FrustumCulling::Spheres& spheres, std::vector<uint32_t>& visible)
+	{
+		using Float = typename Lanes::Float;
+		constexpr uint32_t W = Lanes::WIDTH;
+
+		Float px[6], py[6], pz[6], pw[6];
+		for (int p = 0; p < 6; p++) {
+			px[p] = Lanes::Set(planes.planes[p].x);
+			py[p] = Lanes::Set(planes.planes[p].y);
+			pz[p] = Lanes::Set(planes.planes[p].z);
+			pw[p] = Lanes::Set(planes.planes[p].w);
+		}
+
+		size_t blocks = spheres.Size() / W * W;
+		for (size_t first = 0; first < blocks; first += W) {
+			Float x = Lanes::Load(&spheres.x[first]);
+			Float y = Lanes::Load(&spheres.y[first]);
+			Float z = Lanes::Load(&spheres.z[first]);
+			Float r = Lanes::Load(&spheres.radius[first]);
+
+			// inside if no plane has the sphere entirely behind it,
+			// so only the nearest miss matters
+			Float nearest = Lanes::Set(FLT_MAX);
+			for (int p = 0; p < 6; p++) {
+				Float distance = Lanes::Add(Lanes::Add(Lanes::Mul(x, px[p]), Lanes::Mul(y, py[p])),
+					Lanes::Add(Lanes::Mul(z, pz[p]), pw[p]));
+				nearest = Lanes::Min(nearest, Lanes::Add(distance, r));
+			}
+
+			unsigned int mask = (unsigned int)Lanes::MoveMask(Lanes::GreaterEqual(nearest, Lanes::Set(0.0f)));
+			for (; mask; mask &= mask - 1)
+				visible.push_back((uint32_t)(first + std::countr_zero(mask)));
+		}
+		return blocks;
+	}
+}
+
+void FrustumCulling::Spheres::Resize(size_t count)
+{
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	radius.resize(count);
+}
+
+void FrustumCulling::Spheres::Set(size_t i, const XMFLOAT3& localCenter, float localRadius, const XMFLOAT4X4& world)
+{
+	XMMATRIX mWorld = XMLoadFloat4x4(&world);
+	XMFLOAT3 center;
+	XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&localCenter), mWorld));
+	float scale = XMVectorGetX(XMVectorMax(XMVector3LengthSq(mWorld.r[0]),
+		XMVectorMax(XMVector3LengthSq(mWorld.r[1]), XMVector3LengthSq(mWorld.r[2]))));
+
+	x[i] = center.x;
+	y[i] = center.y;
+	z[i] = center.z;
+	radius[i] = localRadius * sqrtf(scale);
+}
+
+FrustumCulling::Planes FrustumCulling::ExtractPlanes(const XMFLOAT4X4& m)
+{
+	// Gribb/Hartmann, combinations of the matrix's columns
+	XMVECTOR col0 = XMVectorSet(m._11, m._21, m._31, m._41);
+	XMVECTOR col1 = XMVectorSet(m._12, m._22, m._32, m._42);
+	XMVECTOR col2 = XMVectorSet(m._13, m._23, m._33, m._43);
+	XMVECTOR col3 = XMVectorSet(m._14, m._24, m._34, m._44);
+	XMVECTOR planes[6] = { col3 + col0, col3 - col0, col3 + col1, col3 - col1, col2, col3 - col2 };
+
+	Planes result;
+	for (int p = 0; p < 6; p++) XMStoreFloat4(&result.planes[p], XMPlaneNormalize(planes[p]));
+	return result;
+}
+
+FrustumCulling::Planes FrustumCulling::ExtractCasterPlanes(const XMFLOAT4X4& lightViewProjection, float reach)
+{
+	// the near plane is normalized, so w is in world units
+	Planes result = ExtractPlanes(lightViewProjection);
+	result.planes[4].w += reach;
+	return result;
+}
+
+FrustumCulling::CullStats FrustumCulling::Cull(const Planes& planes, const Spheres& spheres, std::vector<uint32_t>& visible, bool avx)
+{
+	auto start = std::chrono::steady_clock::now();
+	visible.clear();
+
+	// the last few that don't fill a block
+	size_t first = avx ? CullBlocks<AVXLanes>(planes, spheres, visible) : CullBlocks<SSELanes>(planes, spheres, visible);
+	for (size_t i = first; i < spheres.Size(); i++) {
+		bool inside = true;
+		for (const XMFLOAT4& p : planes.planes)
+			inside &= p.x * spheres.x[i] + p.y * spheres.y[i] + p.z * spheres.z[i] + p.w + spheres.radius[i] >= 0.0f;
+		if (inside) visible.push_back((uint32_t)i);
+	}
+
+	CullStats stats = {};
+	stats.tested = (uint32_t)spheres.Size();
+	stats.visible = (uint32_t)visible.size();
+	stats.culled = stats.tested - stats.visible;
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// View frustum culling of world space bounding spheres
+// - Planes come straight out of a view-projection matrix, so
+//   perspective and orthographic cameras work the same way
+// - Spheres are kept as structure of arrays and tested 4 (SSE)
+//   or 8 (AVX) at a time against all six planes
+// --------------------------------------------------------
+namespace FrustumCulling
+{
+	// left, right, bottom, top, near, far - normalized, a point p
+	// is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+	struct Planes
+	{
+		DirectX::XMFLOAT4 planes[6];
+	};
+
+	struct Spheres
+	{
+		std::vector<float> x, y, z, radius;
+
+		void Resize(size_t count);
+		size_t Size() const { return x.size(); }
+
+		// world space bounds of a mesh's local sphere under "world",
+		// the radius grows by the largest axis scale
+		void Set(size_t i, const DirectX::XMFLOAT3& localCenter, float localRadius, const DirectX::XMFLOAT4X4& world);
+	};
+
+	struct CullStats
+	{
+		uint32_t tested;
+		uint32_t visible;
+		uint32_t culled;
+		double ms;
+	};
+
+	// Frustum of row vector view-projection (or world-view-projection,
+	// giving planes in that object's space), D3D clip z is [0, w]
+	Planes ExtractPlanes(const DirectX::XMFLOAT4X4& viewProjection);
+
+	// ExtractPlanes() of an orthographic light with its near plane moved
+	// "reach" world units back toward the light, so casters in front of
+	// the shadow map still count (they need depth clamping to land in it
+	// rather than being clipped) and ones further back than that don't
+	Planes ExtractCasterPlanes(const DirectX::XMFLOAT4X4& lightViewProjection, float reach);
+
+	// Fills "visible" with the indices of the spheres that touch the
+	// frustum, in increasing order
+	// - "avx" needs TransformSystem::IsAVXSupported()
+	CullStats Cull(const Planes& planes, const Spheres& spheres, std::vector<uint32_t>& visible, bool avx);
+}
@@ -7,6 +7,15 @@
 #include "Lights.h"
 #include "Mesh.h"
 #include "Material.h"
+#include "ObjectMatrices.h"
+#include "FrustumCulling.h"
+#include "ShadowCascades.h"
+#include "LightClusters.h"
+#include "EntityLights.h"
+#include "RenderQueue.h"
+#include "Instancing.h"
+#include "ParallelFor.h"
+#include "StateCache.h"
 
 // ImGui & simple shaders includes
 #include "ImGui/imgui.h"
@@ -19,6 +28,9 @@
 #include <WICTextureLoader.h>
 #include <memory>
 #include <format>
+#include <chrono>
+#include <random>
+#include <thread>
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
@@ -100,11 +112,11 @@ Game::~Game()
 void Game::CreateShadowMapResources()
 {
 	// describe and create shadowmap
-	// Create the actual texture that will be the shadow map
+	// Create the actual texture that will be the shadow map, a slice per cascade
 	D3D11_TEXTURE2D_DESC shadowDesc = {};
 	shadowDesc.Width = shadowMapResolution; // Ideally a power of 2 (like 1024)
 	shadowDesc.Height = shadowMapResolution; // Ideally a power of 2 (like 1024)
-	shadowDesc.ArraySize = 1;
+	shadowDesc.ArraySize = ShadowCascades::MAX_CASCADES;
 	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	shadowDesc.CPUAccessFlags = 0;
 	shadowDesc.Format = DXGI_FORMAT_R32_TYPELESS;
@@ -113,37 +125,65 @@ void Game::CreateShadowMapResources()
 	shadowDesc.SampleDesc.Count = 1;
 	shadowDesc.SampleDesc.Quality = 0;
 	shadowDesc.Usage = D3D11_USAGE_DEFAULT;
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
-	Graphics::Device->CreateTexture2D(&shadowDesc, 0, shadowTexture.GetAddressOf());
+	Graphics::Device->CreateTexture2D(&shadowDesc, 0, shadowTexture.ReleaseAndGetAddressOf());
+
+	// the same again for static casters only, copied under the dynamic ones
+	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	Graphics::Device->CreateTexture2D(&shadowDesc, 0, staticShadowTexture.ReleaseAndGetAddressOf());
 
-	// Create the depth/stencil view
+	// Create the depth/stencil views, one per slice
 	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
 	shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	shadowDSDesc.Texture2D.MipSlice = 0;
-	Graphics::Device->CreateDepthStencilView(
-		shadowTexture.Get(),
-		&shadowDSDesc,
-		shadowDSV.GetAddressOf());
+	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+	shadowDSDesc.Texture2DArray.MipSlice = 0;
+	shadowDSDesc.Texture2DArray.ArraySize = 1;
+	for (UINT c = 0; c < ShadowCascades::MAX_CASCADES; c++) {
+		shadowDSDesc.Texture2DArray.FirstArraySlice = c;
+		Graphics::Device->CreateDepthStencilView(
+			shadowTexture.Get(),
+			&shadowDSDesc,
+			shadowDSVs[c].ReleaseAndGetAddressOf());
+		Graphics::Device->CreateDepthStencilView(
+			staticShadowTexture.Get(),
+			&shadowDSDesc,
+			staticShadowDSVs[c].ReleaseAndGetAddressOf());
+	}
+
+	// nothing cached survives new textures
+	shadowCacheValid = false;
 
-	// Create the SRV for the shadow map
+	// Create the SRV for the shadow map, all slices for the shaders
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = ShadowCascades::MAX_CASCADES;
+	Graphics::Device->CreateShaderResourceView(
+		shadowTexture.Get(),
+		&srvDesc,
+		shadowSRV.ReleaseAndGetAddressOf());
+
+	// ImGui only takes plain 2D textures, so one slice is copied out to show
+	shadowDesc.ArraySize = 1;
+	shadowDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	Graphics::Device->CreateTexture2D(&shadowDesc, 0, shadowPreviewTexture.ReleaseAndGetAddressOf());
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Texture2D.MipLevels = 1;
 	srvDesc.Texture2D.MostDetailedMip = 0;
 	Graphics::Device->CreateShaderResourceView(
-		shadowTexture.Get(),
+		shadowPreviewTexture.Get(),
 		&srvDesc,
-		shadowSRV.GetAddressOf());
+		shadowPreviewSRV.ReleaseAndGetAddressOf());
 
 	D3D11_RASTERIZER_DESC shadowRastDesc = {};
 	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
 	shadowRastDesc.CullMode = D3D11_CULL_BACK;
-	shadowRastDesc.DepthClipEnable = true;
+	shadowRastDesc.DepthClipEnable = false; // casters in front of the near plane clamp to it, see ExtractCasterPlanes()
 	shadowRastDesc.DepthBias = 1000; // Min. precision units, not world units!
 	shadowRastDesc.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
-	Graphics::Device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
+	shadowRasterizer = StateCache::GetRasterizerState(shadowRastDesc);
 
 	D3D11_SAMPLER_DESC shadowSampDesc = {};
 	shadowSampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
@@ -152,7 +192,7 @@ void Game::CreateShadowMapResources()
 	shadowSampDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
 	shadowSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
 	shadowSampDesc.BorderColor[0] = 1.0f; // Only need the first component
-	Graphics::Device->CreateSamplerState(&shadowSampDesc, &shadowSampler);
+	shadowSampler = StateCache::GetSamplerState(shadowSampDesc);
 }
 
 // --------------------------------------------------------
@@ -169,7 +209,7 @@ void Game::CreateGeometry()
 	dscSampler.Filter = D3D11_FILTER_ANISOTROPIC;
 	dscSampler.MaxAnisotropy = 16;
 	dscSampler.MaxLOD = D3D11_FLOAT32_MAX;
-	Graphics::Device->CreateSamplerState(&dscSampler, sampler.GetAddressOf());
+	sampler = StateCache::GetSamplerState(dscSampler);
 
 	// load textures, make entities
 	{
@@ -199,12 +239,16 @@ void Game::CreateGeometry()
 		LoadTexture(L"Base/flat_normals.png", flatNSRV);
 
 		// load meshes
+		// - the cube stays full precision since the sky draws it with SkyVS
+		MeshLoadOptions packed;
+		packed.packVertices = true;
+		packed.buildMeshlets = true;
 		std::shared_ptr<Mesh> cube, cylinder, helix, sphere, torus, quad, quad_double_sided;
 		cube = MeshHelper("cube");
-		cylinder = MeshHelper("cylinder");
-		helix = MeshHelper("helix");
-		sphere = MeshHelper("sphere");
-		torus = MeshHelper("torus");
+		cylinder = MeshHelper("cylinder", packed);
+		helix = MeshHelper("helix", packed);
+		sphere = MeshHelper("sphere", packed);
+		torus = MeshHelper("torus", packed);
 		quad = MeshHelper("quad");
 		quad_double_sided = MeshHelper("quad_double_sided");
 
@@ -215,6 +259,17 @@ void Game::CreateGeometry()
 		skyVS = VSHelper(L"SkyVS.cso");
 		shadowVS = std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, FixPath(L"ShadowMapVS.cso").c_str());
 
+		// PackedVertex versions of the above
+		std::shared_ptr<SimpleVertexShader> packedVS, packedVSSS;
+		packedVS = PackedVSHelper(L"PackedVertexShader.cso");
+		packedVSSS = PackedVSHelper(L"PackedSpinShrinkVS.cso");
+		packedShadowVS = PackedVSHelper(L"PackedShadowMapVS.cso");
+
+		// instanced versions of VertexShader.hlsl, see Instancing
+		std::shared_ptr<SimpleVertexShader> instancedVS, packedInstancedVS;
+		instancedVS = VSHelper(L"InstancedVertexShader.cso");
+		packedInstancedVS = PackedVSHelper(L"PackedInstancedVertexShader.cso", true);
+
 		// load pixel shaders
 		std::shared_ptr<SimplePixelShader> ps, psDbNs, psDbUVs, psDbL, psCustom, psTexMultiply, skyPS;
 		ps = PSHelper(L"PixelShader.cso");
@@ -272,6 +327,17 @@ void Game::CreateGeometry()
 		mWoodDecal = MatHelperDecalPBR(
 			"Wood Decal PBR", vs, psTexMultiply, sampler, woodA, beansSRV, woodN, woodR, woodM);
 
+		// let every material draw packed meshes, and instanced where the
+		// vertex shader only needs the matrices
+		for (auto& [name, mat] : umMats) {
+			if (mat->GetVertexShader() == vs) {
+				mat->SetPackedVertexShader(packedVS);
+				mat->SetInstancedVertexShader(instancedVS);
+				mat->SetPackedInstancedVertexShader(packedInstancedVS);
+			}
+			else if (mat->GetVertexShader() == vsSS) mat->SetPackedVertexShader(packedVSSS);
+		}
+
 		// create entities
 		EntityHelper("Sphere1", sphere, mCobble, XMFLOAT3(-9, 0, 0));
 		EntityHelper("Sphere2", sphere, mFloor, XMFLOAT3(-6, 0, 0));
@@ -288,6 +354,7 @@ void Game::CreateGeometry()
 		EntityHelper("Sphere13", sphere, mRoughDecal, XMFLOAT3(6, 3, 0));
 		EntityHelper("Sphere14", sphere, mWoodDecal, XMFLOAT3(9, 3, 0));
 		EntityHelper("Floor", cube, mWood, XMFLOAT3(0, -5, 0), XMFLOAT3(20, 1, 20));
+		baseEntityCount = lEntities.size();
 
 		// create sky
 		umSkies["No Sky"] = nullptr;
@@ -322,12 +389,6 @@ void Game::CreateGeometry()
 			lightDir,
 			XMVector3Normalize(XMLoadFloat3(&slUpDir))); // Up: World up vector (Z axis for looking straight down)
 		XMStoreFloat4x4(&lightViewMatrix, lightView);
-		XMMATRIX lightProjection = XMMatrixOrthographicLH(
-			lightProjectionSize,
-			lightProjectionSize,
-			1.0f,
-			100.0f);
-		XMStoreFloat4x4(&lightProjectionMatrix, lightProjection);
 
 		Light dl2 = {};
 		dl2.Color = XMFLOAT3(1, 0, 0);
@@ -369,6 +430,7 @@ void Game::CreateGeometry()
 		sl1.SpotInnerAngle = XMConvertToRadians(20);
 		sl1.SpotOuterAngle = XMConvertToRadians(30);
 		lights.push_back(sl1);
+		baseLightCount = lights.size();
 	}
 
 	// post process setup
@@ -386,23 +448,13 @@ void Game::CreateGeometry()
 		ppSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
 		ppSampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
 		ppSampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-		Graphics::Device->CreateSamplerState(&ppSampDesc, ppSampler.GetAddressOf());
+		ppSampler = StateCache::GetSamplerState(ppSampDesc);
 
 		// Create the Render Target View
 		ResizePostProcessResources();
 	}
 }
 
-// helper to resize shadow map
-void Game::ResizeShadowMap() {
-	XMMATRIX lightProjection = XMMatrixOrthographicLH(
-		lightProjectionSize,
-		lightProjectionSize,
-		1.0f,
-		100.0f);
-	XMStoreFloat4x4(&lightProjectionMatrix, lightProjection);
-}
-
 void Game::EditShadowMapLight(Light light, float distance) {
 	XMVECTOR lightDir = XMVector3Normalize(XMLoadFloat3(&light.Direction));
 	XMVECTOR lightPos = XMVectorScale(lightDir, distance);
@@ -413,6 +465,272 @@ void Game::EditShadowMapLight(Light light, float distance) {
 	XMStoreFloat4x4(&lightViewMatrix, lightView);
 }
 
+// --------------------------------------------------------
+// Splits the active camera's view out to shadowDistance and
+// fits a light box to each slice, see ShadowCascades::Fit()
+// - The light matrices become cascade 0's, the others are
+//   reached from its clip space by cascadeScales/Offsets
+// --------------------------------------------------------
+void Game::FitShadowCascades()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// the light looks down its view's z axis, wherever slDistance put it
+	XMFLOAT3 lightDirection(lightViewMatrix._13, lightViewMatrix._23, lightViewMatrix._33);
+	float nearClip = activeCamera->GetNearClip();
+	float farClip = (std::max)((std::min)(activeCamera->GetFarClip(), shadowDistance), nearClip * 2.0f);
+	float splits[ShadowCascades::MAX_CASCADES + 1];
+	ShadowCascades::ComputeSplits(nearClip, farClip, shadowCascadeCount, shadowCascadeLambda, splits);
+
+	XMFLOAT4X4 view = activeCamera->GetView();
+	XMFLOAT4X4 projection = activeCamera->GetProjection();
+	for (int c = 0; c < shadowCascadeCount; c++) {
+		shadowCascades[c] = ShadowCascades::Fit(view, projection, splits[c], splits[c + 1],
+			lightDirection, slUpDir, shadowMapResolution);
+		ShadowCascades::GetClipTransform(shadowCascades[0], shadowCascades[c], cascadeScales[c], cascadeOffsets[c]);
+	}
+	lightViewMatrix = shadowCascades[0].view;
+	lightProjectionMatrix = shadowCascades[0].projection;
+	cascadeFitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Replaces the extra lights with "count" random point and spot
+// lights scattered over the scene, the same ones for a count
+// --------------------------------------------------------
+void Game::SetExtraLights(int count)
+{
+	extraLightCount = count;
+	lights.resize(baseLightCount);
+	if (selectedLightIndex >= (int)lights.size()) selectedLightIndex = -1;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+	for (int i = 0; i < count; i++) {
+		Light light = {};
+		light.Type = i % 4 == 3 ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+		light.Position = XMFLOAT3(dist(rng) * 40.0f - 20.0f, dist(rng) * 5.0f + 0.5f, dist(rng) * 40.0f - 20.0f);
+		light.Direction = XMFLOAT3(dist(rng) - 0.5f, -1.0f, dist(rng) - 0.5f);
+		light.Range = dist(rng) * 4.0f + 2.0f;
+		light.Intensity = 1.0f;
+		light.Color = XMFLOAT3(dist(rng), dist(rng), dist(rng));
+		light.SpotInnerAngle = XMConvertToRadians(15);
+		light.SpotOuterAngle = XMConvertToRadians(30);
+		lights.push_back(light);
+	}
+}
+
+// --------------------------------------------------------
+// Replaces the extra entities with "count" random copies of
+// the ones from Initialize(), same mesh and material, to give
+// instancing and the render queue something to chew on
+// --------------------------------------------------------
+void Game::SetExtraEntities(int count)
+{
+	extraEntityCount = count;
+	lEntities.resize(baseEntityCount);
+	if (selectedEntityIndex >= (int)lEntities.size()) selectedEntityIndex = -1;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+	for (int i = 0; i < count; i++) {
+		const std::shared_ptr<GameEntity>& source = lEntities[i % baseEntityCount];
+		std::shared_ptr<GameEntity> entity = std::make_shared<GameEntity>("Extra", source->GetMesh(), source->GetMaterial());
+		entity->GetTransform()->SetPosition(dist(rng) * 80.0f - 40.0f, dist(rng) * 8.0f - 3.0f, dist(rng) * 80.0f - 40.0f);
+		float scale = dist(rng) * 0.5f + 0.5f;
+		entity->GetTransform()->SetScale(scale, scale, scale);
+		lEntities.push_back(entity);
+	}
+}
+
+// --------------------------------------------------------
+// Fills the instance buffer from instanceData, recreating it
+// when it's too small the same way UpdateStructuredBuffer()
+// does, and binds it to input slot 1
+// --------------------------------------------------------
+void Game::UpdateInstanceBuffer()
+{
+	UINT stride = sizeof(InstanceData);
+	size_t count = instanceData.size();
+	D3D11_BUFFER_DESC desc = {};
+	if (instanceBuffer) instanceBuffer->GetDesc(&desc);
+	if (!instanceBuffer || desc.ByteWidth < stride * count) {
+		UINT capacity = 64;
+		while (capacity < count) capacity *= 2;
+		desc = {};
+		desc.ByteWidth = stride * capacity;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Graphics::Device->CreateBuffer(&desc, 0, instanceBuffer.ReleaseAndGetAddressOf());
+	}
+
+	if (count == 0) return;
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (SUCCEEDED(Graphics::Context->Map(instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+		memcpy(mapped.pData, instanceData.data(), stride * count);
+		Graphics::Context->Unmap(instanceBuffer.Get(), 0);
+	}
+	StateCache::SetVertexBuffer(1, instanceBuffer.Get(), stride);
+}
+
+// --------------------------------------------------------
+// Fills a dynamic structured buffer, recreating it (and its
+// SRV) when it's too small - capacity doubles so a growing
+// light count doesn't make a new one every frame
+// --------------------------------------------------------
+void Game::UpdateStructuredBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
+	const void* data, UINT stride, size_t count)
+{
+	D3D11_BUFFER_DESC desc = {};
+	if (buffer) buffer->GetDesc(&desc);
+	if (!buffer || desc.ByteWidth < stride * count) {
+		UINT capacity = 64;
+		while (capacity < count) capacity *= 2;
+		desc = {};
+		desc.ByteWidth = stride * capacity;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = stride;
+		Graphics::Device->CreateBuffer(&desc, 0, buffer.ReleaseAndGetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = capacity;
+		Graphics::Device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.ReleaseAndGetAddressOf());
+	}
+
+	if (count == 0) return;
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (SUCCEEDED(Graphics::Context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+		memcpy(mapped.pData, data, stride * count);
+		Graphics::Context->Unmap(buffer.Get(), 0);
+	}
+}
+
+// --------------------------------------------------------
+// The main pass's batches, as Draw() would draw them, recorded
+// by a thread per run of batches and run by commandBackend
+// - Runs are merged in order, so the result is the same
+//   whatever the thread count
+// --------------------------------------------------------
+void Game::RecordMainPass(float dt, float tt, const XMFLOAT2& clusterScreenScale, const XMFLOAT3& camForward)
+{
+	auto recordStart = std::chrono::steady_clock::now();
+	const std::vector<RenderQueue::Item>& items = renderQueue.GetItems();
+	const std::vector<Instancing::Batch>& batches = instanceBatches.batches;
+	XMFLOAT3 camPos = activeCamera->GetTransform()->GetWorldPosition();
+	XMFLOAT2 clusterDepthScaleBias = lightClusters.GetDepthScaleBias();
+
+	unsigned int threads = (std::max)(1u, std::thread::hardware_concurrency());
+	size_t chunkCount = (std::min)(batches.size(), (size_t)threads);
+	size_t chunkSize = chunkCount > 0 ? (batches.size() + chunkCount - 1) / chunkCount : 0;
+	if (drawRecorders.size() < chunkCount) drawRecorders.resize(chunkCount);
+
+	ParallelFor(chunkCount, threads, [&](size_t c) {
+		DrawRecorder& recorder = drawRecorders[c];
+		CommandBuffer& commands = recorder.commands;
+		commands.Clear();
+		if (instancingStats.instanced > 0)
+			commands.SetVertexBuffer(1, instanceBuffer.Get(), sizeof(InstanceData));
+
+		size_t end = (std::min)(batches.size(), (c + 1) * chunkSize);
+		for (size_t b = c * chunkSize; b < end; b++) {
+			const Instancing::Batch& batch = batches[b];
+			uint32_t i = items[instanceBatches.draws[batch.first]].entity;
+			const std::shared_ptr<GameEntity>& e = lEntities[i];
+			std::shared_ptr<SimplePixelShader> ps = e->GetMaterial()->GetPixelShader();
+			auto bindSRV = [&](const char* name, ID3D11ShaderResourceView* view) {
+				const SimpleSRV* info = ps->GetShaderResourceViewInfo(name);
+				if (info) commands.SetShaderResource(ShaderStage::Pixel, info->BindIndex, view);
+			};
+
+			// the same frame data Draw() sets on the shader itself
+			ShaderConstants& psData = recorder.ps;
+			psData.Begin(ps.get());
+			bool clustered = lightAssignment == ClusteredLights && ps->GetShaderResourceViewInfo("ClusterLights") != nullptr;
+			const std::vector<Light>* psLights = clustered ? &directionalLights : &lights;
+			if (lightAssignment == PerEntityLights) {
+				recorder.lights.clear();
+				const uint32_t* list = entityLightLists.Get(i);
+				for (uint32_t l = 0; l < entityLightLists.counts[i]; l++) recorder.lights.push_back(lights[list[l]]);
+				psLights = &recorder.lights;
+			}
+			int psLightCount = (std::min)((int)psLights->size(), MAX_LIGHTS);
+			psData.SetData("lights", psLights->data(), sizeof(Light) * psLightCount);
+			psData.SetInt("nLights", psLightCount);
+			psData.SetInt("clustered", clustered ? 1 : 0);
+			if (clustered) {
+				psData.SetFloat3("v3CamForward", camForward);
+				psData.SetFloat2("clusterScreenScale", clusterScreenScale);
+				psData.SetFloat2("clusterDepthScaleBias", clusterDepthScaleBias);
+				bindSRV("ClusterLights", clusterLightSRV.Get());
+				bindSRV("ClusterRanges", clusterRangeSRV.Get());
+				bindSRV("ClusterLightIndices", clusterIndexSRV.Get());
+			}
+			psData.SetData("cascadeScales", cascadeScales, sizeof(cascadeScales));
+			psData.SetData("cascadeOffsets", cascadeOffsets, sizeof(cascadeOffsets));
+			psData.SetInt("cascadeCount", shadowCascadeCount);
+			bindSRV("ShadowMap", shadowSRV.Get());
+			const SimpleSampler* shadowSamplerInfo = ps->GetSamplerInfo("ShadowSampler");
+			if (shadowSamplerInfo) commands.SetSampler(ShaderStage::Pixel, shadowSamplerInfo->BindIndex, shadowSampler.Get());
+
+			e->Record(commands, recorder.vs, psData, camPos, objectWorlds[i], objectWorldITs[i], objectMatrices[i],
+				dt, tt, batch.first, batch.count > 1 ? batch.count : 0);
+		}
+	});
+
+	frameCommands.Clear();
+	for (size_t c = 0; c < chunkCount; c++) frameCommands.Append(drawRecorders[c].commands);
+	auto executeStart = std::chrono::steady_clock::now();
+
+	CommandBackend* backend = &d3d11Backend;
+	if (commandBackend == NullBackend) {
+		nullBackend.Reset();
+		backend = &nullBackend;
+	}
+	else if (commandBackend == ValidationBackend) {
+		validationBackend.Reset();
+		backend = &validationBackend;
+	}
+	backend->Execute(frameCommands);
+
+	recordStats.chunks = (uint32_t)chunkCount;
+	recordStats.commands = frameCommands.GetCount();
+	recordStats.bytes = frameCommands.GetSize();
+	recordStats.recordMs = std::chrono::duration<double, std::milli>(executeStart - recordStart).count();
+	recordStats.executeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - executeStart).count();
+}
+
+// --------------------------------------------------------
+// Draws entities (indices into lEntities) into whichever
+// shadow map is bound, with the matrices in their states
+// --------------------------------------------------------
+void Game::DrawShadowCasters(const std::vector<uint32_t>& casters, const std::vector<ShadowCasterState>& states)
+{
+	for (size_t c = 0; c < casters.size(); c++)
+	{
+		std::shared_ptr<GameEntity> e = lEntities[casters[c]];
+		std::shared_ptr<Mesh> mesh = e->GetMesh();
+		std::shared_ptr<SimpleVertexShader> vs = mesh->IsPacked() ? packedShadowVS : shadowVS;
+		StateCache::SetShader(vs.get());
+		vs->SetMatrix4x4("mWorldViewProjLight", states[c].lightWorldViewProj);
+		if (mesh->IsPacked()) {
+			vs->SetFloat3("positionMin", mesh->GetQuantization().positionMin);
+			vs->SetFloat3("positionScale", mesh->GetQuantization().positionScale);
+		}
+		vs->CopyAllBufferData();
+
+		// entities too small to see can still throw a shadow into view
+		int lod = states[c].lod;
+		mesh->Draw(lod < 0 ? mesh->GetLODCount() - 1 : lod);
+	}
+}
+
 // helper to resize render targets
 void Game::ResizePostProcessResources()
 {
@@ -492,12 +810,62 @@ void Game::Update(float deltaTime, float totalTime)
 	UINewFrame(deltaTime);
 	BuildUI();
 
+	// a click (not a camera drag) selects whatever is under the cursor
+	if (Input::MouseLeftPress()) {
+		pickPending = true;
+		pickMouseX = Input::GetMouseX();
+		pickMouseY = Input::GetMouseY();
+	}
+	else if (Input::MouseLeftRelease()) {
+		if (pickPending && abs(Input::GetMouseX() - pickMouseX) + abs(Input::GetMouseY() - pickMouseY) <= 3)
+			PickEntity(pickMouseX, pickMouseY);
+		pickPending = false;
+	}
+
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::KeyDown(VK_ESCAPE))
 		Window::Quit();
 }
 
 
+// --------------------------------------------------------
+// Casts a ray through a pixel against every entity's BVH
+// and selects the closest one it hits
+// --------------------------------------------------------
+void Game::PickEntity(int mouseX, int mouseY)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// the pixel's line from the near plane to the far plane, so
+	// t runs from 0 to 1 with either kind of projection
+	XMFLOAT4X4 view = activeCamera->GetView();
+	XMFLOAT4X4 proj = activeCamera->GetProjection();
+	XMMATRIX invViewProj = XMMatrixInverse(nullptr, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&proj));
+	float x = (mouseX + 0.5f) / Window::Width() * 2.0f - 1.0f;
+	float y = 1.0f - (mouseY + 0.5f) / Window::Height() * 2.0f;
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0, 1), invViewProj);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1, 1), invViewProj);
+	XMFLOAT3 origin, direction;
+	XMStoreFloat3(&origin, nearPoint);
+	XMStoreFloat3(&direction, farPoint - nearPoint);
+
+	int picked = -1;
+	float closest = 1.0f;
+	for (int i = 0; i < lEntities.size(); i++) {
+		RayHit hit;
+		if (lEntities[i]->Raycast(origin, direction, closest, hit)) {
+			closest = hit.t;
+			picked = i;
+			pickHit = hit;
+		}
+	}
+	pickMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	pickedName = picked >= 0 ? lEntities[picked]->GetName() : "";
+	if (picked >= 0) selectedEntityIndex = picked;
+}
+
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
@@ -513,51 +881,299 @@ void Game::Draw(float dt, float tt)
 		// Clear buffers (erase what's on screen)
 		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(), reinterpret_cast<float*>(&bgColor));
 		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+		// ImGui has had the pipeline since the last frame
+		geometryBindStats = GeometryPool::GetBindStats();
+		GeometryPool::ResetBindStats();
+		stateCacheStats = StateCache::GetStats();
+		StateCache::ResetStats();
+		StateCache::Invalidate();
 	}
 
-	// shadow mapping
+	// per object matrices, gathered and multiplied out in one batch
+	// instead of in every vertex
 	{
-		// set render state
-		Graphics::Context->RSSetState(shadowRasterizer.Get());
-
-		// clear depth stencil
-		Graphics::Context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-
-		// setup output merger state
-		ID3D11RenderTargetView* nullRTV{};
-		Graphics::Context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
-
-		// clear pixel shader
-		Graphics::Context->PSSetShader(0, 0, 0);
-
-		// change viewport
-		D3D11_VIEWPORT viewport = {};
-		viewport.Width = (float)shadowMapResolution;
-		viewport.Height = (float)shadowMapResolution;
-		viewport.MaxDepth = 1.0f;
-		Graphics::Context->RSSetViewports(1, &viewport);
-
-		// entity render loop
-		shadowVS->SetShader();
-		shadowVS->SetMatrix4x4("view", lightViewMatrix);
-		shadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
-		// Loop and draw all entities
-		for (auto& e : lEntities)
-		{
-			shadowVS->SetMatrix4x4("world", e->GetTransform()->GetWorldMatrix());
-			shadowVS->CopyAllBufferData();
-			e->GetMesh()->Draw();
+		// light matrices follow the camera
+		FitShadowCascades();
+
+		auto start = std::chrono::steady_clock::now();
+		objectWorlds.resize(lEntities.size());
+		objectWorldITs.resize(lEntities.size());
+		objectMatrices.resize(lEntities.size());
+		for (size_t i = 0; i < lEntities.size(); i++) {
+			objectWorlds[i] = lEntities[i]->GetTransform()->GetWorldMatrix();
+			objectWorldITs[i] = lEntities[i]->GetTransform()->GetWorldInverseTransposeMatrix();
 		}
 
-		// reset pipeline
-		viewport.Width = (float)Window::Width();
-		viewport.Height = (float)Window::Height();
-		Graphics::Context->RSSetViewports(1, &viewport);
-		Graphics::Context->OMSetRenderTargets(
-			1,
-			Graphics::BackBufferRTV.GetAddressOf(),
-			Graphics::DepthBufferDSV.Get());
-		Graphics::Context->RSSetState(0);
+		XMFLOAT4X4 view = activeCamera->GetView();
+		XMFLOAT4X4 projection = activeCamera->GetProjection();
+		XMFLOAT4X4 viewProjection, lightViewProjection;
+		XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+		XMStoreFloat4x4(&lightViewProjection, XMLoadFloat4x4(&lightViewMatrix) * XMLoadFloat4x4(&lightProjectionMatrix));
+		ObjectMatrices::Build(objectWorlds.data(), objectWorlds.size(), viewProjection, lightViewProjection,
+			objectMatrices.data(), TransformSystem::Global().IsAVX());
+		objectMatricesMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// world bounding spheres for both culling passes
+		start = std::chrono::steady_clock::now();
+		entityBounds.Resize(lEntities.size());
+		for (size_t i = 0; i < lEntities.size(); i++) {
+			std::shared_ptr<Mesh> mesh = lEntities[i]->GetMesh();
+			entityBounds.Set(i, mesh->GetBoundsCenter(), mesh->GetBoundsRadius(), objectWorlds[i]);
+		}
+		double boundsMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		bool avx = TransformSystem::Global().IsAVX();
+
+		// frustum culling against the camera
+		if (frustumCulling) {
+			frustumStats = FrustumCulling::Cull(FrustumCulling::ExtractPlanes(viewProjection), entityBounds, visibleEntities, avx);
+		}
+		else {
+			visibleEntities.clear();
+			for (uint32_t i = 0; i < (uint32_t)lEntities.size(); i++) visibleEntities.push_back(i);
+			frustumStats = { (uint32_t)lEntities.size(), (uint32_t)lEntities.size(), 0 };
+		}
+		frustumStats.ms += boundsMs;
+		entityVisible.assign(lEntities.size(), 0);
+		for (uint32_t i : visibleEntities) entityVisible[i] = 1;
+
+		// shadow casters against each cascade's volume, stretched back toward the light
+		shadowCasterStats = {};
+		for (int c = 0; c < shadowCascadeCount; c++) {
+			CascadeCasters& cascade = cascadeCasters[c];
+			if (shadowCasterCulling) {
+				cascade.stats = FrustumCulling::Cull(FrustumCulling::ExtractCasterPlanes(shadowCascades[c].viewProjection, shadowCasterReach),
+					entityBounds, cascade.casters, avx);
+			}
+			else {
+				cascade.casters.clear();
+				for (uint32_t i = 0; i < (uint32_t)lEntities.size(); i++) cascade.casters.push_back(i);
+				cascade.stats = { (uint32_t)lEntities.size(), (uint32_t)lEntities.size(), 0 };
+			}
+			shadowCasterStats.tested += cascade.stats.tested;
+			shadowCasterStats.visible += cascade.stats.visible;
+			shadowCasterStats.culled += cascade.stats.culled;
+			shadowCasterStats.ms += cascade.stats.ms;
+		}
+		shadowCasterStats.ms += boundsMs;
+	}
+
+	// lights for the shaders, binned into clusters against the active
+	// camera or listed per entity that survived culling
+	{
+		directionalLights.clear();
+		for (const Light& light : lights)
+			if (light.Type == LIGHT_TYPE_DIRECTIONAL) directionalLights.push_back(light);
+
+		if (lightAssignment == ClusteredLights) {
+			XMFLOAT4X4 view = activeCamera->GetView();
+			XMFLOAT4X4 projection = activeCamera->GetProjection();
+			lightClusters.SetProjection(projection, activeCamera->GetNearClip(), activeCamera->GetFarClip());
+			unsigned int threads = lights.size() >= LightClusters::PARALLEL_MIN_LIGHTS ? std::thread::hardware_concurrency() : 1;
+			clusterStats = lightClusters.Bin(view, lights.data(), lights.size(), threads);
+
+			auto start = std::chrono::steady_clock::now();
+			UpdateStructuredBuffer(clusterLightBuffer, clusterLightSRV, lights.data(), sizeof(Light), lights.size());
+			UpdateStructuredBuffer(clusterRangeBuffer, clusterRangeSRV, lightClusters.GetRanges().data(),
+				sizeof(XMUINT2), lightClusters.GetRanges().size());
+			UpdateStructuredBuffer(clusterIndexBuffer, clusterIndexSRV, lightClusters.GetLightIndices().data(),
+				sizeof(uint32_t), lightClusters.GetLightIndices().size());
+			clusterUploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		else if (lightAssignment == PerEntityLights) {
+			entityLightStats = EntityLights::Assign(entityBounds, visibleEntities, lights.data(), lights.size(),
+				(uint32_t)maxEntityLights, 0, entityLightLists);
+		}
+	}
+
+	// level of detail
+	{
+		lodEntityCounts.clear();
+		lodCulledCount = 0;
+		lodTrianglesDrawn = 0;
+		meshletStats = {};
+		meshletCullMs = 0;
+		for (size_t i = 0; i < lEntities.size(); i++) {
+			std::shared_ptr<GameEntity> e = lEntities[i];
+			int lod = e->SelectLOD(activeCamera, (float)Window::Height(),
+				lodEnabled ? lodErrorPixels : 0.0f, lodEnabled ? lodCullPixels : 0.0f);
+
+			// out of view, the LOD is still picked for the shadow pass
+			if (!entityVisible[i]) {
+				e->ClearMeshletCulling();
+				continue;
+			}
+			if (lod < 0) {
+				lodCulledCount++;
+				e->ClearMeshletCulling();
+				continue;
+			}
+			if (lodEntityCounts.size() <= (size_t)lod) lodEntityCounts.resize(lod + 1, 0);
+			lodEntityCounts[lod]++;
+
+			// full detail meshes can go further and drop the meshlets out of view
+			if (meshletCulling && lod == 0 && !e->GetMesh()->GetMeshlets().empty()) {
+				auto cullStart = std::chrono::steady_clock::now();
+				Meshlets::CullStats stats = e->CullMeshlets(activeCamera);
+				meshletCullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+				meshletStats += stats;
+				lodTrianglesDrawn += stats.visibleTriangles;
+			}
+			else {
+				e->ClearMeshletCulling();
+				lodTrianglesDrawn += e->GetMesh()->GetLOD(lod).indexCount / 3;
+			}
+		}
+	}
+
+	// render queue, draws sharing shaders, materials and meshes go
+	// together, front to back within them
+	{
+		renderQueue.Clear();
+		XMFLOAT4X4 view = activeCamera->GetView();
+		float nearClip = activeCamera->GetNearClip();
+		float farClip = activeCamera->GetFarClip();
+		for (uint32_t i : visibleEntities) {
+			std::shared_ptr<GameEntity> e = lEntities[i];
+			std::shared_ptr<SimpleVertexShader> vs = e->GetVertexShader();
+			if (e->GetLOD() < 0 || !vs) continue;
+
+			std::shared_ptr<Material> material = e->GetMaterial();
+			float depth = entityBounds.x[i] * view._13 + entityBounds.y[i] * view._23 + entityBounds.z[i] * view._33 + view._43;
+			uint64_t key = RenderQueue::MakeKey(RenderQueue::PASS_OPAQUE,
+				renderQueue.GetShaderId(vs, material->GetPixelShader()),
+				material->GetId(),
+				e->GetMesh()->GetId(),
+				RenderQueue::QuantizeDepth(depth, nearClip, farClip));
+			renderQueue.Push(key, i);
+		}
+
+		const std::vector<RenderQueue::Item>& items = renderQueue.GetItems();
+		unsortedChanges = RenderQueue::CountChanges(items.data(), items.size());
+		if (renderSorting)
+			renderSortStats = renderQueue.Sort();
+		else
+			renderSortStats = { (uint32_t)items.size(), 0, 0 };
+		sortedChanges = RenderQueue::CountChanges(items.data(), items.size());
+
+		// instanced batches in queue order, per entity light lists can't share
+		// a draw and neither can meshlet culled indices, instances draw the whole LOD
+		batchKeys.resize(items.size());
+		for (size_t d = 0; d < items.size(); d++) {
+			std::shared_ptr<GameEntity> e = lEntities[items[d].entity];
+			bool batchable = instancing && lightAssignment != PerEntityLights && !e->IsMeshletCulled() && e->GetInstancedVertexShader();
+			batchKeys[d] = !batchable ? Instancing::NO_BATCH : Instancing::MakeKey(
+				e->GetMaterial()->GetId(), e->GetMesh()->GetId(), (uint32_t)e->GetLOD());
+		}
+		instancingStats = Instancing::Build(batchKeys.data(), batchKeys.size(), (uint32_t)maxBatchInstances, instanceBatches);
+	}
+
+	// shadow mapping, a slice of the map per cascade
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// what every caster would draw into each cascade, a changed light
+		// or camera moves the cascades and changes all of theirs
+		std::vector<ShadowCasterState> staticStates[ShadowCascades::MAX_CASCADES], dynamicStates[ShadowCascades::MAX_CASCADES];
+		std::vector<uint32_t> staticCasters[ShadowCascades::MAX_CASCADES], dynamicCasters[ShadowCascades::MAX_CASCADES];
+		bool staticChanged[ShadowCascades::MAX_CASCADES] = {}, dynamicChanged[ShadowCascades::MAX_CASCADES] = {};
+		bool anyChanged = false;
+		bool fullRedraw = true;
+		for (int c = 0; c < shadowCascadeCount; c++) {
+			// cascade 0's light clip space to this one's
+			XMMATRIX toCascade =
+				XMMatrixScaling(cascadeScales[c].x, cascadeScales[c].y, cascadeScales[c].z) *
+				XMMatrixTranslation(cascadeOffsets[c].x, cascadeOffsets[c].y, cascadeOffsets[c].z);
+			CascadeCasters& cascade = cascadeCasters[c];
+			for (uint32_t i : cascade.casters) {
+				std::shared_ptr<GameEntity> e = lEntities[i];
+				ShadowCasterState state = { e->GetMesh().get(), e->GetLOD() };
+				XMStoreFloat4x4(&state.lightWorldViewProj, XMLoadFloat4x4(&objectMatrices[i].lightWorldViewProj) * toCascade);
+				bool isStatic = shadowStaticSplit && e->IsStatic();
+				(isStatic ? staticStates[c] : dynamicStates[c]).push_back(state);
+				(isStatic ? staticCasters[c] : dynamicCasters[c]).push_back(i);
+			}
+			staticChanged[c] = !shadowCaching || !shadowCacheValid || staticStates[c] != cascade.staticStates;
+			dynamicChanged[c] = !shadowCaching || !shadowCacheValid || dynamicStates[c] != cascade.dynamicStates;
+			cascade.redrawn = staticChanged[c] || dynamicChanged[c];
+			anyChanged |= cascade.redrawn;
+			fullRedraw &= staticChanged[c] || (!shadowStaticSplit && dynamicChanged[c]);
+		}
+		shadowCacheStats.frames++;
+
+		if (anyChanged) {
+			// set render state
+			StateCache::SetRasterizerState(shadowRasterizer.Get());
+
+			// clear pixel shader
+			StateCache::SetPixelShader(nullptr);
+
+			// change viewport
+			D3D11_VIEWPORT viewport = {};
+			viewport.Width = (float)shadowMapResolution;
+			viewport.Height = (float)shadowMapResolution;
+			viewport.MaxDepth = 1.0f;
+			Graphics::Context->RSSetViewports(1, &viewport);
+
+			bool staticReused = false;
+			ID3D11RenderTargetView* nullRTV{};
+			for (int c = 0; c < shadowCascadeCount; c++) {
+				// last frame's slice is still right
+				if (!cascadeCasters[c].redrawn) continue;
+
+				// static casters into their own slice, which then starts the real one
+				if (shadowStaticSplit) {
+					if (staticChanged[c]) {
+						Graphics::Context->ClearDepthStencilView(staticShadowDSVs[c].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+						StateCache::SetRenderTargets(1, &nullRTV, staticShadowDSVs[c].Get());
+						DrawShadowCasters(staticCasters[c], staticStates[c]);
+					}
+					else {
+						staticReused = true;
+					}
+					StateCache::SetRenderTargets(1, &nullRTV, nullptr);
+					UINT slice = D3D11CalcSubresource(0, c, 1);
+					Graphics::Context->CopySubresourceRegion(shadowTexture.Get(), slice, 0, 0, 0, staticShadowTexture.Get(), slice, nullptr);
+				}
+				else {
+					Graphics::Context->ClearDepthStencilView(shadowDSVs[c].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+				}
+
+				// dynamic casters (everything without the split) on top
+				StateCache::SetRenderTargets(1, &nullRTV, shadowDSVs[c].Get());
+				DrawShadowCasters(dynamicCasters[c], dynamicStates[c]);
+			}
+			if (staticReused) shadowCacheStats.staticReused++;
+			Graphics::Context->CopySubresourceRegion(shadowPreviewTexture.Get(), 0, 0, 0, 0,
+				shadowTexture.Get(), D3D11CalcSubresource(0, shadowPreviewCascade, 1), nullptr);
+
+			// reset pipeline
+			viewport.Width = (float)Window::Width();
+			viewport.Height = (float)Window::Height();
+			Graphics::Context->RSSetViewports(1, &viewport);
+			StateCache::SetRenderTargets(
+				1,
+				Graphics::BackBufferRTV.GetAddressOf(),
+				Graphics::DepthBufferDSV.Get());
+			StateCache::SetRasterizerState(nullptr);
+
+			shadowCacheStats.lastMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			// only cascades (or static slices) that were kept save anything
+			if (fullRedraw) shadowCacheStats.fullMs = shadowCacheStats.lastMs;
+			else shadowCacheStats.savedMs += (std::max)(shadowCacheStats.fullMs - shadowCacheStats.lastMs, 0.0);
+		}
+		else {
+			// last frame's map is still right
+			shadowCacheStats.skipped++;
+			shadowCacheStats.lastMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			shadowCacheStats.savedMs += (std::max)(shadowCacheStats.fullMs - shadowCacheStats.lastMs, 0.0);
+		}
+
+		for (int c = 0; c < shadowCascadeCount; c++) {
+			cascadeCasters[c].staticStates.swap(staticStates[c]);
+			cascadeCasters[c].dynamicStates.swap(dynamicStates[c]);
+		}
+		shadowCacheValid = true;
 	}
 
 	// pre rendering
@@ -567,26 +1183,73 @@ void Game::Draw(float dt, float tt)
 		Graphics::Context->ClearRenderTargetView(ppChromaticRTV.Get(), reinterpret_cast<float*>(&bgColor));
 
 		// set 1st process as render target
-		Graphics::Context->OMSetRenderTargets(1, ppBlurRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
+		StateCache::SetRenderTargets(1, ppBlurRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
 	}
 
 	// render
 	{
-		// draw meshes
-		for (size_t i = 0; i < lEntities.size(); i++) {
-			std::shared_ptr<SimpleVertexShader> vs = lEntities[i]->GetMaterial()->GetVertexShader();
-			vs->SetMatrix4x4("mViewLight", lightViewMatrix);
-			vs->SetMatrix4x4("mProjLight", lightProjectionMatrix);
-
-			std::shared_ptr<SimplePixelShader> ps = lEntities[i]->GetMaterial()->GetPixelShader();
-			ps->SetData(
-				"lights", // The name of the (temporary) variable in the shader
-				&lights[0], // The address of the data to set
-				sizeof(Light) * (int)lights.size()); // The size of the data (the whole struct!) to set
-			ps->SetInt("nLights", (int)lights.size());
-			ps->SetShaderResourceView("ShadowMap", shadowSRV);
-			ps->SetSamplerState("ShadowSampler", shadowSampler);
-			lEntities[i]->Draw(activeCamera, dt, tt);
+		// grid to render target pixels and the camera's depth axis, for
+		// the shaders to find their cluster
+		XMFLOAT2 clusterScreenScale(
+			(float)LightClusters::GRID_X / Window::Width(),
+			(float)LightClusters::GRID_Y / Window::Height());
+		XMFLOAT3 camForward = activeCamera->GetTransform()->GetForward();
+
+		// instance data for the batches of more than one draw
+		const std::vector<RenderQueue::Item>& items = renderQueue.GetItems();
+		if (instancingStats.instanced > 0) {
+			instanceEntities.resize(instanceBatches.draws.size());
+			for (size_t k = 0; k < instanceEntities.size(); k++)
+				instanceEntities[k] = items[instanceBatches.draws[k]].entity;
+			instanceData.resize(instanceEntities.size());
+			Instancing::Pack(instanceEntities.data(), instanceEntities.size(), objectWorlds.data(), objectWorldITs.data(),
+				objectMatrices.data(), instanceData.data());
+			UpdateInstanceBuffer();
+		}
+
+		// draw meshes that survived culling, a batch at a time in render
+		// queue order - the batch's first entity stands in for the rest
+		if (recordDraws)
+			RecordMainPass(dt, tt, clusterScreenScale, camForward);
+		else {
+			for (const Instancing::Batch& batch : instanceBatches.batches) {
+				uint32_t i = items[instanceBatches.draws[batch.first]].entity;
+
+				// shaders without clustering still get the first MAX_LIGHTS lights
+				std::shared_ptr<SimplePixelShader> ps = lEntities[i]->GetMaterial()->GetPixelShader();
+				bool clustered = lightAssignment == ClusteredLights && ps->GetShaderResourceViewInfo("ClusterLights") != nullptr;
+				const std::vector<Light>* psLights = clustered ? &directionalLights : &lights;
+				if (lightAssignment == PerEntityLights) {
+					entityLights.clear();
+					const uint32_t* list = entityLightLists.Get(i);
+					for (uint32_t l = 0; l < entityLightLists.counts[i]; l++) entityLights.push_back(lights[list[l]]);
+					psLights = &entityLights;
+				}
+				int psLightCount = (std::min)((int)psLights->size(), MAX_LIGHTS);
+				ps->SetData(
+					"lights", // The name of the (temporary) variable in the shader
+					psLights->data(), // The address of the data to set
+					sizeof(Light) * psLightCount); // The size of the data (the whole struct!) to set
+				ps->SetInt("nLights", psLightCount);
+				ps->SetInt("clustered", clustered ? 1 : 0);
+				if (clustered) {
+					ps->SetFloat3("v3CamForward", camForward);
+					ps->SetFloat2("clusterScreenScale", clusterScreenScale);
+					ps->SetFloat2("clusterDepthScaleBias", lightClusters.GetDepthScaleBias());
+					StateCache::SetShaderResourceView(ps.get(), "ClusterLights", clusterLightSRV.Get());
+					StateCache::SetShaderResourceView(ps.get(), "ClusterRanges", clusterRangeSRV.Get());
+					StateCache::SetShaderResourceView(ps.get(), "ClusterLightIndices", clusterIndexSRV.Get());
+				}
+				ps->SetData("cascadeScales", cascadeScales, sizeof(cascadeScales));
+				ps->SetData("cascadeOffsets", cascadeOffsets, sizeof(cascadeOffsets));
+				ps->SetInt("cascadeCount", shadowCascadeCount);
+				StateCache::SetShaderResourceView(ps.get(), "ShadowMap", shadowSRV.Get());
+				StateCache::SetSamplerState(ps.get(), "ShadowSampler", shadowSampler.Get());
+				if (batch.count > 1)
+					lEntities[i]->DrawInstances(activeCamera, batch.first, batch.count, dt, tt);
+				else
+					lEntities[i]->Draw(activeCamera, objectMatrices[i], dt, tt);
+			}
 		}
 
 		// draw sky
@@ -606,18 +1269,18 @@ void Game::Draw(float dt, float tt)
 	// post processing
 	{
 		// Set back buffer to next PP and activate vert shader
-		Graphics::Context->OMSetRenderTargets(1, ppChromaticRTV.GetAddressOf(), 0);
-		ppVS->SetShader();
+		StateCache::SetRenderTargets(1, ppChromaticRTV.GetAddressOf(), 0);
+		StateCache::SetShader(ppVS.get());
 
 		// blur
 		{
 			// set resources
-			ppBlurPS->SetShader();
+			StateCache::SetShader(ppBlurPS.get());
 			ppBlurPS->SetInt("blurRadius", ppBlurRadius);
 			ppBlurPS->SetFloat("pixelWidth", 1.0f / (float)Window::Width());
 			ppBlurPS->SetFloat("PixelHeight", 1.0f / (float)Window::Height());
-			ppBlurPS->SetShaderResourceView("Pixels", ppBlurSRV.Get());
-			ppBlurPS->SetSamplerState("ClampSampler", ppSampler.Get());
+			StateCache::SetShaderResourceView(ppBlurPS.get(), "Pixels", ppBlurSRV.Get());
+			StateCache::SetSamplerState(ppBlurPS.get(), "ClampSampler", ppSampler.Get());
 			ppBlurPS->CopyAllBufferData();
 			Graphics::Context->Draw(3, 0);
 		}
@@ -625,15 +1288,15 @@ void Game::Draw(float dt, float tt)
 		// chromatic aberration
 		{
 			// set back buffer
-			Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
+			StateCache::SetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
 			
 			// set resources
-			ppChromaticPS->SetShader();
+			StateCache::SetShader(ppChromaticPS.get());
 			ppChromaticPS->SetFloat3("offsets", ppChromaticOffsets);
 			ppChromaticPS->SetFloat2("mousePos", XMFLOAT2((float)Input::GetMouseX(), (float)Input::GetMouseY()));
 			ppChromaticPS->SetFloat2("textureSize", XMFLOAT2((float)Window::Width(), (float)Window::Height()));
-			ppChromaticPS->SetShaderResourceView("Pixels", ppChromaticSRV.Get());
-			ppChromaticPS->SetSamplerState("ClampSampler", ppSampler.Get());
+			StateCache::SetShaderResourceView(ppChromaticPS.get(), "Pixels", ppChromaticSRV.Get());
+			StateCache::SetSamplerState(ppChromaticPS.get(), "ClampSampler", ppSampler.Get());
 			ppChromaticPS->CopyAllBufferData();
 			Graphics::Context->Draw(3, 0);
 		}
@@ -657,7 +1320,7 @@ void Game::Draw(float dt, float tt)
 			vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
 
 		// Re-bind back buffer and depth buffer after presenting
-		Graphics::Context->OMSetRenderTargets(
+		StateCache::SetRenderTargets(
 			1,
 			Graphics::BackBufferRTV.GetAddressOf(),
 			Graphics::DepthBufferDSV.Get());
@@ -1,8 +1,21 @@
 #pragma once
 
 #include "Mesh.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
 #include "BufferStructs.h"
 #include "GameEntity.h"
+#include "TransformSystem.h"
+#include "FrustumCulling.h"
+#include "ShadowCascades.h"
+#include "LightClusters.h"
+#include "EntityLights.h"
+#include "RenderQueue.h"
+#include "Instancing.h"
+#include "CommandBuffer.h"
+#include "D3D11CommandBackend.h"
+#include "ShaderConstants.h"
+#include "StateCache.h"
 #include "Camera.h"
 #include "Lights.h"
 #include "Sky.h"
@@ -20,6 +33,7 @@
 #include <memory>
 #include <unordered_map>
 #include <string>
+#include <cstring>
 class Game
 {
 public:
@@ -43,6 +57,32 @@ private:
 	// game environment vars
 	DirectX::XMFLOAT3 bgColor;
 	std::vector<Light> lights;
+	size_t baseLightCount = 0;	// lights from Initialize(), random extra ones follow
+	int extraLightCount = 0;
+
+	// how lights reach the pixel shaders
+	// - AllLights: the first MAX_LIGHTS in lights[] in their cbuffer
+	// - ClusteredLights: see LightClusters - every light goes to the shaders
+	//   in a structured buffer with per cluster lists of the point and spot
+	//   lights, lights[] in their cbuffer keeps the directional ones
+	// - PerEntityLights: see EntityLights - lights[] gets the brightest few
+	//   that reach each entity, the shadow casting light first
+	enum LightAssignment { AllLights, ClusteredLights, PerEntityLights };
+	int lightAssignment = ClusteredLights;
+	LightClusters lightClusters;
+	LightClusters::BinStats clusterStats = {};
+	double clusterUploadMs = 0;
+	std::vector<Light> directionalLights;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> clusterLightBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> clusterRangeBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> clusterIndexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> clusterLightSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> clusterRangeSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> clusterIndexSRV;
+	int maxEntityLights = 8;
+	EntityLights::Lists entityLightLists;
+	EntityLights::Stats entityLightStats = {};
+	std::vector<Light> entityLights;	// one entity's list, for its draw
 
 	// active camera
 	std::string activeCamName;
@@ -54,6 +94,8 @@ private:
 
 	// vectors to hold GameEntities
 	std::vector<std::shared_ptr<GameEntity>> lEntities;
+	size_t baseEntityCount = 0;	// entities from Initialize(), copies of them follow
+	int extraEntityCount = 0;
 
 	// unordered maps for cams, mats, meshes, skies, and textures
 	std::unordered_map<std::string, std::shared_ptr<Camera>> umCameras;
@@ -62,18 +104,71 @@ private:
 	std::unordered_map<std::string, std::shared_ptr<Sky>> umSkies;
 	std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> lTextureSRVs;
 
-	// shadow mapping
+	// shadow mapping - one slice of shadowTexture per cascade, the
+	// light matrices are cascade 0's, refit to the camera every frame
 	int shadowMapResolution = 1024;
-	float lightProjectionSize = 20.0f;
 	DirectX::XMFLOAT3 slUpDir = DirectX::XMFLOAT3(0, 0, 1);
 	float slDistance = -15.0f;
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSVs[ShadowCascades::MAX_CASCADES];
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowPreviewTexture;	// one cascade's slice, for the UI
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowPreviewSRV;
+	int shadowPreviewCascade = 0;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
+	std::shared_ptr<SimpleVertexShader> packedShadowVS;
 	DirectX::XMFLOAT4X4 lightViewMatrix;
-	DirectX::XMFLOAT4X4 lightProjectionMatrix;
+	DirectX::XMFLOAT4X4 lightProjectionMatrix = {};
+
+	// shadow map caching - the map is only drawn again when a caster
+	// or the light changes, and with the split static casters are kept
+	// in their own map that's copied under the dynamic ones
+	struct ShadowCasterState
+	{
+		const Mesh* mesh;
+		int lod;
+		DirectX::XMFLOAT4X4 lightWorldViewProj;
+		bool operator==(const ShadowCasterState& other) const {
+			return mesh == other.mesh && lod == other.lod &&
+				memcmp(&lightWorldViewProj, &other.lightWorldViewProj, sizeof(lightWorldViewProj)) == 0;
+		}
+	};
+	struct ShadowCacheStats
+	{
+		uint32_t frames;
+		uint32_t skipped;		// nothing drawn, last frame's map kept
+		uint32_t staticReused;	// only dynamic casters drawn
+		double lastMs;			// shadow pass CPU time
+		double fullMs;			// CPU time of the last full redraw
+		double savedMs;			// full redraws avoided, measured against fullMs
+	};
+	bool shadowCaching = true;
+	bool shadowStaticSplit = false;
+	bool shadowCacheValid = false;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> staticShadowTexture;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> staticShadowDSVs[ShadowCascades::MAX_CASCADES];
+	ShadowCacheStats shadowCacheStats = {};
+
+	// cascaded shadow maps, see ShadowCascades::Fit() - each cascade
+	// culls its own casters and is cached on its own
+	struct CascadeCasters
+	{
+		std::vector<uint32_t> casters;	// indices into lEntities
+		FrustumCulling::CullStats stats;
+		std::vector<ShadowCasterState> staticStates;	// as last drawn
+		std::vector<ShadowCasterState> dynamicStates;
+		bool redrawn;					// this frame
+	};
+	int shadowCascadeCount = 4;
+	float shadowCascadeLambda = 0.75f;	// 0 uniform splits, 1 logarithmic
+	float shadowDistance = 60.0f;		// shadows stop here if the camera sees further
+	ShadowCascades::Cascade shadowCascades[ShadowCascades::MAX_CASCADES] = {};
+	DirectX::XMFLOAT4 cascadeScales[ShadowCascades::MAX_CASCADES] = {};	// from cascade 0's clip space
+	DirectX::XMFLOAT4 cascadeOffsets[ShadowCascades::MAX_CASCADES] = {};
+	CascadeCasters cascadeCasters[ShadowCascades::MAX_CASCADES] = {};
+	double cascadeFitMs = 0;
 
 	// ==== post processing ====
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> ppSampler;
@@ -93,6 +188,98 @@ private:
 	std::shared_ptr<SimplePixelShader> ppChromaticPS;
 	// ===========================
 
+	// level of detail, see GameEntity::SelectLOD()
+	bool lodEnabled = true;
+	float lodErrorPixels = 1.0f;
+	float lodCullPixels = 1.0f;
+	std::vector<int> lodEntityCounts;	// entities drawn at each LOD last frame
+	int lodCulledCount = 0;
+	size_t lodTrianglesDrawn = 0;
+
+	// meshlet culling, see GameEntity::CullMeshlets()
+	bool meshletCulling = true;
+	Meshlets::CullStats meshletStats = {};
+	double meshletCullMs = 0;
+
+	// per entity final matrices this frame, see ObjectMatrices::Build()
+	std::vector<DirectX::XMFLOAT4X4> objectWorlds;
+	std::vector<DirectX::XMFLOAT4X4> objectWorldITs;
+	std::vector<PerObjectData> objectMatrices;
+	double objectMatricesMs = 0;
+
+	// frustum culling against the active camera, see FrustumCulling::Cull()
+	bool frustumCulling = true;
+	FrustumCulling::Spheres entityBounds;
+	std::vector<uint32_t> visibleEntities;	// indices into lEntities
+	std::vector<uint8_t> entityVisible;
+	FrustumCulling::CullStats frustumStats = {};
+
+	// visible draws sorted to group state changes, see RenderQueue
+	bool renderSorting = true;
+	RenderQueue renderQueue;
+	RenderQueue::SortStats renderSortStats = {};
+	RenderQueue::StateChanges unsortedChanges = {};	// visibleEntities order
+	RenderQueue::StateChanges sortedChanges = {};
+
+	// render queue draws sharing a mesh, LOD and material drawn as one
+	// instanced draw, see Instancing
+	bool instancing = true;
+	int maxBatchInstances = 1024;
+	std::vector<uint64_t> batchKeys;	// per render queue item
+	Instancing::Batches instanceBatches;
+	Instancing::Stats instancingStats = {};
+	std::vector<uint32_t> instanceEntities;
+	std::vector<InstanceData> instanceData;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+
+	// main pass batches recorded into command buffers across threads,
+	// merged in queue order and run by one backend, see CommandBuffer
+	// - Null and Validation draw nothing, they're for measuring and
+	//   checking what gets recorded
+	enum CommandBackendType { D3D11Backend, NullBackend, ValidationBackend };
+	bool recordDraws = false;
+	int commandBackend = D3D11Backend;
+	struct DrawRecorder
+	{
+		CommandBuffer commands;
+		ShaderConstants vs;
+		ShaderConstants ps;
+		std::vector<Light> lights;		// per entity lights
+	};
+	std::vector<DrawRecorder> drawRecorders;	// one per run of batches
+	CommandBuffer frameCommands;
+	D3D11CommandBackend d3d11Backend;
+	NullCommandBackend nullBackend;
+	ValidationCommandBackend validationBackend;
+	struct RecordStats
+	{
+		uint32_t chunks;
+		uint32_t commands;
+		size_t bytes;
+		double recordMs;		// recording and merging
+		double executeMs;
+	};
+	RecordStats recordStats = {};
+
+	// shadow casters against each cascade, see FrustumCulling::ExtractCasterPlanes()
+	bool shadowCasterCulling = true;
+	float shadowCasterReach = 100.0f;	// how far in front of a cascade casters still count
+	FrustumCulling::CullStats shadowCasterStats = {};	// all cascades together
+
+	// input assembler binds last frame, see GeometryPool::Bind()
+	GeometryPool::BindStats geometryBindStats = {};
+
+	// every pipeline bind last frame, see StateCache
+	StateCache::Stats stateCacheStats = {};
+
+	// viewport picking, see Game::PickEntity()
+	bool pickPending = false;		// left button went down outside the UI
+	int pickMouseX = 0;
+	int pickMouseY = 0;
+	std::string pickedName;			// last pick, empty if it missed
+	RayHit pickHit = {};
+	double pickMs = 0;
+
 
 	// texture loading helper methods
 	void LoadPBRTexture(
@@ -108,10 +295,20 @@ private:
 	);
 
 	// helper methods
+	void PickEntity(int mouseX, int mouseY);
 	void ResizePostProcessResources();
 	void CreateShadowMapResources();
-	void ResizeShadowMap();
 	void EditShadowMapLight(Light light, float distance);
+	void FitShadowCascades();
+	void SetExtraLights(int count);
+	void SetExtraEntities(int count);
+	void UpdateInstanceBuffer();
+	void RecordMainPass(float dt, float tt, const DirectX::XMFLOAT2& clusterScreenScale, const DirectX::XMFLOAT3& camForward);
+	void UpdateStructuredBuffer(
+		Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer,
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
+		const void* data, UINT stride, size_t count);
+	void DrawShadowCasters(const std::vector<uint32_t>& casters, const std::vector<ShadowCasterState>& states);
 	std::shared_ptr<Sky> SkyHelper(
 		const char* path, std::shared_ptr<Mesh> cube,
 		std::shared_ptr<SimpleVertexShader> skyVS, std::shared_ptr<SimplePixelShader> skyPS,
@@ -135,11 +332,12 @@ private:
 		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughness,
 		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metal
 	);
-	std::shared_ptr<Mesh> MeshHelper(const char* name);
+	std::shared_ptr<Mesh> MeshHelper(const char* name, const MeshLoadOptions& options = MeshLoadOptions());
 	void EntityHelper(const char* name, std::shared_ptr<Mesh> mesh, 
 		std::shared_ptr<Material> mat, DirectX::XMFLOAT3 translate, 
 		DirectX::XMFLOAT3 scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
 	std::shared_ptr<SimpleVertexShader> VSHelper(const std::wstring& filename);
+	std::shared_ptr<SimpleVertexShader> PackedVSHelper(const std::wstring& filename, bool instanced = false);
 	std::shared_ptr<SimplePixelShader> PSHelper(const std::wstring& filename);
 
 	// === UI Helpers =============
@@ -179,4 +377,193 @@ private:
 	void UIRenderPasses();
 	void UIDetailsBlur();
 	void UIDetailsChromaticAberration();
+
+	// benchmarks
+	std::vector<MeshLoader::OBJBenchmarkResult> objBenchResults;
+	void UIBenchmarks();
+	void UIBenchmarkOBJ();
+	std::vector<MeshLoader::ParallelOBJBenchmarkResult> parallelOBJBenchResults;
+	size_t parallelOBJBenchBytes = 0;
+	void UIBenchmarkParallelOBJ();
+	void UIBenchmarkWelding();
+	struct MeshCacheBenchResult
+	{
+		std::string file;
+		double objMs;
+		double cacheMs;
+	};
+	std::vector<MeshCacheBenchResult> meshCacheBenchResults;
+	void UIBenchmarkMeshCache();
+	struct VertexCacheBenchResult
+	{
+		std::string file;
+		size_t triangles;
+		MeshOptimizer::CacheStats before;
+		MeshOptimizer::CacheStats after;
+		double ms;
+	};
+	std::vector<VertexCacheBenchResult> vertexCacheBenchResults;
+	void UIBenchmarkVertexCache();
+	struct VertexPackingBenchResult
+	{
+		std::string file;
+		size_t vertices;
+		VertexPacking::PackingError error;
+		bool packed;
+	};
+	std::vector<VertexPackingBenchResult> vertexPackingBenchResults;
+	void UIBenchmarkVertexPacking();
+	struct LODBenchResult
+	{
+		std::string file;
+		std::vector<MeshLOD> lods;
+		double ms;
+	};
+	std::vector<LODBenchResult> lodBenchResults;
+	void UIBenchmarkLOD();
+	struct MeshletBenchResult
+	{
+		std::string file;
+		std::string view;
+		Meshlets::CullStats stats;
+		double us;
+	};
+	std::vector<MeshletBenchResult> meshletBenchResults;
+	void UIBenchmarkMeshlets();
+	struct TangentBenchResult
+	{
+		std::string method;
+		unsigned int threads;
+		double ms;
+		float maxDifference;	// largest component difference from the scalar tangents
+	};
+	std::vector<TangentBenchResult> tangentBenchResults;
+	size_t tangentBenchTriangles = 0;
+	void UIBenchmarkTangents();
+	struct BVHBenchResult
+	{
+		std::string file;
+		size_t triangles;
+		BVH::BuildStats build;
+		double closestRaysPerSec;
+		double anyRaysPerSec;
+		double bruteRaysPerSec;
+		size_t hits;
+		size_t mismatches;		// rays where the BVH and brute force disagree
+	};
+	std::vector<BVHBenchResult> bvhBenchResults;
+	void UIBenchmarkBVH();
+	struct AllocatorBenchResult
+	{
+		int operations;
+		int grows;				// allocations that needed Grow() first
+		double us;				// per operation
+		RangeAllocator::Stats stats;
+		bool valid;				// RangeAllocator::Validate() after every operation
+	};
+	std::vector<AllocatorBenchResult> allocatorBenchResults;
+	void UIBenchmarkAllocator();
+	struct HierarchyBenchResult
+	{
+		int nodes;
+		int maxDepth;
+		float dirtyPercent;
+		unsigned int updated;	// after dirty flags spread to children
+		double ms;
+		double naiveMs;			// every node multiplying its way up to the root
+		float maxDifference;
+	};
+	std::vector<HierarchyBenchResult> hierarchyBenchResults;
+	void UIBenchmarkHierarchy();
+	struct TransformBenchResult
+	{
+		const char* path;
+		int transforms;
+		double ms;
+		double matricesPerSec;	// world and inverse transpose pairs
+		float maxDifference;	// against the per object path
+	};
+	std::vector<TransformBenchResult> transformBenchResults;
+	void UIBenchmarkTransforms();
+	struct RotationBenchResult
+	{
+		const char* operation;
+		int calls;
+		double ns;				// per call
+		float maxErrorDegrees;	// against the euler/per call reference
+	};
+	std::vector<RotationBenchResult> rotationBenchResults;
+	void UIBenchmarkRotations();
+	struct ObjectMatrixBenchResult
+	{
+		const char* path;
+		int entities;
+		double ms;
+		float maxDifference;	// relative, against the per vertex order
+	};
+	std::vector<ObjectMatrixBenchResult> objectMatrixBenchResults;
+	void UIBenchmarkObjectMatrices();
+	struct ClusterBenchResult
+	{
+		uint32_t lights;
+		unsigned int threads;
+		double ms;				// best of the runs
+		uint32_t indices;
+		uint32_t maxPerCluster;
+		uint32_t checked;		// sampled points a light reaches
+		uint32_t missing;		// of those, cluster lists without the light
+		bool matchesSerial;		// same lists as one thread
+	};
+	std::vector<ClusterBenchResult> clusterBenchResults;
+	void UIBenchmarkLightClusters();
+	struct EntityLightBenchResult
+	{
+		uint32_t lights;
+		uint32_t entities;		// in view
+		double assignMs;		// best of the runs
+		float perEntity;		// lights in the average list
+		double allMs;			// modelled shading, the first MAX_LIGHTS lights per pixel
+		double listedMs;		// modelled shading, only the entity's list
+		uint32_t checked;		// sampled points a light reaches
+		uint32_t missing;		// of those, lights left off a list with room
+	};
+	std::vector<EntityLightBenchResult> entityLightBenchResults;
+	double entityLightShadeNs = 0;	// the cost model's time for one light at one pixel
+	void UIBenchmarkEntityLights();
+	struct RenderQueueBenchResult
+	{
+		uint32_t items;
+		double radixMs;			// best of the runs
+		uint32_t passes;
+		double stdSortMs;		// std::stable_sort() of the same items
+		RenderQueue::StateChanges unsorted;
+		RenderQueue::StateChanges sorted;
+		bool matches;			// same order as std::stable_sort()
+	};
+	std::vector<RenderQueueBenchResult> renderQueueBenchResults;
+	void UIBenchmarkRenderQueue();
+	struct InstancingBenchResult
+	{
+		uint32_t draws;
+		uint32_t groups;		// distinct mesh and material pairs
+		uint32_t batches;		// draw calls left
+		double buildMs;			// best of the runs
+		double packMs;
+		bool passed;			// every draw once, batches hold one key, packed matrices match
+	};
+	std::vector<InstancingBenchResult> instancingBenchResults;
+	void UIBenchmarkInstancing();
+	struct CommandBufferBenchResult
+	{
+		uint32_t draws;
+		unsigned int threads;
+		uint32_t commands;
+		size_t bytes;
+		double recordMs;		// best of the runs, merging included
+		double nullMs;			// NullCommandBackend over the merged buffer
+		double perThread;		// commands recorded per second per thread
+		bool passed;			// same bytes as one thread, nothing for validation to report
+	};
+	std::vector<CommandBufferBenchResult> commandBufferBenchResults;
+	void UIBenchmarkCommandBuffers();
 };
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include "Graphics.h"
 #include "BufferStructs.h"
 #include "Camera.h"
+#include "StateCache.h"
 
+#include <cmath>
 #include <memory>
 #include <DirectXMath.h>
 
@@ -17,26 +19,216 @@ GameEntity::GameEntity(const char* name, std::shared_ptr<Mesh> mesh, std::shared
 GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat) 
 	: GameEntity("Entity", std::move(mesh), std::move(mat)) {}
 
-void GameEntity::Draw(std::shared_ptr<Camera> cam, float dt, float tt)
+const std::shared_ptr<SimpleVertexShader> GameEntity::GetVertexShader() const
 {
-	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
+	return mesh->IsPacked() ? material->GetPackedVertexShader() : material->GetVertexShader();
+}
+
+const std::shared_ptr<SimpleVertexShader> GameEntity::GetInstancedVertexShader() const
+{
+	std::shared_ptr<SimpleVertexShader> vs = mesh->IsPacked() ?
+		material->GetPackedInstancedVertexShader() : material->GetInstancedVertexShader();
+	return vs && vs->GetPerInstanceCompatible() ? vs : nullptr;
+}
+
+int GameEntity::SelectLOD(std::shared_ptr<Camera> cam, float viewportHeight, float errorPixels, float cullPixels)
+{
+	// world space bounding sphere, scaled by the largest axis
+	XMFLOAT4X4 world = transform->GetWorldMatrix();
+	XMMATRIX mWorld = XMLoadFloat4x4(&world);
+	XMFLOAT3 localCenter = mesh->GetBoundsCenter();
+	XMVECTOR center = XMVector3Transform(XMLoadFloat3(&localCenter), mWorld);
+	float scale = XMVectorGetX(XMVectorMax(XMVector3Length(mWorld.r[0]),
+		XMVectorMax(XMVector3Length(mWorld.r[1]), XMVector3Length(mWorld.r[2]))));
+	float radius = mesh->GetBoundsRadius() * scale;
+
+	// pixels per world unit at the sphere's distance
+	XMFLOAT4X4 proj = cam->GetProjection();
+	float pixelsPerUnit = proj._22 * viewportHeight * 0.5f;
+	if (cam->GetProjectionType() == CameraProjectionType::Perspective) {
+		XMFLOAT3 camPos = cam->GetTransform()->GetWorldPosition();
+		float distance = XMVectorGetX(XMVector3Length(center - XMLoadFloat3(&camPos)));
+
+		// camera is inside the sphere
+		if (distance <= radius) return lod = 0;
+		pixelsPerUnit /= distance;
+	}
+
+	if (2.0f * radius * pixelsPerUnit < cullPixels) return lod = -1;
+
+	// errors only grow with the level, keep the last one that fits
+	lod = 0;
+	for (UINT i = 1; i < mesh->GetLODCount(); i++)
+		if (mesh->GetLOD(i).error * scale * pixelsPerUnit <= errorPixels) lod = (int)i;
+	return lod;
+}
+
+Meshlets::CullStats GameEntity::CullMeshlets(std::shared_ptr<Camera> cam)
+{
+	XMFLOAT4X4 world = transform->GetWorldMatrix();
+	XMFLOAT4X4 view = cam->GetView();
+	XMFLOAT4X4 proj = cam->GetProjection();
+	XMMATRIX mWorld = XMLoadFloat4x4(&world);
+	XMFLOAT4X4 wvp;
+	XMStoreFloat4x4(&wvp, mWorld * XMLoadFloat4x4(&view) * XMLoadFloat4x4(&proj));
+
+	// the camera in the mesh's local space
+	XMFLOAT3 camPos = cam->GetTransform()->GetWorldPosition();
+	XMFLOAT3 localCamPos;
+	XMStoreFloat3(&localCamPos, XMVector3Transform(XMLoadFloat3(&camPos), XMMatrixInverse(nullptr, mWorld)));
+
+	// normal cones only hold up under a positive uniform scale, and
+	// need a single eye point, so no orthographic cameras
+	// - world scale, so a parent's scale counts too
+	XMFLOAT3 scale(
+		XMVectorGetX(XMVector3Length(mWorld.r[0])),
+		XMVectorGetX(XMVector3Length(mWorld.r[1])),
+		XMVectorGetX(XMVector3Length(mWorld.r[2])));
+	bool backfaceCulling =
+		cam->GetProjectionType() == CameraProjectionType::Perspective &&
+		XMVectorGetX(XMMatrixDeterminant(mWorld)) > 0 && scale.x > 0 &&
+		fabsf(scale.x - scale.y) <= 0.01f * scale.x && fabsf(scale.x - scale.z) <= 0.01f * scale.x;
+
+	// made here, not where the culled draw might be recorded
+	mesh->GetCulledIndexBuffer();
+
+	meshletCulled = true;
+	return Meshlets::Cull(mesh->GetMeshlets(), mesh->GetMeshletIndices(), wvp, localCamPos, backfaceCulling, visibleIndices);
+}
+
+bool GameEntity::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float tMax, RayHit& hit)
+{
+	if (!mesh || mesh->GetBVH().IsEmpty()) return false;
+
+	// into local space, the direction isn't renormalized so t means
+	// the same thing on both sides
+	XMFLOAT4X4 world = transform->GetWorldMatrix();
+	XMMATRIX invWorld = XMMatrixInverse(nullptr, XMLoadFloat4x4(&world));
+	XMFLOAT3 localOrigin, localDirection;
+	XMStoreFloat3(&localOrigin, XMVector3TransformCoord(XMLoadFloat3(&origin), invWorld));
+	XMStoreFloat3(&localDirection, XMVector3TransformNormal(XMLoadFloat3(&direction), invWorld));
+
+	return mesh->GetBVH().ClosestHit(localOrigin, localDirection, tMax, hit);
+}
+
+void GameEntity::Draw(std::shared_ptr<Camera> cam, const PerObjectData& matrices, float dt, float tt)
+{
+	std::shared_ptr<SimpleVertexShader> vs = GetVertexShader();
 	std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
 
+	// packed mesh on a material that can't read it
+	if (!vs) return;
+
 	// activate shaders
-	vs->SetShader();
-	ps->SetShader();
+	StateCache::SetShader(vs.get());
+	StateCache::SetShader(ps.get());
 
 	// set vertex shader data
 	vs->SetMatrix4x4("mWorld", transform->GetWorldMatrix());
 	vs->SetMatrix4x4("mWorldIT", transform->GetWorldInverseTransposeMatrix());
-	vs->SetMatrix4x4("mView", cam->GetView());
-	vs->SetMatrix4x4("mProj", cam->GetProjection());
+	vs->SetMatrix4x4("mWorldViewProj", matrices.worldViewProj);
+	vs->SetMatrix4x4("mWorldViewProjLight", matrices.lightWorldViewProj);
 	vs->SetFloat("dt", dt);
 	vs->SetFloat("tt", tt);
+	if (mesh->IsPacked()) {
+		vs->SetFloat3("positionMin", mesh->GetQuantization().positionMin);
+		vs->SetFloat3("positionScale", mesh->GetQuantization().positionScale);
+	}
 	vs->CopyAllBufferData();
 
+	PreparePixelShader(cam, dt, tt);
+
+	// draw mesh
+	if (meshletCulled)
+		mesh->DrawIndices(visibleIndices);
+	else
+		mesh->Draw(lod > 0 ? lod : 0);
+}
+
+void GameEntity::DrawInstances(std::shared_ptr<Camera> cam, UINT firstInstance, UINT instanceCount, float dt, float tt)
+{
+	std::shared_ptr<SimpleVertexShader> vs = GetInstancedVertexShader();
+	std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
+	if (!vs) return;
+
+	// activate shaders
+	StateCache::SetShader(vs.get());
+	StateCache::SetShader(ps.get());
+
+	// matrices come from the instances, only the mesh's data is left
+	if (mesh->IsPacked()) {
+		vs->SetFloat3("positionMin", mesh->GetQuantization().positionMin);
+		vs->SetFloat3("positionScale", mesh->GetQuantization().positionScale);
+	}
+	vs->CopyAllBufferData();
+
+	PreparePixelShader(cam, dt, tt);
+
+	mesh->DrawInstances(lod > 0 ? lod : 0, firstInstance, instanceCount);
+}
+
+void GameEntity::Record(CommandBuffer& commands, ShaderConstants& vs, ShaderConstants& ps, const XMFLOAT3& camPos,
+	const XMFLOAT4X4& world, const XMFLOAT4X4& worldInverseTranspose, const PerObjectData& matrices,
+	float dt, float tt, UINT firstInstance, UINT instanceCount)
+{
+	bool instanced = instanceCount > 0;
+	std::shared_ptr<SimpleVertexShader> vertexShader = instanced ? GetInstancedVertexShader() : GetVertexShader();
+	std::shared_ptr<SimplePixelShader> pixelShader = material->GetPixelShader();
+	if (!vertexShader) return;
+
+	commands.SetVertexShader(vertexShader->GetDirectXShader().Get(), vertexShader->GetInputLayout().Get());
+	commands.SetPixelShader(pixelShader->GetDirectXShader().Get());
+
+	// vertex shader data, instances bring their own matrices
+	vs.Begin(vertexShader.get());
+	if (!instanced) {
+		vs.SetMatrix4x4("mWorld", world);
+		vs.SetMatrix4x4("mWorldIT", worldInverseTranspose);
+		vs.SetMatrix4x4("mWorldViewProj", matrices.worldViewProj);
+		vs.SetMatrix4x4("mWorldViewProjLight", matrices.lightWorldViewProj);
+		vs.SetFloat("dt", dt);
+		vs.SetFloat("tt", tt);
+	}
+	if (mesh->IsPacked()) {
+		vs.SetFloat3("positionMin", mesh->GetQuantization().positionMin);
+		vs.SetFloat3("positionScale", mesh->GetQuantization().positionScale);
+	}
+	vs.Record(commands, ShaderStage::Vertex);
+
+	// pixel shader data, as in PreparePixelShader()
+	ps.SetFloat3("v3CamPos", camPos);
+	ps.SetFloat3("colorTint", material->GetColorTint());
+	ps.SetFloat("roughness", material->GetRoughness());
+	ps.SetFloat2("uvScale", material->GetUvScale());
+	ps.SetFloat2("uvOffset", material->GetUvOffset());
+	ps.SetFloat("dt", dt);
+	ps.SetFloat("tt", tt);
+	ps.Record(commands, ShaderStage::Pixel);
+
+	// material textures, to the registers the shader reflects
+	for (auto& t : material->GetTextureSRVMap()) {
+		const SimpleSRV* info = pixelShader->GetShaderResourceViewInfo(t.first);
+		if (info) commands.SetShaderResource(ShaderStage::Pixel, info->BindIndex, t.second.Get());
+	}
+	for (auto& s : material->GetSamplerMap()) {
+		const SimpleSampler* info = pixelShader->GetSamplerInfo(s.first);
+		if (info) commands.SetSampler(ShaderStage::Pixel, info->BindIndex, s.second.Get());
+	}
+
+	if (instanced)
+		mesh->RecordInstances(commands, lod > 0 ? lod : 0, firstInstance, instanceCount);
+	else if (meshletCulled)
+		mesh->RecordIndices(commands, visibleIndices);
+	else
+		mesh->Record(commands, lod > 0 ? lod : 0);
+}
+
+void GameEntity::PreparePixelShader(std::shared_ptr<Camera> cam, float dt, float tt)
+{
+	std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
+
 	// set pixel shader data
-	ps->SetFloat3("v3CamPos", cam->GetTransform()->GetPosition());
+	ps->SetFloat3("v3CamPos", cam->GetTransform()->GetWorldPosition());
 	ps->SetFloat3("colorTint", material->GetColorTint());
 	ps->SetFloat("roughness", material->GetRoughness());
 	ps->SetFloat2("uvScale", material->GetUvScale());
@@ -47,7 +239,4 @@ void GameEntity::Draw(std::shared_ptr<Camera> cam, float dt, float tt)
 
 	// prepare material
 	material->PrepareMaterial();
-
-	// draw mesh
-	mesh->Draw();
 }
\ No newline at end of file
@@ -4,8 +4,12 @@
 #include "Transform.h"
 #include "Camera.h"
 #include "Material.h"
+#include "BufferStructs.h"
+#include "CommandBuffer.h"
+#include "ShaderConstants.h"
 
 #include <memory>
+#include <vector>
 #include <DirectXMath.h>
 #include <wrl/client.h>
 class GameEntity
@@ -20,6 +24,22 @@ public:
 	const std::shared_ptr<Transform> GetTransform() const { return transform; }
 	const std::shared_ptr<Material> GetMaterial() const { return material; }
 	const char* GetName() const { return name; }
+
+	// material vertex shader that matches the mesh's vertex format
+	// - nullptr if the mesh is packed and the material has no packed shader
+	const std::shared_ptr<SimpleVertexShader> GetVertexShader() const;
+
+	// the same for instanced draws, see DrawInstances()
+	// - nullptr if the material has none or it takes no instance data
+	const std::shared_ptr<SimpleVertexShader> GetInstancedVertexShader() const;
+
+	// level of detail from the last SelectLOD(), -1 if too small to draw
+	int GetLOD() const { return lod; }
+
+	// static entities don't move, so their shadow can be cached
+	// - See Game::shadowStaticSplit
+	bool IsStatic() const { return isStatic; }
+	void SetStatic(bool s) { isStatic = s; }
 	
 	// setters
 	void SetName(const char* name) { name = name; }
@@ -27,8 +47,40 @@ public:
 	void SetTransform(std::shared_ptr<Transform> t) { transform = t; }
 	void SetMaterial(std::shared_ptr<Material> mat) { material = mat; }
 
-	// draw method
-	void Draw(std::shared_ptr<Camera> cam, float dt, float tt);
+	// Picks the coarsest mesh LOD whose error projects to at most
+	// "errorPixels", or -1 if the bounding sphere is less than
+	// "cullPixels" across on screen
+	int SelectLOD(std::shared_ptr<Camera> cam, float viewportHeight, float errorPixels, float cullPixels);
+
+	// Culls the mesh's meshlets against the camera, Draw() then only
+	// draws the survivors until ClearMeshletCulling()
+	Meshlets::CullStats CullMeshlets(std::shared_ptr<Camera> cam);
+	void ClearMeshletCulling() { meshletCulled = false; }
+	bool IsMeshletCulled() const { return meshletCulled; }
+
+	// Casts a world space ray against the mesh's BVH, "hit.t" is in
+	// units of "direction" so hits on different entities compare
+	// - False if nothing is hit or the mesh has no BVH
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float tMax, RayHit& hit);
+
+	// draw method - "matrices" are this entity's from ObjectMatrices::Build()
+	void Draw(std::shared_ptr<Camera> cam, const PerObjectData& matrices, float dt, float tt);
+
+	// draws this entity's mesh, LOD and material once per instance in
+	// the instance buffer bound to input slot 1 (see Instancing), the
+	// entity's own transform isn't used
+	// - Always the whole LOD, meshlet culled entities aren't batched
+	void DrawInstances(std::shared_ptr<Camera> cam, UINT firstInstance, UINT instanceCount, float dt, float tt);
+
+	// Draw(), or DrawInstances() when "instanceCount" isn't 0, recorded
+	// into "commands" so any thread can do it
+	// - "ps" has to be begun on the material's pixel shader, holding
+	//   whatever the caller sets per frame, the entity's own data is
+	//   added and it's recorded here
+	// - The world matrices are passed in, the transform isn't read
+	void Record(CommandBuffer& commands, ShaderConstants& vs, ShaderConstants& ps, const DirectX::XMFLOAT3& camPos,
+		const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& worldInverseTranspose, const PerObjectData& matrices,
+		float dt, float tt, UINT firstInstance = 0, UINT instanceCount = 0);
 private:
 	// mesh and transform pointers
 	std::shared_ptr<Mesh> mesh;
@@ -37,5 +89,17 @@ private:
 
 	// name member var
 	const char* name;
+
+	// current level of detail
+	int lod = 0;
+
+	bool isStatic = false;
+
+	// LOD 0 indices left after meshlet culling
+	bool meshletCulled = false;
+	std::vector<unsigned int> visibleIndices;
+
+	// pixel shader data and the material's textures, for either draw
+	void PreparePixelShader(std::shared_ptr<Camera> cam, float dt, float tt);
 };
 
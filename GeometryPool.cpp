@@ -0,0 +1,130 @@
+#include "GeometryPool.h"
+#include "Graphics.h"
+#include "StateCache.h"
+
+#include <unordered_map>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// pools by vertex stride, weak so they go away with their meshes
+	std::unordered_map<UINT, std::weak_ptr<GeometryPool>> pools;
+
+	GeometryPool::BindStats bindStats = {};
+
+	ComPtr<ID3D11Buffer> CreatePoolBuffer(UINT byteWidth, UINT bindFlags)
+	{
+		// default usage, meshes are written in with UpdateSubresource
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.ByteWidth = byteWidth;
+		desc.BindFlags = bindFlags;
+
+		ComPtr<ID3D11Buffer> buffer;
+		Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+		return buffer;
+	}
+}
+
+std::shared_ptr<GeometryPool> GeometryPool::Get(UINT vertexStride)
+{
+	std::shared_ptr<GeometryPool> pool = pools[vertexStride].lock();
+	if (!pool) {
+		pool = std::make_shared<GeometryPool>(vertexStride);
+		pools[vertexStride] = pool;
+	}
+	return pool;
+}
+
+std::vector<std::shared_ptr<GeometryPool>> GeometryPool::GetAll()
+{
+	std::vector<std::shared_ptr<GeometryPool>> all;
+	for (const auto& [stride, weak] : pools)
+		if (std::shared_ptr<GeometryPool> pool = weak.lock()) all.push_back(pool);
+	return all;
+}
+
+GeometryPool::GeometryPool(UINT vertexStride)
+	: vertexStride(vertexStride), vertexAllocator(INITIAL_VERTICES), indexAllocator(INITIAL_INDICES)
+{
+	vb = CreatePoolBuffer(vertexStride * INITIAL_VERTICES, D3D11_BIND_VERTEX_BUFFER);
+	ib = CreatePoolBuffer(sizeof(UINT) * INITIAL_INDICES, D3D11_BIND_INDEX_BUFFER);
+}
+
+GeometryPool::~GeometryPool()
+{
+	// a new buffer could land on the same address
+	StateCache::InvalidateInputAssembler();
+}
+
+UINT GeometryPool::Allocate(RangeAllocator& allocator, ComPtr<ID3D11Buffer>& buffer,
+	UINT elementSize, UINT bindFlags, UINT count)
+{
+	UINT offset = allocator.Allocate(count);
+	if (offset != RangeAllocator::INVALID_OFFSET) return offset;
+
+	// double until it would fit even with no free space at the end
+	UINT64 oldCapacity = allocator.GetCapacity();
+	UINT64 capacity = oldCapacity ? oldCapacity : 1;
+	while (capacity < oldCapacity + count) capacity *= 2;
+	if (capacity * elementSize > UINT_MAX) return RangeAllocator::INVALID_OFFSET;
+
+	ComPtr<ID3D11Buffer> bigger = CreatePoolBuffer((UINT)(capacity * elementSize), bindFlags);
+	if (!bigger) return RangeAllocator::INVALID_OFFSET;
+	if (buffer && oldCapacity) {
+		D3D11_BOX box = { 0, 0, 0, (UINT)(oldCapacity * elementSize), 1, 1 };
+		Graphics::Context->CopySubresourceRegion(bigger.Get(), 0, 0, 0, 0, buffer.Get(), 0, &box);
+	}
+	StateCache::InvalidateInputAssembler();
+	buffer = bigger;
+
+	allocator.Grow((uint32_t)capacity);
+	return allocator.Allocate(count);
+}
+
+bool GeometryPool::Add(const void* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, UINT& baseVertex, UINT& firstIndex)
+{
+	if (vertexCount == 0 || indexCount == 0) return false;
+
+	baseVertex = Allocate(vertexAllocator, vb, vertexStride, D3D11_BIND_VERTEX_BUFFER, vertexCount);
+	if (baseVertex == RangeAllocator::INVALID_OFFSET) return false;
+	firstIndex = Allocate(indexAllocator, ib, sizeof(UINT), D3D11_BIND_INDEX_BUFFER, indexCount);
+	if (firstIndex == RangeAllocator::INVALID_OFFSET) {
+		vertexAllocator.Free(baseVertex);
+		return false;
+	}
+
+	D3D11_BOX vertexBox = { baseVertex * vertexStride, 0, 0, (baseVertex + vertexCount) * vertexStride, 1, 1 };
+	Graphics::Context->UpdateSubresource(vb.Get(), 0, &vertexBox, vertices, 0, 0);
+	D3D11_BOX indexBox = { firstIndex * (UINT)sizeof(UINT), 0, 0, (firstIndex + indexCount) * (UINT)sizeof(UINT), 1, 1 };
+	Graphics::Context->UpdateSubresource(ib.Get(), 0, &indexBox, indices, 0, 0);
+	return true;
+}
+
+void GeometryPool::Remove(UINT baseVertex, UINT firstIndex)
+{
+	vertexAllocator.Free(baseVertex);
+	indexAllocator.Free(firstIndex);
+}
+
+void GeometryPool::Bind(ID3D11Buffer* indexBuffer)
+{
+	if (!indexBuffer) indexBuffer = ib.Get();
+
+	if (StateCache::SetVertexBuffer(0, vb.Get(), vertexStride)) bindStats.binds++;
+	else bindStats.skipped++;
+
+	if (StateCache::SetIndexBuffer(indexBuffer)) bindStats.binds++;
+	else bindStats.skipped++;
+}
+
+GeometryPool::BindStats GeometryPool::GetBindStats()
+{
+	return bindStats;
+}
+
+void GeometryPool::ResetBindStats()
+{
+	bindStats = {};
+}
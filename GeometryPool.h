@@ -0,0 +1,78 @@
+#pragma once
+
+#include "RangeAllocator.h"
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+
+// --------------------------------------------------------
+// One big vertex buffer and one big index buffer shared by
+// every mesh with the same vertex stride
+// - Meshes get a base vertex and first index from the
+//   RangeAllocators, and their indices stay mesh relative
+//   (DrawIndexed adds the base vertex)
+// - Full buffers are replaced by twice the size, copying the
+//   old contents on the GPU, so offsets never move
+// --------------------------------------------------------
+class GeometryPool
+{
+public:
+	static constexpr UINT INITIAL_VERTICES = 1 << 16;
+	static constexpr UINT INITIAL_INDICES = 1 << 18;
+
+	// IASetVertexBuffers/IASetIndexBuffer calls made by Bind() vs
+	// ones it skipped because the buffer was already bound
+	struct BindStats
+	{
+		UINT binds;
+		UINT skipped;
+	};
+
+	// The pool for a vertex stride, created on first use and
+	// destroyed with the last mesh holding it
+	static std::shared_ptr<GeometryPool> Get(UINT vertexStride);
+
+	// Every pool that currently exists
+	static std::vector<std::shared_ptr<GeometryPool>> GetAll();
+
+	GeometryPool(UINT vertexStride);
+	~GeometryPool();
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	// Copies a mesh in, growing the buffers if needed
+	// - False if either count is 0 or the buffers couldn't grow
+	bool Add(const void* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, UINT& baseVertex, UINT& firstIndex);
+
+	// Frees what Add() returned
+	void Remove(UINT baseVertex, UINT firstIndex);
+
+	// Sets the pool's buffers on the input assembler through the
+	// StateCache, which skips either one that's already bound
+	// - "indexBuffer" replaces the pool's own, e.g. a mesh's culled
+	//   indices, which still use the pool's base vertex
+	void Bind(ID3D11Buffer* indexBuffer = nullptr);
+
+	static BindStats GetBindStats();
+	static void ResetBindStats();
+
+	UINT GetVertexStride() const { return vertexStride; }
+	RangeAllocator::Stats GetVertexStats() const { return vertexAllocator.GetStats(); }
+	RangeAllocator::Stats GetIndexStats() const { return indexAllocator.GetStats(); }
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vb; }
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return ib; }
+
+private:
+	UINT vertexStride;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vb;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> ib;
+	RangeAllocator vertexAllocator;
+	RangeAllocator indexAllocator;
+
+	// allocates "count" elements, replacing the buffer with a bigger
+	// one first if there's no room
+	UINT Allocate(RangeAllocator& allocator, Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer,
+		UINT elementSize, UINT bindFlags, UINT count);
+};
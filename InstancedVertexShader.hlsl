@@ -0,0 +1,24 @@
+
+#include "ShaderStructs.hlsli"
+
+// --------------------------------------------------------
+// VertexShader.hlsl for instanced draws, each instance's
+// matrices come from the instance buffer instead of cbuffers
+// --------------------------------------------------------
+VertexToPixel main( VertexShaderInput input, InstanceInput instance )
+{
+	// Set up output struct
+	VertexToPixel output;
+	
+    output.screenPosition = mul(float4(input.localPosition, 1.0f), instance.worldViewProj);
+
+	// pass through other data
+    output.uv = input.uv;
+    output.normal = mul(input.normal, (float3x3) instance.worldIT);
+    output.tangent = mul(input.tangent, (float3x3) instance.world);
+    output.worldPosition = mul(float4(input.localPosition, 1), instance.world).xyz;
+    
+    output.shadowMapPos = mul(float4(input.localPosition, 1.0f), instance.lightWorldViewProj);
+    
+	return output;
+}
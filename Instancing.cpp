@@ -0,0 +1,61 @@
+#include "Instancing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+Instancing::Stats Instancing::Build(const uint64_t* keys, size_t count, uint32_t maxInstances, Batches& out)
+{
+	auto start = std::chrono::steady_clock::now();
+	Stats stats = {};
+	stats.draws = (uint32_t)count;
+	if (maxInstances == 0) maxInstances = 1;
+
+	// group of each draw, groups numbered as they're first seen
+	std::unordered_map<uint64_t, uint32_t> groupOfKey;
+	std::vector<uint32_t> groupOfDraw(count);
+	std::vector<uint32_t> groupSizes;
+	groupOfKey.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		uint32_t group = (uint32_t)groupSizes.size();
+		if (keys[i] != NO_BATCH) group = groupOfKey.try_emplace(keys[i], group).first->second;
+		if (group == groupSizes.size()) groupSizes.push_back(0);
+		groupOfDraw[i] = group;
+		groupSizes[group]++;
+	}
+
+	// counting sort of the draws by group, then cut each group into batches
+	std::vector<uint32_t> groupStarts(groupSizes.size());
+	uint32_t offset = 0;
+	for (size_t g = 0; g < groupSizes.size(); g++) {
+		groupStarts[g] = offset;
+		offset += groupSizes[g];
+	}
+	out.draws.resize(count);
+	out.batches.clear();
+	for (size_t g = 0; g < groupSizes.size(); g++) {
+		for (uint32_t first = 0; first < groupSizes[g]; first += maxInstances) {
+			Batch batch = { groupStarts[g] + first, (std::min)(maxInstances, groupSizes[g] - first) };
+			out.batches.push_back(batch);
+			if (batch.count > 1) stats.instanced += batch.count;
+			stats.largest = (std::max)(stats.largest, batch.count);
+		}
+	}
+	for (size_t i = 0; i < count; i++) out.draws[groupStarts[groupOfDraw[i]]++] = (uint32_t)i;
+
+	stats.batches = (uint32_t)out.batches.size();
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+void Instancing::Pack(const uint32_t* entities, size_t count, const DirectX::XMFLOAT4X4* worlds,
+	const DirectX::XMFLOAT4X4* worldInverseTransposes, const PerObjectData* objects, InstanceData* out)
+{
+	for (size_t k = 0; k < count; k++) {
+		uint32_t e = entities[k];
+		out[k].world = worlds[e];
+		out[k].worldInverseTranspose = worldInverseTransposes[e];
+		out[k].worldViewProj = objects[e].worldViewProj;
+		out[k].lightWorldViewProj = objects[e].lightWorldViewProj;
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "BufferStructs.h"
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Automatic instancing - draws with the same batch key (the
+// same mesh, LOD and material) are gathered into batches that
+// each become one instanced draw, with every draw's matrices
+// packed into an instance buffer
+// - Nothing here touches the graphics API, the caller uploads
+//   the packed InstanceData and issues the draws
+// --------------------------------------------------------
+namespace Instancing
+{
+	// a draw that can't be instanced, it gets a batch of its own
+	static constexpr uint64_t NO_BATCH = UINT64_MAX;
+
+	// batch key of a draw - 24 bits of material and mesh id each
+	// (Material::GetId(), Mesh::GetId(), unmasked, so past 16M of
+	// either ever made they'd need more room) and 16 of LOD
+	constexpr uint64_t MakeKey(uint32_t material, uint32_t mesh, uint32_t lod)
+	{
+		return (uint64_t)material << 40 | (uint64_t)mesh << 16 | lod;
+	}
+
+	// "count" draws starting at "first" in Batches::draws, and at
+	// instance "first" in what Pack() wrote
+	struct Batch
+	{
+		uint32_t first;
+		uint32_t count;
+	};
+
+	struct Batches
+	{
+		std::vector<uint32_t> draws;	// indices into the keys, grouped by batch
+		std::vector<Batch> batches;
+	};
+
+	struct Stats
+	{
+		uint32_t draws;
+		uint32_t batches;
+		uint32_t instanced;		// draws in batches of two or more
+		uint32_t largest;
+		double ms;
+	};
+
+	// Batches for draws with "keys", in the order each batch's first
+	// draw comes, draws keeping their order within a batch
+	// - Batches hold at most "maxInstances" draws, bigger groups split
+	Stats Build(const uint64_t* keys, size_t count, uint32_t maxInstances, Batches& out);
+
+	// out[k] is the instance data of entity "entities[k]", from its
+	// world matrices and PerObjectData
+	void Pack(const uint32_t* entities, size_t count, const DirectX::XMFLOAT4X4* worlds,
+		const DirectX::XMFLOAT4X4* worldInverseTransposes, const PerObjectData* objects, InstanceData* out);
+}
@@ -0,0 +1,255 @@
+#include "LightClusters.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// lights per task when moving them into view space
+	constexpr size_t LIGHT_BLOCK = 256;
+
+	// view space x (or y, with the other column) at a normalized device
+	// coordinate and depth, for perspective and orthographic projections
+	float Unproject(float ndc, float z, float scale, float zScale, float offset, const XMFLOAT4X4& p)
+	{
+		float w = z * p._34 + p._44;
+		return (ndc * w - z * zScale - offset) / scale;
+	}
+
+	float Project(float v, float z, float scale, float zScale, float offset, const XMFLOAT4X4& p)
+	{
+		return (v * scale + z * zScale + offset) / (z * p._34 + p._44);
+	}
+
+	uint32_t ClampCell(float f, uint32_t cells)
+	{
+		if (f < 0) return 0;
+		return f >= cells ? cells - 1 : (uint32_t)f;
+	}
+}
+
+// ====== Grid ================================================================================
+
+void LightClusters::SetProjection(const XMFLOAT4X4& newProjection, float newNear, float newFar)
+{
+	if (!boxMin.empty() && nearClip == newNear && farClip == newFar &&
+		memcmp(&projection, &newProjection, sizeof(projection)) == 0)
+		return;
+	projection = newProjection;
+	nearClip = newNear;
+	farClip = newFar;
+
+	// exponential slices, near * (far / near)^(slice / GRID_Z)
+	float logRatio = logf(farClip / nearClip);
+	depthScaleBias = XMFLOAT2(GRID_Z / logRatio, -(float)GRID_Z * logf(nearClip) / logRatio);
+
+	boxMin.resize(CLUSTER_COUNT);
+	boxMax.resize(CLUSTER_COUNT);
+	for (uint32_t z = 0; z < GRID_Z; z++) {
+		float depths[2] = {
+			nearClip * powf(farClip / nearClip, (float)z / GRID_Z),
+			nearClip * powf(farClip / nearClip, (float)(z + 1) / GRID_Z) };
+		for (uint32_t y = 0; y < GRID_Y; y++) {
+			// top row first, like the screen
+			float ndcY[2] = { 1.0f - 2.0f * (y + 1) / GRID_Y, 1.0f - 2.0f * y / GRID_Y };
+			for (uint32_t x = 0; x < GRID_X; x++) {
+				float ndcX[2] = { -1.0f + 2.0f * x / GRID_X, -1.0f + 2.0f * (x + 1) / GRID_X };
+
+				XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+				XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+				for (int c = 0; c < 8; c++) {
+					float depth = depths[c >> 2];
+					XMVECTOR corner = XMVectorSet(
+						Unproject(ndcX[c & 1], depth, projection._11, projection._31, projection._41, projection),
+						Unproject(ndcY[(c >> 1) & 1], depth, projection._22, projection._32, projection._42, projection),
+						depth, 0);
+					lo = XMVectorMin(lo, corner);
+					hi = XMVectorMax(hi, corner);
+				}
+				uint32_t cluster = x + GRID_X * (y + GRID_Y * z);
+				XMStoreFloat3(&boxMin[cluster], lo);
+				XMStoreFloat3(&boxMax[cluster], hi);
+			}
+		}
+	}
+}
+
+// ====== Light bounds ========================================================================
+
+bool LightClusters::ToView(const XMFLOAT4X4& view, const Light& light, uint32_t index, ViewLight& out) const
+{
+	if (light.Type != LIGHT_TYPE_POINT && light.Type != LIGHT_TYPE_SPOT) return false;
+
+	XMMATRIX v = XMLoadFloat4x4(&view);
+	XMVECTOR apex = XMVector3TransformCoord(XMLoadFloat3(&light.Position), v);
+	out.index = index;
+	out.range = light.Range;
+	out.spot = light.Type == LIGHT_TYPE_SPOT;
+
+	if (out.spot) {
+		// the cone's own bounding sphere, tighter than its range's
+		XMVECTOR direction = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.Direction), v));
+		float angle = fminf(light.SpotOuterAngle, XM_PIDIV2);
+		out.cosAngle = cosf(angle);
+		out.sinAngle = sinf(angle);
+		XMStoreFloat3(&out.apex, apex);
+		XMStoreFloat3(&out.direction, direction);
+		if (angle > XM_PIDIV4) {
+			XMStoreFloat3(&out.center, apex + direction * (out.cosAngle * light.Range));
+			out.radius = out.sinAngle * light.Range;
+		}
+		else {
+			out.radius = light.Range / (2.0f * out.cosAngle);
+			XMStoreFloat3(&out.center, apex + direction * out.radius);
+		}
+	}
+	else {
+		XMStoreFloat3(&out.center, apex);
+		out.radius = light.Range;
+	}
+
+	// depth slices
+	float zMin = out.center.z - out.radius;
+	float zMax = out.center.z + out.radius;
+	if (zMax < nearClip || zMin > farClip || out.radius <= 0) return false;
+	zMin = fmaxf(zMin, nearClip);
+	zMax = fminf(zMax, farClip);
+	out.sliceMin = ClampCell(floorf(logf(zMin) * depthScaleBias.x + depthScaleBias.y), GRID_Z);
+	out.sliceMax = ClampCell(floorf(logf(zMax) * depthScaleBias.x + depthScaleBias.y), GRID_Z);
+
+	// tiles, from the sphere's view box projected at both ends of its depth
+	// range - either end is the extreme for a fixed x or y
+	float ndc[2][2] = { { FLT_MAX, -FLT_MAX }, { FLT_MAX, -FLT_MAX } };
+	for (float z : { zMin, zMax }) {
+		for (float side : { -out.radius, out.radius }) {
+			float x = Project(out.center.x + side, z, projection._11, projection._31, projection._41, projection);
+			float y = Project(out.center.y + side, z, projection._22, projection._32, projection._42, projection);
+			ndc[0][0] = fminf(ndc[0][0], x);
+			ndc[0][1] = fmaxf(ndc[0][1], x);
+			ndc[1][0] = fminf(ndc[1][0], y);
+			ndc[1][1] = fmaxf(ndc[1][1], y);
+		}
+	}
+	if (ndc[0][1] < -1 || ndc[0][0] > 1 || ndc[1][1] < -1 || ndc[1][0] > 1) return false;
+	out.tileMinX = ClampCell((ndc[0][0] + 1) * 0.5f * GRID_X, GRID_X);
+	out.tileMaxX = ClampCell((ndc[0][1] + 1) * 0.5f * GRID_X, GRID_X);
+	out.tileMinY = ClampCell((1 - ndc[1][1]) * 0.5f * GRID_Y, GRID_Y);
+	out.tileMaxY = ClampCell((1 - ndc[1][0]) * 0.5f * GRID_Y, GRID_Y);
+	return true;
+}
+
+bool LightClusters::TouchesBox(const ViewLight& light, uint32_t cluster) const
+{
+	const XMFLOAT3& lo = boxMin[cluster];
+	const XMFLOAT3& hi = boxMax[cluster];
+
+	// sphere against the box
+	float dx = fmaxf(fmaxf(lo.x - light.center.x, light.center.x - hi.x), 0.0f);
+	float dy = fmaxf(fmaxf(lo.y - light.center.y, light.center.y - hi.y), 0.0f);
+	float dz = fmaxf(fmaxf(lo.z - light.center.z, light.center.z - hi.z), 0.0f);
+	if (dx * dx + dy * dy + dz * dz > light.radius * light.radius) return false;
+	if (!light.spot) return true;
+
+	// cone against the box's bounding sphere (Wronski, "Cull that cone!")
+	XMFLOAT3 center((lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f);
+	float radius = 0.5f * sqrtf((hi.x - lo.x) * (hi.x - lo.x) + (hi.y - lo.y) * (hi.y - lo.y) + (hi.z - lo.z) * (hi.z - lo.z));
+	float vx = center.x - light.apex.x;
+	float vy = center.y - light.apex.y;
+	float vz = center.z - light.apex.z;
+	float lengthSq = vx * vx + vy * vy + vz * vz;
+	float along = vx * light.direction.x + vy * light.direction.y + vz * light.direction.z;
+	float closest = light.cosAngle * sqrtf(fmaxf(lengthSq - along * along, 0.0f)) - along * light.sinAngle;
+	return closest <= radius && along <= radius + light.range && along >= -radius;
+}
+
+uint32_t LightClusters::GetCluster(float ndcX, float ndcY, float viewDepth) const
+{
+	uint32_t x = ClampCell((ndcX + 1) * 0.5f * GRID_X, GRID_X);
+	uint32_t y = ClampCell((1 - ndcY) * 0.5f * GRID_Y, GRID_Y);
+	uint32_t z = ClampCell(floorf(logf(viewDepth) * depthScaleBias.x + depthScaleBias.y), GRID_Z);
+	return x + GRID_X * (y + GRID_Y * z);
+}
+
+// ====== Binning =============================================================================
+
+LightClusters::BinStats LightClusters::Bin(const XMFLOAT4X4& view, const Light* lights, size_t count, unsigned int threads)
+{
+	auto start = std::chrono::steady_clock::now();
+	BinStats stats = {};
+	stats.threads = threads;
+
+	// view space bounds, in blocks so the kept lights stay in order
+	size_t blockCount = (count + LIGHT_BLOCK - 1) / LIGHT_BLOCK;
+	viewLights.resize(count);
+	std::vector<uint32_t> blockKept(blockCount, 0);
+	std::vector<uint32_t> blockLights(blockCount, 0);
+	ParallelFor(blockCount, threads, [&](size_t b) {
+		size_t end = (std::min)((b + 1) * LIGHT_BLOCK, count);
+		uint32_t kept = 0;
+		for (size_t i = b * LIGHT_BLOCK; i < end; i++) {
+			if (lights[i].Type == LIGHT_TYPE_POINT || lights[i].Type == LIGHT_TYPE_SPOT) blockLights[b]++;
+			if (ToView(view, lights[i], (uint32_t)i, viewLights[b * LIGHT_BLOCK + kept])) kept++;
+		}
+		blockKept[b] = kept;
+	});
+	size_t kept = 0;
+	for (size_t b = 0; b < blockCount; b++) {
+		for (uint32_t i = 0; i < blockKept[b]; i++) viewLights[kept++] = viewLights[b * LIGHT_BLOCK + i];
+		stats.lights += blockLights[b];
+	}
+	viewLights.resize(kept);
+	stats.inView = (uint32_t)kept;
+
+	// each slice tests its lights against its clusters, then counting
+	// sorts the pairs by cluster
+	constexpr uint32_t SLICE_CLUSTERS = GRID_X * GRID_Y;
+	ParallelFor(GRID_Z, threads, [&](size_t z) {
+		Slice& slice = slices[z];
+		slice.clusters.clear();
+		slice.lights.clear();
+		for (const ViewLight& light : viewLights) {
+			if (z < light.sliceMin || z > light.sliceMax) continue;
+			for (uint32_t y = light.tileMinY; y <= light.tileMaxY; y++) {
+				for (uint32_t x = light.tileMinX; x <= light.tileMaxX; x++) {
+					uint32_t local = x + GRID_X * y;
+					if (!TouchesBox(light, local + SLICE_CLUSTERS * (uint32_t)z)) continue;
+					slice.clusters.push_back((uint16_t)local);
+					slice.lights.push_back(light.index);
+				}
+			}
+		}
+
+		uint32_t* offsets = slice.offsets;
+		memset(offsets, 0, sizeof(slice.offsets));
+		for (uint16_t c : slice.clusters) offsets[c + 1]++;
+		for (uint32_t c = 0; c < SLICE_CLUSTERS; c++) offsets[c + 1] += offsets[c];
+		slice.sorted.resize(slice.lights.size());
+		uint32_t cursor[SLICE_CLUSTERS];
+		memcpy(cursor, offsets, sizeof(cursor));
+		for (size_t p = 0; p < slice.lights.size(); p++) slice.sorted[cursor[slice.clusters[p]]++] = slice.lights[p];
+	});
+
+	// slices one after another in the final list
+	uint32_t sliceStarts[GRID_Z + 1] = {};
+	for (uint32_t z = 0; z < GRID_Z; z++) sliceStarts[z + 1] = sliceStarts[z] + (uint32_t)slices[z].sorted.size();
+	ranges.resize(CLUSTER_COUNT);
+	lightIndices.resize(sliceStarts[GRID_Z]);
+	ParallelFor(GRID_Z, threads, [&](size_t z) {
+		const Slice& slice = slices[z];
+		if (!slice.sorted.empty())
+			memcpy(&lightIndices[sliceStarts[z]], slice.sorted.data(), slice.sorted.size() * sizeof(uint32_t));
+		for (uint32_t c = 0; c < SLICE_CLUSTERS; c++)
+			ranges[c + SLICE_CLUSTERS * z] = XMUINT2(sliceStarts[z] + slice.offsets[c], slice.offsets[c + 1] - slice.offsets[c]);
+	});
+
+	stats.indices = sliceStarts[GRID_Z];
+	for (const XMUINT2& range : ranges) stats.maxPerCluster = (std::max)(stats.maxPerCluster, range.y);
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Lights.h"
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Clustered forward lighting - the camera's frustum is cut
+// into froxels (screen tiles by exponential depth slices) and
+// every point and spot light is binned into the froxels its
+// range reaches, so a pixel only walks its own froxel's list
+// - Point lights are tested as spheres, spot lights as cones,
+//   against each froxel's view space box
+// - Binning runs a depth slice per task through ParallelFor(),
+//   each froxel's list keeps the lights in index order whatever
+//   the thread count
+// - Directional lights reach everything and aren't binned
+// --------------------------------------------------------
+class LightClusters
+{
+public:
+	// matches the CLUSTER_GRID defines in LightClusters.hlsli
+	static constexpr uint32_t GRID_X = 16;
+	static constexpr uint32_t GRID_Y = 9;
+	static constexpr uint32_t GRID_Z = 24;
+	static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+	// fewer lights than this aren't worth starting threads for
+	static constexpr size_t PARALLEL_MIN_LIGHTS = 256;
+
+	struct BinStats
+	{
+		uint32_t lights;		// point and spot lights handed in
+		uint32_t inView;		// whose bounds reached the grid
+		uint32_t indices;		// light indices across every cluster
+		uint32_t maxPerCluster;
+		unsigned int threads;
+		double ms;
+	};
+
+	// Froxel boxes for a camera projection, only rebuilt when it or
+	// the clip distances change
+	void SetProjection(const DirectX::XMFLOAT4X4& projection, float nearClip, float farClip);
+
+	// Bins the point and spot lights in "lights" for a camera "view",
+	// after SetProjection()
+	BinStats Bin(const DirectX::XMFLOAT4X4& view, const Light* lights, size_t count, unsigned int threads);
+
+	// Per cluster offset and count into GetLightIndices() (indices into
+	// the lights given to Bin()), x fastest, top row first, then depth
+	const std::vector<DirectX::XMUINT2>& GetRanges() const { return ranges; }
+	const std::vector<uint32_t>& GetLightIndices() const { return lightIndices; }
+
+	// slice = floor(log(view depth) * x + y)
+	DirectX::XMFLOAT2 GetDepthScaleBias() const { return depthScaleBias; }
+
+	// Cluster a point falls in, as the pixel shaders find it
+	uint32_t GetCluster(float ndcX, float ndcY, float viewDepth) const;
+
+private:
+	// a light's bounds in view space and the grid cells they can reach
+	struct ViewLight
+	{
+		DirectX::XMFLOAT3 center;	// bounding sphere, the cone's for spot lights
+		float radius;
+		DirectX::XMFLOAT3 apex;		// spot lights only
+		DirectX::XMFLOAT3 direction;
+		float range;
+		float cosAngle;
+		float sinAngle;
+		bool spot;
+		uint32_t index;
+		uint32_t sliceMin, sliceMax;
+		uint32_t tileMinX, tileMaxX, tileMinY, tileMaxY;
+	};
+
+	// one depth slice's (cluster, light) pairs, sorted by cluster
+	struct Slice
+	{
+		std::vector<uint16_t> clusters;	// within the slice
+		std::vector<uint32_t> lights;
+		std::vector<uint32_t> sorted;
+		uint32_t offsets[GRID_X * GRID_Y + 1];
+	};
+
+	DirectX::XMFLOAT4X4 projection = {};
+	float nearClip = 0;
+	float farClip = 0;
+	DirectX::XMFLOAT2 depthScaleBias = {};
+	std::vector<DirectX::XMFLOAT3> boxMin, boxMax;	// view space, per cluster
+	std::vector<ViewLight> viewLights;
+	Slice slices[GRID_Z];
+	std::vector<DirectX::XMUINT2> ranges;
+	std::vector<uint32_t> lightIndices;
+
+	bool ToView(const DirectX::XMFLOAT4X4& view, const Light& light, uint32_t index, ViewLight& out) const;
+	bool TouchesBox(const ViewLight& light, uint32_t cluster) const;
+};
@@ -0,0 +1,19 @@
+#ifndef __GGP_LIGHT_CLUSTERS__
+#define __GGP_LIGHT_CLUSTERS__
+
+// matches LightClusters::GRID_X/Y/Z in C++
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+// Cluster a pixel falls in, the same as LightClusters::GetCluster()
+// - screenScale is the grid's size over the render target's in pixels
+// - depthScaleBias turns log(view depth) into a depth slice
+uint GetLightCluster(float2 screenPosition, float viewDepth, float2 screenScale, float2 depthScaleBias)
+{
+    uint2 tile = min(uint2(screenPosition * screenScale), uint2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    uint slice = (uint)clamp(floor(log(viewDepth) * depthScaleBias.x + depthScaleBias.y), 0.0f, CLUSTER_GRID_Z - 1.0f);
+    return tile.x + CLUSTER_GRID_X * (tile.y + CLUSTER_GRID_Y * slice);
+}
+
+#endif
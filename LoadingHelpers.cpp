@@ -30,8 +30,8 @@ void Game::LoadTexture(
 	lTextureSRVs.push_back(srv);
 }
 
-std::shared_ptr<Mesh> Game::MeshHelper(const char* name) {
-	std::shared_ptr<Mesh> newMesh = std::make_shared<Mesh>(name, FixPath(std::format("../../Assets/Models/{}.obj", name)).c_str());
+std::shared_ptr<Mesh> Game::MeshHelper(const char* name, const MeshLoadOptions& options) {
+	std::shared_ptr<Mesh> newMesh = std::make_shared<Mesh>(name, FixPath(std::format("../../Assets/Models/{}.obj", name)).c_str(), options);
 	umMeshes[newMesh->GetName()] = newMesh;
 	return newMesh;
 }
@@ -49,6 +49,38 @@ std::shared_ptr<SimpleVertexShader> Game::VSHelper(const std::wstring& filename)
 	return std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, FixPath(filename).c_str());
 }
 
+// PackedVertex, matches PackedVertexShaderInput in ShaderStructs.hlsli
+static const D3D11_INPUT_ELEMENT_DESC PackedInputLayout[3] =
+{
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match PackedInputLayout");
+
+// vertex shaders that read PackedVertex need the layout spelled out,
+// reflection would ask for full floats
+// - "instanced" adds InstanceInput (ShaderStructs.hlsli) in slot 1
+std::shared_ptr<SimpleVertexShader> Game::PackedVSHelper(const std::wstring& filename, bool instanced) {
+	std::vector<D3D11_INPUT_ELEMENT_DESC> layout(std::begin(PackedInputLayout), std::end(PackedInputLayout));
+	if (instanced) {
+		for (const char* semantic : { "WORLD_PER_INSTANCE", "WORLD_IT_PER_INSTANCE", "WVP_PER_INSTANCE", "LIGHT_WVP_PER_INSTANCE" })
+			for (UINT row = 0; row < 4; row++)
+				layout.push_back({ semantic, row, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,
+					D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+	}
+
+	std::wstring path = FixPath(filename);
+	Microsoft::WRL::ComPtr<ID3DBlob> blob;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	D3DReadFileToBlob(path.c_str(), blob.GetAddressOf());
+	if (blob) {
+		Graphics::Device->CreateInputLayout(layout.data(), (UINT)layout.size(),
+			blob->GetBufferPointer(), blob->GetBufferSize(), inputLayout.GetAddressOf());
+	}
+	return std::make_shared<SimpleVertexShader>(Graphics::Device, Graphics::Context, path.c_str(), inputLayout, instanced);
+}
+
 std::shared_ptr<SimplePixelShader> Game::PSHelper(const std::wstring& filename) {
 	return std::make_shared<SimplePixelShader>(Graphics::Device, Graphics::Context, FixPath(filename).c_str());
 }
@@ -1,6 +1,15 @@
 #include "Material.h"
+#include "StateCache.h"
+
+#include <atomic>
 using namespace DirectX;
 
+uint32_t Material::NextId()
+{
+	static std::atomic<uint32_t> next = 0;
+	return next++;
+}
+
 Material::Material(const char* name, std::shared_ptr<SimpleVertexShader> vs,
 	std::shared_ptr<SimplePixelShader> ps, DirectX::XMFLOAT3 ct, float r)
 	: name(name), pixelShader(ps), vertexShader(vs), colorTint(ct), roughness(r)
@@ -36,6 +45,6 @@ void Material::RemoveSampler(std::string name)
 void Material::PrepareMaterial() {
 
 	// Loop and set any other resources
-	for (auto& t : textureSRVs) { pixelShader->SetShaderResourceView(t.first.c_str(), t.second.Get()); }
-	for (auto& s : samplers) { pixelShader->SetSamplerState(s.first.c_str(), s.second.Get()); }
+	for (auto& t : textureSRVs) { StateCache::SetShaderResourceView(pixelShader.get(), t.first, t.second.Get()); }
+	for (auto& s : samplers) { StateCache::SetSamplerState(pixelShader.get(), s.first, s.second.Get()); }
 }
@@ -13,10 +13,15 @@ public:
 
 	// getters
 	const char* GetName() { return name; }
+	// unique for the life of the process, never reused like an address can be
+	uint32_t GetId() const { return id; }
 	const DirectX::XMFLOAT3 GetColorTint() const { return colorTint; }
 	const float GetRoughness() const { return roughness; }
 	const std::shared_ptr<SimplePixelShader> GetPixelShader() { return pixelShader; }
 	const std::shared_ptr<SimpleVertexShader> GetVertexShader() { return vertexShader; }
+	const std::shared_ptr<SimpleVertexShader> GetPackedVertexShader() { return packedVertexShader; }
+	const std::shared_ptr<SimpleVertexShader> GetInstancedVertexShader() { return instancedVertexShader; }
+	const std::shared_ptr<SimpleVertexShader> GetPackedInstancedVertexShader() { return packedInstancedVertexShader; }
 	const DirectX::XMFLOAT2 GetUvScale() const { return uvScale; }
 	const DirectX::XMFLOAT2 GetUvOffset() const { return uvOffset; }
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& GetTextureSRVMap() { return textureSRVs; }
@@ -25,6 +30,9 @@ public:
 	// setters
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> ps) { pixelShader = ps; }
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> vs) { vertexShader = vs; }
+	void SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> vs) { packedVertexShader = vs; }
+	void SetInstancedVertexShader(std::shared_ptr<SimpleVertexShader> vs) { instancedVertexShader = vs; }
+	void SetPackedInstancedVertexShader(std::shared_ptr<SimpleVertexShader> vs) { packedInstancedVertexShader = vs; }
 	void SetColorTint(DirectX::XMFLOAT3 ct) { colorTint = ct; }
 	void SetRoughness(float r) { roughness = std::clamp(r, 0.0f, 1.0f); }
 	void SetName(const char* n) { name = n; } 
@@ -44,6 +52,8 @@ public:
 private:
 	// name for UI
 	const char* name;
+	const uint32_t id = NextId();
+	static uint32_t NextId();
 
 	// material properties
 	DirectX::XMFLOAT3 colorTint;
@@ -52,6 +62,9 @@ private:
 	// shaders
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimpleVertexShader> packedVertexShader;	// same shader for PackedVertex meshes
+	std::shared_ptr<SimpleVertexShader> instancedVertexShader;	// same shaders for instanced draws, if any
+	std::shared_ptr<SimpleVertexShader> packedInstancedVertexShader;
 
 	// textures
 	DirectX::XMFLOAT2 uvScale;
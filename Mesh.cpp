@@ -1,12 +1,30 @@
 #include "Mesh.h"
 #include "Graphics.h"
+#include "MeshLoader.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Tangents.h"
+#include "GeometryPool.h"
 
 #include <DirectXMath.h>
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 #include <vector>
 using namespace DirectX;
 // constructor
+uint32_t Mesh::NextId()
+{
+	// meshes can load on worker threads
+	static std::atomic<uint32_t> next = 0;
+	return next++;
+}
+
 Mesh::Mesh(const char* name, Vertex* ptrVertices, const size_t& nVertices, UINT* ptrIndices, const size_t& nIndices) {
 	
 	// store num vertices, indeces, and name
@@ -14,285 +32,174 @@ Mesh::Mesh(const char* name, Vertex* ptrVertices, const size_t& nVertices, UINT*
 	this->nVertices = (UINT)nVertices;
 	this->nIndices = (UINT)nIndices;
 	this->nTris = (UINT)(nIndices / 3);
+	loadStats.sourceVertices = (UINT)nVertices;
 
+	MeshLoader::ComputeBounds(ptrVertices, nVertices, boundsMin, boundsMax);
+	boundsRadius = MeshLoader::ComputeBoundsRadius(ptrVertices, nVertices, GetBoundsCenter());
 	CalculateTangents(ptrVertices, (int)nVertices, ptrIndices, (int)nIndices);
-	CreateBuffers(ptrVertices, nVertices, ptrIndices, nIndices);
+	CreateBuffers(ptrVertices, sizeof(Vertex), nVertices, ptrIndices, nIndices);
+	lods.push_back(MeshLOD{ 0, (uint32_t)nIndices, 0.0f });
+	loadStats.bvhMs = bvh.Build(ptrVertices, nVertices, ptrIndices, nIndices).ms;
 }
-Mesh::Mesh(const char* name, const char* objFile) 
+Mesh::Mesh(const char* name, const char* objFile, const MeshLoadOptions& options)
 	: name(name), nVertices(0), nIndices(0), nTris(0)
 {
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-	// 
-	// - You are allowed to directly copy/paste this into your code base
-	//   for assignments, given that you clearly cite that this is not
-	//   code of your own design.
-	
-	// *************************************
-	//      IMPLEMENTATION NOTES (1/2)
-	//
-	//  - You'll need to #include both
-	//      <fstream> and <stdexcept>
-	//
-	//  - This is code you will need to 
-	//      integrate into a function or
-	//      constructor of your own making
-	//
-	//  - There is MORE TO DO after pasting 
-	//      this code in - see the bottom for
-	//      what to do *after* including 
-	//      this code in your mesh class
-	//
-	// *************************************
-	
-	// File input object
-	std::ifstream obj(objFile);
-
-	// Check for successful open
-	if (!obj.is_open())
+	auto start = std::chrono::steady_clock::now();
+
+	// memory map the file - it's needed for the hash even if
+	// the mesh ends up coming from the cache
+	// - See MeshLoader.cpp for the tokenizer and the original
+	//   getline/sscanf_s loader it replaced
+	MappedFile obj(objFile);
+	if (!obj.IsOpen())
 		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
-
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm = {};
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
+	uint64_t sourceHash = MeshCache::HashBytes(obj.GetData(), obj.GetSize());
+	std::string cachePath = MeshCache::GetCachePath(objFile);
+	uint32_t cacheFlags =
+		(options.optimizeVertexCache ? MeshCache::FLAG_VERTEX_CACHE_OPTIMIZED : 0) |
+		(options.packVertices ? MeshCache::FLAG_PACK_VERTICES : 0) |
+		(options.buildMeshlets ? MeshCache::FLAG_MESHLETS : 0) |
+		(options.buildBVH ? MeshCache::FLAG_BVH : 0);
+
+	// up to date cache, hand the mapped blobs straight to the GPU
+	if (options.useCache) {
+		MeshCache::MeshBinFile bin(cachePath.c_str());
+		if (bin.IsValid(sourceHash, cacheFlags, options.lodLevels, options.lodReduction, options.packingTolerance)) {
+			const MeshCache::MeshBinHeader& header = bin.GetHeader();
+			boundsMin = header.boundsMin;
+			boundsMax = header.boundsMax;
+			boundsRadius = header.boundsRadius;
+			packed = header.layout == MeshCache::VertexLayout::Packed;
+			if (packed) quantization = VertexPacking::GetQuantization(boundsMin, boundsMax);
+
+			if (header.vertexCount && header.indexCount) {
+				CreateBuffers(bin.GetVertices(), header.vertexStride, header.vertexCount, bin.GetIndices(), header.indexCount);
+				lods.assign(bin.GetLODs(), bin.GetLODs() + header.lodCount);
+				meshlets.assign(bin.GetMeshlets(), bin.GetMeshlets() + header.meshletCount);
+				if (!meshlets.empty())
+					meshletIndices.assign(bin.GetIndices(), bin.GetIndices() + lods[0].indexCount);
+				bvh.Assign(bin.GetBVHNodes(), header.bvhNodeCount, bin.GetBVHBlocks(), header.bvhBlockCount);
+				nIndices = lods[0].indexCount;
+				nTris = nIndices / 3;
+			}
+			loadStats.sourceVertices = header.sourceVertices;
+			loadStats.packingError = header.packingError;
+			loadStats.fromCache = true;
+			loadStats.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			return;
 		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv = {};
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
+	}
+
+	MeshData data;
+	MeshLoader::LoadOBJ(obj, data);
+	MeshLoader::ComputeBounds(data.vertices.data(), data.vertices.size(), boundsMin, boundsMax);
+	boundsRadius = MeshLoader::ComputeBoundsRadius(data.vertices.data(), data.vertices.size(), GetBoundsCenter());
+
+	// packed copy of the vertices, if asked for and accurate enough
+	std::vector<PackedVertex> packedVertices;
+
+	if (!data.vertices.empty() && !data.indices.empty()) {
+		// obj faces don't share vertices, so collapse the duplicates
+		// to get an index buffer that actually does something
+		MeshLoader::WeldStats weld = MeshLoader::WeldVertices(data);
+		loadStats.sourceVertices = (UINT)weld.verticesBefore;
+		loadStats.weldMs = weld.ms;
+
+		// triangle order from the file is arbitrary, sort it for the
+		// post-transform cache and lay the vertices out to match
+		if (options.optimizeVertexCache) {
+			auto optimizeStart = std::chrono::steady_clock::now();
+			MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+			MeshOptimizer::OptimizeVertexFetch(data);
+			loadStats.optimizeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - optimizeStart).count();
 		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos = {};
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
+
+		// group the triangles into meshlets, which reorders them, so
+		// the vertices get laid out again to follow
+		if (options.buildMeshlets) {
+			auto meshletStart = std::chrono::steady_clock::now();
+			Meshlets::Build(data.vertices, data.indices, meshlets);
+			if (options.optimizeVertexCache) MeshOptimizer::OptimizeVertexFetch(data);
+			meshletIndices = data.indices;
+			loadStats.meshletMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - meshletStart).count();
 		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12] = {};
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
 
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-            Vertex v1 = {};
-            v1.Position = positions[static_cast<size_t>(i[0]) - 1];
-            v1.UV = uvs[static_cast<size_t>(i[1]) - 1];
-            v1.Normal = normals[static_cast<size_t>(i[2]) - 1];
-
-            Vertex v2 = {};
-            v2.Position = positions[static_cast<size_t>(i[3]) - 1];
-            v2.UV = uvs[static_cast<size_t>(i[4]) - 1];
-            v2.Normal = normals[static_cast<size_t>(i[5]) - 1];
-
-            Vertex v3 = {};
-            v3.Position = positions[static_cast<size_t>(i[6]) - 1];
-            v3.UV = uvs[static_cast<size_t>(i[7]) - 1];
-            v3.Normal = normals[static_cast<size_t>(i[8]) - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4 = {};
-				v4.Position = positions[static_cast<size_t>(i[9]) - 1];
-				v4.UV = uvs[static_cast<size_t>(i[10]) - 1];
-				v4.Normal = normals[static_cast<size_t>(i[11]) - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
+		CalculateTangents(&data.vertices[0], (int)data.vertices.size(), &data.indices[0], (int)data.indices.size());
+
+		// simplified copies of the triangles go after LOD 0 in the same
+		// index buffer, all of them using the vertices above
+		if (options.lodLevels > 1) {
+			MeshSimplifier::LODStats lodStats = MeshSimplifier::GenerateLODs(data.vertices, data.indices,
+				options.lodLevels, options.lodReduction, options.optimizeVertexCache, lods);
+			loadStats.simplifyMs = lodStats.ms;
+		}
+		else {
+			lods.push_back(MeshLOD{ 0, (uint32_t)data.indices.size(), 0.0f });
+		}
+
+		// full precision positions, before any packing
+		if (options.buildBVH)
+			loadStats.bvhMs = bvh.Build(data.vertices.data(), data.vertices.size(), data.indices.data(), lods[0].indexCount).ms;
+
+		if (options.packVertices) {
+			quantization = VertexPacking::GetQuantization(boundsMin, boundsMax);
+			loadStats.packingError = VertexPacking::MeasureError(data.vertices.data(), data.vertices.size(), quantization);
+			packed = VertexPacking::WithinTolerance(loadStats.packingError, options.packingTolerance);
+			if (packed) VertexPacking::PackVertices(data.vertices.data(), data.vertices.size(), quantization, packedVertices);
 		}
+
+		if (packed)
+			CreateBuffers(packedVertices.data(), sizeof(PackedVertex), packedVertices.size(), &data.indices[0], data.indices.size());
+		else
+			CreateBuffers(&data.vertices[0], sizeof(Vertex), data.vertices.size(), &data.indices[0], data.indices.size());
+		nIndices = lods[0].indexCount;
+		nTris = nIndices / 3;
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
-
-	// *************************************
-	//      IMPLEMENTATION NOTES (2/2)
-	//
-	// - At this point, "verts" is a std::vector 
-	//     of Vertex structs, and can be used
-	//     to create your mesh's vertex buffer
-	//
-	// - NOTE: Use &verts[0] for the address of 
-	//     the first vertx, NOT JUST &verts
-	//
-	// - The vector "indices" is similar. It's 
-	//     a std::vector of unsigned ints and
-	//     can be used to create the index 
-	//     buffer (again, &indices[0] is the 
-	//     address of the first integer)
-	//
-	// - Make sure your mesh class actually SAVES
-	//     the number of vertices and indices, or
-	//     drawing may have unintended problems.
-	//     - "vertCounter" is the number of vertices
-	//     - "indexCounter" is the number of indices
-	//
-	// - If you dig into the code, you may notice 
-	//     that  "vertCounter" and "indexCounter" 
-	//     end up being the same.  Recall that OBJs 
-	//     do not index entire vertices, making
-	//     it complex to detect duplicate vertices.
-	//     This also means an index buffer isn't
-	//     doing much for us.  We could try to 
-	//     detect duplicate vertices ourselves, 
-	//     but at that point it would be better 
-	//     to use a more sophisticated mesh loading
-	//     library like TinyOBJLoader or 
-	//     The Open Asset Importer Library, both
-	//     of which are unnecessary for now.
-	//
-	// *************************************
-
-	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
-	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
+	// write the finished mesh out for next time
+	if (options.useCache) {
+		MeshCache::MeshBinHeader header = {};
+		header.layout = packed ? MeshCache::VertexLayout::Packed : MeshCache::VertexLayout::PositionNormalUVTangent;
+		header.vertexCount = (uint32_t)data.vertices.size();
+		header.indexCount = (uint32_t)data.indices.size();
+		header.sourceVertices = loadStats.sourceVertices;
+		header.flags = cacheFlags;
+		header.boundsMin = boundsMin;
+		header.boundsMax = boundsMax;
+		header.boundsRadius = boundsRadius;
+		header.sourceHash = sourceHash;
+		header.lodCount = (uint32_t)lods.size();
+		header.lodLevels = options.lodLevels;
+		header.lodReduction = options.lodReduction;
+		header.meshletCount = (uint32_t)meshlets.size();
+		header.bvhNodeCount = (uint32_t)bvh.GetNodes().size();
+		header.bvhBlockCount = (uint32_t)bvh.GetBlocks().size();
+		header.packingError = loadStats.packingError;
+		MeshCache::Write(cachePath.c_str(), header,
+			packed ? (const void*)packedVertices.data() : (const void*)data.vertices.data(), data.indices.data(),
+			lods.data(), meshlets.data(), bvh.GetNodes().data(), bvh.GetBlocks().data());
+	}
+
+	loadStats.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Mesh::~Mesh() {
+	if (pool) pool->Remove(baseVertex, firstIndex);
 }
 
-void Mesh::Draw() {
+void Mesh::Draw(unsigned int lod) {
+	if (lods.empty() || !pool) return;
+	const MeshLOD& range = lods[lod < lods.size() ? lod : lods.size() - 1];
+
 	// DRAW geometry
 	// - These steps are generally repeated for EACH object you draw
 	// - Other Direct3D calls will also be necessary to do more complex things
 	
 	// Set buffers in the input assembler (IA) stage
-	//  - Do this ONCE PER OBJECT, since each object may have different geometry
-	//  - For this demo, this step *could* simply be done once during Init()
-	//  - However, this needs to be done between EACH DrawIndexed() call
-	//     when drawing different geometry, so it's here as an example
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, this->vb.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(this->ib.Get(), DXGI_FORMAT_R32_UINT, 0);
+	//  - Every mesh with this vertex format shares the same pair, so
+	//     this is skipped when the last mesh drawn already set them
+	pool->Bind();
 
 	// Tell Direct3D to draw
 	//  - Begins the rendering pipeline on the GPU
@@ -301,64 +208,95 @@ void Mesh::Draw() {
 	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 	//     vertices in the currently set VERTEX BUFFER
 	Graphics::Context->DrawIndexed(
-		this->nIndices,     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+		range.indexCount,     // The number of indices to use (only the requested LOD)
+		firstIndex + range.indexOffset,     // Offset to the first index we want to use
+		baseVertex);    // Offset to add to each index when looking up vertices
 }
 
-void Mesh::CreateBuffers(Vertex* ptrVertices, size_t nVertices, UINT* ptrIndices, size_t nIndices) {
-	// Create a VERTEX BUFFER
-	// - This holds the vertex data of triangles for a single object
-	// - This buffer is created on the GPU, which is where the data needs to
-	//    be if we want the GPU to act on it (as in: draw it to the screen)
-
-	// First, we need to describe the buffer we want Direct3D to make on the GPU
-	//  - Note that this variable is created on the stack since we only need it once
-	//  - After the buffer is created, this description variable is unnecessary
-	D3D11_BUFFER_DESC vbd = {};
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-	vbd.ByteWidth = sizeof(Vertex) * (UINT)nVertices; // number of vertices in the buffer
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells Direct3D this is a vertex buffer
-	vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
-
-	// Create the proper struct to hold the initial vertex data
-	// - This is how we initially fill the buffer with data
-	// - Essentially, we're specifying a pointer to the data to copy
-	D3D11_SUBRESOURCE_DATA initialVertexData = {};
-	initialVertexData.pSysMem = ptrVertices; // pSysMem = Pointer to System Memory
-
-	// Actually create the buffer on the GPU with the initial data
-	// - Once we do this, we'll NEVER CHANGE DATA IN THE BUFFER AGAIN
-	Graphics::Device->CreateBuffer(&vbd, &initialVertexData, this->vb.GetAddressOf());
-	  
-
-	// Create an INDEX BUFFER
-	// - This holds indices to elements in the vertex buffer
-	// - This is most useful when vertices are shared among neighboring triangles
-	// - This buffer is created on the GPU, which is where the data needs to
-	//    be if we want the GPU to act on it (as in: draw it to the screen)
-	
-	// Describe the buffer, as we did above, with two major differences
-	//  - Byte Width (3 unsigned integers vs. 3 whole vertices)
-	//  - Bind Flag (used as an index buffer instead of a vertex buffer) 
-	D3D11_BUFFER_DESC ibd = {};
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-	ibd.ByteWidth = sizeof(UINT) * (UINT)nIndices;	// 3 = number of indices in the buffer
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER; // Tells Direct3D this is an index buffer
-	ibd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
-
-	// Specify the initial data for this buffer, similar to above
-	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = ptrIndices; // pSysMem = Pointer to System Memory
-
-	// Actually create the buffer with the initial data
-	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-	Graphics::Device->CreateBuffer(&ibd, &initialIndexData, this->ib.GetAddressOf());
+void Mesh::DrawInstances(unsigned int lod, UINT firstInstance, UINT instanceCount) {
+	if (lods.empty() || !pool || instanceCount == 0) return;
+	const MeshLOD& range = lods[lod < lods.size() ? lod : lods.size() - 1];
+
+	pool->Bind();
+	Graphics::Context->DrawIndexedInstanced(
+		range.indexCount,
+		instanceCount,
+		firstIndex + range.indexOffset,
+		baseVertex,
+		firstInstance);
+}
+
+void Mesh::DrawIndices(const std::vector<unsigned int>& indices) {
+	if (indices.empty() || !pool) return;
+
+	GetCulledIndexBuffer();
+	UINT count = (UINT)(std::min)(indices.size(), (size_t)lods[0].indexCount);
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	Graphics::Context->Map(culledIB.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, indices.data(), sizeof(UINT) * count);
+	Graphics::Context->Unmap(culledIB.Get(), 0);
+
+	pool->Bind(culledIB.Get());
+	Graphics::Context->DrawIndexed(count, 0, baseVertex);
+}
+
+void Mesh::Record(CommandBuffer& commands, unsigned int lod) {
+	if (lods.empty() || !pool) return;
+	const MeshLOD& range = lods[lod < lods.size() ? lod : lods.size() - 1];
+
+	commands.SetVertexBuffer(0, pool->GetVertexBuffer().Get(), vertexStride);
+	commands.SetIndexBuffer(pool->GetIndexBuffer().Get());
+	commands.DrawIndexed(range.indexCount, firstIndex + range.indexOffset, baseVertex);
+}
+
+void Mesh::RecordInstances(CommandBuffer& commands, unsigned int lod, UINT firstInstance, UINT instanceCount) {
+	if (lods.empty() || !pool || instanceCount == 0) return;
+	const MeshLOD& range = lods[lod < lods.size() ? lod : lods.size() - 1];
+
+	commands.SetVertexBuffer(0, pool->GetVertexBuffer().Get(), vertexStride);
+	commands.SetIndexBuffer(pool->GetIndexBuffer().Get());
+	commands.DrawIndexedInstanced(range.indexCount, instanceCount, firstIndex + range.indexOffset, baseVertex, firstInstance);
+}
+
+void Mesh::RecordIndices(CommandBuffer& commands, const std::vector<unsigned int>& indices) {
+	if (indices.empty() || !pool || !culledIB) return;
 
+	// the indices go in the command, the buffer is filled when it runs
+	UINT count = (UINT)(std::min)(indices.size(), (size_t)lods[0].indexCount);
+	commands.UpdateBuffer(culledIB.Get(), indices.data(), sizeof(UINT) * count);
+	commands.SetVertexBuffer(0, pool->GetVertexBuffer().Get(), vertexStride);
+	commands.SetIndexBuffer(culledIB.Get());
+	commands.DrawIndexed(count, 0, baseVertex);
+}
+
+ID3D11Buffer* Mesh::GetCulledIndexBuffer() {
+	// never holds more than LOD 0, so that's all it's sized for
+	if (!culledIB && !lods.empty()) {
+		D3D11_BUFFER_DESC ibd = {};
+		ibd.Usage = D3D11_USAGE_DYNAMIC;
+		ibd.ByteWidth = sizeof(UINT) * lods[0].indexCount;
+		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Graphics::Device->CreateBuffer(&ibd, 0, culledIB.GetAddressOf());
+	}
+	return culledIB.Get();
+}
+
+const XMFLOAT3 Mesh::GetBoundsCenter() const {
+	return XMFLOAT3(
+		(boundsMin.x + boundsMax.x) * 0.5f,
+		(boundsMin.y + boundsMax.y) * 0.5f,
+		(boundsMin.z + boundsMax.z) * 0.5f);
+}
+
+void Mesh::CreateBuffers(const void* ptrVertices, UINT stride, size_t nVertices, const UINT* ptrIndices, size_t nIndices) {
+	// Copy the geometry into the shared buffers for this vertex format
+	// - See GeometryPool.h, the mesh only keeps where it ended up
+	pool = GeometryPool::Get(stride);
+	if (!pool->Add(ptrVertices, (UINT)nVertices, ptrIndices, (UINT)nIndices, baseVertex, firstIndex))
+		pool.reset();
+
+	this->vertexStride = stride;
 	this->nVertices = (UINT)nVertices;
 	this->nIndices = (UINT)nIndices;
 	this->nTris = (UINT)nIndices / 3;
@@ -377,60 +315,8 @@ void Mesh::CreateBuffers(Vertex* ptrVertices, size_t nVertices, UINT* ptrIndices
 // --------------------------------------------------------
 void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
-	}
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
-	}
+	// see Tangents.cpp, CalculateScalar() there is the original loop
+	auto start = std::chrono::steady_clock::now();
+	Tangents::Calculate(verts, (size_t)numVerts, indices, (size_t)numIndices);
+	loadStats.tangentMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
\ No newline at end of file
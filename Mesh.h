@@ -3,6 +3,56 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 #include "Vertex.h"
+#include "VertexPacking.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "BVH.h"
+#include "GeometryPool.h"
+#include "CommandBuffer.h"
+
+#include <vector>
+
+// stats gathered while loading a mesh, shown in the UI
+struct MeshLoadStats
+{
+	UINT sourceVertices = 0;	// vertices before welding
+	double weldMs = 0;			// time spent welding
+	double optimizeMs = 0;		// time spent reordering for the vertex cache
+	double simplifyMs = 0;		// time spent building the LOD chain
+	double meshletMs = 0;		// time spent building meshlets
+	double tangentMs = 0;		// time spent generating tangents
+	double bvhMs = 0;			// time spent building the BVH
+	double loadMs = 0;			// whole constructor, file to GPU buffers
+	bool fromCache = false;		// loaded from a .meshbin instead of the .obj
+	VertexPacking::PackingError packingError = {};	// measured when packing, kept in the .meshbin
+};
+
+// optional processing when loading from a file
+struct MeshLoadOptions
+{
+	bool useCache = true;				// read/write a .meshbin next to the .obj (see MeshCache.h)
+	bool optimizeVertexCache = true;	// reorder triangles/vertices (see MeshOptimizer.h)
+
+	// store vertices as PackedVertex, unless the precision loss goes
+	// over packingTolerance - packed meshes need a material with a
+	// packed vertex shader (see Material::SetPackedVertexShader)
+	bool packVertices = false;
+	VertexPacking::PackingTolerance packingTolerance;
+
+	// levels of detail to build, LOD 0 included (1 turns it off),
+	// each keeping about lodReduction of the triangles before it
+	// - See MeshSimplifier.h
+	unsigned int lodLevels = 4;
+	float lodReduction = 0.5f;
+
+	// group LOD 0 into meshlets that can be culled on the CPU
+	// - See Meshlets.h
+	bool buildMeshlets = false;
+
+	// triangle BVH over LOD 0 for CPU ray casts, e.g. picking
+	// - See BVH.h
+	bool buildBVH = true;
+};
 
 class Mesh
 {
@@ -10,25 +60,67 @@ public:
 
 	// constructor, wwith overload to make from file
 	Mesh(const char* name, Vertex* ptrVertices, const size_t& nVertices, UINT* ptrIndices, const size_t& nIndices);
-	Mesh(const char* name, const char* objFile);
-	~Mesh() {};
+	Mesh(const char* name, const char* objFile, const MeshLoadOptions& options = MeshLoadOptions());
+	~Mesh();
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
 
 	// public methods
-	void Draw();
+	void Draw(unsigned int lod = 0);
+
+	// Draws part of LOD 0 from a CPU side list of its indices,
+	// e.g. the output of Meshlets::Cull()
+	void DrawIndices(const std::vector<unsigned int>& indices);
+
+	// Draws "instanceCount" copies of a LOD, starting at "firstInstance"
+	// in whatever instance buffer is bound to input slot 1
+	void DrawInstances(unsigned int lod, UINT firstInstance, UINT instanceCount);
+
+	// The same three draws recorded into a CommandBuffer instead,
+	// vertex and index buffers included, safe from any thread
+	// - RecordIndices() needs GetCulledIndexBuffer() to have been
+	//   called first, on the thread that owns the device context
+	void Record(CommandBuffer& commands, unsigned int lod = 0);
+	void RecordIndices(CommandBuffer& commands, const std::vector<unsigned int>& indices);
+	void RecordInstances(CommandBuffer& commands, unsigned int lod, UINT firstInstance, UINT instanceCount);
+
+	// dynamic index buffer DrawIndices() fills, created on first use
+	ID3D11Buffer* GetCulledIndexBuffer();
 
 	// member variable return methods
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vb; };
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return ib; };
+	// the shared buffers, see GetBaseVertex()/GetFirstIndex() for where this mesh is in them
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return pool ? pool->GetVertexBuffer() : nullptr; };
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return pool ? pool->GetIndexBuffer() : nullptr; };
+	const std::shared_ptr<GeometryPool> GetPool() const { return pool; };
+	const UINT GetBaseVertex() const { return baseVertex; };
+	const UINT GetFirstIndex() const { return firstIndex; };
 
+	// counts are for LOD 0, see GetLOD() for the others
 	const UINT GetIndexCount() const { return nIndices; };
 	const UINT GetVertexCount() const { return nVertices; };
 	const UINT GetTriCount() const { return nTris; };
 	const char* GetName() const { return name; };
+	// unique for the life of the process, never reused like an address can be
+	const uint32_t GetId() const { return id; };
+	const MeshLoadStats& GetLoadStats() const { return loadStats; };
+	const UINT GetVertexStride() const { return vertexStride; };
+	const bool IsPacked() const { return packed; };
+	const VertexPacking::Quantization& GetQuantization() const { return quantization; };
+	const DirectX::XMFLOAT3 GetBoundsMin() const { return boundsMin; };
+	const DirectX::XMFLOAT3 GetBoundsMax() const { return boundsMax; };
+	const DirectX::XMFLOAT3 GetBoundsCenter() const;
+	const float GetBoundsRadius() const { return boundsRadius; };
+	const UINT GetLODCount() const { return (UINT)lods.size(); };
+	const MeshLOD& GetLOD(UINT lod) const { return lods[lod]; };
+	const std::vector<Meshlet>& GetMeshlets() const { return meshlets; };
+	const std::vector<unsigned int>& GetMeshletIndices() const { return meshletIndices; };
+	const BVH& GetBVH() const { return bvh; };
 
 private:
-	// buffer ComPtrs
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vb;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> ib;
+	// range of the shared vertex/index buffers, null pool if empty
+	std::shared_ptr<GeometryPool> pool;
+	UINT baseVertex = 0;
+	UINT firstIndex = 0;
 
 	// integers for num indeces and vertices
 	UINT nIndices;
@@ -36,9 +128,35 @@ private:
 	UINT nTris;
 
 	const char* name;
+	const uint32_t id = NextId();
+	static uint32_t NextId();
+	MeshLoadStats loadStats;
+
+	// vertex format in the buffer
+	UINT vertexStride = sizeof(Vertex);
+	bool packed = false;
+	VertexPacking::Quantization quantization = {};
+
+	// local space bounds, the sphere is centered on the box and
+	// fitted to the vertices
+	DirectX::XMFLOAT3 boundsMin = {};
+	DirectX::XMFLOAT3 boundsMax = {};
+	float boundsRadius = 0;
+
+	// index ranges in ib, LOD 0 first
+	std::vector<MeshLOD> lods;
+
+	// meshlets over LOD 0, a CPU copy of its indices to cull
+	// from, and a dynamic index buffer for what survives
+	std::vector<Meshlet> meshlets;
+	std::vector<unsigned int> meshletIndices;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> culledIB;
+
+	// LOD 0 triangles for ray casts, empty if not built
+	BVH bvh;
 
-	// helper for creating buffers
-	void CreateBuffers(Vertex* ptrVertices, size_t nVertices, UINT* ptrIndices, size_t nIndices);
+	// helper for putting the geometry in a pool
+	void CreateBuffers(const void* ptrVertices, UINT stride, size_t nVertices, const UINT* ptrIndices, size_t nIndices);
 	void CalculateTangents(Vertex* ptrVertices, int numVerts, unsigned int* indices, int numIndeces);
 };
 
@@ -0,0 +1,118 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <fstream>
+
+uint64_t MeshCache::HashBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::string MeshCache::GetCachePath(const char* objFile)
+{
+	std::string path = objFile;
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		path.erase(dot);
+	return path + ".meshbin";
+}
+
+uint32_t MeshCache::GetVertexStride(VertexLayout layout)
+{
+	switch (layout) {
+	case VertexLayout::PositionNormalUVTangent: return sizeof(Vertex);
+	case VertexLayout::Packed: return sizeof(PackedVertex);
+	}
+	return 0;
+}
+
+bool MeshCache::Write(const char* path, MeshBinHeader header, const void* vertices, const unsigned int* indices,
+	const MeshLOD* lods, const Meshlet* meshlets, const BVHNode* bvhNodes, const BVHTriangleBlock* bvhBlocks)
+{
+	memcpy(header.magic, "MBIN", 4);
+	header.version = VERSION;
+	header.vertexStride = GetVertexStride(header.layout);
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) return false;
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)vertices, (size_t)header.vertexCount * header.vertexStride);
+	out.write((const char*)indices, (size_t)header.indexCount * sizeof(unsigned int));
+	out.write((const char*)lods, (size_t)header.lodCount * sizeof(MeshLOD));
+	out.write((const char*)meshlets, (size_t)header.meshletCount * sizeof(Meshlet));
+	out.write((const char*)bvhNodes, (size_t)header.bvhNodeCount * sizeof(BVHNode));
+	out.write((const char*)bvhBlocks, (size_t)header.bvhBlockCount * sizeof(BVHTriangleBlock));
+	return out.good();
+}
+
+MeshCache::MeshBinFile::MeshBinFile(const char* path)
+	: file(path), header(nullptr)
+{
+	if (file.IsOpen() && file.GetSize() >= sizeof(MeshBinHeader))
+		header = (const MeshBinHeader*)file.GetData();
+}
+
+bool MeshCache::MeshBinFile::IsValid(uint64_t sourceHash, uint32_t flags, uint32_t lodLevels, float lodReduction,
+	const VertexPacking::PackingTolerance& packingTolerance) const
+{
+	if (!header) return false;
+	if (memcmp(header->magic, "MBIN", 4) != 0) return false;
+	if (header->version != VERSION) return false;
+	if (header->vertexStride == 0 || header->vertexStride != GetVertexStride(header->layout)) return false;
+	if (header->flags != flags) return false;
+	if (header->sourceHash != sourceHash) return false;
+	if (header->lodLevels != lodLevels || header->lodReduction != lodReduction || header->lodCount == 0) return false;
+
+	// a different tolerance can change whether the mesh should be packed
+	if (flags & FLAG_PACK_VERTICES) {
+		bool packed = header->layout == VertexLayout::Packed;
+		if (VertexPacking::WithinTolerance(header->packingError, packingTolerance) != packed) return false;
+	}
+
+	// reject partially written files
+	size_t expected = sizeof(MeshBinHeader) +
+		(size_t)header->vertexCount * header->vertexStride +
+		(size_t)header->indexCount * sizeof(unsigned int) +
+		(size_t)header->lodCount * sizeof(MeshLOD) +
+		(size_t)header->meshletCount * sizeof(Meshlet) +
+		(size_t)header->bvhNodeCount * sizeof(BVHNode) +
+		(size_t)header->bvhBlockCount * sizeof(BVHTriangleBlock);
+	return file.GetSize() == expected;
+}
+
+const void* MeshCache::MeshBinFile::GetVertices() const
+{
+	return file.GetData() + sizeof(MeshBinHeader);
+}
+
+const unsigned int* MeshCache::MeshBinFile::GetIndices() const
+{
+	return (const unsigned int*)(file.GetData() + sizeof(MeshBinHeader) + (size_t)header->vertexCount * header->vertexStride);
+}
+
+const MeshLOD* MeshCache::MeshBinFile::GetLODs() const
+{
+	return (const MeshLOD*)(GetIndices() + header->indexCount);
+}
+
+const Meshlet* MeshCache::MeshBinFile::GetMeshlets() const
+{
+	return (const Meshlet*)(GetLODs() + header->lodCount);
+}
+
+const BVHNode* MeshCache::MeshBinFile::GetBVHNodes() const
+{
+	return (const BVHNode*)(GetMeshlets() + header->meshletCount);
+}
+
+const BVHTriangleBlock* MeshCache::MeshBinFile::GetBVHBlocks() const
+{
+	return (const BVHTriangleBlock*)(GetBVHNodes() + header->bvhNodeCount);
+}
\ No newline at end of file
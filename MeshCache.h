@@ -0,0 +1,110 @@
+#pragma once
+
+#include "MeshLoader.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "BVH.h"
+#include "VertexPacking.h"
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+
+// --------------------------------------------------------
+// Binary mesh cache (.meshbin)
+// - Holds the finished (welded, tangent-space) vertices and
+//   indices of an .obj so later launches can skip parsing
+// - Layout: MeshBinHeader, vertex blob, index blob (every LOD
+//   back to back), MeshLOD table, Meshlet table, BVHNode
+//   table, BVHTriangleBlock table
+// --------------------------------------------------------
+namespace MeshCache
+{
+	// bump whenever the file layout or the mesh pipeline changes
+	constexpr uint32_t VERSION = 9;
+
+	// load options the stored mesh was built with
+	constexpr uint32_t FLAG_VERTEX_CACHE_OPTIMIZED = 1;
+	constexpr uint32_t FLAG_PACK_VERTICES = 2;	// packing was asked for, layout says if it happened
+	constexpr uint32_t FLAG_MESHLETS = 4;
+	constexpr uint32_t FLAG_BVH = 8;
+
+	// identifies the vertex struct stored in the file
+	enum class VertexLayout : uint32_t
+	{
+		PositionNormalUVTangent = 1,	// Vertex from Vertex.h
+		Packed = 2,						// PackedVertex from Vertex.h, bounds are the quantization range
+	};
+
+	// size of one vertex in the given layout, 0 if unknown
+	uint32_t GetVertexStride(VertexLayout layout);
+
+	struct MeshBinHeader
+	{
+		char magic[4];				// "MBIN"
+		uint32_t version;
+		VertexLayout layout;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexCount;		// all LODs together
+		uint32_t sourceVertices;	// vertices before welding
+		uint32_t flags;				// FLAG_* values
+		DirectX::XMFLOAT3 boundsMin;
+		DirectX::XMFLOAT3 boundsMax;
+		float boundsRadius;			// sphere around the middle of the box
+		uint32_t reserved;			// keeps sourceHash 8 byte aligned
+		uint64_t sourceHash;		// FNV-1a of the .obj bytes
+		uint32_t lodCount;			// LODs actually stored
+		uint32_t lodLevels;			// LODs asked for (MeshLoadOptions::lodLevels)
+		float lodReduction;			// MeshLoadOptions::lodReduction
+		uint32_t meshletCount;		// meshlets over LOD 0
+		uint32_t bvhNodeCount;		// BVH over LOD 0
+		uint32_t bvhBlockCount;
+		VertexPacking::PackingError packingError;	// measured with FLAG_PACK_VERTICES, packed or not
+		uint32_t reserved2;			// pads to a multiple of sourceHash's alignment
+	};
+	static_assert(sizeof(MeshBinHeader) == 120, "blobs after the header must stay 4 byte aligned");
+
+	// 64 bit FNV-1a hash of a block of memory
+	uint64_t HashBytes(const void* data, size_t size);
+
+	// "folder/name.obj" -> "folder/name.meshbin"
+	std::string GetCachePath(const char* objFile);
+
+	// Writes the header and blobs for a finished mesh
+	// - magic, version and vertexStride are filled in here
+	// - Returns false if the file couldn't be written, which only
+	//   means the next launch parses the .obj again
+	bool Write(const char* path, MeshBinHeader header, const void* vertices, const unsigned int* indices,
+		const MeshLOD* lods, const Meshlet* meshlets, const BVHNode* bvhNodes, const BVHTriangleBlock* bvhBlocks);
+
+	// --------------------------------------------------------
+	// A memory mapped .meshbin, the vertex and index pointers
+	// point straight into the mapping
+	// --------------------------------------------------------
+	class MeshBinFile
+	{
+	public:
+		MeshBinFile(const char* path);
+
+		// true if the file exists, is complete, matches the current
+		// version/layout/flags/LOD settings and was built from .obj
+		// bytes with this hash
+		// - With FLAG_PACK_VERTICES the stored packing error also has to
+		//   land on the same side of "packingTolerance" as the stored layout
+		bool IsValid(uint64_t sourceHash, uint32_t flags, uint32_t lodLevels, float lodReduction,
+			const VertexPacking::PackingTolerance& packingTolerance) const;
+
+		const MeshBinHeader& GetHeader() const { return *header; }
+		const void* GetVertices() const;
+		const unsigned int* GetIndices() const;
+		const MeshLOD* GetLODs() const;
+		const Meshlet* GetMeshlets() const;
+		const BVHNode* GetBVHNodes() const;
+		const BVHTriangleBlock* GetBVHBlocks() const;
+
+	private:
+		MappedFile file;
+		const MeshBinHeader* header;
+	};
+}
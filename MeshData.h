@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <vector>
+
+// CPU side mesh data, assembled before it is uploaded to the GPU
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+};
@@ -0,0 +1,945 @@
+#include "MeshLoader.h"
+#include "ParallelFor.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace DirectX;
+
+// ====== Memory mapped file =====================================================================
+
+MappedFile::MappedFile(const char* path)
+	: file(INVALID_HANDLE_VALUE), mapping(nullptr), data(nullptr), size(0)
+{
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return;
+
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(file, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+
+	// empty files can't be mapped, but they're still "open"
+	if (size == 0) return;
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping) data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	// mapping failed, treat the file as unopened
+	if (!data) {
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		mapping = nullptr;
+		file = INVALID_HANDLE_VALUE;
+		size = 0;
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+}
+
+// ====== Tokenizer helpers ======================================================================
+
+namespace
+{
+	// Powers of ten that are exactly representable as doubles
+	const double POW10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool IsDigit(char c) { return (unsigned)(c - '0') < 10u; }
+	inline bool IsLineEnd(char c) { return c == '\n' || c == '\r'; }
+
+	// Skips spaces and tabs, but never a line break
+	inline const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t')) p++;
+		return p;
+	}
+
+	// Moves to the first character of the next line
+	inline const char* NextLine(const char* p, const char* end)
+	{
+		const char* nl = (const char*)memchr(p, '\n', end - p);
+		return nl ? nl + 1 : end;
+	}
+
+	// Parses a float without touching the locale
+	// - Plain decimal numbers (what every exporter writes) take the fast
+	//   path: an integer mantissa scaled by an exact power of ten
+	// - Anything else falls back to std::from_chars
+	const char* ParseFloat(const char* p, const char* end, float& out)
+	{
+		p = SkipSpaces(p, end);
+		const char* start = p;
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+
+		unsigned long long mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+
+		// integer part
+		while (p < end && IsDigit(*p)) {
+			anyDigits = true;
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa) digits++;
+			}
+			else exponent++;
+			p++;
+		}
+
+		// fractional part
+		if (p < end && *p == '.') {
+			p++;
+			while (p < end && IsDigit(*p)) {
+				anyDigits = true;
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa) digits++;
+					exponent--;
+				}
+				p++;
+			}
+		}
+
+		// exponent
+		if (anyDigits && p < end && (*p == 'e' || *p == 'E')) {
+			const char* e = p + 1;
+			bool expNegative = false;
+			if (e < end && (*e == '-' || *e == '+')) {
+				expNegative = *e == '-';
+				e++;
+			}
+			if (e < end && IsDigit(*e)) {
+				int expValue = 0;
+				while (e < end && IsDigit(*e)) {
+					if (expValue < 10000) expValue = expValue * 10 + (*e - '0');
+					e++;
+				}
+				exponent += expNegative ? -expValue : expValue;
+				p = e;
+			}
+		}
+
+		// fast path - both operands are exact, so the division/multiplication is correctly rounded
+		if (anyDigits && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22) {
+			double value = (double)mantissa;
+			value = exponent < 0 ? value / POW10[-exponent] : value * POW10[exponent];
+			out = (float)(negative ? -value : value);
+			return p;
+		}
+
+		// slow path for long mantissas, huge exponents, inf/nan, etc.
+		if (start < end && *start == '+') start++;
+		std::from_chars_result result = std::from_chars(start, end, out);
+		if (result.ec == std::errc()) return result.ptr;
+
+		// not a number at all, skip the token
+		out = 0.0f;
+		while (p < end && *p != ' ' && *p != '\t' && !IsLineEnd(*p)) p++;
+		return p;
+	}
+
+	// Parses a (possibly negative) integer, returns 0 if there is none
+	// - Too many digits saturate at INT_MAX, which no index resolves to
+	inline const char* ParseInt(const char* p, const char* end, int& out)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			p++;
+		}
+
+		int value = 0;
+		while (p < end && IsDigit(*p)) {
+			int digit = *p - '0';
+			value = value > (INT_MAX - digit) / 10 ? INT_MAX : value * 10 + digit;
+			p++;
+		}
+		out = negative ? -value : value;
+		return p;
+	}
+
+	// Converts a 1-based (or negative, relative) obj index to a 0-based index
+	// - Returns -1 when the index doesn't refer to anything read so far
+	inline int ResolveIndex(int index, size_t count)
+	{
+		if (index > 0) return index <= (int)count ? index - 1 : -1;
+		if (index < 0) return (int)count + index >= 0 ? (int)count + index : -1;
+		return -1;
+	}
+
+	// Single corner of a face, as raw obj indices
+	struct FaceCorner
+	{
+		int position;
+		int uv;
+		int normal;
+	};
+
+	// Bit patterns of the attributes that identify a vertex when welding
+	// (position, uv and normal - tangents aren't calculated yet)
+	struct WeldKey
+	{
+		unsigned int bits[8];
+	};
+
+	inline WeldKey MakeWeldKey(const Vertex& v)
+	{
+		static_assert(offsetof(Vertex, Normal) + sizeof(XMFLOAT3) == sizeof(WeldKey), "Vertex layout changed");
+		WeldKey key;
+		memcpy(key.bits, &v, sizeof(WeldKey));
+		return key;
+	}
+
+	inline size_t HashWeldKey(const WeldKey& key)
+	{
+		unsigned long long h = 0x9E3779B97F4A7C15ull;
+		for (unsigned int b : key.bits) {
+			h ^= b;
+			h *= 0xFF51AFD7ED558CCDull;
+			h ^= h >> 32;
+		}
+		return (size_t)h;
+	}
+
+	// Builds a left-handed vertex from right-handed obj data
+	// - See the notes in LoadOBJLegacy() for why these flips happen
+	inline Vertex MakeVertex(const XMFLOAT3& pos, const XMFLOAT2& uv, const XMFLOAT3& normal)
+	{
+		Vertex v = {};
+		v.Position = XMFLOAT3(pos.x, pos.y, -pos.z);
+		v.UV = XMFLOAT2(uv.x, 1.0f - uv.y);
+		v.Normal = XMFLOAT3(normal.x, normal.y, -normal.z);
+		return v;
+	}
+
+	// Record counts from a quick pass over the text, used to reserve memory
+	struct OBJCounts
+	{
+		size_t positions;
+		size_t uvs;
+		size_t normals;
+		size_t faces;
+	};
+
+	OBJCounts CountOBJ(const char* p, const char* end)
+	{
+		OBJCounts counts = {};
+		for (; p < end; p = NextLine(p, end)) {
+			if (end - p < 2) break;
+			if (p[0] == 'v') {
+				if (p[1] == ' ' || p[1] == '\t') counts.positions++;
+				else if (p[1] == 't') counts.uvs++;
+				else if (p[1] == 'n') counts.normals++;
+			}
+			else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) counts.faces++;
+		}
+		return counts;
+	}
+
+	// Attribute arrays read from the file
+	struct OBJAttributes
+	{
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT2> uvs;
+		std::vector<XMFLOAT3> normals;
+	};
+
+	// Reads a "v", "vt" or "vn" line (p points at the 'v')
+	inline const char* ParseAttribute(const char* p, const char* end, OBJAttributes& attribs)
+	{
+		if (p[1] == 'n') {
+			XMFLOAT3 norm = {};
+			p = ParseFloat(p + 2, end, norm.x);
+			p = ParseFloat(p, end, norm.y);
+			p = ParseFloat(p, end, norm.z);
+			attribs.normals.push_back(norm);
+		}
+		else if (p[1] == 't') {
+			XMFLOAT2 uv = {};
+			p = ParseFloat(p + 2, end, uv.x);
+			p = ParseFloat(p, end, uv.y);
+			attribs.uvs.push_back(uv);
+		}
+		else if (p[1] == ' ' || p[1] == '\t') {
+			XMFLOAT3 pos = {};
+			p = ParseFloat(p + 1, end, pos.x);
+			p = ParseFloat(p, end, pos.y);
+			p = ParseFloat(p, end, pos.z);
+			attribs.positions.push_back(pos);
+		}
+		return p;
+	}
+
+	// Reads every corner of an "f" line (p points past the 'f')
+	// - Corners can be "v", "v/t", "v//n" or "v/t/n", missing parts are 0
+	inline const char* ParseFaceCorners(const char* p, const char* end, std::vector<FaceCorner>& corners)
+	{
+		while (true) {
+			p = SkipSpaces(p, end);
+			if (p >= end || !(IsDigit(*p) || *p == '-')) break;
+
+			FaceCorner c = {};
+			p = ParseInt(p, end, c.position);
+			if (p < end && *p == '/') {
+				p++;
+				if (p < end && *p != '/') p = ParseInt(p, end, c.uv);
+				if (p < end && *p == '/') p = ParseInt(p + 1, end, c.normal);
+			}
+			corners.push_back(c);
+		}
+		return p;
+	}
+
+	// Turns raw obj indices into 0-based ones given how many of each
+	// attribute had been read when the face appeared (-2 marks "none")
+	// - Returns false if the face points at data that doesn't exist
+	inline bool ResolveFace(FaceCorner* corners, size_t count, size_t nPositions, size_t nUVs, size_t nNormals)
+	{
+		bool valid = count >= 3;
+		for (size_t i = 0; i < count; i++) {
+			FaceCorner& c = corners[i];
+			c.position = ResolveIndex(c.position, nPositions);
+			c.uv = c.uv ? ResolveIndex(c.uv, nUVs) : -2;
+			c.normal = c.normal ? ResolveIndex(c.normal, nNormals) : -2;
+			if (c.position < 0 || c.uv == -1 || c.normal == -1) valid = false;
+		}
+		return valid;
+	}
+
+	// Appends a resolved face as a triangle fan with flipped winding
+	// - Matches the legacy loader's (1, 3, 2) (1, 4, 3) order for quads
+	inline void AppendFace(const FaceCorner* corners, size_t count, const OBJAttributes& attribs, MeshData& out)
+	{
+		const XMFLOAT2 defaultUV(0, 0);
+		const XMFLOAT3 defaultNormal(0, 0, 0);
+
+		auto emit = [&](const FaceCorner& c) {
+			out.indices.push_back((unsigned int)out.vertices.size());
+			out.vertices.push_back(MakeVertex(
+				attribs.positions[c.position],
+				c.uv >= 0 ? attribs.uvs[c.uv] : defaultUV,
+				c.normal >= 0 ? attribs.normals[c.normal] : defaultNormal));
+		};
+		for (size_t k = 1; k + 1 < count; k++) {
+			emit(corners[0]);
+			emit(corners[k + 1]);
+			emit(corners[k]);
+		}
+	}
+
+	// A face read by a worker, which can't be resolved until the
+	// attribute counts of every earlier chunk are known
+	struct FaceRecord
+	{
+		unsigned int firstCorner;
+		unsigned int cornerCount;
+
+		// attributes this chunk had read when the face appeared
+		unsigned int positionCount;
+		unsigned int uvCount;
+		unsigned int normalCount;
+	};
+
+	// One line-aligned slice of the file and everything read from it
+	struct OBJChunk
+	{
+		const char* begin;
+		const char* end;
+
+		OBJAttributes attribs;
+		std::vector<FaceCorner> corners;
+		std::vector<FaceRecord> faces;
+
+		// attributes in all earlier chunks
+		size_t positionBase;
+		size_t uvBase;
+		size_t normalBase;
+
+		// vertices/indices made from this chunk's faces (indices are local)
+		MeshData output;
+		size_t vertexBase;
+		size_t indexBase;
+	};
+}
+
+// ====== Memory mapped loader ===================================================================
+
+bool MeshLoader::LoadOBJ(const char* path, MeshData& out)
+{
+	MappedFile file(path);
+	if (!file.IsOpen()) return false;
+
+	LoadOBJ(file, out);
+	return true;
+}
+
+void MeshLoader::LoadOBJ(const MappedFile& file, MeshData& out)
+{
+	// only big files are worth spinning up threads for
+	if (file.GetSize() >= PARALLEL_PARSE_MIN_BYTES)
+		ParseOBJParallel(file.GetData(), file.GetSize(), out, std::thread::hardware_concurrency());
+	else
+		ParseOBJ(file.GetData(), file.GetSize(), out);
+}
+
+void MeshLoader::ParseOBJ(const char* data, size_t size, MeshData& out)
+{
+	const char* end = data + size;
+
+	// cheap pre-scan so the attribute vectors never reallocate
+	OBJCounts counts = CountOBJ(data, end);
+
+	OBJAttributes attribs;
+	attribs.positions.reserve(counts.positions);
+	attribs.uvs.reserve(counts.uvs);
+	attribs.normals.reserve(counts.normals);
+
+	out.vertices.clear();
+	out.indices.clear();
+	out.vertices.reserve(counts.faces * 3);
+	out.indices.reserve(counts.faces * 3);
+
+	// reused for every face so n-gons don't allocate per line
+	std::vector<FaceCorner> corners;
+	corners.reserve(8);
+
+	const char* p = data;
+	while (p < end) {
+		p = SkipSpaces(p, end);
+		if (p >= end) break;
+
+		if (p[0] == 'v' && p + 1 < end) {
+			p = ParseAttribute(p, end, attribs);
+		}
+		else if (p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')) {
+			corners.clear();
+			p = ParseFaceCorners(p + 1, end, corners);
+
+			// drop any face that points at missing data
+			if (ResolveFace(corners.data(), corners.size(),
+				attribs.positions.size(), attribs.uvs.size(), attribs.normals.size()))
+				AppendFace(corners.data(), corners.size(), attribs, out);
+		}
+
+		// comments, groups, materials and whatever is left on this line
+		p = NextLine(p, end);
+	}
+}
+
+void MeshLoader::ParseOBJParallel(const char* data, size_t size, MeshData& out, unsigned int threadCount)
+{
+	if (threadCount < 1) threadCount = 1;
+	const char* end = data + size;
+
+	// split into line-aligned chunks, a few per thread to even out the load
+	size_t chunkCount = threadCount == 1 ? 1 : (size_t)threadCount * 4;
+	std::vector<OBJChunk> chunks(chunkCount);
+	const char* begin = data;
+	for (size_t i = 0; i < chunkCount; i++) {
+		const char* split = i + 1 == chunkCount ? end : data + size * (i + 1) / chunkCount;
+		if (split < begin) split = begin;
+		if (split > begin && split < end && split[-1] != '\n') split = NextLine(split, end);
+		chunks[i].begin = begin;
+		chunks[i].end = split;
+		begin = split;
+	}
+
+	// 1) read attributes and raw faces from each chunk
+	ParallelFor(chunkCount, threadCount, [&](size_t i) {
+		OBJChunk& chunk = chunks[i];
+		OBJCounts counts = CountOBJ(chunk.begin, chunk.end);
+		chunk.attribs.positions.reserve(counts.positions);
+		chunk.attribs.uvs.reserve(counts.uvs);
+		chunk.attribs.normals.reserve(counts.normals);
+		chunk.faces.reserve(counts.faces);
+		chunk.corners.reserve(counts.faces * 4);
+
+		const char* p = chunk.begin;
+		while (p < chunk.end) {
+			p = SkipSpaces(p, chunk.end);
+			if (p >= chunk.end) break;
+
+			if (p[0] == 'v' && p + 1 < chunk.end) {
+				p = ParseAttribute(p, chunk.end, chunk.attribs);
+			}
+			else if (p[0] == 'f' && p + 1 < chunk.end && (p[1] == ' ' || p[1] == '\t')) {
+				FaceRecord face = {};
+				face.firstCorner = (unsigned int)chunk.corners.size();
+				face.positionCount = (unsigned int)chunk.attribs.positions.size();
+				face.uvCount = (unsigned int)chunk.attribs.uvs.size();
+				face.normalCount = (unsigned int)chunk.attribs.normals.size();
+				p = ParseFaceCorners(p + 1, chunk.end, chunk.corners);
+				face.cornerCount = (unsigned int)chunk.corners.size() - face.firstCorner;
+				chunk.faces.push_back(face);
+			}
+			p = NextLine(p, chunk.end);
+		}
+	});
+
+	// 2) stitch the attribute arrays together in file order
+	OBJAttributes attribs;
+	size_t nPositions = 0, nUVs = 0, nNormals = 0;
+	for (OBJChunk& chunk : chunks) {
+		chunk.positionBase = nPositions;
+		chunk.uvBase = nUVs;
+		chunk.normalBase = nNormals;
+		nPositions += chunk.attribs.positions.size();
+		nUVs += chunk.attribs.uvs.size();
+		nNormals += chunk.attribs.normals.size();
+	}
+	attribs.positions.resize(nPositions);
+	attribs.uvs.resize(nUVs);
+	attribs.normals.resize(nNormals);
+	ParallelFor(chunkCount, threadCount, [&](size_t i) {
+		OBJChunk& chunk = chunks[i];
+		std::copy(chunk.attribs.positions.begin(), chunk.attribs.positions.end(), attribs.positions.begin() + chunk.positionBase);
+		std::copy(chunk.attribs.uvs.begin(), chunk.attribs.uvs.end(), attribs.uvs.begin() + chunk.uvBase);
+		std::copy(chunk.attribs.normals.begin(), chunk.attribs.normals.end(), attribs.normals.begin() + chunk.normalBase);
+		chunk.attribs = OBJAttributes();
+	});
+
+	// 3) resolve faces against the global arrays - a face sees exactly the
+	//    attributes the serial parser would have read by that line, so
+	//    relative indices and references into earlier chunks both work
+	ParallelFor(chunkCount, threadCount, [&](size_t i) {
+		OBJChunk& chunk = chunks[i];
+		chunk.output.vertices.reserve(chunk.faces.size() * 3);
+		chunk.output.indices.reserve(chunk.faces.size() * 3);
+		for (const FaceRecord& face : chunk.faces) {
+			FaceCorner* corners = chunk.corners.data() + face.firstCorner;
+			if (ResolveFace(corners, face.cornerCount,
+				chunk.positionBase + face.positionCount,
+				chunk.uvBase + face.uvCount,
+				chunk.normalBase + face.normalCount))
+				AppendFace(corners, face.cornerCount, attribs, chunk.output);
+		}
+	});
+
+	// 4) concatenate the per-chunk geometry, offsetting indices
+	size_t nVertices = 0, nIndices = 0;
+	for (OBJChunk& chunk : chunks) {
+		chunk.vertexBase = nVertices;
+		chunk.indexBase = nIndices;
+		nVertices += chunk.output.vertices.size();
+		nIndices += chunk.output.indices.size();
+	}
+	out.vertices.resize(nVertices);
+	out.indices.resize(nIndices);
+	ParallelFor(chunkCount, threadCount, [&](size_t i) {
+		const OBJChunk& chunk = chunks[i];
+		std::copy(chunk.output.vertices.begin(), chunk.output.vertices.end(), out.vertices.begin() + chunk.vertexBase);
+		unsigned int* dst = out.indices.data() + chunk.indexBase;
+		for (unsigned int index : chunk.output.indices) *dst++ = index + (unsigned int)chunk.vertexBase;
+	});
+}
+
+// ====== Vertex welding =========================================================================
+
+MeshLoader::WeldStats MeshLoader::WeldVertices(MeshData& data)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	WeldStats stats = {};
+	stats.verticesBefore = data.vertices.size();
+
+	// open addressing table, kept at most half full
+	size_t capacity = 16;
+	while (capacity < data.vertices.size() * 2) capacity <<= 1;
+	const size_t mask = capacity - 1;
+	std::vector<unsigned int> table(capacity, UINT_MAX);
+	std::vector<WeldKey> keys;
+
+	std::vector<unsigned int> remap(data.vertices.size());
+	std::vector<Vertex> unique;
+	unique.reserve(data.vertices.size());
+	keys.reserve(data.vertices.size());
+
+	for (size_t i = 0; i < data.vertices.size(); i++) {
+		WeldKey key = MakeWeldKey(data.vertices[i]);
+		size_t slot = HashWeldKey(key) & mask;
+
+		// probe until we find the same vertex or an empty slot
+		while (true) {
+			unsigned int u = table[slot];
+			if (u == UINT_MAX) {
+				u = (unsigned int)unique.size();
+				table[slot] = u;
+				unique.push_back(data.vertices[i]);
+				keys.push_back(key);
+				remap[i] = u;
+				break;
+			}
+			if (memcmp(&keys[u], &key, sizeof(WeldKey)) == 0) {
+				remap[i] = u;
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	for (unsigned int& index : data.indices) index = remap[index];
+	data.vertices.swap(unique);
+
+	stats.verticesAfter = data.vertices.size();
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+// ====== Bounds =================================================================================
+
+void MeshLoader::ComputeBounds(const Vertex* vertices, size_t count, XMFLOAT3& boundsMin, XMFLOAT3& boundsMax)
+{
+	if (count == 0) {
+		boundsMin = boundsMax = XMFLOAT3(0, 0, 0);
+		return;
+	}
+
+	XMVECTOR vMin = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR vMax = vMin;
+	for (size_t i = 1; i < count; i++) {
+		XMVECTOR p = XMLoadFloat3(&vertices[i].Position);
+		vMin = XMVectorMin(vMin, p);
+		vMax = XMVectorMax(vMax, p);
+	}
+	XMStoreFloat3(&boundsMin, vMin);
+	XMStoreFloat3(&boundsMax, vMax);
+}
+
+float MeshLoader::ComputeBoundsRadius(const Vertex* vertices, size_t count, const XMFLOAT3& center)
+{
+	XMVECTOR c = XMLoadFloat3(&center);
+	XMVECTOR maxLengthSq = XMVectorZero();
+	for (size_t i = 0; i < count; i++)
+		maxLengthSq = XMVectorMax(maxLengthSq, XMVector3LengthSq(XMLoadFloat3(&vertices[i].Position) - c));
+	return sqrtf(XMVectorGetX(maxLengthSq));
+}
+
+// ====== Legacy loader ==========================================================================
+
+bool MeshLoader::LoadOBJLegacy(const char* path, MeshData& out)
+{
+	// Author: Chris Cascioli
+	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
+	//
+	// - You are allowed to directly copy/paste this into your code base
+	//   for assignments, given that you clearly cite that this is not
+	//   code of your own design.
+
+	// File input object
+	std::ifstream obj(path);
+
+	// Check for successful open
+	if (!obj.is_open())
+		return false;
+
+	// Variables used while reading the file
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;		// UVs from the file
+	std::vector<Vertex>& verts = out.vertices;	// Verts we're assembling
+	std::vector<UINT>& indices = out.indices;	// Indices of these verts
+	int vertCounter = 0;			// Count of vertices
+	int indexCounter = 0;			// Count of indices
+	char chars[100];			// String for line reading
+
+	verts.clear();
+	indices.clear();
+
+	// Still have data left?
+	while (obj.good())
+	{
+		// Get the line (100 characters should be more than enough)
+		obj.getline(chars, 100);
+
+		// Check the type of line
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			// Read the 3 numbers directly into an XMFLOAT3
+			XMFLOAT3 norm = {};
+			sscanf_s(
+				chars,
+				"vn %f %f %f",
+				&norm.x, &norm.y, &norm.z);
+
+			// Add to the list of normals
+			normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			// Read the 2 numbers directly into an XMFLOAT2
+			XMFLOAT2 uv = {};
+			sscanf_s(
+				chars,
+				"vt %f %f",
+				&uv.x, &uv.y);
+
+			// Add to the list of uv's
+			uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			// Read the 3 numbers directly into an XMFLOAT3
+			XMFLOAT3 pos = {};
+			sscanf_s(
+				chars,
+				"v %f %f %f",
+				&pos.x, &pos.y, &pos.z);
+
+			// Add to the positions
+			positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			// Read the face indices into an array
+			// NOTE: This assumes the given obj file contains
+			//  vertex positions, uv coordinates AND normals.
+			unsigned int i[12] = {};
+			int numbersRead = sscanf_s(
+				chars,
+				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2],
+				&i[3], &i[4], &i[5],
+				&i[6], &i[7], &i[8],
+				&i[9], &i[10], &i[11]);
+
+			// If we only got the first number, chances are the OBJ
+			// file has no UV coordinates.  This isn't great, but we
+			// still want to load the model without crashing, so we
+			// need to re-read a different pattern (in which we assume
+			// there are no UVs denoted for any of the vertices)
+			if (numbersRead == 1)
+			{
+				// Re-read with a different pattern
+				numbersRead = sscanf_s(
+					chars,
+					"f %d//%d %d//%d %d//%d %d//%d",
+					&i[0], &i[2],
+					&i[3], &i[5],
+					&i[6], &i[8],
+					&i[9], &i[11]);
+
+				// The following indices are where the UVs should
+				// have been, so give them a valid value
+				i[1] = 1;
+				i[4] = 1;
+				i[7] = 1;
+				i[10] = 1;
+
+				// If we have no UVs, create a single UV coordinate
+				// that will be used for all vertices
+				if (uvs.size() == 0)
+					uvs.push_back(XMFLOAT2(0, 0));
+			}
+
+			// - Create the verts by looking up
+			//    corresponding data from vectors
+			// - OBJ File indices are 1-based, so
+			//    they need to be adusted
+			Vertex v1 = {};
+			v1.Position = positions[static_cast<size_t>(i[0]) - 1];
+			v1.UV = uvs[static_cast<size_t>(i[1]) - 1];
+			v1.Normal = normals[static_cast<size_t>(i[2]) - 1];
+
+			Vertex v2 = {};
+			v2.Position = positions[static_cast<size_t>(i[3]) - 1];
+			v2.UV = uvs[static_cast<size_t>(i[4]) - 1];
+			v2.Normal = normals[static_cast<size_t>(i[5]) - 1];
+
+			Vertex v3 = {};
+			v3.Position = positions[static_cast<size_t>(i[6]) - 1];
+			v3.UV = uvs[static_cast<size_t>(i[7]) - 1];
+			v3.Normal = normals[static_cast<size_t>(i[8]) - 1];
+
+			// The model is most likely in a right-handed space,
+			// especially if it came from Maya.  We want to convert
+			// to a left-handed space for DirectX.  This means we
+			// need to:
+			//  - Invert the Z position
+			//  - Invert the normal's Z
+			//  - Flip the winding order
+			// We also need to flip the UV coordinate since DirectX
+			// defines (0,0) as the top left of the texture, and many
+			// 3D modeling packages use the bottom left as (0,0)
+
+			// Flip the UV's since they're probably "upside down"
+			v1.UV.y = 1.0f - v1.UV.y;
+			v2.UV.y = 1.0f - v2.UV.y;
+			v3.UV.y = 1.0f - v3.UV.y;
+
+			// Flip Z (LH vs. RH)
+			v1.Position.z *= -1.0f;
+			v2.Position.z *= -1.0f;
+			v3.Position.z *= -1.0f;
+
+			// Flip normal's Z
+			v1.Normal.z *= -1.0f;
+			v2.Normal.z *= -1.0f;
+			v3.Normal.z *= -1.0f;
+
+			// Add the verts to the vector (flipping the winding order)
+			verts.push_back(v1);
+			verts.push_back(v3);
+			verts.push_back(v2);
+			vertCounter += 3;
+
+			// Add three more indices
+			indices.push_back(indexCounter); indexCounter += 1;
+			indices.push_back(indexCounter); indexCounter += 1;
+			indices.push_back(indexCounter); indexCounter += 1;
+
+			// Was there a 4th face?
+			// - 12 numbers read means 4 faces WITH uv's
+			// - 8 numbers read means 4 faces WITHOUT uv's
+			if (numbersRead == 12 || numbersRead == 8)
+			{
+				// Make the last vertex
+				Vertex v4 = {};
+				v4.Position = positions[static_cast<size_t>(i[9]) - 1];
+				v4.UV = uvs[static_cast<size_t>(i[10]) - 1];
+				v4.Normal = normals[static_cast<size_t>(i[11]) - 1];
+
+				// Flip the UV, Z pos and normal's Z
+				v4.UV.y = 1.0f - v4.UV.y;
+				v4.Position.z *= -1.0f;
+				v4.Normal.z *= -1.0f;
+
+				// Add a whole triangle (flipping the winding order)
+				verts.push_back(v1);
+				verts.push_back(v4);
+				verts.push_back(v3);
+				vertCounter += 3;
+
+				// Add three more indices
+				indices.push_back(indexCounter); indexCounter += 1;
+				indices.push_back(indexCounter); indexCounter += 1;
+				indices.push_back(indexCounter); indexCounter += 1;
+			}
+		}
+	}
+
+	// Close the file
+	obj.close();
+	return true;
+}
+
+// ====== Benchmark ==============================================================================
+
+std::vector<MeshLoader::OBJBenchmarkResult> MeshLoader::BenchmarkOBJ(const std::vector<std::string>& paths, int iterations)
+{
+	using Clock = std::chrono::steady_clock;
+	std::vector<OBJBenchmarkResult> results;
+	if (iterations < 1) iterations = 1;
+
+	for (const std::string& path : paths) {
+		OBJBenchmarkResult result = {};
+		result.file = path;
+		{
+			MappedFile file(path.c_str());
+			if (!file.IsOpen()) continue;
+			result.bytes = file.GetSize();
+		}
+
+		MeshData data;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < iterations; i++) LoadOBJLegacy(path.c_str(), data);
+		result.legacyMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+
+		start = Clock::now();
+		for (int i = 0; i < iterations; i++) LoadOBJ(path.c_str(), data);
+		result.mappedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+
+		results.push_back(result);
+	}
+	return results;
+}
+
+std::string MeshLoader::GenerateSyntheticOBJ(int gridSize)
+{
+	if (gridSize < 1) gridSize = 1;
+	int side = gridSize + 1;
+
+	std::string text;
+	text.reserve((size_t)side * side * 96 + (size_t)gridSize * gridSize * 48);
+	text += "# synthetic grid\n";
+
+	char line[128];
+	for (int y = 0; y < side; y++) {
+		for (int x = 0; x < side; x++) {
+			float u = (float)x / gridSize;
+			float v = (float)y / gridSize;
+			snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", u * 10.0f - 5.0f, sinf(u * 6.2831853f) * 0.5f, v * 10.0f - 5.0f);
+			text += line;
+			snprintf(line, sizeof(line), "vt %.6f %.6f\n", u, v);
+			text += line;
+			snprintf(line, sizeof(line), "vn 0.000000 1.000000 0.000000\n");
+			text += line;
+		}
+	}
+
+	// faces use absolute 1-based indices, same index for v/vt/vn
+	for (int y = 0; y < gridSize; y++) {
+		for (int x = 0; x < gridSize; x++) {
+			int a = y * side + x + 1;
+			int b = a + 1;
+			int c = a + side + 1;
+			int d = a + side;
+			snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+			text += line;
+		}
+	}
+	return text;
+}
+
+std::vector<MeshLoader::ParallelOBJBenchmarkResult> MeshLoader::BenchmarkParallelOBJ(
+	const std::string& text, const std::vector<unsigned int>& threadCounts, int iterations)
+{
+	using Clock = std::chrono::steady_clock;
+	std::vector<ParallelOBJBenchmarkResult> results;
+	if (iterations < 1) iterations = 1;
+
+	MeshData reference;
+	ParseOBJ(text.data(), text.size(), reference);
+
+	for (unsigned int threads : threadCounts) {
+		ParallelOBJBenchmarkResult result = {};
+		result.threads = threads;
+
+		MeshData data;
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < iterations; i++) ParseOBJParallel(text.data(), text.size(), data, threads);
+		result.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+
+		result.matchesSerial =
+			data.vertices.size() == reference.vertices.size() &&
+			data.indices.size() == reference.indices.size() &&
+			memcmp(data.vertices.data(), reference.vertices.data(), data.vertices.size() * sizeof(Vertex)) == 0 &&
+			memcmp(data.indices.data(), reference.indices.data(), data.indices.size() * sizeof(unsigned int)) == 0;
+
+		results.push_back(result);
+	}
+	return results;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "MeshData.h"
+
+#include <Windows.h>
+#include <vector>
+#include <string>
+
+// --------------------------------------------------------
+// Read-only memory mapped view of a whole file
+// - The view stays valid for the lifetime of the object
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const char* path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsOpen() const { return file != INVALID_HANDLE_VALUE; }
+	const char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const char* data;
+	size_t size;
+};
+
+namespace MeshLoader
+{
+	// Memory maps an .obj file and parses it with the tokenizer below
+	// - Returns false if the file could not be opened
+	bool LoadOBJ(const char* path, MeshData& out);
+
+	// Parses an .obj that is already mapped, on several threads if it's big
+	void LoadOBJ(const MappedFile& file, MeshData& out);
+
+	// Parses .obj text already in memory (no copies, no locale)
+	void ParseOBJ(const char* data, size_t size, MeshData& out);
+
+	// Same output as ParseOBJ(), but the text is split into line-aligned
+	// chunks that are tokenized on "threadCount" threads and stitched
+	// back together in file order
+	void ParseOBJParallel(const char* data, size_t size, MeshData& out, unsigned int threadCount);
+
+	// Files smaller than this are parsed on a single thread by LoadOBJ()
+	constexpr size_t PARALLEL_PARSE_MIN_BYTES = 1 << 20;
+
+	// Result of a welding pass
+	struct WeldStats
+	{
+		size_t verticesBefore;
+		size_t verticesAfter;
+		double ms;
+	};
+
+	// Collapses vertices with identical position/uv/normal into one
+	// shared vertex and rewrites the index buffer to match
+	// - Tangents are ignored, run this before CalculateTangents()
+	WeldStats WeldVertices(MeshData& data);
+
+	// Axis aligned bounds of the vertex positions (zero if empty)
+	void ComputeBounds(const Vertex* vertices, size_t count, DirectX::XMFLOAT3& boundsMin, DirectX::XMFLOAT3& boundsMax);
+
+	// Radius of the smallest sphere around "center" that holds every
+	// vertex, at most half the box's diagonal when "center" is its middle
+	float ComputeBoundsRadius(const Vertex* vertices, size_t count, const DirectX::XMFLOAT3& center);
+
+	// Original ifstream/getline/sscanf_s parser
+	// - Kept as the reference implementation for benchmarking
+	bool LoadOBJLegacy(const char* path, MeshData& out);
+
+	// Timing for a single file, legacy vs. memory mapped parser
+	struct OBJBenchmarkResult
+	{
+		std::string file;
+		size_t bytes;
+		double legacyMs;
+		double mappedMs;
+	};
+
+	// Loads every file "iterations" times with both parsers and
+	// reports the average time per load
+	std::vector<OBJBenchmarkResult> BenchmarkOBJ(const std::vector<std::string>& paths, int iterations);
+
+	// Builds .obj text for a gridSize x gridSize patch of quads with
+	// positions, uvs and normals - used as a large parsing workload
+	std::string GenerateSyntheticOBJ(int gridSize);
+
+	// Timing for one thread count of the parallel parser
+	struct ParallelOBJBenchmarkResult
+	{
+		unsigned int threads;
+		double ms;
+		bool matchesSerial;
+	};
+
+	// Parses "text" with each thread count "iterations" times and checks
+	// the output against the serial parser byte for byte
+	std::vector<ParallelOBJBenchmarkResult> BenchmarkParallelOBJ(
+		const std::string& text, const std::vector<unsigned int>& threadCounts, int iterations);
+}
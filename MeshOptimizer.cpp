@@ -0,0 +1,258 @@
+#include "MeshOptimizer.h"
+
+#include <cmath>
+
+// ====== Forsyth scoring ========================================================================
+
+namespace
+{
+	// tuning values from the original article
+	// - https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRI_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	// valence is clamped here for the score table, higher counts
+	// all get (close to) no boost anyway
+	const unsigned int MAX_VALENCE = 32;
+
+	// precomputed scores by cache position and by remaining triangle count
+	struct ScoreTables
+	{
+		float cache[MeshOptimizer::FORSYTH_CACHE_SIZE];
+		float valence[MAX_VALENCE + 1];
+
+		ScoreTables()
+		{
+			const unsigned int size = MeshOptimizer::FORSYTH_CACHE_SIZE;
+			for (unsigned int i = 0; i < size; i++) {
+				// the last triangle's three vertices get a fixed score so the
+				// next triangle doesn't just reuse the same edge
+				if (i < 3) cache[i] = LAST_TRI_SCORE;
+				else cache[i] = powf(1.0f - (float)(i - 3) / (size - 3), CACHE_DECAY_POWER);
+			}
+
+			valence[0] = 0;
+			for (unsigned int i = 1; i <= MAX_VALENCE; i++)
+				valence[i] = VALENCE_BOOST_SCALE * powf((float)i, -VALENCE_BOOST_POWER);
+		}
+	};
+
+	const ScoreTables& GetScoreTables()
+	{
+		static const ScoreTables tables;
+		return tables;
+	}
+
+	// score of a vertex at "cachePosition" (-1 if not cached) with
+	// "remaining" triangles still to be emitted
+	inline float VertexScore(int cachePosition, unsigned int remaining)
+	{
+		// nothing left to draw, vertex can't help any triangle
+		if (remaining == 0) return -1.0f;
+
+		const ScoreTables& tables = GetScoreTables();
+		float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+		return score + tables.valence[remaining < MAX_VALENCE ? remaining : MAX_VALENCE];
+	}
+}
+
+// ====== Vertex cache ===========================================================================
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	size_t triCount = indices.size() / 3;
+	if (triCount == 0 || vertexCount == 0) return;
+
+	// triangle adjacency per vertex, as offsets into one flat array
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int index : indices) remaining[index]++;
+
+	std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	{
+		std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t t = 0; t < triCount; t++)
+			for (int k = 0; k < 3; k++)
+				adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+	}
+
+	// starting scores
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) vertexScore[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triScore(triCount);
+	std::vector<bool> emitted(triCount, false);
+	for (size_t t = 0; t < triCount; t++)
+		triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	// simulated LRU cache, with room for a triangle's worth of overflow
+	const unsigned int cacheSize = FORSYTH_CACHE_SIZE;
+	unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+	unsigned int cacheCount = 0;
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	// best triangle overall to start
+	size_t best = 0;
+	for (size_t t = 1; t < triCount; t++)
+		if (triScore[t] > triScore[best]) best = t;
+
+	// fallback cursor for when nothing in the cache has triangles left
+	size_t cursor = 0;
+
+	while (true) {
+		const unsigned int* tri = &indices[best * 3];
+		result.push_back(tri[0]);
+		result.push_back(tri[1]);
+		result.push_back(tri[2]);
+		emitted[best] = true;
+
+		// new cache: this triangle's vertices first, then the old order
+		unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+		unsigned int newCount = 0;
+		for (int k = 0; k < 3; k++) newCache[newCount++] = tri[k];
+		for (unsigned int i = 0; i < cacheCount; i++) {
+			unsigned int v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2]) newCache[newCount++] = v;
+		}
+
+		// the triangle no longer counts toward its vertices' valence
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = tri[k];
+			unsigned int* begin = &adjacency[adjacencyOffset[v]];
+			unsigned int* end = begin + remaining[v];
+			for (unsigned int* a = begin; a < end; a++) {
+				if (*a == best) {
+					*a = end[-1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// rescore everything that was or is in the cache
+		for (unsigned int i = 0; i < newCount; i++) {
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < cacheSize ? (int)i : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		// update affected triangles and find the best candidate
+		float bestScore = -1.0f;
+		size_t next = triCount;
+		for (unsigned int i = 0; i < newCount; i++) {
+			unsigned int v = newCache[i];
+			const unsigned int* adj = &adjacency[adjacencyOffset[v]];
+			for (unsigned int a = 0; a < remaining[v]; a++) {
+				unsigned int t = adj[a];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				triScore[t] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					next = t;
+				}
+			}
+		}
+
+		cacheCount = newCount < cacheSize ? newCount : cacheSize;
+		for (unsigned int i = 0; i < cacheCount; i++) cache[i] = newCache[i];
+
+		// cache ran dry, continue with the next unemitted triangle
+		if (next == triCount) {
+			while (cursor < triCount && emitted[cursor]) cursor++;
+			if (cursor == triCount) break;
+			next = cursor;
+		}
+		best = next;
+	}
+
+	indices.swap(result);
+}
+
+// ====== Vertex fetch ===========================================================================
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& data)
+{
+	const unsigned int unassigned = ~0u;
+	std::vector<unsigned int> remap(data.vertices.size(), unassigned);
+	std::vector<Vertex> vertices;
+	vertices.reserve(data.vertices.size());
+
+	for (unsigned int& index : data.indices) {
+		if (remap[index] == unassigned) {
+			remap[index] = (unsigned int)vertices.size();
+			vertices.push_back(data.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	// keep anything the index buffer never touches
+	for (size_t v = 0; v < data.vertices.size(); v++)
+		if (remap[v] == unassigned) vertices.push_back(data.vertices[v]);
+
+	data.vertices.swap(vertices);
+}
+
+// ====== Analysis ===============================================================================
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount,
+	size_t vertexCount, unsigned int cacheSize, CacheModel model)
+{
+	CacheStats stats = {};
+	if (indexCount < 3 || vertexCount == 0 || cacheSize == 0) return stats;
+
+	if (model == FIFO) {
+		// a vertex is cached if fewer than cacheSize misses happened since
+		// it was last loaded - no need to model the queue itself
+		std::vector<size_t> loadedAt(vertexCount, 0);
+		std::vector<bool> seen(vertexCount, false);
+		for (size_t i = 0; i < indexCount; i++) {
+			unsigned int v = indices[i];
+			if (!seen[v] || stats.misses - loadedAt[v] >= cacheSize) {
+				seen[v] = true;
+				loadedAt[v] = stats.misses;
+				stats.misses++;
+			}
+		}
+	}
+	else {
+		// small caches, so a linear search over the entries is fine
+		std::vector<unsigned int> cache;
+		cache.reserve(cacheSize + 1);
+		for (size_t i = 0; i < indexCount; i++) {
+			unsigned int v = indices[i];
+			size_t slot = 0;
+			while (slot < cache.size() && cache[slot] != v) slot++;
+
+			if (slot == cache.size()) {
+				stats.misses++;
+				cache.insert(cache.begin(), v);
+				if (cache.size() > cacheSize) cache.pop_back();
+			}
+			else {
+				cache.erase(cache.begin() + slot);
+				cache.insert(cache.begin(), v);
+			}
+		}
+	}
+
+	// ATVR is against the vertices the index buffer actually uses
+	std::vector<bool> used(vertexCount, false);
+	size_t usedCount = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		if (!used[indices[i]]) {
+			used[indices[i]] = true;
+			usedCount++;
+		}
+	}
+
+	stats.acmr = (double)stats.misses / (indexCount / 3);
+	stats.atvr = (double)stats.misses / usedCount;
+	return stats;
+}
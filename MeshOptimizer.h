@@ -0,0 +1,41 @@
+#pragma once
+
+#include "MeshData.h"
+
+#include <vector>
+
+// --------------------------------------------------------
+// Index/vertex reordering for better GPU cache use
+// - Run after welding, once vertices are actually shared
+// --------------------------------------------------------
+namespace MeshOptimizer
+{
+	// cache size the triangle reordering scores against
+	constexpr unsigned int FORSYTH_CACHE_SIZE = 32;
+
+	// Reorders triangles so consecutive triangles reuse recently
+	// transformed vertices (Tom Forsyth's linear-speed algorithm)
+	void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+	// Reorders the vertex buffer into first-use order of the index
+	// buffer so vertex fetches walk memory forwards
+	// - Unreferenced vertices are kept, at the end
+	void OptimizeVertexFetch(MeshData& data);
+
+	// How the simulated post-transform cache replaces entries
+	enum CacheModel {
+		FIFO,	// most hardware, a hit doesn't refresh the entry
+		LRU		// a hit moves the entry to the front
+	};
+
+	struct CacheStats
+	{
+		double acmr;	// average cache miss ratio: misses per triangle (0.5 - 3)
+		double atvr;	// average transform to vertex ratio: misses per vertex (1 is ideal)
+		size_t misses;
+	};
+
+	// Runs the index buffer through a simulated cache of "cacheSize" entries
+	CacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+		unsigned int cacheSize, CacheModel model);
+}
@@ -0,0 +1,544 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "BVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+// ====== Quadrics ===============================================================================
+
+namespace
+{
+	// open borders are held in place by a plane through the edge,
+	// weighted this much more than the surface around it
+	const float BORDER_WEIGHT = 10.0f;
+
+	// penalty for collapsing across a change in normal/uv, scaled by
+	// the squared edge length so it's in the same units as the quadric
+	const float NORMAL_WEIGHT = 0.5f;
+	const float UV_WEIGHT = 0.5f;
+
+	// a collapse may turn a neighbouring triangle's normal by at most
+	// acos(this), more than that counts as a flip
+	const float FLIP_COS = 0.25f;
+
+	// LOD generation gives up once a level keeps more than this
+	// fraction of the triangles of the level before
+	const float MIN_LOD_GAIN = 0.9f;
+
+	// symmetric 4x4 error matrix plus the total weight that went into it
+	struct Quadric
+	{
+		double a00, a11, a22, a10, a20, a21;
+		double b0, b1, b2;
+		double c;
+		double w;
+	};
+
+	// plane through "point" with unit normal (nx, ny, nz)
+	void AddPlane(Quadric& q, float nx, float ny, float nz, const XMFLOAT3& point, float weight)
+	{
+		double d = -((double)nx * point.x + (double)ny * point.y + (double)nz * point.z);
+		q.a00 += weight * nx * nx; q.a11 += weight * ny * ny; q.a22 += weight * nz * nz;
+		q.a10 += weight * ny * nx; q.a20 += weight * nz * nx; q.a21 += weight * nz * ny;
+		q.b0 += weight * nx * d; q.b1 += weight * ny * d; q.b2 += weight * nz * d;
+		q.c += weight * d * d;
+		q.w += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a00 += other.a00; q.a11 += other.a11; q.a22 += other.a22;
+		q.a10 += other.a10; q.a20 += other.a20; q.a21 += other.a21;
+		q.b0 += other.b0; q.b1 += other.b1; q.b2 += other.b2;
+		q.c += other.c;
+		q.w += other.w;
+	}
+
+	// weighted average squared distance from "p" to the planes in "q"
+	float EvaluateQuadric(const Quadric& q, const XMFLOAT3& p)
+	{
+		if (q.w <= 0) return 0;
+		double x = p.x, y = p.y, z = p.z;
+		double r =
+			q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+			2 * (q.a10 * x * y + q.a20 * x * z + q.a21 * y * z) +
+			2 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+		return (float)((std::max)(r, 0.0) / q.w);
+	}
+
+	inline XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+}
+
+// ====== Topology ===============================================================================
+
+namespace
+{
+	// what a vertex is allowed to collapse along
+	enum VertexKind : unsigned char
+	{
+		Manifold,	// interior vertex, any edge
+		Border,		// on an open edge, only along that edge onto another border vertex
+		Seam,		// one of a pair sharing a position (uv/normal split), only along the seam
+		Locked		// corners, poles and anything more tangled, never moves
+	};
+
+	const unsigned int NONE = UINT_MAX;
+
+	struct Topology
+	{
+		std::vector<unsigned int> positionId;	// first vertex with the same position
+		std::vector<unsigned int> wedge;		// next vertex with the same position (circular)
+		std::vector<unsigned int> openOut;		// open edge leaving the vertex, NONE if none, itself if several
+		std::vector<unsigned int> openIn;		// open edge arriving at the vertex, same rules
+		std::vector<VertexKind> kind;
+		std::vector<uint64_t> edges;			// every directed edge of the input, sorted
+	};
+
+	inline uint64_t EdgeKey(unsigned int a, unsigned int b) { return ((uint64_t)a << 32) | b; }
+
+	// true if a -> b was an edge of the input without a b -> a
+	inline bool IsOpenEdge(const Topology& topo, unsigned int a, unsigned int b)
+	{
+		return !std::binary_search(topo.edges.begin(), topo.edges.end(), EdgeKey(b, a));
+	}
+
+	void BuildTopology(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, Topology& topo)
+	{
+		size_t vertexCount = vertices.size();
+
+		// vertices that share a position, open addressing like WeldVertices()
+		topo.positionId.resize(vertexCount);
+		topo.wedge.resize(vertexCount);
+		{
+			size_t capacity = 16;
+			while (capacity < vertexCount * 2) capacity <<= 1;
+			const size_t mask = capacity - 1;
+			std::vector<unsigned int> table(capacity, NONE);
+
+			for (unsigned int v = 0; v < vertexCount; v++) {
+				const XMFLOAT3& p = vertices[v].Position;
+				uint32_t bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				size_t slot = ((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u)) & mask;
+
+				while (true) {
+					unsigned int u = table[slot];
+					if (u == NONE) {
+						table[slot] = v;
+						topo.positionId[v] = v;
+						topo.wedge[v] = v;
+						break;
+					}
+					if (memcmp(&vertices[u].Position, &p, sizeof(XMFLOAT3)) == 0) {
+						topo.positionId[v] = u;
+						topo.wedge[v] = topo.wedge[u];
+						topo.wedge[u] = v;
+						break;
+					}
+					slot = (slot + 1) & mask;
+				}
+			}
+		}
+
+		// directed edges, an edge is open if the reverse isn't there
+		topo.edges.clear();
+		topo.edges.reserve(indices.size());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+			for (int k = 0; k < 3; k++)
+				topo.edges.push_back(EdgeKey(indices[t + k], indices[t + (k + 1) % 3]));
+		std::sort(topo.edges.begin(), topo.edges.end());
+
+		topo.openOut.assign(vertexCount, NONE);
+		topo.openIn.assign(vertexCount, NONE);
+		for (uint64_t e : topo.edges) {
+			unsigned int a = (unsigned int)(e >> 32);
+			unsigned int b = (unsigned int)e;
+			if (!IsOpenEdge(topo, a, b)) continue;
+
+			topo.openOut[a] = (topo.openOut[a] == NONE || topo.openOut[a] == b) ? b : a;
+			topo.openIn[b] = (topo.openIn[b] == NONE || topo.openIn[b] == a) ? a : b;
+		}
+
+		topo.kind.resize(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; v++) {
+			unsigned int out = topo.openOut[v];
+			unsigned int in = topo.openIn[v];
+			unsigned int w = topo.wedge[v];
+
+			if (w == v) {
+				if (out == NONE && in == NONE) topo.kind[v] = Manifold;
+				else if (out != NONE && in != NONE && out != v && in != v) topo.kind[v] = Border;
+				else topo.kind[v] = Locked;
+			}
+			else if (topo.wedge[w] == v) {
+				// the two halves of a seam run in opposite directions
+				unsigned int wOut = topo.openOut[w];
+				unsigned int wIn = topo.openIn[w];
+				bool open = out != NONE && in != NONE && wOut != NONE && wIn != NONE &&
+					out != v && in != v && wOut != w && wIn != w;
+				if (open &&
+					topo.positionId[out] == topo.positionId[wIn] &&
+					topo.positionId[in] == topo.positionId[wOut])
+					topo.kind[v] = Seam;
+				else
+					topo.kind[v] = Locked;
+			}
+			else {
+				topo.kind[v] = Locked;
+			}
+		}
+	}
+
+	// the other half of a seam collapse v0 -> v1
+	inline unsigned int SeamTarget(const Topology& topo, unsigned int v0, unsigned int v1)
+	{
+		unsigned int s0 = topo.wedge[v0];
+		return topo.openOut[v0] == v1 ? topo.openIn[s0] : topo.openOut[s0];
+	}
+
+	// true if v0 -> v1 is a collapse the vertex kinds allow
+	bool CanCollapse(const Topology& topo, unsigned int v0, unsigned int v1)
+	{
+		VertexKind k0 = topo.kind[v0];
+		VertexKind k1 = topo.kind[v1];
+		if (k0 == Manifold) return true;
+		if (k0 == Locked || k0 != k1) return false;
+
+		// borders and seams only move along their own open edge
+		if (topo.openOut[v0] != v1 && topo.openIn[v0] != v1) return false;
+		if (k0 == Seam) {
+			unsigned int s1 = SeamTarget(topo, v0, v1);
+			return s1 != NONE && topo.positionId[s1] == topo.positionId[v1];
+		}
+		return true;
+	}
+
+	// points an open edge past a vertex that was collapsed away
+	void RemapOpenEdges(std::vector<unsigned int>& open, const std::vector<unsigned int>& remap)
+	{
+		for (unsigned int v = 0; v < open.size(); v++) {
+			unsigned int t = open[v];
+			if (t == NONE || t == v || remap[t] == t) continue;
+			open[v] = remap[t] == v ? open[t] : remap[t];
+		}
+	}
+}
+
+// ====== Simplification =========================================================================
+
+namespace
+{
+	struct Collapse
+	{
+		unsigned int v0;
+		unsigned int v1;
+		float cost;		// quadric error plus attribute penalty, for ordering
+		float error;	// distance part only, in local units
+	};
+
+	// vertex -> triangle adjacency as offsets into one flat array
+	struct Adjacency
+	{
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> triangles;
+	};
+
+	void BuildAdjacency(const std::vector<unsigned int>& indices, size_t vertexCount, Adjacency& adj)
+	{
+		adj.offsets.assign(vertexCount + 1, 0);
+		for (unsigned int index : indices) adj.offsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++) adj.offsets[v + 1] += adj.offsets[v];
+
+		adj.triangles.resize(indices.size());
+		std::vector<unsigned int> fill(adj.offsets.begin(), adj.offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adj.triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	// cost of moving v0 (and its seam partner) onto v1
+	Collapse EvaluateCollapse(const std::vector<Vertex>& vertices, const Topology& topo,
+		const std::vector<Quadric>& quadrics, unsigned int v0, unsigned int v1)
+	{
+		const Vertex& a = vertices[v0];
+		const Vertex& b = vertices[v1];
+
+		float error = EvaluateQuadric(quadrics[v0], b.Position);
+		if (topo.kind[v0] == Seam)
+			error = (std::max)(error, EvaluateQuadric(quadrics[topo.wedge[v0]], b.Position));
+
+		XMFLOAT3 edge = Sub(b.Position, a.Position);
+		XMFLOAT3 dn = Sub(b.Normal, a.Normal);
+		float du = b.UV.x - a.UV.x;
+		float dv = b.UV.y - a.UV.y;
+		float attribute = Dot(edge, edge) * (NORMAL_WEIGHT * Dot(dn, dn) + UV_WEIGHT * (du * du + dv * dv));
+
+		return Collapse{ v0, v1, error + attribute, sqrtf(error) };
+	}
+
+	// true if moving v0 onto v1 turns any of v0's remaining triangles over
+	bool Flips(const std::vector<Vertex>& vertices, const Topology& topo, const std::vector<unsigned int>& indices,
+		const Adjacency& adj, unsigned int v0, unsigned int v1)
+	{
+		const XMFLOAT3& p0 = vertices[v0].Position;
+		const XMFLOAT3& p1 = vertices[v1].Position;
+		unsigned int target = topo.positionId[v1];
+
+		for (unsigned int i = adj.offsets[v0]; i < adj.offsets[v0 + 1]; i++) {
+			const unsigned int* tri = &indices[adj.triangles[i] * 3];
+			int k = tri[0] == v0 ? 0 : tri[1] == v0 ? 1 : 2;
+			unsigned int b = tri[(k + 1) % 3];
+			unsigned int c = tri[(k + 2) % 3];
+
+			// triangles on the collapsing edge disappear
+			if (topo.positionId[b] == target || topo.positionId[c] == target) continue;
+
+			const XMFLOAT3& pb = vertices[b].Position;
+			const XMFLOAT3& pc = vertices[c].Position;
+			XMFLOAT3 before = Cross(Sub(pb, p0), Sub(pc, p0));
+			XMFLOAT3 after = Cross(Sub(pb, p1), Sub(pc, p1));
+			float d = Dot(before, after);
+			if (d <= 0 || d * d < FLIP_COS * FLIP_COS * Dot(before, before) * Dot(after, after)) return true;
+		}
+		return false;
+	}
+
+	// locks every position in v's triangles for the rest of the pass
+	void LockNeighbours(const Topology& topo, const std::vector<unsigned int>& indices, const Adjacency& adj,
+		unsigned int v, std::vector<unsigned char>& locked)
+	{
+		for (unsigned int i = adj.offsets[v]; i < adj.offsets[v + 1]; i++) {
+			const unsigned int* tri = &indices[adj.triangles[i] * 3];
+			for (int k = 0; k < 3; k++) locked[topo.positionId[tri[k]]] = 1;
+		}
+	}
+}
+
+float MeshSimplifier::Simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+	size_t targetIndexCount, float maxError, std::vector<unsigned int>& out,
+	std::vector<unsigned int>* collapsedTo)
+{
+	out = indices;
+	size_t vertexCount = vertices.size();
+	if (collapsedTo) {
+		collapsedTo->resize(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; v++) (*collapsedTo)[v] = v;
+	}
+	if (out.size() <= targetIndexCount || vertexCount == 0) return 0;
+
+	Topology topo;
+	BuildTopology(vertices, indices, topo);
+
+	// area weighted face planes, plus border planes along open edges
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		unsigned int i[3] = { indices[t], indices[t + 1], indices[t + 2] };
+		const XMFLOAT3& p0 = vertices[i[0]].Position;
+		XMFLOAT3 n = Cross(Sub(vertices[i[1]].Position, p0), Sub(vertices[i[2]].Position, p0));
+		float length = sqrtf(Dot(n, n));
+		if (length == 0) continue;
+		n = XMFLOAT3(n.x / length, n.y / length, n.z / length);
+
+		for (int k = 0; k < 3; k++)
+			AddPlane(quadrics[i[k]], n.x, n.y, n.z, p0, length * 0.5f);
+
+		for (int k = 0; k < 3; k++) {
+			unsigned int a = i[k];
+			unsigned int b = i[(k + 1) % 3];
+			if (!IsOpenEdge(topo, a, b)) continue;
+
+			XMFLOAT3 edge = Sub(vertices[b].Position, vertices[a].Position);
+			XMFLOAT3 side = Cross(edge, n);
+			float sideLength = sqrtf(Dot(side, side));
+			if (sideLength == 0) continue;
+			float weight = Dot(edge, edge) * BORDER_WEIGHT;
+			AddPlane(quadrics[a], side.x / sideLength, side.y / sideLength, side.z / sideLength, vertices[a].Position, weight);
+			AddPlane(quadrics[b], side.x / sideLength, side.y / sideLength, side.z / sideLength, vertices[a].Position, weight);
+		}
+	}
+
+	float resultError = 0;
+	Adjacency adj;
+	std::vector<Collapse> candidates;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<unsigned char> locked(vertexCount);
+
+	// each pass makes as many independent collapses as it can, cheapest first
+	while (out.size() > targetIndexCount) {
+		BuildAdjacency(out, vertexCount, adj);
+
+		candidates.clear();
+		for (size_t t = 0; t + 2 < out.size(); t += 3) {
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = out[t + k];
+				unsigned int b = out[t + (k + 1) % 3];
+
+				// interior edges show up in both triangles, only take one
+				if (topo.openOut[a] != b && a > b) continue;
+
+				bool ab = CanCollapse(topo, a, b);
+				bool ba = CanCollapse(topo, b, a);
+				if (!ab && !ba) continue;
+
+				Collapse c = ab ? EvaluateCollapse(vertices, topo, quadrics, a, b) : Collapse{};
+				if (ba) {
+					Collapse reverse = EvaluateCollapse(vertices, topo, quadrics, b, a);
+					if (!ab || reverse.cost < c.cost) c = reverse;
+				}
+				if (c.error <= maxError) candidates.push_back(c);
+			}
+		}
+		if (candidates.empty()) break;
+
+		std::sort(candidates.begin(), candidates.end(),
+			[](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		// an interior collapse removes two triangles
+		size_t goal = std::max<size_t>((out.size() - targetIndexCount) / 3 / 2, 1);
+		size_t collapsed = 0;
+
+		for (unsigned int v = 0; v < vertexCount; v++) remap[v] = v;
+		std::fill(locked.begin(), locked.end(), (unsigned char)0);
+
+		for (const Collapse& c : candidates) {
+			if (collapsed >= goal) break;
+
+			unsigned int v0 = c.v0, v1 = c.v1;
+			if (locked[topo.positionId[v0]] || locked[topo.positionId[v1]]) continue;
+
+			bool seam = topo.kind[v0] == Seam;
+			unsigned int s0 = seam ? topo.wedge[v0] : NONE;
+			unsigned int s1 = seam ? SeamTarget(topo, v0, v1) : NONE;
+
+			if (Flips(vertices, topo, out, adj, v0, v1)) continue;
+			if (seam && Flips(vertices, topo, out, adj, s0, s1)) continue;
+
+			LockNeighbours(topo, out, adj, v0, locked);
+			remap[v0] = v1;
+			AddQuadric(quadrics[v1], quadrics[v0]);
+			if (seam) {
+				LockNeighbours(topo, out, adj, s0, locked);
+				remap[s0] = s1;
+				AddQuadric(quadrics[s1], quadrics[s0]);
+			}
+
+			resultError = (std::max)(resultError, c.error);
+			collapsed++;
+		}
+		if (collapsed == 0) break;
+
+		// rewrite the triangles, dropping the ones that collapsed flat
+		size_t write = 0;
+		for (size_t t = 0; t + 2 < out.size(); t += 3) {
+			unsigned int a = remap[out[t]], b = remap[out[t + 1]], c = remap[out[t + 2]];
+			if (a == b || b == c || c == a) continue;
+			out[write++] = a;
+			out[write++] = b;
+			out[write++] = c;
+		}
+		out.resize(write);
+
+		RemapOpenEdges(topo.openOut, remap);
+		RemapOpenEdges(topo.openIn, remap);
+
+		// locked neighbours mean a target never moves in the same pass
+		if (collapsedTo)
+			for (unsigned int& v : *collapsedTo) v = remap[v];
+	}
+
+	return resultError;
+}
+
+// ====== LOD chain ==============================================================================
+
+MeshSimplifier::LODStats MeshSimplifier::GenerateLODs(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+	unsigned int levelCount, float reduction, bool optimizeVertexCache, std::vector<MeshLOD>& lods)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	lods.clear();
+	lods.push_back(MeshLOD{ 0, (uint32_t)indices.size(), 0.0f });
+
+	// each level is simplified from the one before, so every full mesh
+	// vertex is followed through the chain to the vertex it collapsed
+	// onto, and a level's error is the furthest any of them is from the
+	// triangles around that vertex - an upper bound on their distance to
+	// the level's surface. Simplify()'s quadric errors are RMS averages
+	// and don't add up to one
+	std::vector<unsigned int> chain = indices;
+	std::vector<unsigned int> current = indices;
+	std::vector<unsigned int> next;
+	std::vector<unsigned int> step;
+	Adjacency adj;
+	BVH orphanSearch;
+
+	std::vector<unsigned int> used;
+	{
+		std::vector<unsigned char> referenced(vertices.size(), 0);
+		for (unsigned int index : indices) referenced[index] = 1;
+		for (unsigned int v = 0; v < vertices.size(); v++)
+			if (referenced[v]) used.push_back(v);
+	}
+	std::vector<unsigned int> landedOn = used;
+
+	while (lods.size() < levelCount) {
+		size_t target = (size_t)(current.size() / 3 * reduction) * 3;
+		Simplify(vertices, current, target, FLT_MAX, next, &step);
+		if (next.empty() || next.size() > current.size() * MIN_LOD_GAIN) break;
+
+		if (optimizeVertexCache)
+			MeshOptimizer::OptimizeVertexCache(next, vertices.size());
+
+		BuildAdjacency(next, vertices.size(), adj);
+		bool searchBuilt = false;
+		float error = 0;
+		for (size_t i = 0; i < used.size(); i++) {
+			unsigned int v = landedOn[i] = step[landedOn[i]];
+			const XMFLOAT3& p = vertices[used[i]].Position;
+
+			float distance = FLT_MAX;
+			for (unsigned int k = adj.offsets[v]; k < adj.offsets[v + 1] && distance > 0; k++) {
+				const unsigned int* tri = &next[adj.triangles[k] * 3];
+				distance = (std::min)(distance, BVH::TriangleDistanceSq(p,
+					vertices[tri[0]].Position, vertices[tri[1]].Position, vertices[tri[2]].Position));
+			}
+
+			// a vertex can also lose its triangles without collapsing, when
+			// its neighbours collapse into each other (or a small part of the
+			// mesh goes altogether) - then it's the nearest triangle anywhere
+			if (adj.offsets[v] == adj.offsets[v + 1]) {
+				if (!searchBuilt) {
+					orphanSearch.Build(vertices.data(), vertices.size(), next.data(), next.size());
+					searchBuilt = true;
+				}
+				distance = orphanSearch.ClosestDistanceSq(p);
+			}
+			error = (std::max)(error, distance);
+		}
+		error = sqrtf(error);
+
+		// never below the level before, so LOD selection stays monotonic
+		error = (std::max)(error, lods.back().error);
+		lods.push_back(MeshLOD{ (uint32_t)chain.size(), (uint32_t)next.size(), error });
+		chain.insert(chain.end(), next.begin(), next.end());
+		current.swap(next);
+	}
+
+	indices.swap(chain);
+
+	LODStats stats = {};
+	stats.levels = (unsigned int)lods.size();
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "MeshData.h"
+
+#include <cstdint>
+#include <vector>
+
+// one level of detail inside a mesh's index buffer, every
+// level indexes into the same vertex buffer
+struct MeshLOD
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;	// bound on how far any full mesh vertex is from this level, in local units
+};
+
+// --------------------------------------------------------
+// Quadric error metric (Garland/Heckbert) edge collapse
+// - Vertices only ever collapse onto existing vertices, so the
+//   result is a new index buffer for the same vertex buffer
+// - Open borders and uv/normal seams only collapse along
+//   themselves, so texture and shading splits stay intact
+// --------------------------------------------------------
+namespace MeshSimplifier
+{
+	// Simplifies "indices" towards "targetIndexCount" indices, stopping
+	// early if no collapse under "maxError" is left
+	// - Errors are quadric ones, the RMS distance (local units) from where
+	//   a vertex lands to the planes it gathered, not a true maximum
+	// - Returns the largest error of the collapses that were made
+	// - "collapsedTo", if given, gets the vertex each vertex collapsed onto,
+	//   itself if it never moved (even when its triangles are gone)
+	float Simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+		size_t targetIndexCount, float maxError, std::vector<unsigned int>& out,
+		std::vector<unsigned int>* collapsedTo = nullptr);
+
+	// Timing/output of a whole chain
+	struct LODStats
+	{
+		double ms;
+		unsigned int levels;
+	};
+
+	// Builds up to "levelCount" levels (LOD 0 included), each about
+	// "reduction" times the triangles of the one before
+	// - On return "indices" holds every level back to back and "lods"
+	//   says where each one starts
+	// - Stops early once a level can't be reduced much further
+	LODStats GenerateLODs(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+		unsigned int levelCount, float reduction, bool optimizeVertexCache, std::vector<MeshLOD>& lods);
+}
@@ -0,0 +1,249 @@
+#include "Meshlets.h"
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+using namespace DirectX;
+
+// ====== Building ===============================================================================
+
+namespace
+{
+	// unit face normal that points out of the front face, zero if degenerate
+	XMFLOAT3 FaceNormal(const std::vector<Vertex>& vertices, const unsigned int* tri)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&vertices[tri[0]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&vertices[tri[1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&vertices[tri[2]].Position);
+
+		// clockwise front faces in a left handed space
+		XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+		float length = XMVectorGetX(XMVector3Length(n));
+
+		XMFLOAT3 normal(0, 0, 0);
+		if (length > 0) XMStoreFloat3(&normal, n / length);
+		return normal;
+	}
+
+	// bounding sphere and normal cone of one finished meshlet
+	void ComputeBounds(const std::vector<Vertex>& vertices, const unsigned int* indices,
+		const XMFLOAT3* normals, Meshlet& m)
+	{
+		XMVECTOR vMin = XMLoadFloat3(&vertices[indices[0]].Position);
+		XMVECTOR vMax = vMin;
+		for (uint32_t i = 0; i < m.triangleCount * 3; i++) {
+			XMVECTOR p = XMLoadFloat3(&vertices[indices[i]].Position);
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+		XMVECTOR center = (vMin + vMax) * 0.5f;
+
+		float radius = 0;
+		for (uint32_t i = 0; i < m.triangleCount * 3; i++) {
+			XMVECTOR p = XMLoadFloat3(&vertices[indices[i]].Position);
+			radius = std::max(radius, XMVectorGetX(XMVector3Length(p - center)));
+		}
+		XMStoreFloat3(&m.center, center);
+		m.radius = radius;
+
+		// cone around the average normal, as wide as the worst triangle
+		XMVECTOR axis = XMVectorZero();
+		for (uint32_t t = 0; t < m.triangleCount; t++)
+			axis += XMLoadFloat3(&normals[t]);
+
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		m.coneApex = m.center;
+		m.coneAxis = XMFLOAT3(0, 0, 0);
+		m.coneCutoff = 1.0f;
+		if (axisLength <= 0) return;
+		axis /= axisLength;
+		XMStoreFloat3(&m.coneAxis, axis);
+
+		float minDot = 1.0f;
+		for (uint32_t t = 0; t < m.triangleCount; t++)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&normals[t]))));
+
+		// wider than a hemisphere (or a degenerate triangle), can't be all backfacing
+		if (minDot <= 0) return;
+		m.coneCutoff = sqrtf(1.0f - minDot * minDot);
+
+		// slide back from the center along the axis until the point is
+		// behind every triangle, a camera inside the cone from there
+		// sees only back faces
+		float maxT = 0;
+		for (uint32_t t = 0; t < m.triangleCount; t++) {
+			XMVECTOR n = XMLoadFloat3(&normals[t]);
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3]].Position);
+			float dc = XMVectorGetX(XMVector3Dot(center - p0, n));
+			float dn = XMVectorGetX(XMVector3Dot(axis, n));
+			maxT = std::max(maxT, dc / dn);
+		}
+		XMStoreFloat3(&m.coneApex, center - axis * maxT);
+	}
+}
+
+void Meshlets::Build(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<Meshlet>& out)
+{
+	out.clear();
+	size_t triCount = indices.size() / 3;
+	size_t vertexCount = vertices.size();
+	if (triCount == 0) return;
+
+	std::vector<XMFLOAT3> normals(triCount);
+	for (size_t t = 0; t < triCount; t++)
+		normals[t] = FaceNormal(vertices, &indices[t * 3]);
+
+	// triangle adjacency per vertex, as offsets into one flat array
+	std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+	for (unsigned int index : indices) adjacencyOffset[index + 1]++;
+	for (size_t v = 0; v < vertexCount; v++) adjacencyOffset[v + 1] += adjacencyOffset[v];
+	std::vector<unsigned int> adjacency(indices.size());
+	{
+		std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<bool> used(triCount, false);
+	std::vector<unsigned char> inMeshlet(vertexCount, 0);
+	std::vector<unsigned int> meshletVertices;
+	std::vector<unsigned int> order;
+	order.reserve(triCount);
+	size_t seed = 0;
+
+	while (order.size() < triCount) {
+		while (used[seed]) seed++;
+
+		Meshlet m = {};
+		m.indexOffset = (uint32_t)order.size() * 3;
+		size_t firstTriangle = order.size();
+		XMVECTOR axis = XMVectorZero();
+		size_t next = seed;
+
+		while (next != SIZE_MAX) {
+			used[next] = true;
+			order.push_back((unsigned int)next);
+			m.triangleCount++;
+			axis += XMLoadFloat3(&normals[next]);
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = indices[next * 3 + k];
+				if (!inMeshlet[v]) {
+					inMeshlet[v] = 1;
+					meshletVertices.push_back(v);
+				}
+			}
+			if (m.triangleCount == MAX_TRIANGLES) break;
+
+			// best neighbour: fewest new vertices, then closest facing,
+			// ignoring anything that would make the cone too wide
+			XMVECTOR facing = XMVector3Normalize(axis);
+			next = SIZE_MAX;
+			float bestScore = -FLT_MAX;
+			for (unsigned int v : meshletVertices) {
+				for (unsigned int i = adjacencyOffset[v]; i < adjacencyOffset[v + 1]; i++) {
+					unsigned int t = adjacency[i];
+					if (used[t]) continue;
+
+					int extra = 0;
+					for (int k = 0; k < 3; k++) extra += inMeshlet[indices[t * 3 + k]] ? 0 : 1;
+					if (meshletVertices.size() + extra > MAX_VERTICES) continue;
+
+					float facingDot = XMVectorGetX(XMVector3Dot(facing, XMLoadFloat3(&normals[t])));
+					if (facingDot < MIN_CONE_DOT) continue;
+
+					float score = (float)(3 - extra) + facingDot;
+					if (score > bestScore) {
+						bestScore = score;
+						next = t;
+					}
+				}
+			}
+		}
+
+		m.vertexCount = (uint32_t)meshletVertices.size();
+		for (unsigned int v : meshletVertices) inMeshlet[v] = 0;
+		meshletVertices.clear();
+		out.push_back(m);
+
+		// bounds need the reordered triangles, which only exist in "order"
+		std::vector<unsigned int> local(m.triangleCount * 3);
+		std::vector<XMFLOAT3> localNormals(m.triangleCount);
+		for (uint32_t t = 0; t < m.triangleCount; t++) {
+			unsigned int src = order[firstTriangle + t];
+			for (int k = 0; k < 3; k++) local[t * 3 + k] = indices[src * 3 + k];
+			localNormals[t] = normals[src];
+		}
+		ComputeBounds(vertices, local.data(), localNormals.data(), out.back());
+	}
+
+	std::vector<unsigned int> reordered(indices.size());
+	for (size_t t = 0; t < triCount; t++)
+		for (int k = 0; k < 3; k++)
+			reordered[t * 3 + k] = indices[order[t] * 3 + k];
+	indices.swap(reordered);
+}
+
+// ====== Culling ================================================================================
+
+Meshlets::CullStats& Meshlets::CullStats::operator+=(const CullStats& other)
+{
+	meshlets += other.meshlets;
+	visibleMeshlets += other.visibleMeshlets;
+	frustumCulled += other.frustumCulled;
+	backfaceCulled += other.backfaceCulled;
+	triangles += other.triangles;
+	visibleTriangles += other.visibleTriangles;
+	return *this;
+}
+
+Meshlets::CullStats Meshlets::Cull(const std::vector<Meshlet>& meshlets, const std::vector<unsigned int>& indices,
+	const XMFLOAT4X4& worldViewProj, const XMFLOAT3& cameraPosition,
+	bool backfaceCulling, std::vector<unsigned int>& out)
+{
+	CullStats stats = {};
+	out.clear();
+
+	// frustum planes in the mesh's local space
+	FrustumCulling::Planes localPlanes = FrustumCulling::ExtractPlanes(worldViewProj);
+	XMVECTOR planes[6];
+	for (int p = 0; p < 6; p++) planes[p] = XMLoadFloat4(&localPlanes.planes[p]);
+
+	XMVECTOR camera = XMLoadFloat3(&cameraPosition);
+
+	for (const Meshlet& meshlet : meshlets) {
+		stats.meshlets++;
+		stats.triangles += meshlet.triangleCount;
+
+		XMVECTOR center = XMLoadFloat3(&meshlet.center);
+		bool outside = false;
+		for (const XMVECTOR& plane : planes) {
+			if (XMVectorGetX(XMPlaneDotCoord(plane, center)) < -meshlet.radius) {
+				outside = true;
+				break;
+			}
+		}
+		if (outside) {
+			stats.frustumCulled++;
+			continue;
+		}
+
+		// every triangle faces away if the camera sits in the cone of
+		// directions they can all be seen from behind
+		if (backfaceCulling && meshlet.coneCutoff < 1.0f) {
+			XMVECTOR toApex = XMVector3Normalize(XMLoadFloat3(&meshlet.coneApex) - camera);
+			if (XMVectorGetX(XMVector3Dot(toApex, XMLoadFloat3(&meshlet.coneAxis))) >= meshlet.coneCutoff) {
+				stats.backfaceCulled++;
+				continue;
+			}
+		}
+
+		stats.visibleMeshlets++;
+		stats.visibleTriangles += meshlet.triangleCount;
+		out.insert(out.end(), indices.begin() + meshlet.indexOffset,
+			indices.begin() + meshlet.indexOffset + meshlet.triangleCount * 3);
+	}
+	return stats;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// a small cluster of triangles, stored as a range of a mesh's
+// LOD 0 index buffer
+struct Meshlet
+{
+	uint32_t indexOffset;
+	uint32_t triangleCount;
+	uint32_t vertexCount;		// unique vertices the triangles use
+	DirectX::XMFLOAT3 center;	// bounding sphere, local space
+	float radius;
+	DirectX::XMFLOAT3 coneApex;	// behind every triangle's plane, see Meshlets::Cull()
+	DirectX::XMFLOAT3 coneAxis;	// average facing of the triangles
+	float coneCutoff;			// sin of the normal cone's half angle, 1 if the cone is too wide to cull
+};
+
+// --------------------------------------------------------
+// Meshlet building and CPU culling
+// - Triangles are grouped so each meshlet is spatially tight
+//   and faces roughly one way, then whole meshlets are
+//   rejected by frustum and backface (normal cone) tests
+// --------------------------------------------------------
+namespace Meshlets
+{
+	constexpr unsigned int MAX_VERTICES = 64;
+	constexpr unsigned int MAX_TRIANGLES = 124;
+
+	// a triangle only joins a meshlet if its normal is within
+	// acos(this) of the meshlet's average, keeps the cones cullable
+	constexpr float MIN_CONE_DOT = 0.7f;
+
+	// Reorders "indices" so every meshlet's triangles are contiguous
+	// - Triangles are pulled in by shared vertices, starting from the
+	//   current order, so run it after OptimizeVertexCache()
+	void Build(const std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<Meshlet>& out);
+
+	struct CullStats
+	{
+		size_t meshlets;
+		size_t visibleMeshlets;
+		size_t frustumCulled;
+		size_t backfaceCulled;
+		size_t triangles;
+		size_t visibleTriangles;
+
+		CullStats& operator+=(const CullStats& other);
+	};
+
+	// Tests every meshlet against the frustum of "worldViewProj" and
+	// against "cameraPosition" (both in the mesh's local space), and
+	// writes the indices of the survivors to "out"
+	// - Backface culling assumes the world matrix has a uniform scale,
+	//   turn it off otherwise
+	CullStats Cull(const std::vector<Meshlet>& meshlets, const std::vector<unsigned int>& indices,
+		const DirectX::XMFLOAT4X4& worldViewProj, const DirectX::XMFLOAT3& cameraPosition,
+		bool backfaceCulling, std::vector<unsigned int>& out);
+}
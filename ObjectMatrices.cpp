@@ -0,0 +1,51 @@
+#include "ObjectMatrices.h"
+
+#include <immintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	void BuildSSE(const XMFLOAT4X4* worlds, size_t count,
+		const XMFLOAT4X4& viewProjection, const XMFLOAT4X4& lightViewProjection, PerObjectData* out)
+	{
+		XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+		XMMATRIX lightVP = XMLoadFloat4x4(&lightViewProjection);
+		for (size_t i = 0; i < count; i++) {
+			XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+			XMStoreFloat4x4(&out[i].worldViewProj, XMMatrixMultiply(world, vp));
+			XMStoreFloat4x4(&out[i].lightWorldViewProj, XMMatrixMultiply(world, lightVP));
+		}
+	}
+
+	void BuildAVX(const XMFLOAT4X4* worlds, size_t count,
+		const XMFLOAT4X4& viewProjection, const XMFLOAT4X4& lightViewProjection, PerObjectData* out)
+	{
+		// row k of both matrices in one register, camera in the low half
+		__m256 rows[4];
+		for (int k = 0; k < 4; k++)
+			rows[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(viewProjection.m[k])),
+				_mm_loadu_ps(lightViewProjection.m[k]), 1);
+
+		for (size_t i = 0; i < count; i++) {
+			const XMFLOAT4X4& world = worlds[i];
+			for (int r = 0; r < 4; r++) {
+				// row r of the result is world row r times the other matrix
+				__m256 result = _mm256_mul_ps(_mm256_broadcast_ss(&world.m[r][0]), rows[0]);
+				result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_broadcast_ss(&world.m[r][1]), rows[1]));
+				result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_broadcast_ss(&world.m[r][2]), rows[2]));
+				result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_broadcast_ss(&world.m[r][3]), rows[3]));
+				_mm_storeu_ps(out[i].worldViewProj.m[r], _mm256_castps256_ps128(result));
+				_mm_storeu_ps(out[i].lightWorldViewProj.m[r], _mm256_extractf128_ps(result, 1));
+			}
+		}
+	}
+}
+
+void ObjectMatrices::Build(const XMFLOAT4X4* worlds, size_t count,
+	const XMFLOAT4X4& viewProjection, const XMFLOAT4X4& lightViewProjection,
+	PerObjectData* out, bool avx)
+{
+	if (avx) BuildAVX(worlds, count, viewProjection, lightViewProjection, out);
+	else BuildSSE(worlds, count, viewProjection, lightViewProjection, out);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "BufferStructs.h"
+
+#include <DirectXMath.h>
+#include <cstddef>
+
+// --------------------------------------------------------
+// Camera and light world-view-projection matrices for every
+// entity, multiplied out once a frame so the vertex shaders
+// read them from PerObject.hlsli instead of doing four 4x4
+// multiplies per vertex
+// - The AVX path works on a camera row and a light row side by
+//   side, so one pass over a world matrix fills both
+// --------------------------------------------------------
+namespace ObjectMatrices
+{
+	// out[i] is worlds[i] * viewProjection and worlds[i] * lightViewProjection
+	// - "avx" needs TransformSystem::IsAVXSupported(), otherwise the
+	//   DirectXMath (SSE) multiply is used
+	void Build(const DirectX::XMFLOAT4X4* worlds, size_t count,
+		const DirectX::XMFLOAT4X4& viewProjection, const DirectX::XMFLOAT4X4& lightViewProjection,
+		PerObjectData* out, bool avx);
+}
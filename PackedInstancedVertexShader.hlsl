@@ -0,0 +1,31 @@
+#include "ShaderStructs.hlsli"
+#include "VertexPacking.hlsli"
+
+cbuffer ExternalData : register(b0)
+{
+    float3 positionMin;
+    float3 positionScale;
+}
+
+// --------------------------------------------------------
+// InstancedVertexShader.hlsl for meshes stored as PackedVertex
+// --------------------------------------------------------
+VertexToPixel main( PackedVertexShaderInput packedInput, InstanceInput instance )
+{
+    VertexShaderInput input = UnpackVertex(packedInput, positionMin, positionScale);
+
+	// Set up output struct
+	VertexToPixel output;
+	
+    output.screenPosition = mul(float4(input.localPosition, 1.0f), instance.worldViewProj);
+
+	// pass through other data
+    output.uv = input.uv;
+    output.normal = mul(input.normal, (float3x3) instance.worldIT);
+    output.tangent = mul(input.tangent, (float3x3) instance.world);
+    output.worldPosition = mul(float4(input.localPosition, 1), instance.world).xyz;
+    
+    output.shadowMapPos = mul(float4(input.localPosition, 1.0f), instance.lightWorldViewProj);
+    
+	return output;
+}
@@ -0,0 +1,18 @@
+#include "ShaderStructs.hlsli"
+#include "VertexPacking.hlsli"
+#include "PerObject.hlsli"
+
+// Constant Buffer for external (C++) data
+cbuffer externalData : register(b0)
+{
+    float3 positionMin;
+    float3 positionScale;
+};
+// --------------------------------------------------------
+// ShadowMapVS.hlsl for meshes stored as PackedVertex
+// --------------------------------------------------------
+float4 main(PackedVertexShaderInput packedInput) : SV_POSITION
+{
+    float3 localPosition = positionMin + packedInput.quantizedPosition.xyz * positionScale;
+    return mul(mWorldViewProjLight, float4(localPosition, 1.0f));
+}
@@ -0,0 +1,50 @@
+#include "ShaderStructs.hlsli"
+#include "PerObject.hlsli"
+#include "VertexPacking.hlsli"
+
+cbuffer ExternalData : register(b0)
+{
+	matrix mWorld;
+    matrix mWorldIT;
+    float dt;
+    float tt;
+    float3 positionMin;
+    float3 positionScale;
+}
+
+// --------------------------------------------------------
+// SpinShrinkVS.hlsl for meshes stored as PackedVertex
+// --------------------------------------------------------
+VertexToPixelBasic main( PackedVertexShaderInput packedInput )
+{
+    VertexShaderInput input = UnpackVertex(packedInput, positionMin, positionScale);
+
+	// Set up output struct
+	VertexToPixelBasic output;
+	
+    float scale = 1.0f + 0.5f * sin(tt * 5.0f);
+    
+    float3 scaledPosition = input.localPosition * scale;
+    
+    float angle = tt * 5.0f; // Rotate over time
+    float cosA = cos(angle);
+    float sinA = sin(angle);
+    matrix rotationMatrix =
+    {
+        cosA, 0, -sinA, 0,
+        0, 1, 0, 0,
+        sinA, 0, cosA, 0,
+        0, 0, 0, 1
+    };
+
+    float4 rotatedPosition = mul(rotationMatrix, float4(scaledPosition, 1.0f));
+    
+    output.screenPosition = mul(mWorldViewProj, rotatedPosition);
+
+    output.uv = input.uv;
+    output.normal = mul((float3x3) mWorldIT, input.normal);
+    output.tangent = mul((float3x3) mWorld, input.tangent);
+    output.worldPosition = mul(mWorld, float4(input.localPosition, 1)).xyz;
+
+	return output;
+}
@@ -0,0 +1,34 @@
+#include "ShaderStructs.hlsli"
+#include "PerObject.hlsli"
+#include "VertexPacking.hlsli"
+
+cbuffer ExternalData : register(b0)
+{
+	matrix mWorld;
+    matrix mWorldIT;
+    float3 positionMin;
+    float3 positionScale;
+}
+
+// --------------------------------------------------------
+// VertexShader.hlsl for meshes stored as PackedVertex
+// --------------------------------------------------------
+VertexToPixel main( PackedVertexShaderInput packedInput )
+{
+    VertexShaderInput input = UnpackVertex(packedInput, positionMin, positionScale);
+
+	// Set up output struct
+	VertexToPixel output;
+	
+    output.screenPosition = mul(mWorldViewProj, float4(input.localPosition, 1.0f));
+
+	// pass through other data
+    output.uv = input.uv;
+    output.normal = mul((float3x3) mWorldIT, input.normal); 
+    output.tangent = mul((float3x3) mWorld, input.tangent);
+    output.worldPosition = mul(mWorld, float4(input.localPosition, 1)).xyz;
+    
+    output.shadowMapPos = mul(mWorldViewProjLight, float4(input.localPosition, 1.0f));
+    
+	return output;
+}
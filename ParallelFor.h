@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Runs fn(i) for i in [0, count) across up to "threads" threads
+// - The calling thread takes part, so threads == 1 runs inline
+// - Which thread gets which i is not fixed, anything that has to
+//   be deterministic should key its work off i alone
+template<typename Fn>
+void ParallelFor(size_t count, unsigned int threads, Fn fn)
+{
+	if (threads > count) threads = (unsigned int)count;
+	if (threads <= 1) {
+		for (size_t i = 0; i < count; i++) fn(i);
+		return;
+	}
+
+	std::atomic<size_t> next = 0;
+	auto worker = [&]() {
+		for (size_t i = next++; i < count; i = next++) fn(i);
+	};
+
+	std::vector<std::thread> pool;
+	pool.reserve(threads - 1);
+	for (unsigned int t = 1; t < threads; t++) pool.emplace_back(worker);
+	worker();
+	for (std::thread& t : pool) t.join();
+}
@@ -0,0 +1,13 @@
+#ifndef __GGP_PER_OBJECT__
+#define __GGP_PER_OBJECT__
+
+// Final matrices for one entity, multiplied out on the CPU once a
+// frame instead of once per vertex
+// - Matches PerObjectData in C++, see ObjectMatrices::Build()
+cbuffer PerObject : register(b1)
+{
+    matrix mWorldViewProj;
+    matrix mWorldViewProjLight;
+}
+
+#endif
@@ -1,6 +1,8 @@
 
 #include "ShaderStructs.hlsli"
 #include "Lighting.hlsli"
+#include "ShadowCascades.hlsli"
+#include "LightClusters.hlsli"
 
 cbuffer ExternalData : register(b0)
 {
@@ -16,6 +18,18 @@ cbuffer ExternalData : register(b0)
     //float roughness;
     float2 uvScale;
     float2 uvOffset;
+    
+    // shadow cascades, from cascade 0's light clip space
+    float4 cascadeScales[MAX_CASCADES];
+    float4 cascadeOffsets[MAX_CASCADES];
+    uint cascadeCount;
+    
+    // clustered point and spot lights, lights[] only holds the
+    // directional ones while this is set, see LightClusters
+    uint clustered;
+    float3 v3CamForward;
+    float2 clusterScreenScale;
+    float2 clusterDepthScaleBias;
 }
 
 // texture related resources
@@ -23,23 +37,18 @@ Texture2D Albedo                     : register(t0); // "t" registers for textur
 Texture2D NormalMap                  : register(t1);
 Texture2D RoughnessMap               : register(t2);
 Texture2D MetalnessMap               : register(t3);
-Texture2D ShadowMap                  : register(t4);
+Texture2DArray ShadowMap             : register(t4); // a slice per cascade
+StructuredBuffer<Light> ClusterLights : register(t5); // every light
+StructuredBuffer<uint2> ClusterRanges : register(t6); // offset and count per cluster
+StructuredBuffer<uint> ClusterLightIndices : register(t7);
 SamplerState BasicSampler            : register(s0); // "s" registers for samplers
 SamplerComparisonState ShadowSampler : register(s1);
 
 float4 main(VertexToPixel input) : SV_TARGET
 {
-    // perspective divide
-    input.shadowMapPos /= input.shadowMapPos.w;
-    
-    // convert normalize coords for sampling
-    float2 shadowUV = input.shadowMapPos.xy * 0.5f + 0.5f;
-    shadowUV.y = 1 - shadowUV.y; // flip y
-    
-    // grab distances
-    float distToLight = input.shadowMapPos.z;
-    float shadowAmount = ShadowMap.SampleCmpLevelZero(
-    ShadowSampler, shadowUV, distToLight).r;
+    // shadow from whichever cascade covers this pixel
+    float shadowAmount = SampleShadowCascades(ShadowMap, ShadowSampler, input.shadowMapPos,
+        cascadeScales, cascadeOffsets, cascadeCount);
     
 	// adjust uv coords
     input.normal = normalize(input.normal);
@@ -94,5 +103,26 @@ float4 main(VertexToPixel input) : SV_TARGET
             totalLight *= shadowAmount;
         }
     }
+    
+    // point and spot lights that reach this pixel's cluster
+    if (clustered)
+    {
+        float viewDepth = dot(input.worldPosition - v3CamPos, v3CamForward);
+        uint2 range = ClusterRanges[GetLightCluster(
+            input.screenPosition.xy, viewDepth, clusterScreenScale, clusterDepthScaleBias)];
+        for (uint j = 0; j < range.y; j++)
+        {
+            Light light = ClusterLights[ClusterLightIndices[range.x + j]];
+            light.Direction = normalize(light.Direction);
+            if (light.Type == LIGHT_TYPE_SPOT)
+                totalLight += SpotLightPBR(
+                    light, input.normal, input.worldPosition, v3CamPos,
+                    roughness, metalness, surfaceColor, specularColor);
+            else
+                totalLight += PointLightPBR(
+                    light, input.normal, input.worldPosition, v3CamPos,
+                    roughness, metalness, surfaceColor, specularColor);
+        }
+    }
     return float4(pow(totalLight, 1.0f/2.2f), 1);
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "Quaternions.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+XMFLOAT3 Quaternions::ToPitchYawRoll(const XMFLOAT4& q)
+{
+	// the rotation matrix entries that pick the angles back out,
+	// for R = roll * pitch * yaw the third row is
+	// (cos p sin y, -sin p, cos p cos y)
+	float m12 = 2.0f * (q.x * q.y + q.z * q.w);
+	float m22 = 1.0f - 2.0f * (q.x * q.x + q.z * q.z);
+	float m31 = 2.0f * (q.x * q.z + q.y * q.w);
+	float m32 = 2.0f * (q.y * q.z - q.x * q.w);
+	float m33 = 1.0f - 2.0f * (q.x * q.x + q.y * q.y);
+
+	// atan2 rather than asin(-m32), which loses precision near +-90
+	float sinPitch = -m32;
+	XMFLOAT3 pitchYawRoll;
+	pitchYawRoll.x = atan2f(sinPitch, sqrtf(m31 * m31 + m33 * m33));
+	if (fabsf(sinPitch) < GIMBAL_LOCK_SINE) {
+		pitchYawRoll.y = atan2f(m31, m33);
+		pitchYawRoll.z = atan2f(m12, m22);
+	}
+	else {
+		// looking straight up/down, put it all in yaw
+		float m11 = 1.0f - 2.0f * (q.y * q.y + q.z * q.z);
+		float m13 = 2.0f * (q.x * q.z - q.y * q.w);
+		pitchYawRoll.y = atan2f(-m13, m11);
+		pitchYawRoll.z = 0.0f;
+	}
+	return pitchYawRoll;
+}
+
+XMFLOAT4 Quaternions::LookRotation(const XMFLOAT3& forward, const XMFLOAT3& up)
+{
+	XMVECTOR f = XMVector3Normalize(XMLoadFloat3(&forward));
+	XMVECTOR r = XMVector3Cross(XMLoadFloat3(&up), f);
+
+	// up is parallel to forward, use whichever axis is furthest from it
+	if (XMVectorGetX(XMVector3LengthSq(r)) < 1e-12f) {
+		XMFLOAT3 fAbs;
+		XMStoreFloat3(&fAbs, XMVectorAbs(f));
+		XMVECTOR fallback = fAbs.x < fAbs.y && fAbs.x < fAbs.z ? XMVectorSet(1, 0, 0, 0)
+			: fAbs.y < fAbs.z ? XMVectorSet(0, 1, 0, 0) : XMVectorSet(0, 0, 1, 0);
+		r = XMVector3Cross(fallback, f);
+	}
+	r = XMVector3Normalize(r);
+	XMVECTOR u = XMVector3Cross(f, r);
+
+	// rows of the rotation matrix are where +x, +y and +z end up
+	XMMATRIX rotation(r, u, f, XMVectorSet(0, 0, 0, 1));
+	XMFLOAT4 q;
+	XMStoreFloat4(&q, XMQuaternionNormalize(XMQuaternionRotationMatrix(rotation)));
+	return q;
+}
+
+// ====== Batched interpolation ==================================================================
+
+namespace
+{
+	template<bool SLERP>
+	void Interpolate(const XMFLOAT4* from, const XMFLOAT4* to, const float* t, XMFLOAT4* out, size_t count)
+	{
+		for (size_t first = 0; first < count; first += 4) {
+			size_t n = count - first < 4 ? count - first : 4;
+
+			// copies so the tail can be padded and "out" can alias the inputs
+			XMFLOAT4 a[4] = { {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1} };
+			XMFLOAT4 b[4] = { {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1} };
+			XMFLOAT4 weights(0, 0, 0, 0);
+			for (size_t i = 0; i < n; i++) {
+				a[i] = from[first + i];
+				b[i] = to[first + i];
+				(&weights.x)[i] = t[first + i];
+			}
+
+			// transposed, so each row is one component of all four
+			XMMATRIX qa = XMMatrixTranspose(XMMATRIX(XMLoadFloat4(&a[0]), XMLoadFloat4(&a[1]), XMLoadFloat4(&a[2]), XMLoadFloat4(&a[3])));
+			XMMATRIX qb = XMMatrixTranspose(XMMATRIX(XMLoadFloat4(&b[0]), XMLoadFloat4(&b[1]), XMLoadFloat4(&b[2]), XMLoadFloat4(&b[3])));
+			XMVECTOR tv = XMLoadFloat4(&weights);
+
+			XMVECTOR cosAngle = qa.r[0] * qb.r[0] + qa.r[1] * qb.r[1] + qa.r[2] * qb.r[2] + qa.r[3] * qb.r[3];
+			XMVECTOR sign = XMVectorSelect(XMVectorReplicate(1.0f), XMVectorReplicate(-1.0f), XMVectorLess(cosAngle, XMVectorZero()));
+			cosAngle *= sign;
+
+			XMVECTOR weightA = XMVectorReplicate(1.0f) - tv;
+			XMVECTOR weightB = tv;
+			if (SLERP) {
+				// sin((1 - t) angle) / sin(angle) and sin(t angle) / sin(angle),
+				// near 0 those blow up and lerp is just as good
+				XMVECTOR angle = XMVectorACos(cosAngle);
+				XMVECTOR invSin = XMVectorReciprocal(XMVectorSin(angle));
+				XMVECTOR slerpA = XMVectorSin(weightA * angle) * invSin;
+				XMVECTOR slerpB = XMVectorSin(tv * angle) * invSin;
+				XMVECTOR linear = XMVectorGreater(cosAngle, XMVectorReplicate(Quaternions::SLERP_LINEAR_COSINE));
+				weightA = XMVectorSelect(slerpA, weightA, linear);
+				weightB = XMVectorSelect(slerpB, weightB, linear);
+			}
+			weightB *= sign;
+
+			XMMATRIX result;
+			for (int c = 0; c < 4; c++) result.r[c] = qa.r[c] * weightA + qb.r[c] * weightB;
+			XMVECTOR invLength = XMVectorReciprocal(XMVectorSqrt(
+				result.r[0] * result.r[0] + result.r[1] * result.r[1] + result.r[2] * result.r[2] + result.r[3] * result.r[3]));
+			for (int c = 0; c < 4; c++) result.r[c] *= invLength;
+
+			result = XMMatrixTranspose(result);
+			for (size_t i = 0; i < n; i++) XMStoreFloat4(&out[first + i], result.r[i]);
+		}
+	}
+}
+
+void Quaternions::Nlerp(const XMFLOAT4* from, const XMFLOAT4* to, const float* t, XMFLOAT4* out, size_t count)
+{
+	Interpolate<false>(from, to, t, out, count);
+}
+
+void Quaternions::Slerp(const XMFLOAT4* from, const XMFLOAT4* to, const float* t, XMFLOAT4* out, size_t count)
+{
+	Interpolate<true>(from, to, t, out, count);
+}
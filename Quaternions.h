@@ -0,0 +1,38 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+
+// --------------------------------------------------------
+// Quaternion helpers for Transform, in DirectXMath's
+// conventions (x, y, z, w, row vectors, left handed)
+// - Rotations compose with XMQuaternionMultiply(first, second)
+// - Euler angles are pitch (x), yaw (y), roll (z) applied
+//   roll, then pitch, then yaw like
+//   XMQuaternionRotationRollPitchYaw
+// --------------------------------------------------------
+namespace Quaternions
+{
+	// |sin(pitch)| past this is treated as straight up/down, where
+	// yaw and roll turn the same way and roll is set to 0
+	constexpr float GIMBAL_LOCK_SINE = 0.99999f;
+
+	// Above this cos(angle) Slerp() falls back to a normalized lerp
+	constexpr float SLERP_LINEAR_COSINE = 0.9995f;
+
+	// Pitch, yaw and roll that XMQuaternionRotationRollPitchYaw turns
+	// back into "q" (or -q), each in [-pi, pi]
+	DirectX::XMFLOAT3 ToPitchYawRoll(const DirectX::XMFLOAT4& q);
+
+	// Rotation that turns +z to "forward" and keeps +y as close to
+	// "up" as it can, any up works if it's parallel to forward
+	DirectX::XMFLOAT4 LookRotation(const DirectX::XMFLOAT3& forward, const DirectX::XMFLOAT3& up);
+
+	// Batched interpolation from "from[i]" to "to[i]" by "t[i]",
+	// four at a time as structure of arrays
+	// - Both take the shorter way around (flipping "to" if needed),
+	//   and outputs are unit length
+	// - "out" may be the same array as either input
+	void Nlerp(const DirectX::XMFLOAT4* from, const DirectX::XMFLOAT4* to, const float* t, DirectX::XMFLOAT4* out, size_t count);
+	void Slerp(const DirectX::XMFLOAT4* from, const DirectX::XMFLOAT4* to, const float* t, DirectX::XMFLOAT4* out, size_t count);
+}
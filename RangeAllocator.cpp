@@ -0,0 +1,124 @@
+#include "RangeAllocator.h"
+
+#include <algorithm>
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+	: capacity(0), used(0)
+{
+	Grow(capacity);
+}
+
+uint32_t RangeAllocator::Allocate(uint32_t size)
+{
+	if (size == 0) return INVALID_OFFSET;
+
+	// smallest hole that fits, so big holes stay big
+	size_t best = freeBlocks.size();
+	for (size_t i = 0; i < freeBlocks.size(); i++) {
+		if (freeBlocks[i].size < size) continue;
+		if (best == freeBlocks.size() || freeBlocks[i].size < freeBlocks[best].size) best = i;
+		if (freeBlocks[i].size == size) break;
+	}
+	if (best == freeBlocks.size()) return INVALID_OFFSET;
+
+	Block& block = freeBlocks[best];
+	uint32_t offset = block.offset;
+	if (block.size == size) {
+		freeBlocks.erase(freeBlocks.begin() + best);
+	}
+	else {
+		block.offset += size;
+		block.size -= size;
+	}
+
+	allocations[offset] = size;
+	used += size;
+	return offset;
+}
+
+bool RangeAllocator::Free(uint32_t offset)
+{
+	auto it = allocations.find(offset);
+	if (it == allocations.end()) return false;
+
+	uint32_t size = it->second;
+	allocations.erase(it);
+	used -= size;
+	AddFree(offset, size);
+	return true;
+}
+
+void RangeAllocator::Grow(uint32_t newCapacity)
+{
+	if (newCapacity <= capacity) return;
+	uint32_t oldCapacity = capacity;
+	capacity = newCapacity;
+	AddFree(oldCapacity, newCapacity - oldCapacity);
+}
+
+void RangeAllocator::AddFree(uint32_t offset, uint32_t size)
+{
+	// first block after the freed range
+	auto next = std::lower_bound(freeBlocks.begin(), freeBlocks.end(), offset,
+		[](const Block& b, uint32_t o) { return b.offset < o; });
+
+	bool mergePrev = next != freeBlocks.begin() && (next - 1)->offset + (next - 1)->size == offset;
+	bool mergeNext = next != freeBlocks.end() && offset + size == next->offset;
+
+	if (mergePrev && mergeNext) {
+		(next - 1)->size += size + next->size;
+		freeBlocks.erase(next);
+	}
+	else if (mergePrev) {
+		(next - 1)->size += size;
+	}
+	else if (mergeNext) {
+		next->offset = offset;
+		next->size += size;
+	}
+	else {
+		freeBlocks.insert(next, Block{ offset, size });
+	}
+}
+
+RangeAllocator::Stats RangeAllocator::GetStats() const
+{
+	Stats stats = {};
+	stats.capacity = capacity;
+	stats.used = used;
+	stats.allocations = (uint32_t)allocations.size();
+	stats.freeBlocks = (uint32_t)freeBlocks.size();
+
+	uint32_t freeTotal = 0;
+	for (const Block& b : freeBlocks) {
+		freeTotal += b.size;
+		stats.largestFreeBlock = std::max(stats.largestFreeBlock, b.size);
+	}
+	stats.fragmentation = freeTotal ? 1.0f - (float)stats.largestFreeBlock / freeTotal : 0.0f;
+	return stats;
+}
+
+bool RangeAllocator::Validate() const
+{
+	// every range, free or not, sorted - they should tile [0, capacity) exactly
+	std::vector<Block> ranges(freeBlocks.begin(), freeBlocks.end());
+	uint64_t allocated = 0;
+	for (const auto& [offset, size] : allocations) {
+		ranges.push_back(Block{ offset, size });
+		allocated += size;
+	}
+	if (allocated != used) return false;
+	std::sort(ranges.begin(), ranges.end(), [](const Block& a, const Block& b) { return a.offset < b.offset; });
+
+	uint64_t end = 0;
+	for (const Block& r : ranges) {
+		if (r.size == 0 || r.offset != end) return false;
+		end = (uint64_t)r.offset + r.size;
+	}
+	if (end != capacity) return false;
+
+	// free blocks in order and never touching, or they'd have merged
+	for (size_t i = 1; i < freeBlocks.size(); i++)
+		if (freeBlocks[i - 1].offset + freeBlocks[i - 1].size >= freeBlocks[i].offset) return false;
+	return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// --------------------------------------------------------
+// Offset allocator over the elements [0, capacity) of a buffer
+// - Best fit from a free list kept sorted by offset, a freed
+//   range merges with free neighbours on both sides
+// - No D3D in here, GeometryPool keeps one per buffer
+// --------------------------------------------------------
+class RangeAllocator
+{
+public:
+	static constexpr uint32_t INVALID_OFFSET = UINT32_MAX;
+
+	struct Stats
+	{
+		uint32_t capacity;
+		uint32_t used;
+		uint32_t allocations;
+		uint32_t freeBlocks;
+		uint32_t largestFreeBlock;
+		float fragmentation;	// 1 - largest free block / all free space, 0 is one hole
+	};
+
+	RangeAllocator(uint32_t capacity = 0);
+
+	// Offset of "size" free elements, INVALID_OFFSET if no hole is big enough
+	uint32_t Allocate(uint32_t size);
+
+	// Returns a range from Allocate(), false if "offset" isn't one
+	bool Free(uint32_t offset);
+
+	// Adds [capacity, newCapacity) as free space, after the buffer grew
+	void Grow(uint32_t newCapacity);
+
+	uint32_t GetCapacity() const { return capacity; }
+	Stats GetStats() const;
+
+	// Checks the free list is sorted, merged, inside the capacity and
+	// adds up with the allocations - for stress tests, it's O(n log n)
+	bool Validate() const;
+
+private:
+	struct Block
+	{
+		uint32_t offset;
+		uint32_t size;
+	};
+	std::vector<Block> freeBlocks;						// sorted by offset, never touching
+	std::unordered_map<uint32_t, uint32_t> allocations;	// offset -> size
+	uint32_t capacity;
+	uint32_t used;
+
+	void AddFree(uint32_t offset, uint32_t size);
+};
@@ -0,0 +1,116 @@
+#include "RenderQueue.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	constexpr uint32_t DEPTH_SHIFT = 0;
+	constexpr uint32_t MESH_SHIFT = DEPTH_SHIFT + RenderQueue::DEPTH_BITS;
+	constexpr uint32_t MATERIAL_SHIFT = MESH_SHIFT + RenderQueue::MESH_BITS;
+	constexpr uint32_t SHADER_SHIFT = MATERIAL_SHIFT + RenderQueue::MATERIAL_BITS;
+	constexpr uint32_t PASS_SHIFT = SHADER_SHIFT + RenderQueue::SHADER_BITS;
+	static_assert(PASS_SHIFT + RenderQueue::PASS_BITS == 64, "key fields have to fill 64 bits");
+
+	uint64_t Field(uint64_t value, uint32_t bits, uint32_t shift)
+	{
+		return (value & ((1ull << bits) - 1)) << shift;
+	}
+
+	uint32_t GetField(uint64_t key, uint32_t bits, uint32_t shift)
+	{
+		return (uint32_t)((key >> shift) & ((1ull << bits) - 1));
+	}
+}
+
+uint64_t RenderQueue::MakeKey(uint32_t pass, uint32_t shaders, uint32_t material, uint32_t mesh, uint32_t depth)
+{
+	return Field(pass, PASS_BITS, PASS_SHIFT) |
+		Field(shaders, SHADER_BITS, SHADER_SHIFT) |
+		Field(material, MATERIAL_BITS, MATERIAL_SHIFT) |
+		Field(mesh, MESH_BITS, MESH_SHIFT) |
+		Field(depth, DEPTH_BITS, DEPTH_SHIFT);
+}
+
+uint32_t RenderQueue::QuantizeDepth(float viewDepth, float nearClip, float farClip)
+{
+	const uint32_t maxDepth = (1u << DEPTH_BITS) - 1;
+	float t = (viewDepth - nearClip) / (farClip - nearClip);
+	if (!(t > 0)) return 0;
+	if (t >= 1) return maxDepth;
+	return (uint32_t)(t * maxDepth);
+}
+
+// ====== Ids ================
+
+uint32_t RenderQueue::GetShaderId(const std::shared_ptr<const void>& vs, const std::shared_ptr<const void>& ps)
+{
+	auto found = shaderIds.find({ vs.get(), ps.get() });
+	if (found != shaderIds.end() && !found->second.vs.expired() && !found->second.ps.expired())
+		return found->second.id;
+
+	// new, or at the addresses of a pair that's been freed since - drop
+	// every freed pair while here, so the map only holds live ones
+	std::erase_if(shaderIds, [](const auto& entry) { return entry.second.vs.expired() || entry.second.ps.expired(); });
+	uint32_t id = nextShaderId++;
+	shaderIds[{ vs.get(), ps.get() }] = ShaderPair{ vs, ps, id };
+	return id;
+}
+
+// ====== Sorting ============
+
+RenderQueue::SortStats RenderQueue::Sort()
+{
+	auto start = std::chrono::steady_clock::now();
+	SortStats stats = {};
+	size_t count = items.size();
+	stats.items = (uint32_t)count;
+	scratch.resize(count);
+
+	// every byte's histogram in one read of the keys
+	uint32_t histograms[8][256] = {};
+	for (const Item& item : items) {
+		uint64_t key = item.key;
+		for (int digit = 0; digit < 8; digit++)
+			histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+	}
+
+	Item* from = items.data();
+	Item* to = scratch.data();
+	for (int digit = 0; digit < 8; digit++) {
+		uint32_t* histogram = histograms[digit];
+		uint32_t shift = digit * 8;
+
+		// a byte every key shares wouldn't move anything
+		if (count == 0 || histogram[(from[0].key >> shift) & 0xFF] == count) continue;
+
+		uint32_t offset = 0;
+		for (int b = 0; b < 256; b++) {
+			uint32_t n = histogram[b];
+			histogram[b] = offset;
+			offset += n;
+		}
+		for (size_t i = 0; i < count; i++)
+			to[histogram[(from[i].key >> shift) & 0xFF]++] = from[i];
+		std::swap(from, to);
+		stats.passes++;
+	}
+	if (from != items.data()) items.swap(scratch);
+
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
+
+RenderQueue::StateChanges RenderQueue::CountChanges(const Item* items, size_t count)
+{
+	StateChanges changes = {};
+	for (size_t i = 0; i < count; i++) {
+		uint64_t key = items[i].key;
+		uint64_t previous = i > 0 ? items[i - 1].key : 0;
+		bool first = i == 0;
+		if (first || GetField(key, SHADER_BITS, SHADER_SHIFT) != GetField(previous, SHADER_BITS, SHADER_SHIFT)) changes.shaders++;
+		if (first || GetField(key, MATERIAL_BITS, MATERIAL_SHIFT) != GetField(previous, MATERIAL_BITS, MATERIAL_SHIFT)) changes.materials++;
+		if (first || GetField(key, MESH_BITS, MESH_SHIFT) != GetField(previous, MESH_BITS, MESH_SHIFT)) changes.meshes++;
+	}
+	return changes;
+}
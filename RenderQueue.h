@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------
+// A frame's draws as 64 bit sort keys, so drawing them in key
+// order changes shaders, materials and meshes as little as it
+// can - high bits first:
+//   pass (4) | shader pair (12) | material (12) | mesh (16) | depth (20)
+// - Depth is quantized view depth, front to back within a mesh
+// - Keys are sorted with an LSD radix sort, a byte per pass,
+//   skipping bytes every key shares; equal keys keep their order
+// - Materials and meshes bring their own ids (GetId()), shader
+//   pairs get one here, ids past a field's width wrap (which only
+//   costs grouping)
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	static constexpr uint32_t PASS_BITS = 4;
+	static constexpr uint32_t SHADER_BITS = 12;
+	static constexpr uint32_t MATERIAL_BITS = 12;
+	static constexpr uint32_t MESH_BITS = 16;
+	static constexpr uint32_t DEPTH_BITS = 20;
+
+	// passes, drawn in this order
+	static constexpr uint32_t PASS_OPAQUE = 0;
+
+	struct Item
+	{
+		uint64_t key;
+		uint32_t entity;		// whatever the caller draws it from
+	};
+
+	struct SortStats
+	{
+		uint32_t items;
+		uint32_t passes;		// radix passes that ran, at most 8
+		double ms;
+	};
+
+	// binds a draw order needs, the first draw counting for each
+	struct StateChanges
+	{
+		uint32_t shaders;
+		uint32_t materials;
+		uint32_t meshes;
+	};
+
+	static uint64_t MakeKey(uint32_t pass, uint32_t shaders, uint32_t material, uint32_t mesh, uint32_t depth);
+
+	// View depth to the key's depth bits, 0 at "nearClip"
+	static uint32_t QuantizeDepth(float viewDepth, float nearClip, float farClip);
+
+	// Id for a vertex and pixel shader pair, for as long as both live -
+	// a pair at a freed pair's addresses gets a new one
+	uint32_t GetShaderId(const std::shared_ptr<const void>& vs, const std::shared_ptr<const void>& ps);
+
+	void Clear() { items.clear(); }
+	void Push(uint64_t key, uint32_t entity) { items.push_back({ key, entity }); }
+
+	// Sorts the items by key, the order they draw in
+	SortStats Sort();
+	const std::vector<Item>& GetItems() const { return items; }
+
+	// Binds drawing "items" in order would need
+	static StateChanges CountChanges(const Item* items, size_t count);
+
+private:
+	std::vector<Item> items;
+	std::vector<Item> scratch;
+
+	struct ShaderPair
+	{
+		std::weak_ptr<const void> vs;
+		std::weak_ptr<const void> ps;
+		uint32_t id;
+	};
+	std::map<std::pair<const void*, const void*>, ShaderPair> shaderIds;
+	uint32_t nextShaderId = 0;
+};
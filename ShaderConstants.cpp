@@ -0,0 +1,42 @@
+#include "ShaderConstants.h"
+
+#include <cstring>
+
+void ShaderConstants::Begin(ISimpleShader* s)
+{
+	shader = s;
+	data.clear();
+	offsets.clear();
+	if (!shader) return;
+
+	for (unsigned int b = 0; b < shader->GetBufferCount(); b++) {
+		const SimpleConstantBuffer* buffer = shader->GetBufferInfo(b);
+		offsets.push_back((uint32_t)data.size());
+		data.insert(data.end(), buffer->LocalDataBuffer, buffer->LocalDataBuffer + buffer->Size);
+	}
+}
+
+bool ShaderConstants::SetData(const char* name, const void* value, unsigned int size)
+{
+	if (!shader) return false;
+	const SimpleShaderVariable* variable = shader->GetVariableInfo(name);
+	if (!variable || size > variable->Size) return false;
+
+	memcpy(data.data() + offsets[variable->ConstantBufferIndex] + variable->ByteOffset, value, size);
+	return true;
+}
+
+void ShaderConstants::Record(CommandBuffer& commands, ShaderStage stage) const
+{
+	if (!shader) return;
+
+	for (unsigned int b = 0; b < shader->GetBufferCount(); b++) {
+		// structured buffers are reflected as constant buffers too
+		const SimpleConstantBuffer* buffer = shader->GetBufferInfo(b);
+		if (buffer->Type != D3D11_CT_CBUFFER) continue;
+
+		ID3D11Buffer* constantBuffer = buffer->ConstantBuffer.Get();
+		commands.UpdateConstants(constantBuffer, data.data() + offsets[b], buffer->Size);
+		commands.SetConstantBuffer(stage, buffer->BindIndex, constantBuffer);
+	}
+}
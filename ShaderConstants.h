@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CommandBuffer.h"
+#include "SimpleShader/SimpleShader.h"
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// A private copy of a SimpleShader's constant buffers, so a
+// thread can fill them in and record the updates into a
+// CommandBuffer without touching the shader's own copies
+// - Variables are found by name through the shader's reflection,
+//   the same way ISimpleShader::SetData() finds them, and
+//   unknown names are skipped the same way too
+// - The shader is only read, any number of these can record
+//   from one shader at once
+// --------------------------------------------------------
+class ShaderConstants
+{
+public:
+	// Starts from the data last set on "shader" itself
+	void Begin(ISimpleShader* shader);
+
+	// False if there's no such variable or "size" is bigger than it
+	bool SetData(const char* name, const void* data, unsigned int size);
+	bool SetInt(const char* name, int data) { return SetData(name, &data, sizeof(int)); }
+	bool SetFloat(const char* name, float data) { return SetData(name, &data, sizeof(float)); }
+	bool SetFloat2(const char* name, const DirectX::XMFLOAT2& data) { return SetData(name, &data, sizeof(data)); }
+	bool SetFloat3(const char* name, const DirectX::XMFLOAT3& data) { return SetData(name, &data, sizeof(data)); }
+	bool SetMatrix4x4(const char* name, const DirectX::XMFLOAT4X4& data) { return SetData(name, &data, sizeof(data)); }
+
+	// Records an update and a bind of each of the shader's constant
+	// buffers, to their registers in "stage"
+	void Record(CommandBuffer& commands, ShaderStage stage) const;
+
+	ISimpleShader* GetShader() const { return shader; }
+
+private:
+	ISimpleShader* shader = nullptr;
+	std::vector<uint8_t> data;			// every buffer, back to back
+	std::vector<uint32_t> offsets;		// where each buffer starts in data
+};
@@ -14,6 +14,26 @@ struct VertexShaderInput
     float3 tangent          : TANGENT;      // tangent coordinate
 };
 
+// Compact version of the vertex above, matches PackedVertex in C++
+// - See VertexPacking.hlsli for turning this back into a VertexShaderInput
+struct PackedVertexShaderInput
+{
+    float4 quantizedPosition    : POSITION;     // unorm xyz within the mesh bounds
+    float2 uv                   : TEXCOORD;     // half float
+    float4 octNormalTangent     : NORMAL;       // octahedral normal (xy) and tangent (zw)
+};
+
+// Per instance matrices for instanced draws, matches InstanceData in C++
+// - "_PER_INSTANCE" semantics put them in input slot 1, see SimpleShader
+// - row_major so the rows are the C++ matrices' rows, multiply as mul(v, m)
+struct InstanceInput
+{
+    row_major float4x4 world                : WORLD_PER_INSTANCE;
+    row_major float4x4 worldIT              : WORLD_IT_PER_INSTANCE;
+    row_major float4x4 worldViewProj        : WVP_PER_INSTANCE;
+    row_major float4x4 lightWorldViewProj   : LIGHT_WVP_PER_INSTANCE;
+};
+
 // Struct representing the data we're sending down the pipeline
 // - Should match our pixel shader's input (hence the name: Vertex to Pixel)
 // - At a minimum, we need a piece of data defined tagged as SV_POSITION
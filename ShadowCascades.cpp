@@ -0,0 +1,95 @@
+#include "ShadowCascades.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+void ShadowCascades::ComputeSplits(float nearClip, float farClip, unsigned int count, float lambda, float* splits)
+{
+	for (unsigned int i = 0; i <= count; i++) {
+		float f = (float)i / count;
+		float logarithmic = nearClip * powf(farClip / nearClip, f);
+		float uniform = nearClip + (farClip - nearClip) * f;
+		splits[i] = uniform + (logarithmic - uniform) * lambda;
+	}
+
+	// exact ends, pow() can be off by an ulp
+	splits[0] = nearClip;
+	splits[count] = farClip;
+}
+
+ShadowCascades::Cascade ShadowCascades::Fit(const XMFLOAT4X4& cameraView, const XMFLOAT4X4& cameraProjection,
+	float splitNear, float splitFar, const XMFLOAT3& lightDirection, const XMFLOAT3& lightUp, unsigned int resolution)
+{
+	// the frustum's edges are straight lines from the near corners to
+	// the far ones in view space, whichever kind of projection it is
+	XMMATRIX inverseProjection = XMMatrixInverse(nullptr, XMLoadFloat4x4(&cameraProjection));
+	XMMATRIX inverseView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&cameraView));
+	XMVECTOR corners[8];
+	for (int c = 0; c < 4; c++) {
+		float x = (c & 1) ? 1.0f : -1.0f;
+		float y = (c & 2) ? 1.0f : -1.0f;
+		XMVECTOR nearCorner = XMVector3TransformCoord(XMVectorSet(x, y, 0, 1), inverseProjection);
+		XMVECTOR farCorner = XMVector3TransformCoord(XMVectorSet(x, y, 1, 1), inverseProjection);
+		float nearZ = XMVectorGetZ(nearCorner);
+		float farZ = XMVectorGetZ(farCorner);
+		corners[c] = XMVectorLerp(nearCorner, farCorner, (splitNear - nearZ) / (farZ - nearZ));
+		corners[c + 4] = XMVectorLerp(nearCorner, farCorner, (splitFar - nearZ) / (farZ - nearZ));
+	}
+
+	// bounding sphere in world space, padded by the texel snapping can
+	// move it and rounded up so float noise as the camera turns can't
+	// change the size
+	XMVECTOR center = XMVectorZero();
+	for (XMVECTOR& corner : corners) {
+		corner = XMVector3TransformCoord(corner, inverseView);
+		center += corner;
+	}
+	center *= 1.0f / 8.0f;
+	float radius = 0;
+	for (const XMVECTOR& corner : corners)
+		radius = fmaxf(radius, XMVectorGetX(XMVector3Length(corner - center)));
+	radius *= (float)resolution / (resolution - 2);
+	radius = ceilf(radius * 16.0f) / 16.0f;
+
+	// center in light space, snapped across the light to whole texels
+	XMMATRIX rotation = XMMatrixLookToLH(XMVectorZero(), XMLoadFloat3(&lightDirection), XMLoadFloat3(&lightUp));
+	XMFLOAT3 lightCenter;
+	XMStoreFloat3(&lightCenter, XMVector3TransformCoord(center, rotation));
+	float texelSize = 2.0f * radius / resolution;
+	lightCenter.x = floorf(lightCenter.x / texelSize) * texelSize;
+	lightCenter.y = floorf(lightCenter.y / texelSize) * texelSize;
+
+	// x and y in [-radius, radius] and z in [0, 2 * radius] in the light's view
+	Cascade cascade = {};
+	XMMATRIX view = rotation * XMMatrixTranslation(-lightCenter.x, -lightCenter.y, radius - lightCenter.z);
+	XMMATRIX projection = XMMatrixOrthographicLH(2.0f * radius, 2.0f * radius, 0.0f, 2.0f * radius);
+	XMStoreFloat4x4(&cascade.view, view);
+	XMStoreFloat4x4(&cascade.projection, projection);
+	XMStoreFloat4x4(&cascade.viewProjection, view * projection);
+	cascade.splitNear = splitNear;
+	cascade.splitFar = splitFar;
+	cascade.radius = radius;
+	cascade.texelSize = texelSize;
+	return cascade;
+}
+
+void ShadowCascades::GetClipTransform(const Cascade& from, const Cascade& to, XMFLOAT4& scale, XMFLOAT4& offset)
+{
+	// clip = (rotated position + view row 3) * projection diagonal + projection row 3,
+	// per axis, with the rotated position the same for both
+	const float* fromView = from.view.m[3];
+	const float* toView = to.view.m[3];
+	const float* fromProjection = from.projection.m[3];
+	const float* toProjection = to.projection.m[3];
+	float fromScale[3] = { from.projection._11, from.projection._22, from.projection._33 };
+	float toScale[3] = { to.projection._11, to.projection._22, to.projection._33 };
+
+	float s[3], o[3];
+	for (int a = 0; a < 3; a++) {
+		s[a] = toScale[a] / fromScale[a];
+		o[a] = (toView[a] - fromView[a] - fromProjection[a] / fromScale[a]) * toScale[a] + toProjection[a];
+	}
+	scale = XMFLOAT4(s[0], s[1], s[2], 1.0f);
+	offset = XMFLOAT4(o[0], o[1], o[2], 0.0f);
+}
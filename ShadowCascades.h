@@ -0,0 +1,48 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// Cascaded shadow map math for a directional light, with no
+// D3D in it so it can be checked on its own
+// - The camera's depth range is cut into slices, each covered
+//   by its own orthographic light box and shadow map
+// - Every cascade shares the light's rotation, so light clip
+//   space in one is a scale and offset of any other
+// --------------------------------------------------------
+namespace ShadowCascades
+{
+	// matches MAX_CASCADES in ShadowCascades.hlsli
+	constexpr unsigned int MAX_CASCADES = 4;
+
+	struct Cascade
+	{
+		DirectX::XMFLOAT4X4 view;
+		DirectX::XMFLOAT4X4 projection;
+		DirectX::XMFLOAT4X4 viewProjection;
+		float splitNear;	// camera view depths the slice covers
+		float splitFar;
+		float radius;		// half the box's width, the slice's bounding sphere
+		float texelSize;	// world units per shadow map texel
+	};
+
+	// "count" + 1 view depths from nearClip to farClip, the practical split
+	// scheme - each is lambda of the way from the uniform split to the
+	// logarithmic one, near * (far / near)^(i / count)
+	void ComputeSplits(float nearClip, float farClip, unsigned int count, float lambda, float* splits);
+
+	// Light box around the part of the camera's frustum between view
+	// depths splitNear and splitFar, perspective or orthographic
+	// - Sized to the slice's bounding sphere so it keeps its size as
+	//   the camera turns, and moved in whole texels so it doesn't
+	//   swim as the camera moves
+	// - The box starts at the light side of the sphere, casters nearer
+	//   the light need depth clamping (see FrustumCulling::ExtractCasterPlanes())
+	Cascade Fit(const DirectX::XMFLOAT4X4& cameraView, const DirectX::XMFLOAT4X4& cameraProjection,
+		float splitNear, float splitFar,
+		const DirectX::XMFLOAT3& lightDirection, const DirectX::XMFLOAT3& lightUp, unsigned int resolution);
+
+	// clip_to = clip_from * scale + offset (xyz, w is unused), for
+	// cascades fitted with the same light direction and up
+	void GetClipTransform(const Cascade& from, const Cascade& to, DirectX::XMFLOAT4& scale, DirectX::XMFLOAT4& offset);
+}
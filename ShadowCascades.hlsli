@@ -0,0 +1,30 @@
+#ifndef __GGP_SHADOW_CASCADES__
+#define __GGP_SHADOW_CASCADES__
+
+// matches ShadowCascades::MAX_CASCADES in C++
+#define MAX_CASCADES 4
+
+// Shadow amount from the first cascade whose box the pixel is in
+// - "shadowMapPos" is in cascade 0's light clip space, each cascade's
+//   is a scale and offset of it, see ShadowCascades::GetClipTransform()
+// - Past the last cascade nothing is shadowed
+float SampleShadowCascades(Texture2DArray shadowMap, SamplerComparisonState shadowSampler, float4 shadowMapPos,
+    float4 scales[MAX_CASCADES], float4 offsets[MAX_CASCADES], uint cascadeCount)
+{
+    float3 cascadePos = shadowMapPos.xyz / shadowMapPos.w;
+    for (uint c = 0; c < cascadeCount; c++)
+    {
+        float3 pos = cascadePos * scales[c].xyz + offsets[c].xyz;
+        
+        // a little in from the edges so filtering stays in the slice
+        if (all(abs(pos.xy) < 0.99f) && pos.z < 1.0f)
+        {
+            // convert normalize coords for sampling, flip y
+            float2 shadowUV = pos.xy * float2(0.5f, -0.5f) + 0.5f;
+            return shadowMap.SampleCmpLevelZero(shadowSampler, float3(shadowUV, c), pos.z).r;
+        }
+    }
+    return 1.0f;
+}
+
+#endif
@@ -1,17 +1,10 @@
 #include "ShaderStructs.hlsli"
+#include "PerObject.hlsli"
 
-// Constant Buffer for external (C++) data
-cbuffer externalData : register(b0)
-{
-    matrix view;
-    matrix projection;
-    matrix world;
-};
 // --------------------------------------------------------
 // A simplified vertex shader for rendering to a shadow map
 // --------------------------------------------------------
 float4 main(VertexShaderInput input) : SV_POSITION
 {
-    matrix wvp = mul(projection, mul(view, world));
-    return mul(wvp, float4(input.localPosition, 1.0f));
+    return mul(mWorldViewProjLight, float4(input.localPosition, 1.0f));
 }
\ No newline at end of file
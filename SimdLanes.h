@@ -0,0 +1,42 @@
+#pragma once
+
+#include <immintrin.h>
+#include <cstdint>
+
+// --------------------------------------------------------
+// The same batched kernel runs 4 or 8 lanes wide through
+// these, picked at runtime with TransformSystem::IsAVXSupported()
+// - Loads and stores are unaligned
+// - Masks come back from MoveMask() one bit per lane
+// --------------------------------------------------------
+struct SSELanes
+{
+	static constexpr uint32_t WIDTH = 4;
+	using Float = __m128;
+	static Float Load(const float* p) { return _mm_loadu_ps(p); }
+	static void Store(float* p, Float v) { _mm_storeu_ps(p, v); }
+	static Float Set(float f) { return _mm_set1_ps(f); }
+	static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+	static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+	static Float GreaterEqual(Float a, Float b) { return _mm_cmpge_ps(a, b); }
+	static int MoveMask(Float v) { return _mm_movemask_ps(v); }
+};
+
+struct AVXLanes
+{
+	static constexpr uint32_t WIDTH = 8;
+	using Float = __m256;
+	static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+	static void Store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+	static Float Set(float f) { return _mm256_set1_ps(f); }
+	static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+	static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+	static Float GreaterEqual(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static int MoveMask(Float v) { return _mm256_movemask_ps(v); }
+};
@@ -1,6 +1,7 @@
 #include "Sky.h"
 #include "Graphics.h"
 #include "Mesh.h"
+#include "StateCache.h"
 
 #include <d3d11.h>
 #include <WICTextureLoader.h>
@@ -34,30 +35,30 @@ void Sky::InitRenderStates() {
 	rastDesc.CullMode = D3D11_CULL_FRONT; // Draw the inside instead of the outside!
 	rastDesc.FillMode = D3D11_FILL_SOLID;
 	rastDesc.DepthClipEnable = true;
-	Graphics::Device->CreateRasterizerState(&rastDesc, skyRasterState.GetAddressOf());
+	skyRasterState = StateCache::GetRasterizerState(rastDesc);
 
 	// Depth state to draw pixels at depth = 1
 	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
 	depthDesc.DepthEnable = true;
 	depthDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
 	depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-	Graphics::Device->CreateDepthStencilState(&depthDesc, skyDepthState.GetAddressOf());
+	skyDepthState = StateCache::GetDepthStencilState(depthDesc);
 }
 
 void Sky::Draw(std::shared_ptr<Camera> cam) {
 	// set render states
-	Graphics::Context->RSSetState(skyRasterState.Get());
-	Graphics::Context->OMSetDepthStencilState(skyDepthState.Get(), 0);
+	StateCache::SetRasterizerState(skyRasterState.Get());
+	StateCache::SetDepthStencilState(skyDepthState.Get());
 
 	// set shader data and draw mesh
-	skyVS->SetShader();
-	skyPS->SetShader();
+	StateCache::SetShader(skyVS.get());
+	StateCache::SetShader(skyPS.get());
 
 	skyVS->SetMatrix4x4("mView", cam->GetView());
 	skyVS->SetMatrix4x4("mProj", cam->GetProjection());
 
-	skyPS->SetShaderResourceView("SkyTexture", skySRV);
-	skyPS->SetSamplerState("BasicSampler", samplerOptions);
+	StateCache::SetShaderResourceView(skyPS.get(), "SkyTexture", skySRV.Get());
+	StateCache::SetSamplerState(skyPS.get(), "BasicSampler", samplerOptions.Get());
 
 	skyVS->CopyAllBufferData();
 	skyPS->CopyAllBufferData();
@@ -65,8 +66,8 @@ void Sky::Draw(std::shared_ptr<Camera> cam) {
 	skyMesh->Draw();
 
 	// reset render states to default
-	Graphics::Context->RSSetState(nullptr);
-	Graphics::Context->OMSetDepthStencilState(nullptr, 0);
+	StateCache::SetRasterizerState(nullptr);
+	StateCache::SetDepthStencilState(nullptr);
 }
 
 // --------------------------------------------------------
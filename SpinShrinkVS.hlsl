@@ -1,11 +1,10 @@
 #include "ShaderStructs.hlsli"
+#include "PerObject.hlsli"
 
 cbuffer ExternalData : register(b0)
 {
 	matrix mWorld;
     matrix mWorldIT;
-    matrix mView;
-    matrix mProj;
     float dt;
     float tt;
 }
@@ -32,8 +31,7 @@ VertexToPixelBasic main( VertexShaderInput input )
 
     float4 rotatedPosition = mul(rotationMatrix, float4(scaledPosition, 1.0f));
     
-    matrix wvp = mul(mProj, mul(mView, mWorld));
-    output.screenPosition = mul(wvp, rotatedPosition);
+    output.screenPosition = mul(mWorldViewProj, rotatedPosition);
 
     output.uv = input.uv;
     output.normal = mul((float3x3) mWorldIT, input.normal);
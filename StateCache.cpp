@@ -0,0 +1,396 @@
+#include "StateCache.h"
+#include "Graphics.h"
+
+#include <cstring>
+#include <vector>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// a bound value, "known" false when whatever's bound can't be trusted
+	template<typename T>
+	struct Slot
+	{
+		T value = {};
+		bool known = false;
+	};
+
+	struct VertexBinding
+	{
+		ID3D11Buffer* buffer;
+		UINT stride;
+		UINT offset;
+		bool operator==(const VertexBinding&) const = default;
+	};
+
+	struct IndexBinding
+	{
+		ID3D11Buffer* buffer;
+		DXGI_FORMAT format;
+		UINT offset;
+		bool operator==(const IndexBinding&) const = default;
+	};
+
+	struct DepthStencilBinding
+	{
+		ID3D11DepthStencilState* state;
+		UINT stencilRef;
+		bool operator==(const DepthStencilBinding&) const = default;
+	};
+
+	struct BlendBinding
+	{
+		ID3D11BlendState* state;
+		float factor[4];
+		UINT sampleMask;
+		bool operator==(const BlendBinding&) const = default;
+	};
+
+	constexpr UINT STAGE_COUNT = 2;
+
+	bool filtering = true;
+	StateCache::Stats stats = {};
+
+	Slot<ID3D11VertexShader*> vertexShader;
+	Slot<ID3D11InputLayout*> inputLayout;
+	Slot<ID3D11PixelShader*> pixelShader;
+	Slot<ID3D11Buffer*> constantBuffers[STAGE_COUNT][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	Slot<ID3D11ShaderResourceView*> shaderResources[STAGE_COUNT][D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+	Slot<ID3D11SamplerState*> samplers[STAGE_COUNT][D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+	Slot<ID3D11RasterizerState*> rasterizerState;
+	Slot<DepthStencilBinding> depthStencilState;
+	Slot<BlendBinding> blendState;
+	Slot<VertexBinding> vertexBuffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+	Slot<IndexBinding> indexBuffer;
+
+	// true if "value" has to be bound, remembering it - a null slot
+	// is one out of range, which is always bound and never remembered
+	template<typename T>
+	bool Changes(Slot<T>* slot, const T& value, StateCache::Counts& counts)
+	{
+		if (slot && filtering && slot->known && slot->value == value) {
+			counts.filtered++;
+			return false;
+		}
+		if (slot) {
+			slot->value = value;
+			slot->known = true;
+		}
+		counts.issued++;
+		return true;
+	}
+
+	template<typename T, size_t N>
+	Slot<T>* At(Slot<T>(&slots)[N], UINT index)
+	{
+		return index < N ? &slots[index] : nullptr;
+	}
+
+	template<typename T, size_t N>
+	void Forget(Slot<T>(&slots)[N])
+	{
+		for (Slot<T>& slot : slots) slot.known = false;
+	}
+
+	// state objects by the desc they were made from
+	std::vector<std::pair<D3D11_RASTERIZER_DESC, ComPtr<ID3D11RasterizerState>>> rasterizerStates;
+	std::vector<std::pair<D3D11_DEPTH_STENCIL_DESC, ComPtr<ID3D11DepthStencilState>>> depthStencilStates;
+	std::vector<std::pair<D3D11_BLEND_DESC, ComPtr<ID3D11BlendState>>> blendStates;
+	std::vector<std::pair<D3D11_SAMPLER_DESC, ComPtr<ID3D11SamplerState>>> samplerStates;
+	UINT stateObjectsShared = 0;
+
+	template<typename Desc, typename State, typename Create>
+	ComPtr<State> FindOrCreate(std::vector<std::pair<Desc, ComPtr<State>>>& made, const Desc& desc, Create create)
+	{
+		for (auto& [madeDesc, state] : made) {
+			if (memcmp(&madeDesc, &desc, sizeof(Desc)) == 0) {
+				stateObjectsShared++;
+				return state;
+			}
+		}
+		ComPtr<State> state;
+		if (SUCCEEDED(create(&desc, state.GetAddressOf()))) made.push_back({ desc, state });
+		return state;
+	}
+
+	// copies of descs with padding in them, with the padding zeroed
+	// so they compare as bytes
+	D3D11_DEPTH_STENCIL_DESC Normalized(const D3D11_DEPTH_STENCIL_DESC& desc)
+	{
+		D3D11_DEPTH_STENCIL_DESC copy;
+		memset(&copy, 0, sizeof(copy));
+		copy.DepthEnable = desc.DepthEnable;
+		copy.DepthWriteMask = desc.DepthWriteMask;
+		copy.DepthFunc = desc.DepthFunc;
+		copy.StencilEnable = desc.StencilEnable;
+		copy.StencilReadMask = desc.StencilReadMask;
+		copy.StencilWriteMask = desc.StencilWriteMask;
+		copy.FrontFace = desc.FrontFace;
+		copy.BackFace = desc.BackFace;
+		return copy;
+	}
+
+	D3D11_BLEND_DESC Normalized(const D3D11_BLEND_DESC& desc)
+	{
+		D3D11_BLEND_DESC copy;
+		memset(&copy, 0, sizeof(copy));
+		copy.AlphaToCoverageEnable = desc.AlphaToCoverageEnable;
+		copy.IndependentBlendEnable = desc.IndependentBlendEnable;
+		for (int i = 0; i < 8; i++) {
+			const D3D11_RENDER_TARGET_BLEND_DESC& from = desc.RenderTarget[i];
+			D3D11_RENDER_TARGET_BLEND_DESC& to = copy.RenderTarget[i];
+			to.BlendEnable = from.BlendEnable;
+			to.SrcBlend = from.SrcBlend;
+			to.DestBlend = from.DestBlend;
+			to.BlendOp = from.BlendOp;
+			to.SrcBlendAlpha = from.SrcBlendAlpha;
+			to.DestBlendAlpha = from.DestBlendAlpha;
+			to.BlendOpAlpha = from.BlendOpAlpha;
+			to.RenderTargetWriteMask = from.RenderTargetWriteMask;
+		}
+		return copy;
+	}
+
+	// the constant buffers SimpleShader's SetShader() binds
+	void SetConstantBuffers(ISimpleShader* shader, ShaderStage stage)
+	{
+		for (unsigned int b = 0; b < shader->GetBufferCount(); b++) {
+			const SimpleConstantBuffer* buffer = shader->GetBufferInfo(b);
+			if (buffer->Type == D3D11_CT_CBUFFER)
+				StateCache::SetConstantBuffer(stage, buffer->BindIndex, buffer->ConstantBuffer.Get());
+		}
+	}
+
+	bool SetShaderResourceView(ISimpleShader* shader, ShaderStage stage, const std::string& name, ID3D11ShaderResourceView* view)
+	{
+		const SimpleSRV* info = shader->GetShaderResourceViewInfo(name);
+		if (!info) return false;
+		StateCache::SetShaderResource(stage, info->BindIndex, view);
+		return true;
+	}
+
+	bool SetSamplerState(ISimpleShader* shader, ShaderStage stage, const std::string& name, ID3D11SamplerState* sampler)
+	{
+		const SimpleSampler* info = shader->GetSamplerInfo(name);
+		if (!info) return false;
+		StateCache::SetSampler(stage, info->BindIndex, sampler);
+		return true;
+	}
+}
+
+// ====== Binds ==============
+
+bool StateCache::SetVertexShader(ID3D11VertexShader* shader, ID3D11InputLayout* layout)
+{
+	bool issued = false;
+	if (Changes(&inputLayout, layout, stats.shaders)) {
+		Graphics::Context->IASetInputLayout(layout);
+		issued = true;
+	}
+	if (Changes(&vertexShader, shader, stats.shaders)) {
+		Graphics::Context->VSSetShader(shader, 0, 0);
+		issued = true;
+	}
+	return issued;
+}
+
+bool StateCache::SetPixelShader(ID3D11PixelShader* shader)
+{
+	if (!Changes(&pixelShader, shader, stats.shaders)) return false;
+	Graphics::Context->PSSetShader(shader, 0, 0);
+	return true;
+}
+
+bool StateCache::SetConstantBuffer(ShaderStage stage, UINT slot, ID3D11Buffer* buffer)
+{
+	if (!Changes(At(constantBuffers[(UINT)stage], slot), buffer, stats.constantBuffers)) return false;
+	if (stage == ShaderStage::Vertex) Graphics::Context->VSSetConstantBuffers(slot, 1, &buffer);
+	else Graphics::Context->PSSetConstantBuffers(slot, 1, &buffer);
+	return true;
+}
+
+bool StateCache::SetShaderResource(ShaderStage stage, UINT slot, ID3D11ShaderResourceView* view)
+{
+	if (!Changes(At(shaderResources[(UINT)stage], slot), view, stats.shaderResources)) return false;
+	if (stage == ShaderStage::Vertex) Graphics::Context->VSSetShaderResources(slot, 1, &view);
+	else Graphics::Context->PSSetShaderResources(slot, 1, &view);
+	return true;
+}
+
+bool StateCache::SetSampler(ShaderStage stage, UINT slot, ID3D11SamplerState* sampler)
+{
+	if (!Changes(At(samplers[(UINT)stage], slot), sampler, stats.samplers)) return false;
+	if (stage == ShaderStage::Vertex) Graphics::Context->VSSetSamplers(slot, 1, &sampler);
+	else Graphics::Context->PSSetSamplers(slot, 1, &sampler);
+	return true;
+}
+
+bool StateCache::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	if (!Changes(&rasterizerState, state, stats.states)) return false;
+	Graphics::Context->RSSetState(state);
+	return true;
+}
+
+bool StateCache::SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef)
+{
+	if (!Changes(&depthStencilState, DepthStencilBinding{ state, stencilRef }, stats.states)) return false;
+	Graphics::Context->OMSetDepthStencilState(state, stencilRef);
+	return true;
+}
+
+bool StateCache::SetBlendState(ID3D11BlendState* state, const float blendFactor[4], UINT sampleMask)
+{
+	// no factor is the same as all ones
+	BlendBinding binding = { state, { 1, 1, 1, 1 }, sampleMask };
+	if (blendFactor) memcpy(binding.factor, blendFactor, sizeof(binding.factor));
+	if (!Changes(&blendState, binding, stats.states)) return false;
+	Graphics::Context->OMSetBlendState(state, binding.factor, sampleMask);
+	return true;
+}
+
+bool StateCache::SetVertexBuffer(UINT slot, ID3D11Buffer* buffer, UINT stride, UINT offset)
+{
+	if (!Changes(At(vertexBuffers, slot), VertexBinding{ buffer, stride, offset }, stats.inputAssembler)) return false;
+	Graphics::Context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+	return true;
+}
+
+bool StateCache::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset)
+{
+	if (!Changes(&indexBuffer, IndexBinding{ buffer, format, offset }, stats.inputAssembler)) return false;
+	Graphics::Context->IASetIndexBuffer(buffer, format, offset);
+	return true;
+}
+
+void StateCache::SetRenderTargets(UINT count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth)
+{
+	Graphics::Context->OMSetRenderTargets(count, views, depth);
+	InvalidateShaderResources();
+}
+
+// ====== SimpleShader =======
+
+void StateCache::SetShader(SimpleVertexShader* shader)
+{
+	if (!shader->IsShaderValid()) return;
+	SetVertexShader(shader->GetDirectXShader().Get(), shader->GetInputLayout().Get());
+	SetConstantBuffers(shader, ShaderStage::Vertex);
+}
+
+void StateCache::SetShader(SimplePixelShader* shader)
+{
+	if (!shader->IsShaderValid()) return;
+	SetPixelShader(shader->GetDirectXShader().Get());
+	SetConstantBuffers(shader, ShaderStage::Pixel);
+}
+
+bool StateCache::SetShaderResourceView(SimpleVertexShader* shader, const std::string& name, ID3D11ShaderResourceView* view)
+{
+	return ::SetShaderResourceView(shader, ShaderStage::Vertex, name, view);
+}
+
+bool StateCache::SetShaderResourceView(SimplePixelShader* shader, const std::string& name, ID3D11ShaderResourceView* view)
+{
+	return ::SetShaderResourceView(shader, ShaderStage::Pixel, name, view);
+}
+
+bool StateCache::SetSamplerState(SimpleVertexShader* shader, const std::string& name, ID3D11SamplerState* sampler)
+{
+	return ::SetSamplerState(shader, ShaderStage::Vertex, name, sampler);
+}
+
+bool StateCache::SetSamplerState(SimplePixelShader* shader, const std::string& name, ID3D11SamplerState* sampler)
+{
+	return ::SetSamplerState(shader, ShaderStage::Pixel, name, sampler);
+}
+
+// ====== State objects ======
+
+ComPtr<ID3D11RasterizerState> StateCache::GetRasterizerState(const D3D11_RASTERIZER_DESC& desc)
+{
+	return FindOrCreate(rasterizerStates, desc, [](const D3D11_RASTERIZER_DESC* d, ID3D11RasterizerState** state) {
+		return Graphics::Device->CreateRasterizerState(d, state);
+	});
+}
+
+ComPtr<ID3D11DepthStencilState> StateCache::GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc)
+{
+	return FindOrCreate(depthStencilStates, Normalized(desc), [](const D3D11_DEPTH_STENCIL_DESC* d, ID3D11DepthStencilState** state) {
+		return Graphics::Device->CreateDepthStencilState(d, state);
+	});
+}
+
+ComPtr<ID3D11BlendState> StateCache::GetBlendState(const D3D11_BLEND_DESC& desc)
+{
+	return FindOrCreate(blendStates, Normalized(desc), [](const D3D11_BLEND_DESC* d, ID3D11BlendState** state) {
+		return Graphics::Device->CreateBlendState(d, state);
+	});
+}
+
+ComPtr<ID3D11SamplerState> StateCache::GetSamplerState(const D3D11_SAMPLER_DESC& desc)
+{
+	return FindOrCreate(samplerStates, desc, [](const D3D11_SAMPLER_DESC* d, ID3D11SamplerState** state) {
+		return Graphics::Device->CreateSamplerState(d, state);
+	});
+}
+
+UINT StateCache::GetStateObjectCount()
+{
+	return (UINT)(rasterizerStates.size() + depthStencilStates.size() + blendStates.size() + samplerStates.size());
+}
+
+UINT StateCache::GetStateObjectsShared()
+{
+	return stateObjectsShared;
+}
+
+// ====== Tracking ===========
+
+void StateCache::Invalidate()
+{
+	vertexShader.known = false;
+	inputLayout.known = false;
+	pixelShader.known = false;
+	for (UINT stage = 0; stage < STAGE_COUNT; stage++) {
+		Forget(constantBuffers[stage]);
+		Forget(samplers[stage]);
+	}
+	rasterizerState.known = false;
+	depthStencilState.known = false;
+	blendState.known = false;
+	InvalidateShaderResources();
+	InvalidateInputAssembler();
+}
+
+void StateCache::InvalidateShaderResources()
+{
+	for (UINT stage = 0; stage < STAGE_COUNT; stage++) Forget(shaderResources[stage]);
+}
+
+void StateCache::InvalidateInputAssembler()
+{
+	Forget(vertexBuffers);
+	indexBuffer.known = false;
+}
+
+void StateCache::SetFiltering(bool enabled)
+{
+	filtering = enabled;
+}
+
+bool StateCache::IsFiltering()
+{
+	return filtering;
+}
+
+StateCache::Stats StateCache::GetStats()
+{
+	return stats;
+}
+
+void StateCache::ResetStats()
+{
+	stats = {};
+}
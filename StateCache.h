@@ -0,0 +1,91 @@
+#pragma once
+
+#include "CommandBuffer.h"
+#include "SimpleShader/SimpleShader.h"
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <string>
+
+// --------------------------------------------------------
+// Every pipeline bind on Graphics::Context goes through here,
+// which remembers what's bound and drops binds that wouldn't
+// change anything
+// - Shadows the vertex and pixel shaders, input layout, their
+//   constant buffers, shader resources and samplers per slot,
+//   the rasterizer, depth stencil and blend states and the
+//   input assembler's buffers
+// - Anything that binds behind its back (ImGui, SimpleShader's
+//   own SetShader()) has to be followed by Invalidate()
+// - Render targets go through SetRenderTargets(), binding one
+//   unbinds views of the same resource, so the shader resources
+//   are forgotten with it
+// - State objects made from the same desc are shared
+// - Immediate context only, so main thread only
+// --------------------------------------------------------
+namespace StateCache
+{
+	// binds made vs binds dropped since ResetStats()
+	struct Counts
+	{
+		UINT issued;
+		UINT filtered;
+	};
+
+	struct Stats
+	{
+		Counts shaders;				// shaders and input layouts
+		Counts constantBuffers;
+		Counts shaderResources;
+		Counts samplers;
+		Counts states;				// rasterizer, depth stencil, blend
+		Counts inputAssembler;		// vertex and index buffers
+	};
+
+	// Each returns true if the bind was made
+	bool SetVertexShader(ID3D11VertexShader* shader, ID3D11InputLayout* inputLayout);
+	bool SetPixelShader(ID3D11PixelShader* shader);
+	bool SetConstantBuffer(ShaderStage stage, UINT slot, ID3D11Buffer* buffer);
+	bool SetShaderResource(ShaderStage stage, UINT slot, ID3D11ShaderResourceView* view);
+	bool SetSampler(ShaderStage stage, UINT slot, ID3D11SamplerState* sampler);
+	bool SetRasterizerState(ID3D11RasterizerState* state);
+	bool SetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef = 0);
+	bool SetBlendState(ID3D11BlendState* state, const float blendFactor[4] = nullptr, UINT sampleMask = 0xFFFFFFFF);
+	bool SetVertexBuffer(UINT slot, ID3D11Buffer* buffer, UINT stride, UINT offset = 0);
+	bool SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format = DXGI_FORMAT_R32_UINT, UINT offset = 0);
+
+	// Always made, see above
+	void SetRenderTargets(UINT count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth);
+
+	// What SimpleShader's SetShader(), SetShaderResourceView() and
+	// SetSamplerState() bind, filtered
+	// - The resource and sampler ones are false if the shader has no
+	//   such name, like SimpleShader's
+	void SetShader(SimpleVertexShader* shader);
+	void SetShader(SimplePixelShader* shader);
+	bool SetShaderResourceView(SimpleVertexShader* shader, const std::string& name, ID3D11ShaderResourceView* view);
+	bool SetShaderResourceView(SimplePixelShader* shader, const std::string& name, ID3D11ShaderResourceView* view);
+	bool SetSamplerState(SimpleVertexShader* shader, const std::string& name, ID3D11SamplerState* sampler);
+	bool SetSamplerState(SimplePixelShader* shader, const std::string& name, ID3D11SamplerState* sampler);
+
+	// State objects, one per distinct desc
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> GetRasterizerState(const D3D11_RASTERIZER_DESC& desc);
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> GetDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc);
+	Microsoft::WRL::ComPtr<ID3D11BlendState> GetBlendState(const D3D11_BLEND_DESC& desc);
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> GetSamplerState(const D3D11_SAMPLER_DESC& desc);
+	UINT GetStateObjectCount();		// distinct ones made
+	UINT GetStateObjectsShared();	// Get*State() calls that found one
+
+	// Forgets what's bound, everything or just the shader resources
+	// or input assembler buffers
+	void Invalidate();
+	void InvalidateShaderResources();
+	void InvalidateInputAssembler();
+
+	// Off, every bind is made, but still counted and remembered
+	void SetFiltering(bool enabled);
+	bool IsFiltering();
+
+	Stats GetStats();
+	void ResetStats();
+}
@@ -0,0 +1,286 @@
+#include "Tangents.h"
+#include "ParallelFor.h"
+
+#include <DirectXMath.h>
+#include <xmmintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+// ====== Shared helpers =========================================================================
+
+namespace
+{
+	// every chunk keeps 12 bytes of accumulator per vertex, the thread
+	// count is cut back until all of them fit in this
+	const size_t MAX_ACCUMULATOR_BYTES = (size_t)256 << 20;
+
+	// vertices per block in the reduction/orthogonalize pass
+	const size_t VERTEX_BLOCK = 4096;
+
+	// a tangent that loses all but this much (squared) of its length to
+	// the normal was parallel to it, and gets a fallback instead
+	const float MIN_ORTHOGONAL_FRACTION_SQ = 1e-12f;
+
+	// uv gradient of one triangle, false if its uvs are degenerate
+	inline bool TriangleTangent(const Vertex& v1, const Vertex& v2, const Vertex& v3, float& tx, float& ty, float& tz)
+	{
+		// Calculate vectors relative to triangle positions
+		float x1 = v2.Position.x - v1.Position.x;
+		float y1 = v2.Position.y - v1.Position.y;
+		float z1 = v2.Position.z - v1.Position.z;
+		float x2 = v3.Position.x - v1.Position.x;
+		float y2 = v3.Position.y - v1.Position.y;
+		float z2 = v3.Position.z - v1.Position.z;
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2.UV.x - v1.UV.x;
+		float t1 = v2.UV.y - v1.UV.y;
+		float s2 = v3.UV.x - v1.UV.x;
+		float t2 = v3.UV.y - v1.UV.y;
+
+		// det = |uv edge 1| * |uv edge 2| * sin(angle), so this is
+		// scale independent and also catches zero length edges
+		float det = s1 * t2 - s2 * t1;
+		const float eps = Tangents::DEGENERATE_UV_SINE;
+		if (!(det * det > eps * eps * (s1 * s1 + t1 * t1) * (s2 * s2 + t2 * t2))) return false;
+
+		float r = 1.0f / det;
+		tx = (t2 * x1 - t1 * x2) * r;
+		ty = (t2 * y1 - t1 * y2) * r;
+		tz = (t2 * z1 - t1 * z2) * r;
+		return true;
+	}
+
+	// unit vector perpendicular to "normal", for vertices whose
+	// triangles gave no usable uv direction
+	XMFLOAT3 FallbackTangent(const XMFLOAT3& normal)
+	{
+		XMVECTOR n = XMLoadFloat3(&normal);
+		XMVECTOR axis = fabsf(normal.x) < 0.9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+		XMVECTOR t = XMVector3Cross(n, axis);
+		float lengthSq = XMVectorGetX(XMVector3LengthSq(t));
+		if (!(lengthSq > 0)) return XMFLOAT3(1, 0, 0);
+
+		XMFLOAT3 tangent;
+		XMStoreFloat3(&tangent, t / sqrtf(lengthSq));
+		return tangent;
+	}
+
+	// Gram-Schmidt against the normal, with the fallback above
+	XMFLOAT3 Orthogonalize(const XMFLOAT3& normal, float tx, float ty, float tz)
+	{
+		XMVECTOR n = XMLoadFloat3(&normal);
+		XMVECTOR t = XMVectorSet(tx, ty, tz, 0);
+		float originalSq = XMVectorGetX(XMVector3LengthSq(t));
+		t = t - n * XMVector3Dot(n, t);
+		float lengthSq = XMVectorGetX(XMVector3LengthSq(t));
+		if (!(lengthSq > MIN_ORTHOGONAL_FRACTION_SQ * originalSq)) return FallbackTangent(normal);
+
+		XMFLOAT3 tangent;
+		XMStoreFloat3(&tangent, t / sqrtf(lengthSq));
+		return tangent;
+	}
+}
+
+// ====== Reference ==============================================================================
+
+void Tangents::CalculateScalar(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices)
+{
+	// Reset tangents
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+	}
+	// Calculate tangents one whole triangle at a time
+	for (size_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		Vertex* v1 = &verts[indices[i]];
+		Vertex* v2 = &verts[indices[i + 1]];
+		Vertex* v3 = &verts[indices[i + 2]];
+
+		float tx, ty, tz;
+		if (!TriangleTangent(*v1, *v2, *v3, tx, ty, tz)) continue;
+
+		// Adjust tangents of each vert of the triangle
+		v1->Tangent.x += tx; v1->Tangent.y += ty; v1->Tangent.z += tz;
+		v2->Tangent.x += tx; v2->Tangent.y += ty; v2->Tangent.z += tz;
+		v3->Tangent.x += tx; v3->Tangent.y += ty; v3->Tangent.z += tz;
+	}
+	// Ensure all of the tangents are orthogonal to the normals
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		const XMFLOAT3& t = verts[i].Tangent;
+		verts[i].Tangent = Orthogonalize(verts[i].Normal, t.x, t.y, t.z);
+	}
+}
+
+// ====== SSE / threaded =========================================================================
+
+namespace
+{
+	// positions and uvs pulled out of the vertices, one array per component
+	struct VertexSoA
+	{
+		std::vector<float> px, py, pz, u, v;
+	};
+
+	// adds the tangents of triangles [begin, end) into ax/ay/az
+	void AccumulateTriangles(const VertexSoA& s, const Vertex* vertices, const unsigned int* indices,
+		size_t begin, size_t end, float* ax, float* ay, float* az)
+	{
+		const float eps = Tangents::DEGENERATE_UV_SINE;
+		const __m128 eps2 = _mm_set1_ps(eps * eps);
+		const __m128 one = _mm_set1_ps(1.0f);
+		alignas(16) float tx[4], ty[4], tz[4];
+
+		size_t t = begin;
+		for (; t + 4 <= end; t += 4) {
+			const unsigned int* i = indices + t * 3;
+
+			// lane n is triangle t + n
+			auto gather = [i](const std::vector<float>& a, int k) {
+				return _mm_setr_ps(a[i[k]], a[i[k + 3]], a[i[k + 6]], a[i[k + 9]]);
+			};
+			__m128 x0 = gather(s.px, 0), y0 = gather(s.py, 0), z0 = gather(s.pz, 0);
+			__m128 x1 = _mm_sub_ps(gather(s.px, 1), x0);
+			__m128 y1 = _mm_sub_ps(gather(s.py, 1), y0);
+			__m128 z1 = _mm_sub_ps(gather(s.pz, 1), z0);
+			__m128 x2 = _mm_sub_ps(gather(s.px, 2), x0);
+			__m128 y2 = _mm_sub_ps(gather(s.py, 2), y0);
+			__m128 z2 = _mm_sub_ps(gather(s.pz, 2), z0);
+
+			__m128 u0 = gather(s.u, 0), v0 = gather(s.v, 0);
+			__m128 s1 = _mm_sub_ps(gather(s.u, 1), u0);
+			__m128 t1 = _mm_sub_ps(gather(s.v, 1), v0);
+			__m128 s2 = _mm_sub_ps(gather(s.u, 2), u0);
+			__m128 t2 = _mm_sub_ps(gather(s.v, 2), v0);
+
+			// same degenerate test as TriangleTangent(), failing lanes add zero
+			__m128 det = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+			__m128 length1 = _mm_add_ps(_mm_mul_ps(s1, s1), _mm_mul_ps(t1, t1));
+			__m128 length2 = _mm_add_ps(_mm_mul_ps(s2, s2), _mm_mul_ps(t2, t2));
+			__m128 valid = _mm_cmpgt_ps(_mm_mul_ps(det, det), _mm_mul_ps(eps2, _mm_mul_ps(length1, length2)));
+			__m128 r = _mm_and_ps(valid, _mm_div_ps(one, det));
+
+			_mm_store_ps(tx, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r));
+			_mm_store_ps(ty, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r));
+			_mm_store_ps(tz, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r));
+
+			// the scatter stays scalar, triangles in a group can share vertices
+			for (int n = 0; n < 4; n++) {
+				for (int k = 0; k < 3; k++) {
+					unsigned int index = i[n * 3 + k];
+					ax[index] += tx[n];
+					ay[index] += ty[n];
+					az[index] += tz[n];
+				}
+			}
+		}
+
+		// leftover triangles
+		for (; t < end; t++) {
+			const unsigned int* i = indices + t * 3;
+			float x, y, z;
+			if (!TriangleTangent(vertices[i[0]], vertices[i[1]], vertices[i[2]], x, y, z)) continue;
+			for (int k = 0; k < 3; k++) {
+				ax[i[k]] += x;
+				ay[i[k]] += y;
+				az[i[k]] += z;
+			}
+		}
+	}
+
+	// Gram-Schmidt for vertices [begin, end), four at a time
+	void OrthogonalizeVertices(Vertex* vertices, size_t begin, size_t end, const float* ax, const float* ay, const float* az)
+	{
+		const __m128 minFraction = _mm_set1_ps(MIN_ORTHOGONAL_FRACTION_SQ);
+		alignas(16) float ox[4], oy[4], oz[4], ok[4];
+
+		size_t v = begin;
+		for (; v + 4 <= end; v += 4) {
+			Vertex* q = vertices + v;
+			__m128 nx = _mm_setr_ps(q[0].Normal.x, q[1].Normal.x, q[2].Normal.x, q[3].Normal.x);
+			__m128 ny = _mm_setr_ps(q[0].Normal.y, q[1].Normal.y, q[2].Normal.y, q[3].Normal.y);
+			__m128 nz = _mm_setr_ps(q[0].Normal.z, q[1].Normal.z, q[2].Normal.z, q[3].Normal.z);
+			__m128 tx = _mm_loadu_ps(ax + v);
+			__m128 ty = _mm_loadu_ps(ay + v);
+			__m128 tz = _mm_loadu_ps(az + v);
+
+			__m128 originalSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz));
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)), _mm_mul_ps(nz, tz));
+			tx = _mm_sub_ps(tx, _mm_mul_ps(nx, d));
+			ty = _mm_sub_ps(ty, _mm_mul_ps(ny, d));
+			tz = _mm_sub_ps(tz, _mm_mul_ps(nz, d));
+
+			__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, tx), _mm_mul_ps(ty, ty)), _mm_mul_ps(tz, tz));
+			__m128 length = _mm_sqrt_ps(lengthSq);
+			_mm_store_ps(ox, _mm_div_ps(tx, length));
+			_mm_store_ps(oy, _mm_div_ps(ty, length));
+			_mm_store_ps(oz, _mm_div_ps(tz, length));
+			_mm_store_ps(ok, _mm_cmpgt_ps(lengthSq, _mm_mul_ps(minFraction, originalSq)));
+
+			for (int n = 0; n < 4; n++) {
+				if (ok[n] != 0) q[n].Tangent = XMFLOAT3(ox[n], oy[n], oz[n]);
+				else q[n].Tangent = FallbackTangent(q[n].Normal);
+			}
+		}
+
+		for (; v < end; v++)
+			vertices[v].Tangent = Orthogonalize(vertices[v].Normal, ax[v], ay[v], az[v]);
+	}
+}
+
+void Tangents::CalculateParallel(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+	unsigned int threadCount)
+{
+	if (vertexCount == 0) return;
+	size_t triCount = indexCount / 3;
+
+	VertexSoA soa;
+	soa.px.resize(vertexCount); soa.py.resize(vertexCount); soa.pz.resize(vertexCount);
+	soa.u.resize(vertexCount); soa.v.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		soa.px[i] = vertices[i].Position.x;
+		soa.py[i] = vertices[i].Position.y;
+		soa.pz[i] = vertices[i].Position.z;
+		soa.u[i] = vertices[i].UV.x;
+		soa.v[i] = vertices[i].UV.y;
+	}
+
+	size_t memoryLimit = std::max<size_t>(MAX_ACCUMULATOR_BYTES / (vertexCount * 3 * sizeof(float)), 1);
+	size_t chunkCount = std::max<size_t>(std::min<size_t>({ (size_t)threadCount, memoryLimit, triCount }), 1);
+
+	// one set of accumulators per chunk, [chunk][axis][vertex]
+	std::vector<float> accumulators(chunkCount * 3 * vertexCount, 0.0f);
+	auto accumulator = [&](size_t chunk, int axis) { return accumulators.data() + (chunk * 3 + axis) * vertexCount; };
+
+	ParallelFor(chunkCount, (unsigned int)chunkCount, [&](size_t c) {
+		size_t begin = triCount * c / chunkCount;
+		size_t end = triCount * (c + 1) / chunkCount;
+		AccumulateTriangles(soa, vertices, indices, begin, end, accumulator(c, 0), accumulator(c, 1), accumulator(c, 2));
+	});
+
+	// sum every chunk into the first one, in chunk order, then orthogonalize
+	size_t blockCount = (vertexCount + VERTEX_BLOCK - 1) / VERTEX_BLOCK;
+	ParallelFor(blockCount, (unsigned int)chunkCount, [&](size_t b) {
+		size_t begin = b * VERTEX_BLOCK;
+		size_t end = std::min(begin + VERTEX_BLOCK, vertexCount);
+		for (int axis = 0; axis < 3; axis++) {
+			float* sum = accumulator(0, axis);
+			for (size_t c = 1; c < chunkCount; c++) {
+				const float* part = accumulator(c, axis);
+				for (size_t v = begin; v < end; v++) sum[v] += part[v];
+			}
+		}
+		OrthogonalizeVertices(vertices, begin, end, accumulator(0, 0), accumulator(0, 1), accumulator(0, 2));
+	});
+}
+
+void Tangents::Calculate(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	unsigned int threads = indexCount / 3 >= PARALLEL_MIN_TRIANGLES ? std::thread::hardware_concurrency() : 1;
+	CalculateParallel(vertices, vertexCount, indices, indexCount, threads);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// Per-vertex tangents from positions, uvs and normals
+// - Each triangle's uv gradient is added to its three
+//   vertices, then orthogonalized against the normal
+//   (Gram-Schmidt)
+// - Triangles with collinear or collapsed uvs don't add
+//   anything, and a vertex left with no tangent at all gets
+//   an arbitrary one perpendicular to its normal
+// --------------------------------------------------------
+namespace Tangents
+{
+	// Meshes with fewer triangles than this are done on a single thread by Calculate()
+	constexpr size_t PARALLEL_MIN_TRIANGLES = 1 << 16;
+
+	// uv triangles with sin(angle between their edges) under this count as degenerate
+	constexpr float DEGENERATE_UV_SINE = 1e-6f;
+
+	// Picks a thread count from the mesh size and runs CalculateParallel()
+	void Calculate(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+	// SSE over SoA copies of the positions/uvs, four triangles at a time
+	// - Triangles are split into one chunk per thread, each with its own
+	//   accumulators, which are summed at the end in chunk order so the
+	//   result only depends on the thread count
+	void CalculateParallel(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+		unsigned int threadCount);
+
+	// Original scalar loop (with the degenerate uv handling above)
+	// - Kept as the reference implementation for benchmarking
+	void CalculateScalar(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+}
@@ -0,0 +1,70 @@
+#include "Tests.h"
+
+#include "BVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// random triangles of varied size in a 20 unit box
+	void RandomTriangles(size_t count, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> spot(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> size(-1.5f, 1.5f);
+		for (size_t t = 0; t < count; t++) {
+			XMFLOAT3 center(spot(rng), spot(rng), spot(rng));
+			for (int k = 0; k < 3; k++) {
+				Vertex v = {};
+				v.Position = XMFLOAT3(center.x + size(rng), center.y + size(rng), center.z + size(rng));
+				indices.push_back((unsigned int)vertices.size());
+				vertices.push_back(v);
+			}
+		}
+	}
+}
+
+TEST(BVH, TriangleDistanceByFeature)
+{
+	const XMFLOAT3 a(0, 0, 0), b(2, 0, 0), c(0, 2, 0);
+	CHECK(BVH::TriangleDistanceSq(XMFLOAT3(0.5f, 0.5f, 3), a, b, c) == 9.0f);	// over the face
+	CHECK(BVH::TriangleDistanceSq(XMFLOAT3(-1, -1, 0), a, b, c) == 2.0f);		// past a corner
+	CHECK(BVH::TriangleDistanceSq(XMFLOAT3(1, -2, 0), a, b, c) == 4.0f);		// beside an edge
+	CHECK(BVH::TriangleDistanceSq(XMFLOAT3(2, 2, 0), a, b, c) == 2.0f);			// beside the long edge
+	CHECK(BVH::TriangleDistanceSq(XMFLOAT3(0.5f, 0.5f, 0), a, b, c) == 0.0f);	// on it
+
+	// a sliver with no area still measures to its line
+	CHECK(fabsf(BVH::TriangleDistanceSq(XMFLOAT3(1, 1, 0), a, b, XMFLOAT3(1, 0, 0)) - 1.0f) <= 1e-6f);
+}
+
+TEST(BVH, ClosestDistanceMatchesBruteForce)
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	RandomTriangles(2000, vertices, indices);
+	BVH bvh;
+	bvh.Build(vertices.data(), vertices.size(), indices.data(), indices.size());
+
+	std::mt19937 rng(99);
+	std::uniform_real_distribution<float> spot(-15.0f, 15.0f);
+	for (int query = 0; query < 500; query++) {
+		XMFLOAT3 p(spot(rng), spot(rng), spot(rng));
+		float expected = FLT_MAX;
+		for (size_t i = 0; i < indices.size(); i += 3)
+			expected = (std::min)(expected, BVH::TriangleDistanceSq(p,
+				vertices[indices[i]].Position, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position));
+
+		// leaves store edges, so corners come back with a little rounding
+		float found = bvh.ClosestDistanceSq(p);
+		CHECK(fabsf(found - expected) <= 1e-4f * (1.0f + expected));
+	}
+
+	BVH empty;
+	CHECK(empty.ClosestDistanceSq(XMFLOAT3(0, 0, 0)) == FLT_MAX);
+}
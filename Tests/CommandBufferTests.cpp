@@ -0,0 +1,279 @@
+#include "Tests.h"
+
+#include "CommandBuffer.h"
+#include "ParallelFor.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace
+{
+	// made up handles, the backends here never dereference them
+	const void* Handle(uintptr_t kind, uint32_t n = 0)
+	{
+		return (const void*)(kind << 24 | (uintptr_t)(n + 1) << 4);
+	}
+
+	const void* VS = Handle(1);
+	const void* LAYOUT = Handle(2);
+	const void* PS = Handle(3);
+	const void* CONSTANTS = Handle(4);
+	const void* VERTICES = Handle(5);
+	const void* INSTANCES = Handle(6);
+	const void* INDICES = Handle(7);
+
+	// everything a draw needs, then the draw - what GameEntity::Record() writes
+	void RecordDraw(CommandBuffer& commands, uint32_t d)
+	{
+		uint8_t constants[64];
+		memset(constants, (int)(d & 0xFF), sizeof(constants));
+		commands.SetVertexShader(VS, LAYOUT);
+		commands.SetPixelShader(PS);
+		commands.UpdateConstants(CONSTANTS, constants, sizeof(constants));
+		commands.SetConstantBuffer(ShaderStage::Vertex, 0, CONSTANTS);
+		commands.SetShaderResource(ShaderStage::Pixel, 0, Handle(8, d % 4));
+		commands.SetSampler(ShaderStage::Pixel, 0, Handle(9));
+		commands.SetVertexBuffer(0, VERTICES, 48);
+		commands.SetIndexBuffer(INDICES);
+		commands.DrawIndexed(36, d * 36, 0);
+	}
+
+	bool HasError(const ValidationCommandBackend& validation, const char* what)
+	{
+		for (const std::string& error : validation.GetErrors())
+			if (error.find(what) != std::string::npos) return true;
+		return false;
+	}
+}
+
+TEST(CommandBuffer, NullBackendCountsEachType)
+{
+	CommandBuffer commands;
+	for (uint32_t d = 0; d < 10; d++) RecordDraw(commands, d);
+	commands.SetVertexBuffer(1, INSTANCES, 64);
+	commands.DrawIndexedInstanced(36, 5, 0, 0, 0);
+
+	NullCommandBackend null;
+	null.Execute(commands);
+	CHECK(null.GetTotal() == commands.GetCount());
+	CHECK(null.GetTotal() == 10 * 9 + 2);
+	CHECK(null.GetBytes() == commands.GetSize());
+	CHECK(null.GetCount(CommandType::SetVertexShader) == 10);
+	CHECK(null.GetCount(CommandType::UpdateConstants) == 10);
+	CHECK(null.GetCount(CommandType::SetVertexBuffer) == 11);
+	CHECK(null.GetCount(CommandType::DrawIndexed) == 10);
+	CHECK(null.GetCount(CommandType::DrawIndexedInstanced) == 1);
+	CHECK(null.GetCount(CommandType::UpdateBuffer) == 0);
+
+	// counts add up over Execute() calls until Reset()
+	null.Execute(commands);
+	CHECK(null.GetCount(CommandType::DrawIndexed) == 20);
+	null.Reset();
+	CHECK(null.GetTotal() == 0 && null.GetBytes() == 0);
+}
+
+TEST(CommandBuffer, PacketsStayAligned)
+{
+	CommandBuffer commands;
+	uint8_t data[20] = {};
+	commands.UpdateBuffer(VERTICES, data, sizeof(data));
+	commands.SetPixelShader(PS);
+	commands.UpdateBuffer(VERTICES, data, 3);
+
+	uint32_t packets = 0;
+	size_t offset = 0;
+	commands.ForEach([&](const CommandBuffer::Header& header, const uint8_t* payload) {
+		CHECK(header.size % 8 == 0);
+		CHECK(payload == commands.GetData() + offset + sizeof(CommandBuffer::Header));
+		offset += header.size;
+		packets++;
+	});
+	CHECK(packets == 3);
+	CHECK(offset == commands.GetSize());
+}
+
+TEST(CommandBuffer, UpdatesCarryTheirData)
+{
+	CommandBuffer commands;
+	float data[4] = { 1, 2, 3, 4 };
+	commands.UpdateConstants(CONSTANTS, data, sizeof(data));
+	data[0] = 100;	// recording took a copy
+
+	commands.ForEach([&](const CommandBuffer::Header& header, const uint8_t* payload) {
+		CHECK(header.type == CommandType::UpdateConstants);
+		auto update = CommandBuffer::Read<CommandBuffer::UpdateData>(payload);
+		CHECK(update.buffer == CONSTANTS && update.size == sizeof(data));
+		float copy[4];
+		memcpy(copy, payload + sizeof(CommandBuffer::UpdateData), sizeof(copy));
+		CHECK(copy[0] == 1 && copy[3] == 4);
+	});
+}
+
+TEST(CommandBuffer, ParallelRecordingMatchesSerial)
+{
+	const uint32_t drawCount = 1000, chunks = 8, chunkSize = drawCount / chunks;
+	CommandBuffer serial;
+	for (uint32_t d = 0; d < drawCount; d++) RecordDraw(serial, d);
+
+	// the way Game::RecordMainPass() does it, a run of draws per buffer
+	std::vector<CommandBuffer> buffers(chunks);
+	ParallelFor(chunks, 4, [&](size_t c) {
+		for (uint32_t d = (uint32_t)c * chunkSize; d < (c + 1) * chunkSize; d++) RecordDraw(buffers[c], d);
+	});
+	CommandBuffer merged;
+	for (const CommandBuffer& buffer : buffers) merged.Append(buffer);
+
+	CHECK(merged.GetCount() == serial.GetCount());
+	CHECK(merged.GetSize() == serial.GetSize());
+	CHECK(memcmp(merged.GetData(), serial.GetData(), serial.GetSize()) == 0);
+
+	// Clear() keeps the memory, recording again gives the same bytes
+	merged.Clear();
+	CHECK(merged.GetCount() == 0 && merged.GetSize() == 0);
+	for (uint32_t d = 0; d < drawCount; d++) RecordDraw(merged, d);
+	CHECK(memcmp(merged.GetData(), serial.GetData(), serial.GetSize()) == 0);
+}
+
+TEST(CommandBuffer, ValidationPassesCompleteDraws)
+{
+	CommandBuffer commands;
+	for (uint32_t d = 0; d < 10; d++) RecordDraw(commands, d);
+	commands.SetVertexBuffer(1, INSTANCES, 64);
+	commands.DrawIndexedInstanced(36, 5, 0, 0, 0);
+
+	ValidationCommandBackend validation;
+	validation.Execute(commands);
+	CHECK(validation.GetErrorCount() == 0);
+	CHECK(validation.GetDraws() == 11);
+	CHECK(validation.GetCommands() == commands.GetCount());
+}
+
+TEST(CommandBuffer, ValidationCatchesMissingState)
+{
+	struct Case
+	{
+		const char* error;
+		void (*record)(CommandBuffer&);
+	};
+	const Case cases[] =
+	{
+		{ "no vertex shader", [](CommandBuffer& c) {
+			c.SetPixelShader(PS); c.SetVertexBuffer(0, VERTICES, 48); c.SetIndexBuffer(INDICES); c.DrawIndexed(3, 0, 0); } },
+		{ "no input layout", [](CommandBuffer& c) {
+			c.SetVertexShader(VS, nullptr); c.SetPixelShader(PS); c.SetVertexBuffer(0, VERTICES, 48); c.SetIndexBuffer(INDICES); c.DrawIndexed(3, 0, 0); } },
+		{ "no pixel shader", [](CommandBuffer& c) {
+			c.SetVertexShader(VS, LAYOUT); c.SetVertexBuffer(0, VERTICES, 48); c.SetIndexBuffer(INDICES); c.DrawIndexed(3, 0, 0); } },
+		{ "no vertex buffer", [](CommandBuffer& c) {
+			c.SetVertexShader(VS, LAYOUT); c.SetPixelShader(PS); c.SetIndexBuffer(INDICES); c.DrawIndexed(3, 0, 0); } },
+		{ "no index buffer", [](CommandBuffer& c) {
+			c.SetVertexShader(VS, LAYOUT); c.SetPixelShader(PS); c.SetVertexBuffer(0, VERTICES, 48); c.DrawIndexed(3, 0, 0); } },
+		{ "no instance buffer", [](CommandBuffer& c) {
+			RecordDraw(c, 0); c.DrawIndexedInstanced(36, 4, 0, 0, 0); } },
+		{ "draw with no indices", [](CommandBuffer& c) {
+			RecordDraw(c, 0); c.DrawIndexed(0, 0, 0); } },
+		{ "vertex buffer with no stride", [](CommandBuffer& c) {
+			c.SetVertexBuffer(0, VERTICES, 0); } },
+	};
+
+	for (const Case& test : cases) {
+		CommandBuffer commands;
+		test.record(commands);
+		ValidationCommandBackend validation;
+		validation.Execute(commands);
+		CHECK(validation.GetErrorCount() == 1);
+		CHECK(HasError(validation, test.error));
+	}
+}
+
+TEST(CommandBuffer, ValidationChecksConstantUpdates)
+{
+	uint8_t data[64] = {};
+	CommandBuffer commands;
+	commands.UpdateConstants(CONSTANTS, data, 64);
+	commands.UpdateConstants(CONSTANTS, data, 64);
+	commands.UpdateConstants(CONSTANTS, data, 32);		// size changed
+	commands.UpdateConstants(Handle(4, 1), data, 20);	// not a multiple of 16
+	commands.UpdateConstants(nullptr, data, 16);
+
+	ValidationCommandBackend validation;
+	validation.Execute(commands);
+	CHECK(validation.GetErrorCount() == 3);
+	CHECK(HasError(validation, "command 2: constant update size changed"));
+	CHECK(HasError(validation, "command 3: constant update size isn't a multiple of 16"));
+	CHECK(HasError(validation, "command 4: constant update with no buffer"));
+}
+
+TEST(CommandBuffer, ValidationChecksSlots)
+{
+	CommandBuffer commands;
+	commands.SetConstantBuffer(ShaderStage::Pixel, ValidationCommandBackend::MAX_CONSTANT_BUFFERS - 1, CONSTANTS);
+	commands.SetConstantBuffer(ShaderStage::Pixel, ValidationCommandBackend::MAX_CONSTANT_BUFFERS, CONSTANTS);
+	commands.SetShaderResource(ShaderStage::Pixel, ValidationCommandBackend::MAX_SHADER_RESOURCES, Handle(8));
+	commands.SetSampler(ShaderStage::Pixel, ValidationCommandBackend::MAX_SAMPLERS, Handle(9));
+	commands.SetVertexBuffer(ValidationCommandBackend::MAX_VERTEX_BUFFERS, VERTICES, 48);
+
+	ValidationCommandBackend validation;
+	validation.Execute(commands);
+	CHECK(validation.GetErrorCount() == 4);
+	CHECK(HasError(validation, "command 1: constant buffer slot out of range"));
+	CHECK(HasError(validation, "command 2: shader resource slot out of range"));
+	CHECK(HasError(validation, "command 3: sampler slot out of range"));
+	CHECK(HasError(validation, "command 4: vertex buffer slot out of range"));
+}
+
+TEST(CommandBuffer, ValidationStateCarriesOver)
+{
+	// state bound by one buffer is still there for the next, like a device
+	CommandBuffer binds, draw;
+	RecordDraw(binds, 0);
+	draw.DrawIndexed(36, 0, 0);
+
+	ValidationCommandBackend validation;
+	validation.Execute(binds);
+	validation.Execute(draw);
+	CHECK(validation.GetErrorCount() == 0);
+	CHECK(validation.GetDraws() == 2);
+
+	// until Reset()
+	validation.Reset();
+	validation.Execute(draw);
+	CHECK(validation.GetErrorCount() == 1);
+	CHECK(HasError(validation, "command 0: draw with no vertex shader"));
+}
+
+TEST(CommandBuffer, ValidationCatchesBadPackets)
+{
+	CommandBuffer commands;
+	commands.SetPixelShader(PS);
+	commands.SetIndexBuffer(INDICES);
+	commands.SetPixelShader(PS);
+
+	// a packet claiming to be something else of another size, and a
+	// type nobody knows - the buffer's own memory, changed in place
+	uint8_t* bytes = const_cast<uint8_t*>(commands.GetData());
+	CommandBuffer::Header header;
+	memcpy(&header, bytes, sizeof(header));
+	header.type = CommandType::SetIndexBuffer;
+	memcpy(bytes, &header, sizeof(header));
+
+	size_t second = header.size;
+	memcpy(&header, bytes + second, sizeof(header));
+	header.type = CommandType::Count;
+	memcpy(bytes + second, &header, sizeof(header));
+
+	ValidationCommandBackend validation;
+	validation.Execute(commands);
+	CHECK(validation.GetCommands() == 3);
+	CHECK(validation.GetErrorCount() == 2);
+	CHECK(HasError(validation, "command 0: packet size doesn't match its type"));
+	CHECK(HasError(validation, "command 1: unknown command type"));
+
+	// errors past MAX_ERRORS are counted but not kept
+	CommandBuffer many;
+	for (size_t i = 0; i < ValidationCommandBackend::MAX_ERRORS + 10; i++) many.DrawIndexed(3, 0, 0);
+	validation.Reset();
+	validation.Execute(many);
+	CHECK(validation.GetErrorCount() == ValidationCommandBackend::MAX_ERRORS + 10);
+	CHECK(validation.GetErrors().size() == ValidationCommandBackend::MAX_ERRORS);
+}
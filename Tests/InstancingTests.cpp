@@ -0,0 +1,136 @@
+#include "Tests.h"
+
+#include "Instancing.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// batches as lists of draws, to compare against what's expected
+	std::vector<std::vector<uint32_t>> Groups(const Instancing::Batches& out)
+	{
+		std::vector<std::vector<uint32_t>> groups;
+		for (const Instancing::Batch& batch : out.batches)
+			groups.emplace_back(out.draws.begin() + batch.first, out.draws.begin() + batch.first + batch.count);
+		return groups;
+	}
+
+	// every draw once, batches back to back, each one key and no NO_BATCH
+	// draw sharing - the shape Game::DrawEntities() relies on
+	void CheckShape(const uint64_t* keys, size_t count, uint32_t maxInstances, const Instancing::Batches& out)
+	{
+		std::vector<int> seen(count, 0);
+		for (uint32_t d : out.draws) seen[d]++;
+		for (int s : seen) CHECK(s == 1);
+
+		uint32_t next = 0;
+		for (const Instancing::Batch& batch : out.batches) {
+			CHECK(batch.first == next);
+			CHECK(batch.count > 0 && batch.count <= maxInstances);
+			next += batch.count;
+			for (uint32_t k = batch.first + 1; k < batch.first + batch.count; k++) {
+				CHECK(keys[out.draws[k]] == keys[out.draws[batch.first]]);
+				CHECK(keys[out.draws[k]] != Instancing::NO_BATCH);
+				CHECK(out.draws[k] > out.draws[k - 1]);
+			}
+		}
+		CHECK(next == count);
+	}
+}
+
+TEST(Instancing, GroupsByMeshMaterialAndLOD)
+{
+	const uint64_t sphereStone = Instancing::MakeKey(1, 1, 0);
+	const uint64_t sphereWood = Instancing::MakeKey(2, 1, 0);
+	const uint64_t cubeStone = Instancing::MakeKey(1, 2, 0);
+	const uint64_t sphereStoneFar = Instancing::MakeKey(1, 1, 2);
+	CHECK(sphereStone != sphereWood && sphereStone != cubeStone && sphereStone != sphereStoneFar && sphereWood != cubeStone);
+
+	const uint64_t keys[] = { sphereStone, cubeStone, sphereStone, sphereWood, sphereStoneFar, cubeStone, sphereStone, sphereWood };
+	Instancing::Batches out;
+	Instancing::Stats stats = Instancing::Build(keys, 8, 1024, out);
+
+	// in the order each batch's first draw comes
+	std::vector<std::vector<uint32_t>> expected = { { 0, 2, 6 }, { 1, 5 }, { 3, 7 }, { 4 } };
+	CHECK(Groups(out) == expected);
+	CheckShape(keys, 8, 1024, out);
+
+	CHECK(stats.draws == 8);
+	CHECK(stats.batches == 4);
+	CHECK(stats.instanced == 7);
+	CHECK(stats.largest == 3);
+}
+
+TEST(Instancing, NoBatchDrawsStayAlone)
+{
+	const uint64_t sphere = Instancing::MakeKey(1, 1, 0);
+	const uint64_t keys[] = { Instancing::NO_BATCH, sphere, Instancing::NO_BATCH, Instancing::NO_BATCH, sphere };
+	Instancing::Batches out;
+	Instancing::Stats stats = Instancing::Build(keys, 5, 1024, out);
+
+	// NO_BATCH never groups, not even with another NO_BATCH draw
+	std::vector<std::vector<uint32_t>> expected = { { 0 }, { 1, 4 }, { 2 }, { 3 } };
+	CHECK(Groups(out) == expected);
+	CHECK(stats.batches == 4);
+	CHECK(stats.instanced == 2);
+}
+
+TEST(Instancing, BigGroupsSplit)
+{
+	std::vector<uint64_t> keys(10, Instancing::MakeKey(3, 4, 1));
+	Instancing::Batches out;
+	Instancing::Stats stats = Instancing::Build(keys.data(), keys.size(), 4, out);
+
+	std::vector<std::vector<uint32_t>> expected = { { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 8, 9 } };
+	CHECK(Groups(out) == expected);
+	CHECK(stats.largest == 4);
+	CHECK(stats.instanced == 10);
+
+	// no room at all is one per batch
+	Instancing::Build(keys.data(), keys.size(), 0, out);
+	CHECK(out.batches.size() == keys.size());
+}
+
+TEST(Instancing, RandomDrawsKeepTheirShape)
+{
+	for (auto [drawCount, groupCount] : { std::pair{ 100, 10 }, std::pair{ 10000, 14 }, std::pair{ 10000, 1000 } }) {
+		std::mt19937 rng(1234);
+		std::vector<uint64_t> keys(drawCount);
+		for (uint64_t& key : keys)
+			key = rng() % 10 == 0 ? Instancing::NO_BATCH : Instancing::MakeKey(rng() % groupCount, rng() % 3, 0);
+
+		Instancing::Batches out;
+		Instancing::Build(keys.data(), keys.size(), 64, out);
+		CheckShape(keys.data(), keys.size(), 64, out);
+	}
+}
+
+TEST(Instancing, PackCopiesEachEntitysMatrices)
+{
+	const size_t count = 16;
+	std::vector<XMFLOAT4X4> worlds(count), worldITs(count);
+	std::vector<PerObjectData> objects(count);
+	for (size_t e = 0; e < count; e++) {
+		XMMATRIX world = XMMatrixScaling(1.0f + e, 2.0f, 3.0f) * XMMatrixTranslation((float)e, -(float)e, 0.5f * e);
+		XMStoreFloat4x4(&worlds[e], world);
+		XMStoreFloat4x4(&worldITs[e], XMMatrixInverse(nullptr, XMMatrixTranspose(world)));
+		XMStoreFloat4x4(&objects[e].worldViewProj, world * XMMatrixScaling(0.5f, 0.5f, 0.5f));
+		XMStoreFloat4x4(&objects[e].lightWorldViewProj, world * XMMatrixTranslation(1, 2, 3));
+	}
+
+	// a batch's draws point at entities in any order
+	const uint32_t entities[] = { 7, 3, 15, 0, 3 };
+	InstanceData instances[5];
+	Instancing::Pack(entities, 5, worlds.data(), worldITs.data(), objects.data(), instances);
+	for (size_t k = 0; k < 5; k++) {
+		uint32_t e = entities[k];
+		CHECK(memcmp(&instances[k].world, &worlds[e], sizeof(XMFLOAT4X4)) == 0);
+		CHECK(memcmp(&instances[k].worldInverseTranspose, &worldITs[e], sizeof(XMFLOAT4X4)) == 0);
+		CHECK(memcmp(&instances[k].worldViewProj, &objects[e].worldViewProj, sizeof(XMFLOAT4X4)) == 0);
+		CHECK(memcmp(&instances[k].lightWorldViewProj, &objects[e].lightWorldViewProj, sizeof(XMFLOAT4X4)) == 0);
+	}
+}
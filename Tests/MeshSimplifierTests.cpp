@@ -0,0 +1,215 @@
+#include "Tests.h"
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// a height field with random bumps, open on all four sides
+	MeshData BumpyGrid(int size)
+	{
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> bump(-0.2f, 0.2f);
+		MeshData data;
+		for (int z = 0; z <= size; z++) {
+			for (int x = 0; x <= size; x++) {
+				Vertex v = {};
+				v.Position = XMFLOAT3((float)x, sinf(x * 0.4f) * cosf(z * 0.3f) * 2.0f + bump(rng), (float)z);
+				v.UV = XMFLOAT2((float)x / size, (float)z / size);
+				v.Normal = XMFLOAT3(0, 1, 0);
+				v.Tangent = XMFLOAT3(1, 0, 0);
+				data.vertices.push_back(v);
+			}
+		}
+		for (int z = 0; z < size; z++) {
+			for (int x = 0; x < size; x++) {
+				unsigned int i = z * (size + 1) + x;
+				data.indices.insert(data.indices.end(), { i, i + size + 1, i + 1, i + 1, i + size + 1, i + size + 2 });
+			}
+		}
+		return data;
+	}
+
+	// a closed uv sphere, with a uv seam down one side
+	MeshData Sphere(int columns, int rows)
+	{
+		MeshData data;
+		for (int r = 0; r <= rows; r++) {
+			for (int c = 0; c <= columns; c++) {
+				float theta = XM_PI * r / rows;
+				float phi = XM_2PI * (c % columns) / columns;
+				Vertex v = {};
+				v.Normal = XMFLOAT3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+				v.Position = XMFLOAT3(v.Normal.x * 3.0f, v.Normal.y * 3.0f, v.Normal.z * 3.0f);
+				v.UV = XMFLOAT2((float)c / columns, (float)r / rows);
+				v.Tangent = XMFLOAT3(-sinf(phi), 0, cosf(phi));
+				data.vertices.push_back(v);
+			}
+		}
+		for (int r = 0; r < rows; r++) {
+			for (int c = 0; c < columns; c++) {
+				unsigned int i = r * (columns + 1) + c;
+				unsigned int below = i + columns + 1;
+				if (r > 0) data.indices.insert(data.indices.end(), { i, i + 1, below });
+				if (r < rows - 1) data.indices.insert(data.indices.end(), { i + 1, below + 1, below });
+			}
+		}
+		return data;
+	}
+
+	// closest point on a triangle (Ericson, Real-Time Collision Detection 5.1.5)
+	XMVECTOR ClosestPoint(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+	{
+		XMVECTOR ab = b - a, ac = c - a, ap = p - a;
+		float d1 = XMVectorGetX(XMVector3Dot(ab, ap)), d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+		if (d1 <= 0 && d2 <= 0) return a;
+
+		XMVECTOR bp = p - b;
+		float d3 = XMVectorGetX(XMVector3Dot(ab, bp)), d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+		if (d3 >= 0 && d4 <= d3) return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0) return a + ab * (d1 / (d1 - d3));
+
+		XMVECTOR cp = p - c;
+		float d5 = XMVectorGetX(XMVector3Dot(ab, cp)), d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+		if (d6 >= 0 && d5 <= d6) return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0) return a + ac * (d2 / (d2 - d6));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		float denominator = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	// furthest any full mesh vertex is from the level's triangles
+	float DistanceToLOD(const MeshData& data, const std::vector<unsigned int>& full, const MeshLOD& lod)
+	{
+		float furthest = 0;
+		for (unsigned int v : full) {
+			XMVECTOR p = XMLoadFloat3(&data.vertices[v].Position);
+			float nearest = FLT_MAX;
+			for (uint32_t t = lod.indexOffset; t < lod.indexOffset + lod.indexCount; t += 3) {
+				XMVECTOR q = ClosestPoint(p,
+					XMLoadFloat3(&data.vertices[data.indices[t]].Position),
+					XMLoadFloat3(&data.vertices[data.indices[t + 1]].Position),
+					XMLoadFloat3(&data.vertices[data.indices[t + 2]].Position));
+				nearest = (std::min)(nearest, XMVectorGetX(XMVector3LengthSq(p - q)));
+			}
+			furthest = (std::max)(furthest, sqrtf(nearest));
+		}
+		return furthest;
+	}
+
+	void CheckChain(MeshData data, unsigned int levelCount)
+	{
+		std::vector<unsigned int> full = data.indices;
+		std::vector<MeshLOD> lods;
+		MeshSimplifier::LODStats stats = MeshSimplifier::GenerateLODs(data.vertices, data.indices, levelCount, 0.5f, true, lods);
+		CHECK(stats.levels == lods.size());
+		CHECK(lods.size() >= 3);
+
+		// LOD 0 is the untouched mesh, then levels back to back, each smaller
+		CHECK(lods[0].indexOffset == 0 && lods[0].indexCount == full.size() && lods[0].error == 0.0f);
+		CHECK(std::equal(full.begin(), full.end(), data.indices.begin()));
+		for (size_t i = 1; i < lods.size(); i++) {
+			CHECK(lods[i].indexOffset == lods[i - 1].indexOffset + lods[i - 1].indexCount);
+			CHECK(lods[i].indexCount < lods[i - 1].indexCount && lods[i].indexCount % 3 == 0);
+			CHECK(lods[i].error >= lods[i - 1].error);
+		}
+		CHECK(lods.back().indexOffset + lods.back().indexCount == data.indices.size());
+
+		// the reported error bounds how far the full mesh is from each
+		// level, without giving up and going past the mesh's own size
+		XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX), boundsMax = XMVectorReplicate(-FLT_MAX);
+		for (const Vertex& v : data.vertices) {
+			boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&v.Position));
+			boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&v.Position));
+		}
+		float diagonal = XMVectorGetX(XMVector3Length(boundsMax - boundsMin));
+		for (size_t i = 1; i < lods.size(); i++) {
+			float distance = DistanceToLOD(data, full, lods[i]);
+			CHECK(distance <= lods[i].error * (1.0f + 1e-5f) + 1e-5f);
+			CHECK(lods[i].error <= diagonal);
+		}
+	}
+}
+
+TEST(MeshSimplifier, ErrorBoundsOpenMesh)
+{
+	CheckChain(BumpyGrid(24), 5);
+}
+
+TEST(MeshSimplifier, ErrorBoundsLostSpike)
+{
+	// a flat grid simplifies for free until the spike in the middle goes,
+	// which happens by its neighbours collapsing past it rather than it
+	// collapsing onto one of them
+	MeshData data = BumpyGrid(16);
+	for (Vertex& v : data.vertices) v.Position.y = 0;
+	data.vertices[8 * 17 + 8].Position.y = 4.0f;
+	CheckChain(data, 6);
+}
+
+TEST(MeshSimplifier, ErrorBoundsLostDebris)
+{
+	// a ground grid with loose triangles scattered above it, the
+	// simplifier drops whole ones, which leaves their corners on nothing
+	MeshData data = BumpyGrid(16);
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> spot(0.0f, 16.0f);
+	for (int piece = 0; piece < 400; piece++) {
+		unsigned int first = (unsigned int)data.vertices.size();
+		XMFLOAT3 corner(spot(rng), 3.0f + spot(rng) * 0.25f, spot(rng));
+		for (XMFLOAT3 offset : { XMFLOAT3(0, 0, 0), XMFLOAT3(0.1f, 0, 0), XMFLOAT3(0, 0.05f, 0.1f) }) {
+			Vertex v = {};
+			v.Position = XMFLOAT3(corner.x + offset.x, corner.y + offset.y, corner.z + offset.z);
+			v.Normal = XMFLOAT3(0, 1, 0);
+			v.Tangent = XMFLOAT3(1, 0, 0);
+			data.vertices.push_back(v);
+		}
+		data.indices.insert(data.indices.end(), { first, first + 1, first + 2 });
+	}
+	CheckChain(data, 5);
+}
+
+TEST(MeshSimplifier, ErrorBoundsClosedMeshWithSeam)
+{
+	CheckChain(Sphere(32, 16), 4);
+}
+
+TEST(MeshSimplifier, CollapsedToFollowsTheCollapses)
+{
+	MeshData data = BumpyGrid(16);
+	std::vector<unsigned int> out, collapsedTo;
+	MeshSimplifier::Simplify(data.vertices, data.indices, data.indices.size() / 4, FLT_MAX, out, &collapsedTo);
+	CHECK(out.size() < data.indices.size());
+	CHECK(collapsedTo.size() == data.vertices.size());
+
+	// vertices the result still uses stay put, the rest land on one that
+	// stayed put, and it's the collapses that took them out of the result
+	std::vector<unsigned char> used(data.vertices.size(), 0);
+	for (unsigned int index : out) used[index] = 1;
+	size_t moved = 0;
+	for (unsigned int v = 0; v < collapsedTo.size(); v++) {
+		if (used[v]) CHECK(collapsedTo[v] == v);
+		CHECK(collapsedTo[collapsedTo[v]] == collapsedTo[v]);
+		if (collapsedTo[v] != v) moved++;
+	}
+	CHECK(moved > 0);
+
+	// nothing to do leaves everything where it was
+	MeshSimplifier::Simplify(data.vertices, data.indices, data.indices.size(), FLT_MAX, out, &collapsedTo);
+	for (unsigned int v = 0; v < collapsedTo.size(); v++) CHECK(collapsedTo[v] == v);
+}
+
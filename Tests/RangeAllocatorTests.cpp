@@ -0,0 +1,167 @@
+#include "Tests.h"
+
+#include "RangeAllocator.h"
+
+#include <random>
+#include <vector>
+
+TEST(RangeAllocator, AllocatesInOrder)
+{
+	RangeAllocator allocator(100);
+	CHECK(allocator.Allocate(10) == 0);
+	CHECK(allocator.Allocate(20) == 10);
+	CHECK(allocator.Allocate(70) == 30);
+	CHECK(allocator.Allocate(1) == RangeAllocator::INVALID_OFFSET);	// full
+	CHECK(allocator.Allocate(0) == RangeAllocator::INVALID_OFFSET);
+	CHECK(allocator.Validate());
+
+	RangeAllocator::Stats stats = allocator.GetStats();
+	CHECK(stats.capacity == 100 && stats.used == 100);
+	CHECK(stats.allocations == 3);
+	CHECK(stats.freeBlocks == 0 && stats.largestFreeBlock == 0);
+	CHECK(stats.fragmentation == 0.0f);
+}
+
+TEST(RangeAllocator, FreeOnlyTakesAllocations)
+{
+	RangeAllocator allocator(100);
+	uint32_t a = allocator.Allocate(10);
+	allocator.Allocate(10);
+	CHECK(!allocator.Free(5));		// inside a range, not its start
+	CHECK(!allocator.Free(50));		// free space
+	CHECK(allocator.Free(a));
+	CHECK(!allocator.Free(a));		// twice
+	CHECK(allocator.GetStats().used == 10);
+	CHECK(allocator.Validate());
+}
+
+TEST(RangeAllocator, FreedRangesCoalesce)
+{
+	// [a][b][c][d][rest], freed so each kind of merge happens once
+	RangeAllocator allocator(100);
+	uint32_t a = allocator.Allocate(10);
+	uint32_t b = allocator.Allocate(10);
+	uint32_t c = allocator.Allocate(10);
+	uint32_t d = allocator.Allocate(10);
+	CHECK(allocator.GetStats().freeBlocks == 1);
+
+	// no free neighbours, a hole of its own
+	CHECK(allocator.Free(b));
+	CHECK(allocator.GetStats().freeBlocks == 2);
+	CHECK(allocator.Validate());
+
+	// free on the left, merges with b
+	CHECK(allocator.Free(c));
+	CHECK(allocator.GetStats().freeBlocks == 2);
+	CHECK(allocator.GetStats().largestFreeBlock == 60);
+	CHECK(allocator.Validate());
+
+	// free on the right, merges with b + c
+	CHECK(allocator.Free(a));
+	CHECK(allocator.GetStats().freeBlocks == 2);
+	CHECK(allocator.Validate());
+
+	// free on both sides, everything is one block again
+	CHECK(allocator.Free(d));
+	RangeAllocator::Stats stats = allocator.GetStats();
+	CHECK(stats.freeBlocks == 1 && stats.largestFreeBlock == 100);
+	CHECK(stats.used == 0 && stats.allocations == 0);
+	CHECK(allocator.Validate());
+	CHECK(allocator.Allocate(100) == 0);
+}
+
+TEST(RangeAllocator, BestFitKeepsBigHoles)
+{
+	// holes of 30, 10 and 20 between allocations
+	RangeAllocator allocator(100);
+	uint32_t hole30 = allocator.Allocate(30);
+	allocator.Allocate(5);
+	uint32_t hole10 = allocator.Allocate(10);
+	allocator.Allocate(5);
+	uint32_t hole20 = allocator.Allocate(20);
+	allocator.Allocate(30);
+	allocator.Free(hole30);
+	allocator.Free(hole10);
+	allocator.Free(hole20);
+
+	CHECK(allocator.Allocate(8) == hole10);		// smallest that fits
+	CHECK(allocator.Allocate(20) == hole20);	// exact
+	CHECK(allocator.Allocate(25) == hole30);
+	CHECK(allocator.Allocate(6) == RangeAllocator::INVALID_OFFSET);
+	CHECK(allocator.Validate());
+}
+
+TEST(RangeAllocator, FragmentationStats)
+{
+	// 40 free in holes of 10 and 30: the largest holds 3/4 of it
+	RangeAllocator allocator(100);
+	uint32_t a = allocator.Allocate(10);
+	allocator.Allocate(60);
+	allocator.Free(a);
+
+	RangeAllocator::Stats stats = allocator.GetStats();
+	CHECK(stats.freeBlocks == 2);
+	CHECK(stats.largestFreeBlock == 30);
+	CHECK(stats.fragmentation == 0.25f);
+}
+
+TEST(RangeAllocator, GrowJoinsTheLastHole)
+{
+	RangeAllocator allocator(100);
+	allocator.Allocate(90);
+	CHECK(allocator.Allocate(20) == RangeAllocator::INVALID_OFFSET);
+
+	// [90, 100) and the new [100, 200) are one block
+	allocator.Grow(200);
+	CHECK(allocator.GetCapacity() == 200);
+	CHECK(allocator.GetStats().freeBlocks == 1);
+	CHECK(allocator.Allocate(110) == 90);
+	CHECK(allocator.Validate());
+
+	allocator.Grow(150);	// never shrinks
+	CHECK(allocator.GetCapacity() == 200);
+
+	// growing an empty allocator
+	RangeAllocator empty;
+	CHECK(empty.Allocate(1) == RangeAllocator::INVALID_OFFSET);
+	empty.Grow(16);
+	CHECK(empty.Allocate(16) == 0);
+	CHECK(empty.Validate());
+}
+
+TEST(RangeAllocator, RandomUseStaysValid)
+{
+	// random mesh sized allocations and frees, growing like GeometryPool does
+	RangeAllocator allocator(1 << 16);
+	std::vector<uint32_t> live;
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<uint32_t> size(1, 4096);
+
+	bool valid = true;
+	for (int op = 0; op < 5000; op++) {
+		if (!live.empty() && rng() % 5 < 2) {
+			size_t pick = rng() % live.size();
+			valid &= allocator.Free(live[pick]);
+			live[pick] = live.back();
+			live.pop_back();
+		}
+		else {
+			uint32_t count = size(rng);
+			uint32_t offset = allocator.Allocate(count);
+			if (offset == RangeAllocator::INVALID_OFFSET) {
+				allocator.Grow(allocator.GetCapacity() * 2 + count);
+				offset = allocator.Allocate(count);
+			}
+			valid &= offset != RangeAllocator::INVALID_OFFSET;
+			live.push_back(offset);
+		}
+		valid &= allocator.Validate();
+	}
+	CHECK(valid);
+	CHECK(allocator.GetStats().allocations == live.size());
+
+	// and everything coalesces back into one block
+	for (uint32_t offset : live) CHECK(allocator.Free(offset));
+	RangeAllocator::Stats stats = allocator.GetStats();
+	CHECK(stats.used == 0 && stats.freeBlocks == 1 && stats.largestFreeBlock == stats.capacity);
+}
@@ -0,0 +1,191 @@
+#include "Tests.h"
+
+#include "ShadowCascades.h"
+
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	const float NEAR_CLIP = 0.1f;
+	const float FAR_CLIP = 100.0f;
+	const unsigned int RESOLUTION = 1024;
+
+	// a light at an angle
+	const XMFLOAT3 LIGHT_DIRECTION(0.3f, -1.0f, 0.2f);
+	const XMFLOAT3 LIGHT_UP(0, 0, 1);
+
+	XMFLOAT4X4 Projection(bool perspective)
+	{
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&projection, perspective ?
+			XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, NEAR_CLIP, FAR_CLIP) :
+			XMMatrixOrthographicLH(30.0f, 30.0f * 9.0f / 16.0f, NEAR_CLIP, FAR_CLIP));
+		return projection;
+	}
+
+	XMFLOAT4X4 View(XMVECTOR position, XMVECTOR forward)
+	{
+		XMFLOAT4X4 view;
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(position, XMVector3Normalize(forward), XMVectorSet(0, 1, 0, 0)));
+		return view;
+	}
+
+	// world space corner k of the camera's frustum between two view depths
+	XMVECTOR SliceCorner(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float splitNear, float splitFar, int k)
+	{
+		XMMATRIX inverseProjection = XMMatrixInverse(nullptr, XMLoadFloat4x4(&projection));
+		float x = (k & 1) ? 1.0f : -1.0f;
+		float y = (k & 2) ? 1.0f : -1.0f;
+		XMVECTOR nearCorner = XMVector3TransformCoord(XMVectorSet(x, y, 0, 1), inverseProjection);
+		XMVECTOR farCorner = XMVector3TransformCoord(XMVectorSet(x, y, 1, 1), inverseProjection);
+		float depth = (k & 4) ? splitFar : splitNear;
+		float t = (depth - XMVectorGetZ(nearCorner)) / (XMVectorGetZ(farCorner) - XMVectorGetZ(nearCorner));
+		return XMVector3TransformCoord(XMVectorLerp(nearCorner, farCorner, t), XMMatrixInverse(nullptr, XMLoadFloat4x4(&view)));
+	}
+}
+
+TEST(ShadowCascades, SplitsIncreaseAndCoverTheRange)
+{
+	float splits[ShadowCascades::MAX_CASCADES + 1];
+	for (unsigned int count = 1; count <= ShadowCascades::MAX_CASCADES; count++) {
+		for (float lambda : { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f }) {
+			ShadowCascades::ComputeSplits(NEAR_CLIP, FAR_CLIP, count, lambda, splits);
+
+			// exact ends, so the cascades cover the whole range with no gap
+			CHECK(splits[0] == NEAR_CLIP);
+			CHECK(splits[count] == FAR_CLIP);
+			for (unsigned int i = 1; i <= count; i++) CHECK(splits[i] > splits[i - 1]);
+		}
+	}
+
+	// more logarithmic pulls every inner split closer
+	float uniform[ShadowCascades::MAX_CASCADES + 1], blended[ShadowCascades::MAX_CASCADES + 1];
+	ShadowCascades::ComputeSplits(NEAR_CLIP, FAR_CLIP, ShadowCascades::MAX_CASCADES, 0.0f, uniform);
+	ShadowCascades::ComputeSplits(NEAR_CLIP, FAR_CLIP, ShadowCascades::MAX_CASCADES, 0.5f, blended);
+	ShadowCascades::ComputeSplits(NEAR_CLIP, FAR_CLIP, ShadowCascades::MAX_CASCADES, 1.0f, splits);
+	for (unsigned int i = 1; i < ShadowCascades::MAX_CASCADES; i++)
+		CHECK(splits[i] < blended[i] && blended[i] < uniform[i]);
+}
+
+TEST(ShadowCascades, SplitsMatchTheirSchemes)
+{
+	float splits[ShadowCascades::MAX_CASCADES + 1];
+	for (float lambda : { 0.0f, 1.0f }) {
+		ShadowCascades::ComputeSplits(NEAR_CLIP, FAR_CLIP, ShadowCascades::MAX_CASCADES, lambda, splits);
+		for (unsigned int i = 0; i <= ShadowCascades::MAX_CASCADES; i++) {
+			double f = (double)i / ShadowCascades::MAX_CASCADES;
+			double expected = lambda == 0.0f ? NEAR_CLIP + (FAR_CLIP - NEAR_CLIP) * f : NEAR_CLIP * pow(FAR_CLIP / NEAR_CLIP, f);
+			CHECK(fabs(splits[i] - expected) / expected <= 1e-5);
+		}
+	}
+}
+
+TEST(ShadowCascades, FitHoldsItsSlice)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	float splits[ShadowCascades::MAX_CASCADES + 1];
+	ShadowCascades::ComputeSplits(NEAR_CLIP, FAR_CLIP, ShadowCascades::MAX_CASCADES, 0.75f, splits);
+
+	for (bool perspective : { true, false }) {
+		XMFLOAT4X4 projection = Projection(perspective);
+		for (int trial = 0; trial < 50; trial++) {
+			XMFLOAT4X4 view = View(XMVectorSet(dist(rng) * 50.0f, dist(rng) * 10.0f, dist(rng) * 50.0f, 0),
+				XMVectorSet(dist(rng), dist(rng) * 0.5f, dist(rng), 0));
+
+			for (unsigned int c = 0; c < ShadowCascades::MAX_CASCADES; c++) {
+				ShadowCascades::Cascade cascade = ShadowCascades::Fit(view, projection, splits[c], splits[c + 1],
+					LIGHT_DIRECTION, LIGHT_UP, RESOLUTION);
+				CHECK(cascade.splitNear == splits[c] && cascade.splitFar == splits[c + 1]);
+				CHECK(cascade.texelSize == 2.0f * cascade.radius / RESOLUTION);
+
+				// every corner of the slice lands inside the box, clip x, y in
+				// [-1, 1] and z in [0, 1], so the cascades cover the view between them
+				XMMATRIX viewProjection = XMLoadFloat4x4(&cascade.viewProjection);
+				for (int k = 0; k < 8; k++) {
+					XMFLOAT3 clip;
+					XMStoreFloat3(&clip, XMVector3TransformCoord(SliceCorner(view, projection, splits[c], splits[c + 1], k), viewProjection));
+					CHECK(fabsf(clip.x) <= 1.0f && fabsf(clip.y) <= 1.0f);
+					CHECK(clip.z >= -1e-5f && clip.z <= 1.0f + 1e-5f);
+				}
+			}
+		}
+	}
+}
+
+TEST(ShadowCascades, FitIsStable)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	float splits[ShadowCascades::MAX_CASCADES + 1];
+	ShadowCascades::ComputeSplits(NEAR_CLIP, FAR_CLIP, ShadowCascades::MAX_CASCADES, 0.75f, splits);
+
+	for (bool perspective : { true, false }) {
+		XMFLOAT4X4 projection = Projection(perspective);
+		for (int trial = 0; trial < 50; trial++) {
+			XMVECTOR position = XMVectorSet(dist(rng) * 50.0f, dist(rng) * 10.0f, dist(rng) * 50.0f, 0);
+			XMVECTOR forward = XMVectorSet(dist(rng), dist(rng) * 0.5f, dist(rng), 0);
+			XMFLOAT4X4 view = View(position, forward);
+
+			// the same spot looking somewhere else, and nudged a fraction of a texel
+			XMFLOAT4X4 turned = View(position, XMVectorSet(dist(rng), dist(rng) * 0.5f, dist(rng), 0));
+			XMFLOAT4X4 nudged = View(position + XMVectorSet(dist(rng), dist(rng), dist(rng), 0) * 0.01f, forward);
+
+			for (unsigned int c = 0; c < ShadowCascades::MAX_CASCADES; c++) {
+				auto fit = [&](const XMFLOAT4X4& v) {
+					return ShadowCascades::Fit(v, projection, splits[c], splits[c + 1], LIGHT_DIRECTION, LIGHT_UP, RESOLUTION);
+				};
+				ShadowCascades::Cascade cascade = fit(view);
+
+				// turning doesn't resize the box, past the 1/16 it rounds up to
+				CHECK(fabsf(fit(turned).radius - cascade.radius) <= 0.0625f);
+
+				// moving shifts it by whole texels
+				ShadowCascades::Cascade moved = fit(nudged);
+				if (moved.radius != cascade.radius) continue;
+				for (int a = 0; a < 2; a++) {
+					double texels = (moved.view.m[3][a] - cascade.view.m[3][a]) / cascade.texelSize;
+					CHECK(fabs(texels - round(texels)) <= 0.05);
+				}
+			}
+		}
+	}
+}
+
+TEST(ShadowCascades, ClipTransformMatchesEachCascade)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	float splits[ShadowCascades::MAX_CASCADES + 1];
+	ShadowCascades::ComputeSplits(NEAR_CLIP, FAR_CLIP, ShadowCascades::MAX_CASCADES, 0.75f, splits);
+
+	for (bool perspective : { true, false }) {
+		XMFLOAT4X4 projection = Projection(perspective);
+		for (int trial = 0; trial < 20; trial++) {
+			XMVECTOR position = XMVectorSet(dist(rng) * 50.0f, dist(rng) * 10.0f, dist(rng) * 50.0f, 0);
+			XMFLOAT4X4 view = View(position, XMVectorSet(dist(rng), dist(rng) * 0.5f, dist(rng), 0));
+
+			ShadowCascades::Cascade cascades[ShadowCascades::MAX_CASCADES];
+			for (unsigned int c = 0; c < ShadowCascades::MAX_CASCADES; c++)
+				cascades[c] = ShadowCascades::Fit(view, projection, splits[c], splits[c + 1], LIGHT_DIRECTION, LIGHT_UP, RESOLUTION);
+
+			// the shaders' route from cascade 0's clip space to each of the others
+			for (unsigned int c = 0; c < ShadowCascades::MAX_CASCADES; c++) {
+				XMFLOAT4 scale, offset;
+				ShadowCascades::GetClipTransform(cascades[0], cascades[c], scale, offset);
+				for (int k = 0; k < 8; k++) {
+					XMVECTOR world = position + XMVectorSet(dist(rng), dist(rng), dist(rng), 0) * 40.0f;
+					XMFLOAT3 from, to;
+					XMStoreFloat3(&from, XMVector3TransformCoord(world, XMLoadFloat4x4(&cascades[0].viewProjection)));
+					XMStoreFloat3(&to, XMVector3TransformCoord(world, XMLoadFloat4x4(&cascades[c].viewProjection)));
+					CHECK(fabsf(from.x * scale.x + offset.x - to.x) <= 1e-4f);
+					CHECK(fabsf(from.y * scale.y + offset.y - to.y) <= 1e-4f);
+					CHECK(fabsf(from.z * scale.z + offset.z - to.z) <= 1e-4f);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,149 @@
+#include "Tests.h"
+
+#include "FrustumCulling.h"
+
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// what TransformSystem::IsAVXSupported() asks, without its dependencies
+	bool CanRunAVX()
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+#else
+		return __builtin_cpu_supports("avx");
+#endif
+	}
+
+	// light 20 units above the origin looking straight down, 20 x 20
+	// units across and 5 to 100 deep, so the volume is x, z in
+	// [-10, 10] and y in [-80, 15] - with a reach of 5 casters count
+	// up to the light at y = 20
+	const float REACH = 5.0f;
+
+	XMFLOAT4X4 LightViewProjection()
+	{
+		XMFLOAT4X4 lightViewProjection;
+		XMStoreFloat4x4(&lightViewProjection,
+			XMMatrixLookToLH(XMVectorSet(0, 20, 0, 0), XMVectorSet(0, -1, 0, 0), XMVectorSet(0, 0, 1, 0)) *
+			XMMatrixOrthographicLH(20.0f, 20.0f, 5.0f, 100.0f));
+		return lightViewProjection;
+	}
+
+	// unit spheres at known spots and whether each should be kept
+	struct Caster
+	{
+		XMFLOAT3 position;
+		bool inVolume;		// by the light's frustum itself
+		bool inReach;		// only once it's stretched toward the light
+	};
+
+	std::vector<Caster> Layout()
+	{
+		std::vector<Caster> layout;
+		for (float x : { -5.0f, 0.0f, 5.0f })
+			for (float z : { -5.0f, 0.0f, 5.0f })
+				layout.push_back({ XMFLOAT3(x, 0, z), true, false });	// on the ground under the light
+		layout.push_back({ XMFLOAT3(10.5f, 0, 0), true, false });		// straddling the edge
+		layout.push_back({ XMFLOAT3(0, -80.5f, 0), true, false });		// straddling the far plane
+		layout.push_back({ XMFLOAT3(0, 18, 0), false, true });			// between the light and the near plane
+		layout.push_back({ XMFLOAT3(5, 16.5f, -5), false, true });
+		layout.push_back({ XMFLOAT3(0, 40, 0), false, false });			// behind the light
+		layout.push_back({ XMFLOAT3(15, 0, 0), false, false });			// off each side
+		layout.push_back({ XMFLOAT3(-15, 0, 0), false, false });
+		layout.push_back({ XMFLOAT3(0, 0, 15), false, false });
+		layout.push_back({ XMFLOAT3(0, 0, -15), false, false });
+		layout.push_back({ XMFLOAT3(0, -85, 0), false, false });		// past the far plane
+		layout.push_back({ XMFLOAT3(15, 18, 0), false, false });		// above the near plane but off the side
+		return layout;
+	}
+
+	FrustumCulling::Spheres Bounds(const std::vector<Caster>& layout)
+	{
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+		FrustumCulling::Spheres spheres;
+		spheres.Resize(layout.size());
+		for (size_t i = 0; i < layout.size(); i++) spheres.Set(i, layout[i].position, 1.0f, identity);
+		return spheres;
+	}
+
+	// kept[i] for each caster, checking the SSE and AVX paths agree
+	std::vector<bool> Cull(const FrustumCulling::Planes& planes, const FrustumCulling::Spheres& spheres)
+	{
+		std::vector<uint32_t> visible;
+		FrustumCulling::CullStats stats = FrustumCulling::Cull(planes, spheres, visible, false);
+		CHECK(stats.tested == spheres.Size());
+		CHECK(stats.visible == visible.size());
+		CHECK(stats.visible + stats.culled == stats.tested);
+		for (size_t i = 1; i < visible.size(); i++) CHECK(visible[i - 1] < visible[i]);
+
+		if (CanRunAVX()) {
+			std::vector<uint32_t> visibleAVX;
+			FrustumCulling::Cull(planes, spheres, visibleAVX, true);
+			CHECK(visibleAVX == visible);
+		}
+
+		std::vector<bool> kept(spheres.Size(), false);
+		for (uint32_t i : visible) kept[i] = true;
+		return kept;
+	}
+}
+
+TEST(ShadowCasters, CasterVolumeKeepsShadowsIntoView)
+{
+	std::vector<Caster> layout = Layout();
+	std::vector<bool> kept = Cull(FrustumCulling::ExtractCasterPlanes(LightViewProjection(), REACH), Bounds(layout));
+	for (size_t i = 0; i < layout.size(); i++)
+		CHECK(kept[i] == (layout[i].inVolume || layout[i].inReach));
+
+	// the spots the request cares about by name
+	CHECK(kept[11]);	// off the frustum, toward the light, throwing its shadow into it
+	CHECK(!kept[13]);	// behind the light
+}
+
+TEST(ShadowCasters, PlainFrustumDropsCastersTowardTheLight)
+{
+	std::vector<Caster> layout = Layout();
+	std::vector<bool> kept = Cull(FrustumCulling::ExtractPlanes(LightViewProjection()), Bounds(layout));
+	for (size_t i = 0; i < layout.size(); i++)
+		CHECK(kept[i] == layout[i].inVolume);
+}
+
+TEST(ShadowCasters, ReachLimitsHowFarBack)
+{
+	// reach moves the near plane back in world units, whatever the matrices
+	FrustumCulling::Spheres spheres = Bounds(Layout());
+	auto kept = [&](float reach) { return Cull(FrustumCulling::ExtractCasterPlanes(LightViewProjection(), reach), spheres); };
+
+	// the caster at y = 18 reaches down to 17, the near plane is at 15
+	CHECK(!kept(0.0f)[11]);
+	CHECK(!kept(1.5f)[11]);
+	CHECK(kept(1.5f)[12]);
+	CHECK(kept(2.5f)[11]);
+
+	// the one behind the light reaches down to 39
+	CHECK(!kept(23.0f)[13]);
+	CHECK(kept(25.0f)[13]);
+}
+
+TEST(ShadowCasters, ScaledBoundsGrow)
+{
+	// a unit sphere scaled by 3 on one axis reaches 3 units out
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixScaling(1, 3, 1) * XMMatrixTranslation(12, 0, 0));
+	FrustumCulling::Spheres spheres;
+	spheres.Resize(1);
+	spheres.Set(0, XMFLOAT3(0, 0, 0), 1.0f, world);
+	CHECK(spheres.x[0] == 12 && spheres.radius[0] == 3);
+	CHECK(Cull(FrustumCulling::ExtractCasterPlanes(LightViewProjection(), REACH), spheres)[0]);
+}
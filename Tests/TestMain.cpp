@@ -0,0 +1,40 @@
+#include "Tests.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	int failures = 0;
+}
+
+std::vector<Tests::Test>& Tests::GetTests()
+{
+	// a function static so registrations in other files can't run first
+	static std::vector<Test> tests;
+	return tests;
+}
+
+void Tests::Fail(const char* expression, const char* file, int line)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	failures++;
+}
+
+int main(int argc, char** argv)
+{
+	const char* prefix = argc > 1 ? argv[1] : "";
+	int run = 0, failed = 0;
+	for (const Tests::Test& test : Tests::GetTests()) {
+		if (strncmp(test.name, prefix, strlen(prefix)) != 0) continue;
+
+		int before = failures;
+		test.run();
+		run++;
+		if (failures != before) failed++;
+		printf("%s %s\n", failures != before ? "FAIL" : "pass", test.name);
+	}
+
+	printf("%d of %d tests passed\n", run - failed, run);
+	return run == 0 || failed ? 1 : 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// Just enough of a test framework for the headless tests
+// - TEST(Group, Name) registers a test, CHECK() reports a
+//   failed expression and lets the test carry on
+// - "HeadlessTests Group." runs the tests whose "Group.Name"
+//   starts with the argument, no argument runs them all
+// --------------------------------------------------------
+namespace Tests
+{
+	struct Test
+	{
+		const char* name;
+		void (*run)();
+	};
+
+	std::vector<Test>& GetTests();
+	void Fail(const char* expression, const char* file, int line);
+
+	struct Registration
+	{
+		Registration(const char* name, void (*run)()) { GetTests().push_back({ name, run }); }
+	};
+}
+
+#define TEST(group, name) \
+	static void group##_##name(); \
+	static Tests::Registration group##_##name##_registration(#group "." #name, group##_##name); \
+	static void group##_##name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) Tests::Fail(#expression, __FILE__, __LINE__); } while (0)
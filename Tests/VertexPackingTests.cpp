@@ -0,0 +1,175 @@
+#include "Tests.h"
+
+#include "VertexPacking.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR va = XMVector3Normalize(XMLoadFloat3(&a));
+		XMVECTOR vb = XMVector3Normalize(XMLoadFloat3(&b));
+		return XMConvertToDegrees(atan2f(XMVectorGetX(XMVector3Length(XMVector3Cross(va, vb))), XMVectorGetX(XMVector3Dot(va, vb))));
+	}
+
+	XMFLOAT3 RandomDirection(std::mt19937& rng)
+	{
+		std::normal_distribution<float> dist;
+		XMFLOAT3 d;
+		XMStoreFloat3(&d, XMVector3Normalize(XMVectorSet(dist(rng), dist(rng), dist(rng), 0)));
+		return d;
+	}
+
+	// random vertices inside the bounds, like a loaded mesh
+	std::vector<Vertex> RandomVertices(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, size_t count)
+	{
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<Vertex> vertices(count);
+		for (Vertex& v : vertices) {
+			v.Position = XMFLOAT3(
+				boundsMin.x + (boundsMax.x - boundsMin.x) * unit(rng),
+				boundsMin.y + (boundsMax.y - boundsMin.y) * unit(rng),
+				boundsMin.z + (boundsMax.z - boundsMin.z) * unit(rng));
+			v.UV = XMFLOAT2(unit(rng), unit(rng));
+			v.Normal = RandomDirection(rng);
+			v.Tangent = RandomDirection(rng);
+		}
+		return vertices;
+	}
+}
+
+TEST(VertexPacking, EachPartStaysInsideItsBound)
+{
+	const XMFLOAT3 boundsMin(-3.0f, 0.0f, -250.0f);
+	const XMFLOAT3 boundsMax(5.0f, 0.5f, 250.0f);
+	VertexPacking::Quantization q = VertexPacking::GetQuantization(boundsMin, boundsMax);
+	std::vector<Vertex> vertices = RandomVertices(boundsMin, boundsMax, 10000);
+
+	for (const Vertex& original : vertices) {
+		Vertex decoded = VertexPacking::Decode(VertexPacking::Encode(original, q), q);
+
+		// half a unorm step per axis, plus float rounding in the decode
+		const float* o = &original.Position.x;
+		const float* d = &decoded.Position.x;
+		const float* scale = &q.positionScale.x;
+		for (int a = 0; a < 3; a++)
+			CHECK(fabsf(d[a] - o[a]) <= scale[a] * (0.5f / 65535.0f) + 1e-5f * (fabsf(o[a]) + scale[a]));
+
+		// halfs keep 11 significant bits, so half a step is 2^-11 relative
+		CHECK(fabsf(decoded.UV.x - original.UV.x) <= fabsf(original.UV.x) * 0x1p-11f + 0x1p-25f);
+		CHECK(fabsf(decoded.UV.y - original.UV.y) <= fabsf(original.UV.y) * 0x1p-11f + 0x1p-25f);
+
+		// a 16 bit octahedral step is a few thousandths of a degree
+		CHECK(AngleDegrees(original.Normal, decoded.Normal) <= 0.01f);
+		CHECK(AngleDegrees(original.Tangent, decoded.Tangent) <= 0.01f);
+	}
+}
+
+TEST(VertexPacking, BoundsCornersAreExact)
+{
+	const XMFLOAT3 boundsMin(-1.0f, 2.0f, -3.0f);
+	const XMFLOAT3 boundsMax(4.0f, 6.0f, 5.0f);
+	VertexPacking::Quantization q = VertexPacking::GetQuantization(boundsMin, boundsMax);
+
+	Vertex v = {};
+	v.Normal = XMFLOAT3(0, 1, 0);
+	v.Tangent = XMFLOAT3(1, 0, 0);
+	v.Position = boundsMin;
+	PackedVertex p = VertexPacking::Encode(v, q);
+	CHECK(p.Position.x == 0 && p.Position.y == 0 && p.Position.z == 0);
+	Vertex decoded = VertexPacking::Decode(p, q);
+	CHECK(decoded.Position.x == boundsMin.x && decoded.Position.y == boundsMin.y && decoded.Position.z == boundsMin.z);
+
+	v.Position = boundsMax;
+	p = VertexPacking::Encode(v, q);
+	CHECK(p.Position.x == 65535 && p.Position.y == 65535 && p.Position.z == 65535);
+	decoded = VertexPacking::Decode(p, q);
+	CHECK(fabsf(decoded.Position.x - boundsMax.x) <= 1e-6f);
+	CHECK(fabsf(decoded.Position.y - boundsMax.y) <= 1e-6f);
+	CHECK(fabsf(decoded.Position.z - boundsMax.z) <= 1e-6f);
+}
+
+TEST(VertexPacking, FlatAxisLandsOnTheMinimum)
+{
+	// a quad in the xz plane has no height at all
+	VertexPacking::Quantization q = VertexPacking::GetQuantization(XMFLOAT3(-1, 2, -1), XMFLOAT3(1, 2, 1));
+	CHECK(q.positionScale.y == 0.0f);
+
+	Vertex v = {};
+	v.Position = XMFLOAT3(0.5f, 2.0f, -0.5f);
+	v.Normal = XMFLOAT3(0, 1, 0);
+	v.Tangent = XMFLOAT3(1, 0, 0);
+	Vertex decoded = VertexPacking::Decode(VertexPacking::Encode(v, q), q);
+	CHECK(decoded.Position.y == 2.0f);
+
+	VertexPacking::PackingError error = VertexPacking::MeasureError(&v, 1, q);
+	CHECK(error.position <= 1.0f / 65535.0f);
+	CHECK(VertexPacking::WithinTolerance(error, VertexPacking::PackingTolerance()));
+}
+
+TEST(VertexPacking, OctahedralRoundTrip)
+{
+	// the axes and the octahedron's folds, then anything
+	std::vector<XMFLOAT3> directions = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ 0.6f, 0, -0.8f }, { 0, -0.6f, -0.8f }, { -0.6f, 0.8f, 0 },
+	};
+	std::mt19937 rng(1234);
+	for (int i = 0; i < 1000; i++) directions.push_back(RandomDirection(rng));
+
+	for (const XMFLOAT3& n : directions) {
+		XMFLOAT2 e = VertexPacking::OctEncode(n);
+		CHECK(fabsf(e.x) <= 1.0f && fabsf(e.y) <= 1.0f);
+		XMFLOAT3 decoded = VertexPacking::OctDecode(e);
+		CHECK(fabsf(XMVectorGetX(XMVector3Length(XMLoadFloat3(&decoded))) - 1.0f) <= 1e-5f);
+		CHECK(AngleDegrees(n, decoded) <= 1e-3f);
+	}
+}
+
+TEST(VertexPacking, MeasuredErrorMatchesTheTolerance)
+{
+	const XMFLOAT3 boundsMin(-10.0f, -10.0f, -10.0f);
+	const XMFLOAT3 boundsMax(10.0f, 10.0f, 10.0f);
+	VertexPacking::Quantization q = VertexPacking::GetQuantization(boundsMin, boundsMax);
+	std::vector<Vertex> vertices = RandomVertices(boundsMin, boundsMax, 10000);
+
+	// the defaults pass real data, and the measured numbers are the bounds above
+	VertexPacking::PackingError error = VertexPacking::MeasureError(vertices.data(), vertices.size(), q);
+	CHECK(VertexPacking::WithinTolerance(error, VertexPacking::PackingTolerance()));
+	CHECK(error.position > 0.0f && error.position <= 20.0f * (0.5f / 65535.0f) + 1e-5f);
+	CHECK(error.uv > 0.0f && error.uv <= 0x1p-11f);
+	CHECK(error.normalDegrees > 0.0f && error.normalDegrees <= 0.01f);
+	CHECK(error.tangentDegrees > 0.0f && error.tangentDegrees <= 0.01f);
+
+	// and a tolerance tighter than the encoding fails
+	VertexPacking::PackingTolerance tight;
+	tight.positionRelative = error.positionRelative * 0.5f;
+	CHECK(!VertexPacking::WithinTolerance(error, tight));
+	tight = VertexPacking::PackingTolerance();
+	tight.normalDegrees = error.normalDegrees * 0.5f;
+	CHECK(!VertexPacking::WithinTolerance(error, tight));
+
+	// UVs halfs can't hold, like a tiled texture far from the origin
+	vertices[17].UV.x = 3000.25f;
+	error = VertexPacking::MeasureError(vertices.data(), vertices.size(), q);
+	CHECK(error.uv == 0.25f);
+	CHECK(!VertexPacking::WithinTolerance(error, VertexPacking::PackingTolerance()));
+}
+
+TEST(VertexPacking, MissingTangentsDontCount)
+{
+	// OBJ files without UVs leave tangents at zero
+	VertexPacking::Quantization q = VertexPacking::GetQuantization(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1));
+	Vertex v = {};
+	v.Position = XMFLOAT3(0.25f, 0.5f, 0.75f);
+	v.Normal = XMFLOAT3(0, 0, -1);
+	VertexPacking::PackingError error = VertexPacking::MeasureError(&v, 1, q);
+	CHECK(error.tangentDegrees == 0.0f);
+	CHECK(VertexPacking::WithinTolerance(error, VertexPacking::PackingTolerance()));
+}
@@ -1,34 +1,53 @@
 #include "Transform.h"
+#include "TransformSystem.h"
+#include "Quaternions.h"
 
 using namespace DirectX;
 
 Transform::Transform() :
-    position(0, 0, 0),
     pitchYawRoll(0, 0, 0),
-    scale(1, 1, 1),
+    eulerSource(0, 0, 0, 1),
     up(0, 1, 0),
     right(1, 0, 0),
     forward(0, 0, 1),
-    qRotation(0, 0, 0, 0),
-    bMatricesDirty(false),
-    bVectorsDirty(false)
+    vectorsSource(0, 0, 0, 1)
 {
-    XMStoreFloat4x4(&mWorld, XMMatrixIdentity());
-    XMStoreFloat4x4(&mWorldInverseTranspose, XMMatrixIdentity());
+    handle = TransformSystem::Global().Create(this);
+}
+
+Transform::~Transform()
+{
+    TransformSystem::Global().Destroy(handle);
 }
 
 // getters
-const DirectX::XMFLOAT3 Transform::GetPosition() const { return position; }
-const DirectX::XMFLOAT3 Transform::GetRotation() const { return pitchYawRoll; }
-const DirectX::XMFLOAT3 Transform::GetScale() const { return scale; }
+const DirectX::XMFLOAT3 Transform::GetPosition() const { return TransformSystem::Global().GetPosition(handle); }
+const DirectX::XMFLOAT3 Transform::GetRotation() {
+    UpdateEuler();
+    return pitchYawRoll;
+}
+const DirectX::XMFLOAT4 Transform::GetRotationQuaternion() const { return TransformSystem::Global().GetRotation(handle); }
+const DirectX::XMFLOAT3 Transform::GetScale() const { return TransformSystem::Global().GetScale(handle); }
+const DirectX::XMFLOAT4X4 Transform::GetLocalMatrix()
+{
+    TransformSystem& system = TransformSystem::Global();
+    system.Update();
+    return system.GetLocal(handle);
+}
 const DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-    UpdateMatrices();
-    return mWorld;
+    TransformSystem& system = TransformSystem::Global();
+    system.Update();
+    return system.GetWorld(handle);
 }
 const DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix() {
-    UpdateMatrices();
-    return mWorldInverseTranspose;
+    TransformSystem& system = TransformSystem::Global();
+    system.Update();
+    return system.GetWorldInverseTranspose(handle);
+}
+const DirectX::XMFLOAT3 Transform::GetWorldPosition() {
+    XMFLOAT4X4 world = GetWorldMatrix();
+    return XMFLOAT3(world._41, world._42, world._43);
 }
 const DirectX::XMFLOAT3 Transform::GetUp() {
     UpdateVectors();
@@ -43,14 +62,23 @@ const DirectX::XMFLOAT3 Transform::GetForward() {
     return forward;
 }
 
+// hierarchy
+bool Transform::SetParent(Transform* parent)
+{
+    return TransformSystem::Global().SetParent(handle, parent ? parent->handle : TransformSystem::INVALID_HANDLE);
+}
+Transform* Transform::GetParent() const
+{
+    return TransformSystem::Global().GetParent(handle);
+}
+
 // setters
 void Transform::SetPosition(float x, float y, float z)
 {
     SetPosition(XMFLOAT3(x, y, z));
 }
 void Transform::SetPosition(const XMFLOAT3& pos) {
-    this->position = pos;
-    bMatricesDirty = true;
+    TransformSystem::Global().SetPosition(handle, pos);
 }
 void Transform::SetRotation(float p, float y, float r)
 {
@@ -58,8 +86,17 @@ void Transform::SetRotation(float p, float y, float r)
 }
 void Transform::SetRotation(const XMFLOAT3& rotation)
 {
+    XMFLOAT4 qRotation;
+    XMStoreFloat4(&qRotation, XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&rotation)));
+    SetRotationQuaternion(qRotation);
+
+    // keep the angles as given, so the UI doesn't see them wrap
     pitchYawRoll = rotation;
-    UpdateQuaternion();
+    eulerSource = qRotation;
+}
+void Transform::SetRotationQuaternion(const XMFLOAT4& rotation)
+{
+    TransformSystem::Global().SetRotation(handle, rotation);
 }
 void Transform::SetScale(float x, float y, float z)
 {
@@ -67,8 +104,7 @@ void Transform::SetScale(float x, float y, float z)
 }
 void Transform::SetScale(const XMFLOAT3& scale)
 {
-    this->scale = scale;
-    bMatricesDirty = true;
+    TransformSystem::Global().SetScale(handle, scale);
 }
 
 
@@ -80,9 +116,9 @@ void Transform::MoveAbsolute(float x, float y, float z)
 }
 void Transform::MoveAbsolute(const DirectX::XMFLOAT3& offset)
 {
-    UpdateVectors();
+    XMFLOAT3 position = GetPosition();
     DirectX::XMStoreFloat3(&position, XMLoadFloat3(&position) + XMLoadFloat3(&offset));
-    bMatricesDirty = true;
+    SetPosition(position);
 }
 
 // Move Relative
@@ -92,9 +128,12 @@ void Transform::MoveRelative(float x, float y, float z)
 }
 void Transform::MoveRelative(const DirectX::XMFLOAT3& offset)
 {
+    TransformSystem& system = TransformSystem::Global();
+    XMFLOAT3 position = system.GetPosition(handle);
+    XMFLOAT4 qRotation = system.GetRotation(handle);
     XMVECTOR dir = XMVector3Rotate(XMLoadFloat3(&offset), XMLoadFloat4(&qRotation));
     XMStoreFloat3(&position, XMLoadFloat3(&position) + dir);
-    bMatricesDirty = true;
+    system.SetPosition(handle, position);
 }
 
 // Rotate
@@ -104,8 +143,46 @@ void Transform::Rotate(float x, float y, float z)
 }
 void Transform::Rotate(const DirectX::XMFLOAT3& rotation)
 {
-    DirectX::XMStoreFloat3(&pitchYawRoll, XMLoadFloat3(&pitchYawRoll) + XMLoadFloat3(&rotation));
-    UpdateQuaternion();
+    // pitch and roll about the local axes, yaw about the parent's up,
+    // the same as adding to the angles while roll is 0
+    XMFLOAT4 current = GetRotationQuaternion();
+    XMVECTOR q = XMLoadFloat4(&current);
+    q = XMQuaternionMultiply(XMQuaternionRotationRollPitchYaw(rotation.x, 0, rotation.z), q);
+    q = XMQuaternionMultiply(q, XMQuaternionRotationRollPitchYaw(0, rotation.y, 0));
+
+    XMFLOAT4 qRotation;
+    XMStoreFloat4(&qRotation, XMQuaternionNormalize(q));
+    SetRotationQuaternion(qRotation);
+}
+void Transform::RotateAxisAngle(const DirectX::XMFLOAT3& axis, float angle)
+{
+    XMFLOAT4 rotation;
+    XMStoreFloat4(&rotation, XMQuaternionRotationAxis(XMLoadFloat3(&axis), angle));
+    RotateQuaternion(rotation);
+}
+void Transform::RotateLocalAxisAngle(const DirectX::XMFLOAT3& axis, float angle)
+{
+    // turning first, before the current rotation, is turning about the local axis
+    XMFLOAT4 current = GetRotationQuaternion();
+    XMFLOAT4 qRotation;
+    XMStoreFloat4(&qRotation, XMQuaternionNormalize(
+        XMQuaternionMultiply(XMQuaternionRotationAxis(XMLoadFloat3(&axis), angle), XMLoadFloat4(&current))));
+    SetRotationQuaternion(qRotation);
+}
+void Transform::RotateQuaternion(const DirectX::XMFLOAT4& rotation)
+{
+    XMFLOAT4 current = GetRotationQuaternion();
+    XMFLOAT4 qRotation;
+    XMStoreFloat4(&qRotation, XMQuaternionNormalize(XMQuaternionMultiply(XMLoadFloat4(&current), XMLoadFloat4(&rotation))));
+    SetRotationQuaternion(qRotation);
+}
+void Transform::LookAt(const DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& up)
+{
+    XMFLOAT3 position = GetPosition();
+    XMFLOAT3 forward;
+    XMStoreFloat3(&forward, XMLoadFloat3(&target) - XMLoadFloat3(&position));
+    if (XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&forward))) == 0.0f) return;
+    SetRotationQuaternion(Quaternions::LookRotation(forward, up));
 }
 
 // Scale
@@ -115,43 +192,33 @@ void Transform::Scale(float x, float y, float z)
 }
 void Transform::Scale(const DirectX::XMFLOAT3& scaleFactor)
 {
+    XMFLOAT3 scale = GetScale();
     DirectX::XMStoreFloat3(&scale, XMLoadFloat3(&scale) * XMLoadFloat3(&scaleFactor));
-    bMatricesDirty = true;
+    SetScale(scale);
 }
 
-// update quaternion
-void Transform::UpdateQuaternion() {
-    // load pitch yaw roll into xmvector and convert to radians
-    XMVECTOR euler = XMLoadFloat3(&pitchYawRoll);
-
-    // convert to quaternion
-    XMStoreFloat4(&qRotation, XMQuaternionRotationRollPitchYawFromVector(euler));
-    bMatricesDirty = true;
-    bVectorsDirty = true;
+// the caches are stale once the quaternion isn't the one they came from
+static bool SameRotation(const XMFLOAT4& a, const XMFLOAT4& b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w;
 }
 
-void Transform::UpdateMatrices() {
-    if (!bMatricesDirty) return;
-
-    // make translation, rotation, and scale matrices
-    XMMATRIX mT = XMMatrixTranslation(position.x, position.y, position.z);
-    XMMATRIX mR = XMMatrixRotationQuaternion(XMLoadFloat4(&qRotation));
-    XMMATRIX mS = XMMatrixScaling(scale.x, scale.y, scale.z);
-    XMMATRIX mW = mS * mR * mT;
-
-    // world matrix as result of transformation
-    XMStoreFloat4x4(&mWorld, mW);
-    XMStoreFloat4x4(&mWorldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(mW)));
+// update euler angles
+void Transform::UpdateEuler() {
+    XMFLOAT4 qRotation = GetRotationQuaternion();
+    if (SameRotation(qRotation, eulerSource)) return;
 
-    bMatricesDirty = false;
+    pitchYawRoll = Quaternions::ToPitchYawRoll(qRotation);
+    eulerSource = qRotation;
 }
 
 void Transform::UpdateVectors() {
-    if (!bVectorsDirty) return;
+    XMFLOAT4 qRotation = GetRotationQuaternion();
+    if (SameRotation(qRotation, vectorsSource)) return;
 
     XMVECTOR quat = XMLoadFloat4(&qRotation);
     XMStoreFloat3(&up, XMVector3Rotate(XMVectorSet(0, 1, 0, 0), quat));
     XMStoreFloat3(&right, XMVector3Rotate(XMVectorSet(1, 0, 0, 0), quat));
     XMStoreFloat3(&forward, XMVector3Rotate(XMVectorSet(0, 0, 1, 0), quat));
-    bVectorsDirty = false;
+    vectorsSource = qRotation;
 }
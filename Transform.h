@@ -1,27 +1,44 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <cstdint>
 
 class Transform
 {
 public:
 	Transform();
+	~Transform();
+	Transform(const Transform&) = delete;
+	Transform& operator=(const Transform&) = delete;
 
-	// getters
+	// getters - GetRotation() is pitch, yaw, roll, only worked out from
+	// the quaternion when asked for
 	const DirectX::XMFLOAT3 GetPosition() const;
-	const DirectX::XMFLOAT3 GetRotation() const;
+	const DirectX::XMFLOAT3 GetRotation();
+	const DirectX::XMFLOAT4 GetRotationQuaternion() const;
 	const DirectX::XMFLOAT3 GetScale() const;
 	const DirectX::XMFLOAT3 GetUp();
 	const DirectX::XMFLOAT3 GetRight();
 	const DirectX::XMFLOAT3 GetForward();
+	const DirectX::XMFLOAT4X4 GetLocalMatrix();
 	const DirectX::XMFLOAT4X4 GetWorldMatrix();
 	const DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+	const DirectX::XMFLOAT3 GetWorldPosition();
+
+	// hierarchy - position, rotation and scale are relative to the parent
+	// - SetParent() is false if "parent" is this or one of its children
+	bool SetParent(Transform* parent);
+	Transform* GetParent() const;
+
+	// handle in TransformSystem::Global(), for its batched calls
+	uint32_t GetHandle() const { return handle; }
 
 	// setters with overloads
 	void SetPosition(float x, float y, float z);
 	void SetPosition(const DirectX::XMFLOAT3& pos);
 	void SetRotation(float p, float y, float r);
 	void SetRotation(const DirectX::XMFLOAT3& rotation);
+	void SetRotationQuaternion(const DirectX::XMFLOAT4& rotation);
 	void SetScale(float x, float y, float z);
 	void SetScale(const DirectX::XMFLOAT3& scale);
 
@@ -32,29 +49,35 @@ public:
 	void MoveRelative(const DirectX::XMFLOAT3& offset);
 	void Rotate(float x, float y, float z);
 	void Rotate(const DirectX::XMFLOAT3& rotation);
+
+	// quaternion rotations, no euler angles involved
+	// - RotateAxisAngle() and RotateQuaternion() turn about the parent's
+	//   axes (the world's for a root), RotateLocalAxisAngle() about this
+	//   transform's own
+	// - LookAt() turns +z towards a point in the parent's space
+	void RotateAxisAngle(const DirectX::XMFLOAT3& axis, float angle);
+	void RotateLocalAxisAngle(const DirectX::XMFLOAT3& axis, float angle);
+	void RotateQuaternion(const DirectX::XMFLOAT4& rotation);
+	void LookAt(const DirectX::XMFLOAT3& target, const DirectX::XMFLOAT3& up = DirectX::XMFLOAT3(0, 1, 0));
 	void Scale(float x, float y, float z);
 	void Scale(const DirectX::XMFLOAT3& scaleFactor);
 private:
-	// Transform data
-	DirectX::XMFLOAT3 position;
+	// position, the quaternion and scale live in TransformSystem::Global(),
+	// these are caches of the quaternion they were worked out from
+
+	// euler angles for the UI
 	DirectX::XMFLOAT3 pitchYawRoll;
-	DirectX::XMFLOAT4 qRotation;
-	DirectX::XMFLOAT3 scale;
+	DirectX::XMFLOAT4 eulerSource;
 
 	// local orientation vectors
-	bool bVectorsDirty;
 	DirectX::XMFLOAT3 up;
 	DirectX::XMFLOAT3 right;
 	DirectX::XMFLOAT3 forward;
+	DirectX::XMFLOAT4 vectorsSource;
 
-	// Matrix
-	bool bMatricesDirty;
-	DirectX::XMFLOAT4X4 mWorld;
-	DirectX::XMFLOAT4X4 mWorldInverseTranspose;
+	uint32_t handle;
 
-	// helper methods to update quaternions, vectors, matrices
-	void UpdateQuaternion();
-	void UpdateMatrices();
+	// helper methods to update euler angles, vectors
+	void UpdateEuler();
 	void UpdateVectors();
 };
-
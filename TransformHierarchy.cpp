@@ -0,0 +1,239 @@
+#include "TransformHierarchy.h"
+
+#include <chrono>
+
+using namespace DirectX;
+
+uint32_t TransformHierarchy::Create(Transform* owner)
+{
+	uint32_t handle;
+	if (!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		handle = (uint32_t)indices.size();
+		indices.push_back(INVALID_HANDLE);
+	}
+
+	// roots are depth 0, so appending one never breaks the order
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	uint32_t index = (uint32_t)handles.size();
+	indices[handle] = index;
+	handles.push_back(handle);
+	parentHandles.push_back(INVALID_HANDLE);
+	parents.push_back(INVALID_HANDLE);
+	owners.push_back(owner);
+	dirty.push_back(0);
+	locals.push_back(identity);
+	localInverseTransposes.push_back(identity);
+	worlds.push_back(identity);
+	worldInverseTransposes.push_back(identity);
+
+	MarkDirty(handle);
+	return handle;
+}
+
+void TransformHierarchy::Destroy(uint32_t node)
+{
+	uint32_t index = indices[node];
+	if (index == INVALID_HANDLE) return;
+
+	for (uint32_t i = 0; i < (uint32_t)handles.size(); i++) {
+		if (parentHandles[i] != node) continue;
+		parentHandles[i] = INVALID_HANDLE;
+		MarkDirty(handles[i]);
+	}
+
+	// swap with the last node, Sort() puts the order back
+	uint32_t last = (uint32_t)handles.size() - 1;
+	if (index != last) {
+		handles[index] = handles[last];
+		parentHandles[index] = parentHandles[last];
+		owners[index] = owners[last];
+		dirty[index] = dirty[last];
+		locals[index] = locals[last];
+		localInverseTransposes[index] = localInverseTransposes[last];
+		worlds[index] = worlds[last];
+		worldInverseTransposes[index] = worldInverseTransposes[last];
+		indices[handles[index]] = index;
+		if (dirty[index]) firstDirty = 0;
+	}
+	handles.pop_back();
+	parentHandles.pop_back();
+	parents.pop_back();
+	owners.pop_back();
+	dirty.pop_back();
+	locals.pop_back();
+	localInverseTransposes.pop_back();
+	worlds.pop_back();
+	worldInverseTransposes.pop_back();
+
+	indices[node] = INVALID_HANDLE;
+	freeHandles.push_back(node);
+	orderDirty = true;
+}
+
+bool TransformHierarchy::SetParent(uint32_t node, uint32_t parent)
+{
+	uint32_t index = indices[node];
+	if (parentHandles[index] == parent) return true;
+
+	// walking up from the new parent must not reach the node
+	for (uint32_t p = parent; p != INVALID_HANDLE; p = parentHandles[indices[p]])
+		if (p == node) return false;
+
+	parentHandles[index] = parent;
+	orderDirty = true;
+	MarkDirty(node);
+	return true;
+}
+
+uint32_t TransformHierarchy::GetParent(uint32_t node) const
+{
+	return parentHandles[indices[node]];
+}
+
+Transform* TransformHierarchy::GetOwner(uint32_t node) const
+{
+	return owners[indices[node]];
+}
+
+uint32_t TransformHierarchy::GetDepth(uint32_t node) const
+{
+	uint32_t depth = 0;
+	for (uint32_t p = GetParent(node); p != INVALID_HANDLE; p = GetParent(p)) depth++;
+	return depth;
+}
+
+void TransformHierarchy::MarkDirty(uint32_t node)
+{
+	uint32_t index = indices[node];
+	dirty[index] = 1;
+	if (index < firstDirty) firstDirty = index;
+}
+
+void TransformHierarchy::SetLocal(uint32_t node, const XMFLOAT4X4& local)
+{
+	XMFLOAT4X4 localInverseTranspose;
+	XMStoreFloat4x4(&localInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&local))));
+	SetLocal(node, local, localInverseTranspose);
+}
+
+void TransformHierarchy::SetLocal(uint32_t node, const XMFLOAT4X4& local, const XMFLOAT4X4& localInverseTranspose)
+{
+	uint32_t index = indices[node];
+	locals[index] = local;
+	localInverseTransposes[index] = localInverseTranspose;
+	MarkDirty(node);
+}
+
+const XMFLOAT4X4& TransformHierarchy::GetLocal(uint32_t node) const
+{
+	return locals[indices[node]];
+}
+
+const XMFLOAT4X4& TransformHierarchy::GetWorld(uint32_t node) const
+{
+	return worlds[indices[node]];
+}
+
+const XMFLOAT4X4& TransformHierarchy::GetWorldInverseTranspose(uint32_t node) const
+{
+	return worldInverseTransposes[indices[node]];
+}
+
+void TransformHierarchy::Update()
+{
+	uint32_t count = (uint32_t)handles.size();
+	if (!orderDirty && firstDirty >= count) return;
+
+	auto start = std::chrono::steady_clock::now();
+	UpdateStats stats = {};
+	stats.nodes = count;
+	stats.resorted = orderDirty;
+	if (orderDirty) Sort();
+
+	// parents come first, so a dirty parent is always seen before
+	// its children and the flag carries down the whole subtree
+	for (uint32_t i = firstDirty; i < count; i++) {
+		uint32_t p = parents[i];
+		if (p != INVALID_HANDLE && dirty[p]) dirty[i] = 1;
+		if (!dirty[i]) continue;
+
+		// (local * parent)^-T = local^-T * parent^-T
+		XMMATRIX world = XMLoadFloat4x4(&locals[i]);
+		XMMATRIX worldInverseTranspose = XMLoadFloat4x4(&localInverseTransposes[i]);
+		if (p != INVALID_HANDLE) {
+			world = world * XMLoadFloat4x4(&worlds[p]);
+			worldInverseTranspose = worldInverseTranspose * XMLoadFloat4x4(&worldInverseTransposes[p]);
+		}
+
+		XMStoreFloat4x4(&worlds[i], world);
+		XMStoreFloat4x4(&worldInverseTransposes[i], worldInverseTranspose);
+		stats.updated++;
+	}
+
+	// children read their parent's flag above, so clear them after
+	for (uint32_t i = firstDirty; i < count; i++) dirty[i] = 0;
+	firstDirty = count;
+
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	lastStats = stats;
+}
+
+void TransformHierarchy::Sort()
+{
+	uint32_t count = (uint32_t)handles.size();
+
+	// depth of every node, walking up until a known depth
+	std::vector<uint32_t> depths(count, INVALID_HANDLE);
+	std::vector<uint32_t> chain;
+	uint32_t maxDepth = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t n = i;
+		while (depths[n] == INVALID_HANDLE && parentHandles[n] != INVALID_HANDLE) {
+			chain.push_back(n);
+			n = indices[parentHandles[n]];
+		}
+		uint32_t depth = depths[n] == INVALID_HANDLE ? 0 : depths[n];
+		depths[n] = depth;
+		while (!chain.empty()) {
+			depths[chain.back()] = ++depth;
+			chain.pop_back();
+		}
+		if (depth > maxDepth) maxDepth = depth;
+	}
+
+	// counting sort by depth, stable so the order mostly stays put
+	std::vector<uint32_t> starts(maxDepth + 2, 0);
+	for (uint32_t i = 0; i < count; i++) starts[depths[i] + 1]++;
+	for (uint32_t d = 1; d < starts.size(); d++) starts[d] += starts[d - 1];
+	std::vector<uint32_t> order(count);
+	for (uint32_t i = 0; i < count; i++) order[starts[depths[i]]++] = i;
+
+	auto permute = [&](auto& values) {
+		std::remove_reference_t<decltype(values)> sorted(count);
+		for (uint32_t i = 0; i < count; i++) sorted[i] = values[order[i]];
+		values.swap(sorted);
+	};
+	permute(handles);
+	permute(parentHandles);
+	permute(owners);
+	permute(dirty);
+	permute(locals);
+	permute(localInverseTransposes);
+	permute(worlds);
+	permute(worldInverseTransposes);
+
+	firstDirty = count;
+	for (uint32_t i = 0; i < count; i++) {
+		indices[handles[i]] = i;
+		if (dirty[i] && i < firstDirty) firstDirty = i;
+	}
+	for (uint32_t i = 0; i < count; i++)
+		parents[i] = parentHandles[i] == INVALID_HANDLE ? INVALID_HANDLE : indices[parentHandles[i]];
+
+	orderDirty = false;
+}
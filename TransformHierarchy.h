@@ -0,0 +1,87 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+class Transform;
+
+// --------------------------------------------------------
+// Parent/child world matrices for a set of nodes
+// - Nodes live in flat arrays sorted by depth, so every parent
+//   comes before its children and one front to back pass can
+//   build world = local * parent world
+// - Dirty flags spread to children during that pass, and only
+//   dirty nodes get new matrices
+// - Inverse transposes multiply down the same way, so nothing
+//   here takes a general inverse unless SetLocal() is only
+//   given the local matrix
+// - Handles stay valid while the arrays are resorted
+// --------------------------------------------------------
+class TransformHierarchy
+{
+public:
+	static constexpr uint32_t INVALID_HANDLE = UINT32_MAX;
+
+	struct UpdateStats
+	{
+		uint32_t nodes;
+		uint32_t updated;		// dirty nodes plus their descendants
+		bool resorted;			// parents changed since the last Update()
+		double ms;
+	};
+
+	// New root node with an identity local matrix, "owner" is only
+	// handed back by GetOwner()
+	uint32_t Create(Transform* owner = nullptr);
+
+	// Removes a node, its children become roots
+	void Destroy(uint32_t node);
+
+	// Attaches "node" under "parent", or makes it a root with INVALID_HANDLE
+	// - False if "parent" is "node" or one of its descendants
+	bool SetParent(uint32_t node, uint32_t parent);
+	uint32_t GetParent(uint32_t node) const;
+	Transform* GetOwner(uint32_t node) const;
+
+	// Flags a node so the next Update() rebuilds it and its subtree
+	void MarkDirty(uint32_t node);
+	void SetLocal(uint32_t node, const DirectX::XMFLOAT4X4& local);
+	void SetLocal(uint32_t node, const DirectX::XMFLOAT4X4& local, const DirectX::XMFLOAT4X4& localInverseTranspose);
+	const DirectX::XMFLOAT4X4& GetLocal(uint32_t node) const;
+
+	// Brings every dirty world matrix up to date, cheap when nothing changed
+	void Update();
+
+	// Valid after Update()
+	const DirectX::XMFLOAT4X4& GetWorld(uint32_t node) const;
+	const DirectX::XMFLOAT4X4& GetWorldInverseTranspose(uint32_t node) const;
+
+	uint32_t GetNodeCount() const { return (uint32_t)handles.size(); }
+	uint32_t GetDepth(uint32_t node) const;
+	const UpdateStats& GetLastUpdateStats() const { return lastStats; }
+
+private:
+	// sorted by depth, parents before children
+	std::vector<uint32_t> handles;
+	std::vector<uint32_t> parentHandles;
+	std::vector<uint32_t> parents;		// index into these arrays, or INVALID_HANDLE
+	std::vector<Transform*> owners;
+	std::vector<uint8_t> dirty;
+	std::vector<DirectX::XMFLOAT4X4> locals;
+	std::vector<DirectX::XMFLOAT4X4> localInverseTransposes;
+	std::vector<DirectX::XMFLOAT4X4> worlds;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTransposes;
+
+	// handle -> index, INVALID_HANDLE when free
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> freeHandles;
+
+	// first index that could be dirty, GetNodeCount() if none are
+	uint32_t firstDirty = 0;
+	bool orderDirty = false;
+	UpdateStats lastStats = {};
+
+	// rebuilds the depth order after parents change
+	void Sort();
+};
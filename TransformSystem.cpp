@@ -0,0 +1,308 @@
+#include "TransformSystem.h"
+#include "Quaternions.h"
+#include "SimdLanes.h"
+
+#include <intrin.h>
+#include <chrono>
+
+using namespace DirectX;
+
+namespace
+{
+	// the rows of S * R * T and its inverse transpose that aren't
+	// constant, one lane per transform
+	// - local rows 0-2 are scale * rotation row, row 3 is position
+	// - inverse transpose rows 0-2 are rotation row / scale, with
+	//   -dot(position, rotation row) / scale in the last column,
+	//   row 3 is (0, 0, 0, 1)
+	enum MatrixLane
+	{
+		LOCAL_ROWS = 0,				// 9, row major 3x3
+		INVERSE_TRANSPOSE_ROWS = 9,	// 9, row major 3x3
+		INVERSE_TRANSPOSE_W = 18,	// 3
+		LANE_VALUES = 21
+	};
+}
+
+TransformSystem& TransformSystem::Global()
+{
+	static TransformSystem system;
+	return system;
+}
+
+TransformSystem::TransformSystem()
+	: avx(IsAVXSupported())
+{
+}
+
+bool TransformSystem::IsAVXSupported()
+{
+	// the CPU has AVX and the OS saves the YMM registers
+	static const bool supported = []() {
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool cpuAVX = (info[2] & (1 << 28)) != 0;
+		return osxsave && cpuAVX && (_xgetbv(0) & 6) == 6;
+	}();
+	return supported;
+}
+
+void TransformSystem::SetAVX(bool enabled)
+{
+	avx = enabled && IsAVXSupported();
+}
+
+uint32_t TransformSystem::Create(Transform* owner)
+{
+	uint32_t handle;
+	if (!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		handle = (uint32_t)slots.size();
+		slots.push_back(INVALID_HANDLE);
+	}
+
+	// grow in whole blocks of identity transforms
+	if (count == positionX.size()) {
+		size_t size = count + 8;
+		for (auto* v : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ })
+			v->resize(size, 0.0f);
+		for (auto* v : { &rotationW, &scaleX, &scaleY, &scaleZ })
+			v->resize(size, 1.0f);
+		dirty.resize(size, 0);
+		nodes.resize(size, INVALID_HANDLE);
+		handles.resize(size, INVALID_HANDLE);
+	}
+
+	uint32_t slot = count++;
+	slots[handle] = slot;
+	handles[slot] = handle;
+	nodes[slot] = hierarchy.Create(owner);
+	MarkDirty(slot);
+	return handle;
+}
+
+void TransformSystem::Destroy(uint32_t transform)
+{
+	uint32_t slot = slots[transform];
+	if (slot == INVALID_HANDLE) return;
+	hierarchy.Destroy(nodes[slot]);
+
+	// last slot fills the hole, the freed one goes back to identity
+	uint32_t last = count - 1;
+	if (slot != last) {
+		CopySlot(last, slot);
+		slots[handles[slot]] = slot;
+		if (dirty[slot]) MarkDirty(slot);
+	}
+	positionX[last] = positionY[last] = positionZ[last] = 0.0f;
+	rotationX[last] = rotationY[last] = rotationZ[last] = 0.0f;
+	rotationW[last] = scaleX[last] = scaleY[last] = scaleZ[last] = 1.0f;
+	dirty[last] = 0;
+	nodes[last] = INVALID_HANDLE;
+	handles[last] = INVALID_HANDLE;
+	count--;
+
+	slots[transform] = INVALID_HANDLE;
+	freeHandles.push_back(transform);
+}
+
+void TransformSystem::CopySlot(uint32_t from, uint32_t to)
+{
+	positionX[to] = positionX[from];
+	positionY[to] = positionY[from];
+	positionZ[to] = positionZ[from];
+	rotationX[to] = rotationX[from];
+	rotationY[to] = rotationY[from];
+	rotationZ[to] = rotationZ[from];
+	rotationW[to] = rotationW[from];
+	scaleX[to] = scaleX[from];
+	scaleY[to] = scaleY[from];
+	scaleZ[to] = scaleZ[from];
+	dirty[to] = dirty[from];
+	nodes[to] = nodes[from];
+	handles[to] = handles[from];
+}
+
+void TransformSystem::MarkDirty(uint32_t slot)
+{
+	dirty[slot] = 1;
+	if (slot < firstDirty) firstDirty = slot;
+}
+
+XMFLOAT3 TransformSystem::GetPosition(uint32_t transform) const
+{
+	uint32_t s = slots[transform];
+	return XMFLOAT3(positionX[s], positionY[s], positionZ[s]);
+}
+
+XMFLOAT4 TransformSystem::GetRotation(uint32_t transform) const
+{
+	uint32_t s = slots[transform];
+	return XMFLOAT4(rotationX[s], rotationY[s], rotationZ[s], rotationW[s]);
+}
+
+XMFLOAT3 TransformSystem::GetScale(uint32_t transform) const
+{
+	uint32_t s = slots[transform];
+	return XMFLOAT3(scaleX[s], scaleY[s], scaleZ[s]);
+}
+
+void TransformSystem::SetPosition(uint32_t transform, const XMFLOAT3& position)
+{
+	uint32_t s = slots[transform];
+	positionX[s] = position.x;
+	positionY[s] = position.y;
+	positionZ[s] = position.z;
+	MarkDirty(s);
+}
+
+void TransformSystem::SetRotation(uint32_t transform, const XMFLOAT4& rotation)
+{
+	uint32_t s = slots[transform];
+	rotationX[s] = rotation.x;
+	rotationY[s] = rotation.y;
+	rotationZ[s] = rotation.z;
+	rotationW[s] = rotation.w;
+	MarkDirty(s);
+}
+
+void TransformSystem::SetScale(uint32_t transform, const XMFLOAT3& scale)
+{
+	uint32_t s = slots[transform];
+	scaleX[s] = scale.x;
+	scaleY[s] = scale.y;
+	scaleZ[s] = scale.z;
+	MarkDirty(s);
+}
+
+void TransformSystem::InterpolateRotations(const uint32_t* transforms, const XMFLOAT4* from, const XMFLOAT4* to,
+	float t, size_t count, bool slerp)
+{
+	std::vector<float> weights(count, t);
+	std::vector<XMFLOAT4> rotations(count);
+	if (slerp) Quaternions::Slerp(from, to, weights.data(), rotations.data(), count);
+	else Quaternions::Nlerp(from, to, weights.data(), rotations.data(), count);
+
+	for (size_t i = 0; i < count; i++) SetRotation(transforms[i], rotations[i]);
+}
+
+bool TransformSystem::SetParent(uint32_t transform, uint32_t parent)
+{
+	uint32_t parentNode = parent == INVALID_HANDLE ? TransformHierarchy::INVALID_HANDLE : nodes[slots[parent]];
+	return hierarchy.SetParent(nodes[slots[transform]], parentNode);
+}
+
+Transform* TransformSystem::GetParent(uint32_t transform) const
+{
+	uint32_t parentNode = hierarchy.GetParent(nodes[slots[transform]]);
+	return parentNode == TransformHierarchy::INVALID_HANDLE ? nullptr : hierarchy.GetOwner(parentNode);
+}
+
+const XMFLOAT4X4& TransformSystem::GetLocal(uint32_t transform) const
+{
+	return hierarchy.GetLocal(nodes[slots[transform]]);
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorld(uint32_t transform) const
+{
+	return hierarchy.GetWorld(nodes[slots[transform]]);
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorldInverseTranspose(uint32_t transform) const
+{
+	return hierarchy.GetWorldInverseTranspose(nodes[slots[transform]]);
+}
+
+void TransformSystem::Update()
+{
+	if (firstDirty >= count) {
+		hierarchy.Update();
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	UpdateStats stats = {};
+	stats.transforms = count;
+	stats.avx = avx;
+	stats.rebuilt = avx ? BuildLocals<AVXLanes>() : BuildLocals<SSELanes>();
+	hierarchy.Update();
+	stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	lastStats = stats;
+}
+
+template<class Lanes>
+uint32_t TransformSystem::BuildLocals()
+{
+	using Float = typename Lanes::Float;
+	constexpr uint32_t W = Lanes::WIDTH;
+	alignas(32) float lanes[LANE_VALUES][W];
+	uint32_t rebuilt = 0;
+
+	for (uint32_t first = firstDirty - firstDirty % W; first < count; first += W) {
+		bool any = false;
+		for (uint32_t l = 0; l < W; l++) any |= dirty[first + l] != 0;
+		if (!any) continue;
+
+		Float px = Lanes::Load(&positionX[first]);
+		Float py = Lanes::Load(&positionY[first]);
+		Float pz = Lanes::Load(&positionZ[first]);
+		Float qx = Lanes::Load(&rotationX[first]);
+		Float qy = Lanes::Load(&rotationY[first]);
+		Float qz = Lanes::Load(&rotationZ[first]);
+		Float qw = Lanes::Load(&rotationW[first]);
+		Float one = Lanes::Set(1.0f);
+		Float invScale[3] = {
+			Lanes::Div(one, Lanes::Load(&scaleX[first])),
+			Lanes::Div(one, Lanes::Load(&scaleY[first])),
+			Lanes::Div(one, Lanes::Load(&scaleZ[first])) };
+		Float scale[3] = {
+			Lanes::Load(&scaleX[first]),
+			Lanes::Load(&scaleY[first]),
+			Lanes::Load(&scaleZ[first]) };
+
+		// rotation matrix from the quaternion, same as XMMatrixRotationQuaternion
+		Float x2 = Lanes::Add(qx, qx), y2 = Lanes::Add(qy, qy), z2 = Lanes::Add(qz, qz);
+		Float xx = Lanes::Mul(qx, x2), yy = Lanes::Mul(qy, y2), zz = Lanes::Mul(qz, z2);
+		Float xy = Lanes::Mul(qx, y2), xz = Lanes::Mul(qx, z2), yz = Lanes::Mul(qy, z2);
+		Float wx = Lanes::Mul(qw, x2), wy = Lanes::Mul(qw, y2), wz = Lanes::Mul(qw, z2);
+		Float r[3][3] = {
+			{ Lanes::Sub(one, Lanes::Add(yy, zz)), Lanes::Add(xy, wz), Lanes::Sub(xz, wy) },
+			{ Lanes::Sub(xy, wz), Lanes::Sub(one, Lanes::Add(xx, zz)), Lanes::Add(yz, wx) },
+			{ Lanes::Add(xz, wy), Lanes::Sub(yz, wx), Lanes::Sub(one, Lanes::Add(xx, yy)) } };
+
+		for (int row = 0; row < 3; row++) {
+			Float translated = Lanes::Add(Lanes::Add(Lanes::Mul(px, r[row][0]), Lanes::Mul(py, r[row][1])), Lanes::Mul(pz, r[row][2]));
+			Lanes::Store(lanes[INVERSE_TRANSPOSE_W + row], Lanes::Sub(Lanes::Set(0.0f), Lanes::Mul(translated, invScale[row])));
+			for (int col = 0; col < 3; col++) {
+				Lanes::Store(lanes[LOCAL_ROWS + row * 3 + col], Lanes::Mul(r[row][col], scale[row]));
+				Lanes::Store(lanes[INVERSE_TRANSPOSE_ROWS + row * 3 + col], Lanes::Mul(r[row][col], invScale[row]));
+			}
+		}
+
+		for (uint32_t l = 0; l < W; l++) {
+			uint32_t s = first + l;
+			if (!dirty[s]) continue;
+
+			XMFLOAT4X4 local(
+				lanes[LOCAL_ROWS + 0][l], lanes[LOCAL_ROWS + 1][l], lanes[LOCAL_ROWS + 2][l], 0,
+				lanes[LOCAL_ROWS + 3][l], lanes[LOCAL_ROWS + 4][l], lanes[LOCAL_ROWS + 5][l], 0,
+				lanes[LOCAL_ROWS + 6][l], lanes[LOCAL_ROWS + 7][l], lanes[LOCAL_ROWS + 8][l], 0,
+				positionX[s], positionY[s], positionZ[s], 1);
+			XMFLOAT4X4 inverseTranspose(
+				lanes[INVERSE_TRANSPOSE_ROWS + 0][l], lanes[INVERSE_TRANSPOSE_ROWS + 1][l], lanes[INVERSE_TRANSPOSE_ROWS + 2][l], lanes[INVERSE_TRANSPOSE_W + 0][l],
+				lanes[INVERSE_TRANSPOSE_ROWS + 3][l], lanes[INVERSE_TRANSPOSE_ROWS + 4][l], lanes[INVERSE_TRANSPOSE_ROWS + 5][l], lanes[INVERSE_TRANSPOSE_W + 1][l],
+				lanes[INVERSE_TRANSPOSE_ROWS + 6][l], lanes[INVERSE_TRANSPOSE_ROWS + 7][l], lanes[INVERSE_TRANSPOSE_ROWS + 8][l], lanes[INVERSE_TRANSPOSE_W + 2][l],
+				0, 0, 0, 1);
+			hierarchy.SetLocal(nodes[s], local, inverseTranspose);
+			dirty[s] = 0;
+			rebuilt++;
+		}
+	}
+
+	firstDirty = count;
+	return rebuilt;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "TransformHierarchy.h"
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Transform;
+
+// --------------------------------------------------------
+// Position, rotation and scale of every Transform, stored as
+// structure of arrays so dirty local matrices can be built
+// 8 at a time with AVX (4 at a time with SSE on CPUs without it)
+// - Inverse transposes come straight from the components,
+//   (S * R)^-T = S^-1 * R, so no 4x4 inverse per object
+// - Local matrices go into the hierarchy, which builds the
+//   world matrices; a Transform is a handle into here
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	static constexpr uint32_t INVALID_HANDLE = UINT32_MAX;
+
+	struct UpdateStats
+	{
+		uint32_t transforms;
+		uint32_t rebuilt;		// local matrices built this update
+		bool avx;
+		double ms;				// local matrices and the hierarchy pass
+	};
+
+	// The system every Transform lives in
+	static TransformSystem& Global();
+
+	TransformSystem();
+
+	// New transform at the origin with no rotation and unit scale
+	uint32_t Create(Transform* owner = nullptr);
+	void Destroy(uint32_t transform);
+
+	DirectX::XMFLOAT3 GetPosition(uint32_t transform) const;
+	DirectX::XMFLOAT4 GetRotation(uint32_t transform) const;	// quaternion
+	DirectX::XMFLOAT3 GetScale(uint32_t transform) const;
+	void SetPosition(uint32_t transform, const DirectX::XMFLOAT3& position);
+	void SetRotation(uint32_t transform, const DirectX::XMFLOAT4& rotation);
+	void SetScale(uint32_t transform, const DirectX::XMFLOAT3& scale);
+
+	// Sets each transform's rotation "t" of the way from "from[i]" to
+	// "to[i]", batched through Quaternions::Slerp() or Nlerp()
+	void InterpolateRotations(const uint32_t* transforms, const DirectX::XMFLOAT4* from, const DirectX::XMFLOAT4* to,
+		float t, size_t count, bool slerp = true);
+
+	// Parents go through to the hierarchy, INVALID_HANDLE for none
+	// - GetParent() is the parent's owner from Create()
+	bool SetParent(uint32_t transform, uint32_t parent);
+	Transform* GetParent(uint32_t transform) const;
+
+	// Builds every dirty local matrix, then the world matrices
+	void Update();
+
+	// Valid after Update()
+	const DirectX::XMFLOAT4X4& GetLocal(uint32_t transform) const;
+	const DirectX::XMFLOAT4X4& GetWorld(uint32_t transform) const;
+	const DirectX::XMFLOAT4X4& GetWorldInverseTranspose(uint32_t transform) const;
+
+	// AVX is used when the CPU and OS support it, turning it off
+	// falls back to the SSE kernel
+	static bool IsAVXSupported();
+	void SetAVX(bool enabled);
+	bool IsAVX() const { return avx; }
+
+	uint32_t GetCount() const { return count; }
+	const TransformHierarchy& GetHierarchy() const { return hierarchy; }
+	const UpdateStats& GetLastUpdateStats() const { return lastStats; }
+
+private:
+	// components by slot, padded to a multiple of 8 with identity
+	// transforms so the kernels never need a tail loop
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<uint8_t> dirty;
+	std::vector<uint32_t> nodes;		// in the hierarchy
+	std::vector<uint32_t> handles;
+	uint32_t count = 0;
+
+	// handle -> slot, INVALID_HANDLE when free
+	std::vector<uint32_t> slots;
+	std::vector<uint32_t> freeHandles;
+
+	// first slot that could be dirty, "count" if none are
+	uint32_t firstDirty = 0;
+	bool avx;
+	TransformHierarchy hierarchy;
+	UpdateStats lastStats = {};
+
+	void MarkDirty(uint32_t slot);
+	void CopySlot(uint32_t from, uint32_t to);
+	template<class Lanes> uint32_t BuildLocals();
+};
@@ -8,10 +8,20 @@
 #include <unordered_map>
 #include <string>
 #include <format>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <algorithm>
+#include <random>
+#include <cfloat>
 
 #include "Window.h"
 #include "Input.h"
 #include "Sky.h"
+#include "Tangents.h"
+#include "Quaternions.h"
+#include "ObjectMatrices.h"
+#include "ParallelFor.h"
 
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
@@ -56,6 +66,101 @@ void Game::BuildUI() {
 			ImGui::Text("Frame rate: %f fps", ImGui::GetIO().Framerate);
 			ImGui::Text("Window Client Size: %dx%d", Window::Width(), Window::Height());
 
+			ImGui::Spacing();
+			ImGui::Checkbox("Frustum Culling", &frustumCulling);
+			ImGui::Text("Entities: %u visible, %u culled (%.3f ms)", frustumStats.visible, frustumStats.culled, frustumStats.ms);
+
+			ImGui::Spacing();
+			ImGui::Checkbox("Level of Detail", &lodEnabled);
+			ImGui::DragFloat("LOD Error (px)", &lodErrorPixels, 0.05f, 0.0f, 50.0f, "%.2f");
+			ImGui::DragFloat("Cull Size (px)", &lodCullPixels, 0.1f, 0.0f, 100.0f, "%.1f");
+			ImGui::Text("Triangles drawn: %zu", lodTrianglesDrawn);
+			for (size_t i = 0; i < lodEntityCounts.size(); i++)
+				ImGui::Text("LOD %zu: %d entities", i, lodEntityCounts[i]);
+			ImGui::Text("Culled: %d entities", lodCulledCount);
+
+			ImGui::Spacing();
+			ImGui::Checkbox("Meshlet Culling", &meshletCulling);
+			ImGui::Text("Meshlets: %zu / %zu drawn (%zu frustum, %zu backface culled)",
+				meshletStats.visibleMeshlets, meshletStats.meshlets, meshletStats.frustumCulled, meshletStats.backfaceCulled);
+			ImGui::Text("Meshlet triangles: %zu / %zu drawn", meshletStats.visibleTriangles, meshletStats.triangles);
+			ImGui::Text("Meshlet cull time: %.3f ms", meshletCullMs);
+
+			ImGui::Spacing();
+			ImGui::Checkbox("Sort Draws", &renderSorting);
+			ImGui::Text("Draws: %u (sort %.3f ms, %u radix passes)", renderSortStats.items, renderSortStats.ms, renderSortStats.passes);
+			ImGui::Text("Unsorted changes: %u shaders, %u materials, %u meshes",
+				unsortedChanges.shaders, unsortedChanges.materials, unsortedChanges.meshes);
+			ImGui::Text("Submitted changes: %u shaders, %u materials, %u meshes",
+				sortedChanges.shaders, sortedChanges.materials, sortedChanges.meshes);
+
+			ImGui::Spacing();
+			ImGui::Checkbox("Instanced Drawing", &instancing);
+			ImGui::DragInt("Most Instances", &maxBatchInstances, 1.0f, 2, 65536);
+			ImGui::Text("Draw calls: %u for %u draws, %u instanced (largest %u, %.3f ms)", instancingStats.batches,
+				instancingStats.draws, instancingStats.instanced, instancingStats.largest, instancingStats.ms);
+
+			ImGui::Spacing();
+			ImGui::Checkbox("Record Draws", &recordDraws);
+			const char* backendItems[] = { "D3D11", "Null (draws nothing)", "Validation (draws nothing)" };
+			ImGui::Combo("Command Backend", &commandBackend, backendItems, IM_ARRAYSIZE(backendItems));
+			if (recordDraws) {
+				ImGui::Text("Commands: %u, %zu bytes from %u threads (record %.3f ms, execute %.3f ms)", recordStats.commands,
+					recordStats.bytes, recordStats.chunks, recordStats.recordMs, recordStats.executeMs);
+				if (commandBackend == NullBackend)
+					ImGui::Text("Null: %llu draws", nullBackend.GetCount(CommandType::DrawIndexed) + nullBackend.GetCount(CommandType::DrawIndexedInstanced));
+				if (commandBackend == ValidationBackend) {
+					ImGui::Text("Validation: %llu draws, %llu errors", validationBackend.GetDraws(), validationBackend.GetErrorCount());
+					for (size_t e = 0; e < (std::min)(validationBackend.GetErrors().size(), (size_t)5); e++)
+						ImGui::Text("  %s", validationBackend.GetErrors()[e].c_str());
+				}
+			}
+
+			ImGui::Spacing();
+			bool filterBinds = StateCache::IsFiltering();
+			if (ImGui::Checkbox("Filter Redundant Binds", &filterBinds)) StateCache::SetFiltering(filterBinds);
+			if (ImGui::BeginTable("##Binds", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+				ImGui::TableSetupColumn("Binds");
+				ImGui::TableSetupColumn("Issued");
+				ImGui::TableSetupColumn("Filtered");
+				ImGui::TableHeadersRow();
+				auto row = [](const char* name, const StateCache::Counts& counts) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn(); ImGui::Text("%s", name);
+					ImGui::TableNextColumn(); ImGui::Text("%u", counts.issued);
+					ImGui::TableNextColumn(); ImGui::Text("%u", counts.filtered);
+				};
+				row("Shaders & Layouts", stateCacheStats.shaders);
+				row("Constant Buffers", stateCacheStats.constantBuffers);
+				row("Shader Resources", stateCacheStats.shaderResources);
+				row("Samplers", stateCacheStats.samplers);
+				row("Render States", stateCacheStats.states);
+				row("Vertex & Index Buffers", stateCacheStats.inputAssembler);
+				ImGui::EndTable();
+			}
+			ImGui::Text("State objects: %u (%u requests shared one)", StateCache::GetStateObjectCount(), StateCache::GetStateObjectsShared());
+			ImGui::Text("Geometry buffer binds: %u (%u skipped)", geometryBindStats.binds, geometryBindStats.skipped);
+			for (const auto& pool : GeometryPool::GetAll()) {
+				RangeAllocator::Stats v = pool->GetVertexStats();
+				RangeAllocator::Stats i = pool->GetIndexStats();
+				ImGui::Text("Pool (%u byte vertices): %u / %u vertices, %u / %u indices",
+					pool->GetVertexStride(), v.used, v.capacity, i.used, i.capacity);
+				ImGui::Text("  free blocks %u / %u, fragmentation %.1f%% / %.1f%%",
+					v.freeBlocks, i.freeBlocks, v.fragmentation * 100.0f, i.fragmentation * 100.0f);
+			}
+
+			ImGui::Spacing();
+			TransformSystem& transforms = TransformSystem::Global();
+			bool transformAVX = transforms.IsAVX();
+			ImGui::BeginDisabled(!TransformSystem::IsAVXSupported());
+			if (ImGui::Checkbox("AVX Transforms", &transformAVX)) transforms.SetAVX(transformAVX);
+			ImGui::EndDisabled();
+			const TransformSystem::UpdateStats& transformStats = transforms.GetLastUpdateStats();
+			const TransformHierarchy::UpdateStats& hierarchyStats = transforms.GetHierarchy().GetLastUpdateStats();
+			ImGui::Text("Transforms: %u (last update: %u local, %u world%s, %.3f ms)", transforms.GetCount(),
+				transformStats.rebuilt, hierarchyStats.updated, hierarchyStats.resorted ? ", resorted" : "", transformStats.ms);
+			ImGui::Text("Object matrices: %zu (%.3f ms)", objectMatrices.size(), objectMatricesMs);
+
 			ImGui::Spacing();
 		}
 
@@ -90,6 +195,7 @@ void Game::BuildUI() {
 		UIEntities();
 		UIShadowMap();
 		UIPostProcessing();
+		UIBenchmarks();
 	}
 	ImGui::End();
 }
@@ -126,20 +232,54 @@ void Game::UILights() {
 		ImGui::Indent();
 		const char* lightTypeItems[] = { "Directional", "Point", "Spot" };
 
-		for (size_t i = 0; i < lights.size(); ++i) {
-			Light& light = lights[i];
-			const char* typeStr = lightTypeItems[light.Type];
-
-			if (i == 0) {
-				// Clickable selectable list
-				if (ImGui::Selectable("Shadow Casting Light", selectedLightIndex == i)) {
-					selectedLightIndex = static_cast<int>(i);
+		// how lights are assigned, and random lights to push it
+		const char* assignmentItems[] = { "Every Light", "Clustered", "Per Entity" };
+		ImGui::Text("Light Assignment:");
+		ImGui::Combo("##Light Assignment", &lightAssignment, assignmentItems, IM_ARRAYSIZE(assignmentItems));
+		ImGui::Text("Extra Lights:");
+		if (ImGui::SliderInt("##Extra Lights", &extraLightCount, 0, 10000)) {
+			SetExtraLights(extraLightCount);
+		}
+		if (lightAssignment == ClusteredLights) {
+			ImGui::Text("Point/spot lights: %u, %u in view (%u threads)",
+				clusterStats.lights, clusterStats.inView, clusterStats.threads);
+			ImGui::Text("Cluster lists: %u indices, %u at most in one", clusterStats.indices, clusterStats.maxPerCluster);
+			ImGui::Text("Binning: %.3f ms, upload %.3f ms", clusterStats.ms, clusterUploadMs);
+		}
+		else if (lightAssignment == PerEntityLights) {
+			ImGui::Text("Most lights per entity:");
+			ImGui::SliderInt("##Most Lights Per Entity", &maxEntityLights, 1, MAX_LIGHTS);
+			ImGui::Text("Entities: %u, lights: %u, %llu pairs tested", entityLightStats.entities,
+				entityLightStats.lights, (unsigned long long)entityLightStats.tests);
+			ImGui::Text("Assigned: %u (%.1f per entity), dropped %u", entityLightStats.assigned,
+				entityLightStats.entities ? (float)entityLightStats.assigned / entityLightStats.entities : 0.0f,
+				entityLightStats.dropped);
+			ImGui::Text("Assignment: %.3f ms", entityLightStats.ms);
+		}
+		else if (lights.size() > MAX_LIGHTS) {
+			ImGui::Text("Only the first %d lights are shaded", MAX_LIGHTS);
+		}
+		ImGui::Spacing();
+
+		// only the rows on screen, there can be thousands
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(lights.size()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				Light& light = lights[i];
+				const char* typeStr = lightTypeItems[light.Type];
+
+				if (i == 0) {
+					// Clickable selectable list
+					if (ImGui::Selectable("Shadow Casting Light", selectedLightIndex == i)) {
+						selectedLightIndex = i;
+					}
 				}
-			}
-			else {
-				// Clickable selectable list
-				if (ImGui::Selectable(std::format("light [{}] ({})", i, typeStr).c_str(), selectedLightIndex == i)) {
-					selectedLightIndex = static_cast<int>(i);
+				else {
+					// Clickable selectable list
+					if (ImGui::Selectable(std::format("light [{}] ({})", i, typeStr).c_str(), selectedLightIndex == i)) {
+						selectedLightIndex = i;
+					}
 				}
 			}
 		}
@@ -487,11 +627,25 @@ void Game::UIEditTextureMap(const std::shared_ptr<Material>& mat, const std::str
 void Game::UIEntities() {
 	if (ImGui::CollapsingHeader("Entities")) {
 		ImGui::Indent();
-		for (int i = 0; i < lEntities.size(); i++) {
-			const std::string& name = lEntities[i]->GetName();
-			bool selected = (selectedEntityIndex == i);
-			if (ImGui::Selectable(std::format("{}", name).c_str(), selected)) {
-				selectedEntityIndex = i;
+		ImGui::TextDisabled("Click an entity in the viewport to select it");
+		ImGui::Text("Extra Entities:");
+		if (ImGui::SliderInt("##Extra Entities", &extraEntityCount, 0, 10000)) {
+			SetExtraEntities(extraEntityCount);
+		}
+		if (pickMs > 0) {
+			if (pickedName.empty()) ImGui::Text("Last pick: nothing (%.3f ms)", pickMs);
+			else ImGui::Text("Last pick: %s, triangle %u (%.3f ms)", pickedName.c_str(), pickHit.triangle, pickMs);
+		}
+		// only the rows on screen, extras can run to thousands
+		ImGuiListClipper clipper;
+		clipper.Begin(static_cast<int>(lEntities.size()));
+		while (clipper.Step()) {
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+				const std::string& name = lEntities[i]->GetName();
+				bool selected = (selectedEntityIndex == i);
+				if (ImGui::Selectable(std::format("{}##{}", name, i).c_str(), selected)) {
+					selectedEntityIndex = i;
+				}
 			}
 		}
 		ImGui::Unindent();
@@ -532,9 +686,29 @@ void Game::UIEntityDetails(std::shared_ptr<GameEntity> entity) {
 	if (trans) {
 		UITransform(*trans);
 	}
+
+	bool isStatic = entity->IsStatic();
+	if (ImGui::Checkbox("Static", &isStatic)) entity->SetStatic(isStatic);
 }
 void Game::UITransform(Transform& transform) {
 	if (ImGui::CollapsingHeader("Transform")) {
+		// any entity can be a parent, SetParent() refuses loops
+		Transform* parent = transform.GetParent();
+		const char* parentName = "None";
+		for (const auto& e : lEntities)
+			if (e->GetTransform().get() == parent) parentName = e->GetName();
+		if (ImGui::BeginCombo("Parent", parent ? parentName : "None")) {
+			if (ImGui::Selectable("None", parent == nullptr)) transform.SetParent(nullptr);
+			for (const auto& e : lEntities) {
+				Transform* t = e->GetTransform().get();
+				if (t == &transform) continue;
+				bool selected = (t == parent);
+				if (ImGui::Selectable(e->GetName(), selected)) transform.SetParent(t);
+				if (selected) ImGui::SetItemDefaultFocus();
+			}
+			ImGui::EndCombo();
+		}
+
 		XMFLOAT3 pos = transform.GetPosition();
 		ImGui::Text("Position");
 		if (ImGui::DragFloat3("##Position", reinterpret_cast<float*>(&pos), 0.1f)) {
@@ -590,6 +764,20 @@ void Game::UIMesh(std::shared_ptr<Mesh>& targetMesh) {
 			ImGui::Text("Triangles: %d", targetMesh->GetTriCount());
 			ImGui::Text("Vertices: %d", targetMesh->GetVertexCount());
 			ImGui::Text("Indices: %d", targetMesh->GetIndexCount());
+			ImGui::Text("Vertices before welding: %d", targetMesh->GetLoadStats().sourceVertices);
+			ImGui::Text("Weld time: %.3f ms", targetMesh->GetLoadStats().weldMs);
+			ImGui::Text("Vertex cache optimize time: %.3f ms", targetMesh->GetLoadStats().optimizeMs);
+			ImGui::Text("Tangent time: %.3f ms", targetMesh->GetLoadStats().tangentMs);
+			ImGui::Text("Loaded from: %s", targetMesh->GetLoadStats().fromCache ? ".meshbin" : ".obj");
+			ImGui::Text("Load time: %.3f ms", targetMesh->GetLoadStats().loadMs);
+			ImGui::Text("Vertex format: %s (%d bytes)", targetMesh->IsPacked() ? "packed" : "full", targetMesh->GetVertexStride());
+			ImGui::Text("LOD generation time: %.3f ms", targetMesh->GetLoadStats().simplifyMs);
+			ImGui::Text("Meshlets: %d (%.3f ms)", (int)targetMesh->GetMeshlets().size(), targetMesh->GetLoadStats().meshletMs);
+			ImGui::Text("BVH nodes: %d (%.3f ms)", (int)targetMesh->GetBVH().GetNodes().size(), targetMesh->GetLoadStats().bvhMs);
+			for (UINT i = 0; i < targetMesh->GetLODCount(); i++) {
+				const MeshLOD& lod = targetMesh->GetLOD(i);
+				ImGui::Text("LOD %d: %d triangles, error %.4f", i, lod.indexCount / 3, lod.error);
+			}
 			ImGui::EndPopup();
 		}
 	}
@@ -627,18 +815,73 @@ void Game::UIMaterial(std::shared_ptr<Material>& targetMat)
 // ====== Shadow Map =========
 void Game::UIShadowMap() {
 	if (ImGui::CollapsingHeader("Shadow Map")) {
-		ImGui::Image(reinterpret_cast<ImTextureID>(shadowSRV.Get()), ImVec2(rtWidth, rtWidth));
+		ImGui::Image(reinterpret_cast<ImTextureID>(shadowPreviewSRV.Get()), ImVec2(rtWidth, rtWidth));
+		ImGui::Text("Showing Cascade:");
+		if (ImGui::SliderInt("##Preview", &shadowPreviewCascade, 0, shadowCascadeCount - 1)) {
+			shadowCacheValid = false;
+		}
+
+		ImGui::Text("Shadow Distance:");
+		ImGui::SliderFloat("##Distance", &shadowDistance, 1, 200);
 
-		ImGui::Text("Projection Size:");
-		if (ImGui::SliderFloat("##Size", &lightProjectionSize, 0.5, 100)) {
-			ResizeShadowMap();
+		ImGui::Text("Cascades:");
+		if (ImGui::SliderInt("##Cascades", &shadowCascadeCount, 1, ShadowCascades::MAX_CASCADES)) {
+			shadowPreviewCascade = (std::min)(shadowPreviewCascade, shadowCascadeCount - 1);
+			shadowCacheValid = false;
 		}
 
+		ImGui::Text("Split Blend (uniform to logarithmic):");
+		ImGui::SliderFloat("##Lambda", &shadowCascadeLambda, 0, 1);
+
 		ImGui::Text("Shadow Map Resolution (px):");
 		if (ImGui::SliderInt("##Resolution", &shadowMapResolution, 2, 2048)) {
 			shadowMapResolution = (shadowMapResolution / 2) * 2;
 			CreateShadowMapResources();
 		}
+
+		ImGui::Checkbox("Shadow Caster Culling", &shadowCasterCulling);
+		ImGui::Text("Caster Reach (toward the light):");
+		ImGui::SliderFloat("##CasterReach", &shadowCasterReach, 0, 500);
+		ImGui::Text("Casters: %u drawn, %u culled (%.3f ms)",
+			shadowCasterStats.visible, shadowCasterStats.culled, shadowCasterStats.ms);
+		ImGui::Text("Cascade fit: %.3f ms", cascadeFitMs);
+
+		if (ImGui::BeginTable("Cascades", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+			ImGui::TableSetupColumn("Cascade");
+			ImGui::TableSetupColumn("Depths");
+			ImGui::TableSetupColumn("Width");
+			ImGui::TableSetupColumn("Texel");
+			ImGui::TableSetupColumn("Casters");
+			ImGui::TableSetupColumn("Redrawn");
+			ImGui::TableHeadersRow();
+			for (int c = 0; c < shadowCascadeCount; c++) {
+				const ShadowCascades::Cascade& cascade = shadowCascades[c];
+				const CascadeCasters& casters = cascadeCasters[c];
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%d", c);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f - %.2f", cascade.splitNear, cascade.splitFar);
+				ImGui::TableNextColumn(); ImGui::Text("%.2f", cascade.radius * 2.0f);
+				ImGui::TableNextColumn(); ImGui::Text("%.4f", cascade.texelSize);
+				ImGui::TableNextColumn(); ImGui::Text("%u (%u culled)", casters.stats.visible, casters.stats.culled);
+				ImGui::TableNextColumn(); ImGui::Text("%s", casters.redrawn ? "yes" : "no");
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::Spacing();
+		ImGui::Checkbox("Cache Shadow Map", &shadowCaching);
+		ImGui::Checkbox("Static/Dynamic Split", &shadowStaticSplit);
+		size_t staticCount = 0, dynamicCount = 0;
+		for (int c = 0; c < shadowCascadeCount; c++) {
+			staticCount += cascadeCasters[c].staticStates.size();
+			dynamicCount += cascadeCasters[c].dynamicStates.size();
+		}
+		ImGui::Text("Static casters: %zu, dynamic: %zu (all cascades)", staticCount, dynamicCount);
+		ImGui::Text("Frames skipped: %u / %u (static map reused %u)",
+			shadowCacheStats.skipped, shadowCacheStats.frames, shadowCacheStats.staticReused);
+		ImGui::Text("Shadow pass: %.3f ms (full redraw %.3f ms, %.1f ms CPU saved)",
+			shadowCacheStats.lastMs, shadowCacheStats.fullMs, shadowCacheStats.savedMs);
+		if (ImGui::Button("Reset Counters")) shadowCacheStats = {};
 	}
 }
 
@@ -692,8 +935,8 @@ void Game::UIRenderPasses() {
 	if (!showRenderPasses) return;
 
 	if(ImGui::Begin("Render Passes")) {
-		ImGui::Text("Shadow Map:");
-		ImGui::Image(reinterpret_cast<ImTextureID>(shadowSRV.Get()), ImVec2(rtWidth, rtWidth));
+		ImGui::Text("Shadow Map (cascade %d):", shadowPreviewCascade);
+		ImGui::Image(reinterpret_cast<ImTextureID>(shadowPreviewSRV.Get()), ImVec2(rtWidth, rtWidth));
 
 		ImGui::Text("Before Blur:");
 		ImGui::Image(reinterpret_cast<ImTextureID>(ppBlurSRV.Get()), ImVec2(rtWidth, rtHeight));
@@ -725,4 +968,1625 @@ void Game::UIDetailsChromaticAberration() {
 
 	ImGui::Text("Before Abberation:");
 	ImGui::Image(reinterpret_cast<ImTextureID>(ppChromaticSRV.Get()), ImVec2(rtWidth, rtHeight));
-}
\ No newline at end of file
+}
+
+// ====== Benchmarks =========
+void Game::UIBenchmarks() {
+	if (ImGui::CollapsingHeader("Benchmarks")) {
+		ImGui::Indent();
+		UIBenchmarkOBJ();
+		UIBenchmarkParallelOBJ();
+		UIBenchmarkWelding();
+		UIBenchmarkMeshCache();
+		UIBenchmarkVertexCache();
+		UIBenchmarkVertexPacking();
+		UIBenchmarkLOD();
+		UIBenchmarkMeshlets();
+		UIBenchmarkTangents();
+		UIBenchmarkBVH();
+		UIBenchmarkAllocator();
+		UIBenchmarkHierarchy();
+		UIBenchmarkTransforms();
+		UIBenchmarkRotations();
+		UIBenchmarkObjectMatrices();
+		UIBenchmarkLightClusters();
+		UIBenchmarkEntityLights();
+		UIBenchmarkRenderQueue();
+		UIBenchmarkInstancing();
+		UIBenchmarkCommandBuffers();
+		ImGui::Unindent();
+	}
+}
+
+void Game::UIBenchmarkOBJ() {
+	if (!ImGui::TreeNode("OBJ Parsing")) return;
+
+	static int iterations = 10;
+	ImGui::SliderInt("Iterations##OBJ", &iterations, 1, 100);
+	if (ImGui::Button("Run##OBJ")) {
+		// every model in the assets folder
+		std::vector<std::string> paths;
+		for (const auto& entry : std::filesystem::directory_iterator(FixPath("../../Assets/Models/")))
+			if (entry.path().extension() == ".obj") paths.push_back(entry.path().string());
+		objBenchResults = MeshLoader::BenchmarkOBJ(paths, iterations);
+	}
+
+	if (!objBenchResults.empty() && ImGui::BeginTable("##OBJ Results", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("File");
+		ImGui::TableSetupColumn("KB");
+		ImGui::TableSetupColumn("Legacy ms");
+		ImGui::TableSetupColumn("Mapped ms");
+		ImGui::TableSetupColumn("Legacy MB/s");
+		ImGui::TableSetupColumn("Mapped MB/s");
+		ImGui::TableHeadersRow();
+
+		size_t totalBytes = 0;
+		double totalLegacy = 0, totalMapped = 0;
+		auto row = [](const char* file, size_t bytes, double legacyMs, double mappedMs) {
+			double mb = bytes / (1024.0 * 1024.0);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", file);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", bytes / 1024.0);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", legacyMs);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", mappedMs);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", legacyMs > 0 ? mb / (legacyMs / 1000.0) : 0.0);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", mappedMs > 0 ? mb / (mappedMs / 1000.0) : 0.0);
+		};
+		for (const auto& r : objBenchResults) {
+			row(std::filesystem::path(r.file).filename().string().c_str(), r.bytes, r.legacyMs, r.mappedMs);
+			totalBytes += r.bytes;
+			totalLegacy += r.legacyMs;
+			totalMapped += r.mappedMs;
+		}
+		row("Total", totalBytes, totalLegacy, totalMapped);
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkParallelOBJ() {
+	if (!ImGui::TreeNode("Parallel OBJ Parsing")) return;
+
+	static int gridSize = 1500;
+	static int iterations = 3;
+	ImGui::SliderInt("Grid Size##ParallelOBJ", &gridSize, 100, 2500);
+	ImGui::SameLine(); ImGui::TextDisabled("(%.2fM faces)", gridSize * gridSize / 1000000.0f);
+	ImGui::SliderInt("Iterations##ParallelOBJ", &iterations, 1, 10);
+	if (ImGui::Button("Run##ParallelOBJ")) {
+		// the same counts on every machine so runs compare, past the
+		// core count the extra threads just show the oversubscription cost
+		std::vector<unsigned int> threadCounts = { 1, 2, 4, 8, 16 };
+
+		std::string text = MeshLoader::GenerateSyntheticOBJ(gridSize);
+		parallelOBJBenchBytes = text.size();
+		parallelOBJBenchResults = MeshLoader::BenchmarkParallelOBJ(text, threadCounts, iterations);
+	}
+
+	if (!parallelOBJBenchResults.empty() && ImGui::BeginTable("##Parallel OBJ Results", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Threads");
+		ImGui::TableSetupColumn("ms");
+		ImGui::TableSetupColumn("MB/s");
+		ImGui::TableSetupColumn("Speedup");
+		ImGui::TableSetupColumn("Matches Serial");
+		ImGui::TableHeadersRow();
+
+		double mb = parallelOBJBenchBytes / (1024.0 * 1024.0);
+		double baseMs = parallelOBJBenchResults[0].ms;
+		for (const auto& r : parallelOBJBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.threads);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", r.ms);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", r.ms > 0 ? mb / (r.ms / 1000.0) : 0.0);
+			ImGui::TableNextColumn(); ImGui::Text("%.2fx", r.ms > 0 ? baseMs / r.ms : 0.0);
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.matchesSerial ? "Yes" : "No");
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkWelding() {
+	if (!ImGui::TreeNode("Vertex Welding")) return;
+
+	if (ImGui::BeginTable("##Weld Results", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Mesh");
+		ImGui::TableSetupColumn("Before");
+		ImGui::TableSetupColumn("After");
+		ImGui::TableSetupColumn("Ratio");
+		ImGui::TableSetupColumn("Weld ms");
+		ImGui::TableHeadersRow();
+
+		for (const auto& [name, mesh] : umMeshes) {
+			const MeshLoadStats& stats = mesh->GetLoadStats();
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", name.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%d", stats.sourceVertices);
+			ImGui::TableNextColumn(); ImGui::Text("%d", mesh->GetVertexCount());
+			ImGui::TableNextColumn(); ImGui::Text("%.2fx", mesh->GetVertexCount() ? (float)stats.sourceVertices / mesh->GetVertexCount() : 0.0f);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.weldMs);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkMeshCache() {
+	if (!ImGui::TreeNode("Mesh Cache")) return;
+
+	// what actually happened when this launch loaded its meshes
+	double startupMs = 0;
+	int cached = 0;
+	for (const auto& [name, mesh] : umMeshes) {
+		startupMs += mesh->GetLoadStats().loadMs;
+		if (mesh->GetLoadStats().fromCache) cached++;
+	}
+	ImGui::Text("This launch: %.3f ms for %d meshes (%d from .meshbin)", startupMs, (int)umMeshes.size(), cached);
+
+	if (ImGui::Button("Run##MeshCache")) {
+		meshCacheBenchResults.clear();
+		for (const auto& entry : std::filesystem::directory_iterator(FixPath("../../Assets/Models/"))) {
+			if (entry.path().extension() != ".obj") continue;
+			std::string path = entry.path().string();
+
+			// parse/weld/tangents every time, no cache involved
+			MeshLoadOptions noCache;
+			noCache.useCache = false;
+			Mesh fromObj("bench", path.c_str(), noCache);
+
+			// first construction makes sure the cache is current
+			Mesh warmup("bench", path.c_str());
+			Mesh fromCache("bench", path.c_str());
+
+			meshCacheBenchResults.push_back({ entry.path().filename().string(), fromObj.GetLoadStats().loadMs, fromCache.GetLoadStats().loadMs });
+		}
+	}
+
+	if (!meshCacheBenchResults.empty() && ImGui::BeginTable("##Mesh Cache Results", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("File");
+		ImGui::TableSetupColumn(".obj ms");
+		ImGui::TableSetupColumn(".meshbin ms");
+		ImGui::TableSetupColumn("Speedup");
+		ImGui::TableHeadersRow();
+
+		double totalObj = 0, totalCache = 0;
+		auto row = [](const char* file, double objMs, double cacheMs) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", file);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", objMs);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", cacheMs);
+			ImGui::TableNextColumn(); ImGui::Text("%.1fx", cacheMs > 0 ? objMs / cacheMs : 0.0);
+		};
+		for (const auto& r : meshCacheBenchResults) {
+			row(r.file.c_str(), r.objMs, r.cacheMs);
+			totalObj += r.objMs;
+			totalCache += r.cacheMs;
+		}
+		row("Total", totalObj, totalCache);
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkVertexCache() {
+	if (!ImGui::TreeNode("Vertex Cache Optimization")) return;
+
+	static int cacheSize = 16;
+	static int model = MeshOptimizer::FIFO;
+	ImGui::SliderInt("Cache Size##VertexCache", &cacheSize, 4, 64);
+	ImGui::Combo("Cache Model##VertexCache", &model, "FIFO\0LRU\0");
+	if (ImGui::Button("Run##VertexCache")) {
+		vertexCacheBenchResults.clear();
+		for (const auto& entry : std::filesystem::directory_iterator(FixPath("../../Assets/Models/"))) {
+			if (entry.path().extension() != ".obj") continue;
+
+			// same steps as the mesh constructor, measured on either side of the optimizer
+			MeshData data;
+			if (!MeshLoader::LoadOBJ(entry.path().string().c_str(), data)) continue;
+			MeshLoader::WeldVertices(data);
+
+			VertexCacheBenchResult r = {};
+			r.file = entry.path().filename().string();
+			r.triangles = data.indices.size() / 3;
+			r.before = MeshOptimizer::AnalyzeVertexCache(data.indices.data(), data.indices.size(),
+				data.vertices.size(), cacheSize, (MeshOptimizer::CacheModel)model);
+
+			auto start = std::chrono::steady_clock::now();
+			MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+			MeshOptimizer::OptimizeVertexFetch(data);
+			r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			r.after = MeshOptimizer::AnalyzeVertexCache(data.indices.data(), data.indices.size(),
+				data.vertices.size(), cacheSize, (MeshOptimizer::CacheModel)model);
+			vertexCacheBenchResults.push_back(r);
+		}
+	}
+
+	if (!vertexCacheBenchResults.empty() && ImGui::BeginTable("##Vertex Cache Results", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("File");
+		ImGui::TableSetupColumn("Triangles");
+		ImGui::TableSetupColumn("ACMR Before");
+		ImGui::TableSetupColumn("ACMR After");
+		ImGui::TableSetupColumn("ATVR Before");
+		ImGui::TableSetupColumn("ATVR After");
+		ImGui::TableSetupColumn("Optimize ms");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : vertexCacheBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.file.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%zu", r.triangles);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.before.acmr);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.after.acmr);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.before.atvr);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.after.atvr);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.ms);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkVertexPacking() {
+	if (!ImGui::TreeNode("Vertex Packing")) return;
+
+	static VertexPacking::PackingTolerance tolerance;
+	ImGui::DragFloat("Position (relative)##Packing", &tolerance.positionRelative, 0.00001f, 0.0f, 0.01f, "%.6f");
+	ImGui::DragFloat("UV##Packing", &tolerance.uv, 0.0001f, 0.0f, 0.1f, "%.4f");
+	ImGui::DragFloat("Normal degrees##Packing", &tolerance.normalDegrees, 0.01f, 0.0f, 5.0f, "%.3f");
+	ImGui::DragFloat("Tangent degrees##Packing", &tolerance.tangentDegrees, 0.01f, 0.0f, 5.0f, "%.3f");
+	if (ImGui::Button("Run##VertexPacking")) {
+		vertexPackingBenchResults.clear();
+		for (const auto& entry : std::filesystem::directory_iterator(FixPath("../../Assets/Models/"))) {
+			if (entry.path().extension() != ".obj") continue;
+
+			// skip the cache so the error is measured from the .obj every time
+			MeshLoadOptions options;
+			options.useCache = false;
+			options.packVertices = true;
+			options.packingTolerance = tolerance;
+			Mesh mesh("bench", entry.path().string().c_str(), options);
+
+			VertexPackingBenchResult r = {};
+			r.file = entry.path().filename().string();
+			r.vertices = mesh.GetVertexCount();
+			r.error = mesh.GetLoadStats().packingError;
+			r.packed = mesh.IsPacked();
+			vertexPackingBenchResults.push_back(r);
+		}
+	}
+
+	if (!vertexPackingBenchResults.empty() && ImGui::BeginTable("##Vertex Packing Results", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("File");
+		ImGui::TableSetupColumn("Position");
+		ImGui::TableSetupColumn("UV");
+		ImGui::TableSetupColumn("Normal deg");
+		ImGui::TableSetupColumn("Tangent deg");
+		ImGui::TableSetupColumn("Packed");
+		ImGui::TableSetupColumn("Full KB");
+		ImGui::TableSetupColumn("Packed KB");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : vertexPackingBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.file.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%.2e", r.error.positionRelative);
+			ImGui::TableNextColumn(); ImGui::Text("%.2e", r.error.uv);
+			ImGui::TableNextColumn(); ImGui::Text("%.4f", r.error.normalDegrees);
+			ImGui::TableNextColumn(); ImGui::Text("%.4f", r.error.tangentDegrees);
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.packed ? "yes" : "no (over tolerance)");
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", r.vertices * sizeof(Vertex) / 1024.0f);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", r.vertices * sizeof(PackedVertex) / 1024.0f);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkLOD() {
+	if (!ImGui::TreeNode("LOD Generation")) return;
+
+	static int levels = 4;
+	static float reduction = 0.5f;
+	ImGui::SliderInt("Levels##LOD", &levels, 2, 8);
+	ImGui::SliderFloat("Reduction##LOD", &reduction, 0.1f, 0.9f, "%.2f");
+	if (ImGui::Button("Run##LOD")) {
+		lodBenchResults.clear();
+		for (const auto& entry : std::filesystem::directory_iterator(FixPath("../../Assets/Models/"))) {
+			if (entry.path().extension() != ".obj") continue;
+
+			// same steps as the mesh constructor, up to the LOD chain
+			MeshData data;
+			if (!MeshLoader::LoadOBJ(entry.path().string().c_str(), data)) continue;
+			MeshLoader::WeldVertices(data);
+			MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+			MeshOptimizer::OptimizeVertexFetch(data);
+
+			LODBenchResult r = {};
+			r.file = entry.path().filename().string();
+			r.ms = MeshSimplifier::GenerateLODs(data.vertices, data.indices, levels, reduction, true, r.lods).ms;
+			lodBenchResults.push_back(r);
+		}
+	}
+
+	if (!lodBenchResults.empty() && ImGui::BeginTable("##LOD Results", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("File");
+		ImGui::TableSetupColumn("Triangles per LOD");
+		ImGui::TableSetupColumn("Coarsest error");
+		ImGui::TableSetupColumn("Simplify ms");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : lodBenchResults) {
+			std::string triangles;
+			for (const MeshLOD& lod : r.lods)
+				triangles += std::format("{}{}", triangles.empty() ? "" : " / ", lod.indexCount / 3);
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.file.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%s", triangles.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%.4f", r.lods.back().error);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.ms);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkMeshlets() {
+	if (!ImGui::TreeNode("Meshlet Culling")) return;
+
+	static int iterations = 1000;
+	ImGui::SliderInt("Iterations##Meshlets", &iterations, 1, 10000);
+	if (ImGui::Button("Run##Meshlets")) {
+		meshletBenchResults.clear();
+
+		// a ring of views around the origin plus a couple up close
+		struct View { const char* name; XMFLOAT3 eye; };
+		const View views[] = {
+			{ "Front", XMFLOAT3(0, 0, -5) },
+			{ "Side", XMFLOAT3(5, 0, 0) },
+			{ "Top", XMFLOAT3(0, 5, 0.01f) },
+			{ "Diagonal", XMFLOAT3(3, 3, -3) },
+			{ "Close", XMFLOAT3(0, 0, -1.2f) },
+			{ "Close offset", XMFLOAT3(0.5f, 0, -1.5f) },
+		};
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, Window::AspectRatio(), 0.01f, 100.0f);
+
+		for (const char* file : { "sphere", "torus", "helix" }) {
+			MeshData data;
+			std::string path = FixPath("../../Assets/Models/" + std::string(file) + ".obj");
+			if (!MeshLoader::LoadOBJ(path.c_str(), data)) continue;
+			MeshLoader::WeldVertices(data);
+			MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+
+			std::vector<Meshlet> meshlets;
+			Meshlets::Build(data.vertices, data.indices, meshlets);
+
+			std::vector<unsigned int> visible;
+			for (const View& view : views) {
+				XMMATRIX mView = XMMatrixLookAtLH(XMLoadFloat3(&view.eye), XMVectorZero(), XMVectorSet(0, 1, 0, 0));
+				XMFLOAT4X4 viewProj;
+				XMStoreFloat4x4(&viewProj, mView * proj);
+
+				MeshletBenchResult r = {};
+				r.file = file;
+				r.view = view.name;
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < iterations; i++)
+					r.stats = Meshlets::Cull(meshlets, data.indices, viewProj, view.eye, true, visible);
+				r.us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+				meshletBenchResults.push_back(r);
+			}
+		}
+	}
+
+	if (!meshletBenchResults.empty() && ImGui::BeginTable("##Meshlet Results", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Mesh");
+		ImGui::TableSetupColumn("View");
+		ImGui::TableSetupColumn("Meshlets");
+		ImGui::TableSetupColumn("Triangles");
+		ImGui::TableSetupColumn("Culled");
+		ImGui::TableSetupColumn("Cull us");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : meshletBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.file.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.view.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%zu / %zu", r.stats.visibleMeshlets, r.stats.meshlets);
+			ImGui::TableNextColumn(); ImGui::Text("%zu / %zu", r.stats.visibleTriangles, r.stats.triangles);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f%%", r.stats.triangles ? 100.0 * (r.stats.triangles - r.stats.visibleTriangles) / r.stats.triangles : 0.0);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.us);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkTangents() {
+	if (!ImGui::TreeNode("Tangent Generation")) return;
+
+	static int gridSize = 1000;
+	static int iterations = 3;
+	ImGui::SliderInt("Grid Size##Tangents", &gridSize, 100, 2500);
+	ImGui::SameLine(); ImGui::TextDisabled("(%.2fM triangles)", gridSize * gridSize * 2 / 1000000.0f);
+	ImGui::SliderInt("Iterations##Tangents", &iterations, 1, 10);
+	if (ImGui::Button("Run##Tangents")) {
+		tangentBenchResults.clear();
+
+		std::string text = MeshLoader::GenerateSyntheticOBJ(gridSize);
+		MeshData data;
+		MeshLoader::ParseOBJ(text.data(), text.size(), data);
+		MeshLoader::WeldVertices(data);
+		tangentBenchTriangles = data.indices.size() / 3;
+
+		// scalar first, everything else is compared against it
+		std::vector<Vertex> reference = data.vertices;
+		std::vector<Vertex> vertices = data.vertices;
+		auto run = [&](const char* method, unsigned int threads) {
+			TangentBenchResult r = {};
+			r.method = method;
+			r.threads = threads;
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < iterations; i++) {
+				if (threads == 0) Tangents::CalculateScalar(reference.data(), reference.size(), data.indices.data(), data.indices.size());
+				else Tangents::CalculateParallel(vertices.data(), vertices.size(), data.indices.data(), data.indices.size(), threads);
+			}
+			r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+			if (threads > 0) {
+				for (size_t v = 0; v < vertices.size(); v++) {
+					r.maxDifference = (std::max)({ r.maxDifference,
+						fabsf(vertices[v].Tangent.x - reference[v].Tangent.x),
+						fabsf(vertices[v].Tangent.y - reference[v].Tangent.y),
+						fabsf(vertices[v].Tangent.z - reference[v].Tangent.z) });
+				}
+			}
+			tangentBenchResults.push_back(r);
+		};
+
+		run("Scalar", 0);
+		unsigned int cores = std::thread::hardware_concurrency();
+		for (unsigned int t = 1; t < cores; t *= 2) run("SSE", t);
+		run("SSE", cores ? cores : 1);
+	}
+
+	if (!tangentBenchResults.empty() && ImGui::BeginTable("##Tangent Results", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Method");
+		ImGui::TableSetupColumn("Threads");
+		ImGui::TableSetupColumn("ms");
+		ImGui::TableSetupColumn("Speedup");
+		ImGui::TableSetupColumn("Max Difference");
+		ImGui::TableHeadersRow();
+
+		double baseMs = tangentBenchResults[0].ms;
+		for (const auto& r : tangentBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.method.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.threads ? r.threads : 1);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.ms);
+			ImGui::TableNextColumn(); ImGui::Text("%.2fx", r.ms > 0 ? baseMs / r.ms : 0.0);
+			ImGui::TableNextColumn(); ImGui::Text("%g", r.maxDifference);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkBVH() {
+	if (!ImGui::TreeNode("BVH Ray Casts")) return;
+
+	static int rayCount = 100000;
+	ImGui::SliderInt("Rays##BVH", &rayCount, 1000, 1000000);
+	if (ImGui::Button("Run##BVH")) {
+		bvhBenchResults.clear();
+
+		for (const auto& entry : std::filesystem::directory_iterator(FixPath("../../Assets/Models/"))) {
+			if (entry.path().extension() != ".obj") continue;
+			MeshData data;
+			if (!MeshLoader::LoadOBJ(entry.path().string().c_str(), data)) continue;
+			MeshLoader::WeldVertices(data);
+			if (data.indices.empty()) continue;
+
+			BVHBenchResult r = {};
+			r.file = entry.path().filename().string();
+			r.triangles = data.indices.size() / 3;
+			BVH bvh;
+			r.build = bvh.Build(data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size());
+
+			// rays from a sphere around the mesh aimed at random points
+			// in its bounds, same seed every run
+			XMFLOAT3 boundsMin, boundsMax;
+			MeshLoader::ComputeBounds(data.vertices.data(), data.vertices.size(), boundsMin, boundsMax);
+			XMVECTOR center = (XMLoadFloat3(&boundsMin) + XMLoadFloat3(&boundsMax)) * 0.5f;
+			XMVECTOR extent = (XMLoadFloat3(&boundsMax) - XMLoadFloat3(&boundsMin)) * 0.5f;
+			float radius = XMVectorGetX(XMVector3Length(extent)) * 2.0f;
+			std::mt19937 rng(1234);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			std::vector<XMFLOAT3> origins(rayCount), directions(rayCount);
+			for (int i = 0; i < rayCount; i++) {
+				XMVECTOR onSphere = XMVector3Normalize(XMVectorSet(dist(rng), dist(rng), dist(rng), 0) + XMVectorSet(0, 0, 1e-6f, 0));
+				XMVECTOR target = center + extent * XMVectorSet(dist(rng), dist(rng), dist(rng), 0);
+				XMVECTOR origin = center + onSphere * radius;
+				XMStoreFloat3(&origins[i], origin);
+				XMStoreFloat3(&directions[i], target - origin);
+			}
+
+			std::vector<RayHit> hits(rayCount);
+			std::vector<bool> found(rayCount);
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < rayCount; i++) {
+				RayHit hit = {};
+				found[i] = bvh.ClosestHit(origins[i], directions[i], FLT_MAX, hit);
+				hits[i] = hit;
+			}
+			double closestSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < rayCount; i++)
+				bvh.AnyHit(origins[i], directions[i], FLT_MAX);
+			double anySec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			// brute force is slow, so it only checks a slice of the rays
+			int bruteCount = (std::min)(rayCount, 2000);
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < bruteCount; i++) {
+				RayHit hit = {};
+				bool bruteFound = BVH::ClosestHitBruteForce(data.vertices.data(), data.indices.data(), data.indices.size(),
+					origins[i], directions[i], FLT_MAX, hit);
+				if (bruteFound != found[i] || (bruteFound && hit.t != hits[i].t)) r.mismatches++;
+			}
+			double bruteSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			for (int i = 0; i < rayCount; i++) r.hits += found[i] ? 1 : 0;
+			r.closestRaysPerSec = closestSec > 0 ? rayCount / closestSec : 0;
+			r.anyRaysPerSec = anySec > 0 ? rayCount / anySec : 0;
+			r.bruteRaysPerSec = bruteSec > 0 ? bruteCount / bruteSec : 0;
+			bvhBenchResults.push_back(r);
+		}
+	}
+
+	if (!bvhBenchResults.empty() && ImGui::BeginTable("##BVH Results", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("File");
+		ImGui::TableSetupColumn("Triangles");
+		ImGui::TableSetupColumn("Nodes");
+		ImGui::TableSetupColumn("Depth");
+		ImGui::TableSetupColumn("Build ms");
+		ImGui::TableSetupColumn("Closest Mrays/s");
+		ImGui::TableSetupColumn("Any Mrays/s");
+		ImGui::TableSetupColumn("Brute Mrays/s");
+		ImGui::TableSetupColumn("Hits / Mismatches");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : bvhBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.file.c_str());
+			ImGui::TableNextColumn(); ImGui::Text("%zu", r.triangles);
+			ImGui::TableNextColumn(); ImGui::Text("%zu", r.build.nodes);
+			ImGui::TableNextColumn(); ImGui::Text("%zu", r.build.maxDepth);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.build.ms);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.closestRaysPerSec / 1000000.0);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.anyRaysPerSec / 1000000.0);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.bruteRaysPerSec / 1000000.0);
+			ImGui::TableNextColumn(); ImGui::Text("%zu / %zu", r.hits, r.mismatches);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkAllocator() {
+	if (!ImGui::TreeNode("Geometry Pool Allocator")) return;
+
+	static int operations = 20000;
+	static int maxSize = 4096;
+	ImGui::SliderInt("Operations##Allocator", &operations, 1000, 200000);
+	ImGui::SliderInt("Max Size##Allocator", &maxSize, 16, 65536);
+	if (ImGui::Button("Run##Allocator")) {
+		// random mesh sized allocations and frees, growing like the
+		// pool does, with the whole state checked after every step
+		RangeAllocator allocator(GeometryPool::INITIAL_VERTICES);
+		std::vector<uint32_t> live;
+		std::mt19937 rng(1234);
+		std::uniform_int_distribution<uint32_t> size(1, (uint32_t)maxSize);
+
+		AllocatorBenchResult r = {};
+		r.operations = operations;
+		r.valid = true;
+		double seconds = 0;
+		for (int op = 0; op < operations; op++) {
+			auto start = std::chrono::steady_clock::now();
+			if (!live.empty() && rng() % 5 < 2) {
+				size_t pick = rng() % live.size();
+				allocator.Free(live[pick]);
+				live[pick] = live.back();
+				live.pop_back();
+			}
+			else {
+				uint32_t count = size(rng);
+				uint32_t offset = allocator.Allocate(count);
+				if (offset == RangeAllocator::INVALID_OFFSET) {
+					r.grows++;
+					allocator.Grow(allocator.GetCapacity() * 2 + count);
+					offset = allocator.Allocate(count);
+				}
+				live.push_back(offset);
+			}
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			r.valid = r.valid && allocator.Validate();
+		}
+		r.us = seconds * 1000000.0 / operations;
+		r.stats = allocator.GetStats();
+		allocatorBenchResults.push_back(r);
+	}
+
+	if (!allocatorBenchResults.empty() && ImGui::BeginTable("##Allocator Results", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Operations");
+		ImGui::TableSetupColumn("us / op");
+		ImGui::TableSetupColumn("Grows");
+		ImGui::TableSetupColumn("Used / Capacity");
+		ImGui::TableSetupColumn("Free Blocks");
+		ImGui::TableSetupColumn("Fragmentation");
+		ImGui::TableSetupColumn("Valid");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : allocatorBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%d", r.operations);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.us);
+			ImGui::TableNextColumn(); ImGui::Text("%d", r.grows);
+			ImGui::TableNextColumn(); ImGui::Text("%u / %u", r.stats.used, r.stats.capacity);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.stats.freeBlocks);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f%%", r.stats.fragmentation * 100.0f);
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.valid ? "Yes" : "No");
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkHierarchy() {
+	if (!ImGui::TreeNode("Transform Hierarchy")) return;
+
+	static int nodeCount = 100000;
+	ImGui::SliderInt("Nodes##Hierarchy", &nodeCount, 1000, 200000);
+	if (ImGui::Button("Run##Hierarchy")) {
+		hierarchyBenchResults.clear();
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		auto randomLocal = [&]() {
+			XMFLOAT4X4 local;
+			XMStoreFloat4x4(&local,
+				XMMatrixRotationRollPitchYaw(dist(rng), dist(rng), dist(rng)) *
+				XMMatrixTranslation(dist(rng), dist(rng), dist(rng)));
+			return local;
+		};
+
+		for (int maxDepth : { 1, 4, 16, 64 }) {
+			// depth grows with the index, each node under a random node
+			// one level up, created shuffled so the first update sorts
+			TransformHierarchy hierarchy;
+			std::vector<uint32_t> handles(nodeCount);
+			std::vector<int> depths(nodeCount), levelStarts(maxDepth + 2, nodeCount);
+			for (int i = nodeCount - 1; i >= 0; i--) {
+				depths[i] = (int)((long long)i * (maxDepth + 1) / nodeCount);
+				levelStarts[depths[i]] = i;
+			}
+			std::vector<int> createOrder(nodeCount);
+			for (int i = 0; i < nodeCount; i++) createOrder[i] = i;
+			std::shuffle(createOrder.begin(), createOrder.end(), rng);
+			for (int i : createOrder) handles[i] = hierarchy.Create();
+
+			std::vector<XMFLOAT4X4> locals(nodeCount);
+			std::vector<int> parentOf(nodeCount, -1);
+			for (int i = 0; i < nodeCount; i++) {
+				locals[i] = randomLocal();
+				hierarchy.SetLocal(handles[i], locals[i]);
+				if (depths[i] == 0) continue;
+				int first = levelStarts[depths[i] - 1], count = levelStarts[depths[i]] - first;
+				parentOf[i] = first + (int)(rng() % count);
+				hierarchy.SetParent(handles[i], handles[parentOf[i]]);
+			}
+			hierarchy.Update();
+
+			for (float dirtyPercent : { 1.0f, 10.0f, 100.0f }) {
+				int dirtyCount = (int)(nodeCount * dirtyPercent / 100.0f);
+				for (int d = 0; d < dirtyCount; d++) {
+					int i = dirtyPercent >= 100.0f ? d : (int)(rng() % nodeCount);
+					locals[i] = randomLocal();
+					hierarchy.SetLocal(handles[i], locals[i]);
+				}
+
+				HierarchyBenchResult r = {};
+				r.nodes = nodeCount;
+				r.maxDepth = maxDepth;
+				r.dirtyPercent = dirtyPercent;
+				auto start = std::chrono::steady_clock::now();
+				hierarchy.Update();
+				r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				r.updated = hierarchy.GetLastUpdateStats().updated;
+
+				// without a hierarchy, every node multiplies its way up to the root
+				std::vector<XMFLOAT4X4> naive(nodeCount);
+				start = std::chrono::steady_clock::now();
+				for (int i = 0; i < nodeCount; i++) {
+					XMMATRIX world = XMLoadFloat4x4(&locals[i]);
+					for (int p = parentOf[i]; p >= 0; p = parentOf[p])
+						world = world * XMLoadFloat4x4(&locals[p]);
+					XMStoreFloat4x4(&naive[i], world);
+				}
+				r.naiveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				for (int i = 0; i < nodeCount; i++) {
+					const XMFLOAT4X4& flat = hierarchy.GetWorld(handles[i]);
+					for (int e = 0; e < 16; e++)
+						r.maxDifference = std::max<float>(r.maxDifference, fabsf((&naive[i]._11)[e] - (&flat._11)[e]));
+				}
+				hierarchyBenchResults.push_back(r);
+			}
+		}
+	}
+
+	if (!hierarchyBenchResults.empty() && ImGui::BeginTable("##Hierarchy Results", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Max Depth");
+		ImGui::TableSetupColumn("Dirty");
+		ImGui::TableSetupColumn("Rebuilt");
+		ImGui::TableSetupColumn("Update (ms)");
+		ImGui::TableSetupColumn("Root Walk (ms)");
+		ImGui::TableSetupColumn("Max Difference");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : hierarchyBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%d", r.maxDepth);
+			ImGui::TableNextColumn(); ImGui::Text("%.0f%%", r.dirtyPercent);
+			ImGui::TableNextColumn(); ImGui::Text("%u / %d", r.updated, r.nodes);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.ms);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.naiveMs);
+			ImGui::TableNextColumn(); ImGui::Text("%g", r.maxDifference);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkTransforms() {
+	if (!ImGui::TreeNode("Transform Matrices")) return;
+
+	static int transformCount = 100000;
+	ImGui::SliderInt("Transforms##Matrices", &transformCount, 1000, 1000000);
+	if (ImGui::Button("Run##Matrices")) {
+		transformBenchResults.clear();
+
+		// random components, same seed every run
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> scaleDist(0.25f, 4.0f);
+		std::vector<XMFLOAT3> positions(transformCount), scales(transformCount);
+		std::vector<XMFLOAT4> rotations(transformCount);
+		for (int i = 0; i < transformCount; i++) {
+			positions[i] = XMFLOAT3(dist(rng) * 100.0f, dist(rng) * 100.0f, dist(rng) * 100.0f);
+			XMStoreFloat4(&rotations[i], XMQuaternionRotationRollPitchYaw(dist(rng) * XM_PI, dist(rng) * XM_PI, dist(rng) * XM_PI));
+			scales[i] = XMFLOAT3(scaleDist(rng), scaleDist(rng), scaleDist(rng));
+		}
+
+		// what Transform::UpdateMatrices() used to do, one object at a time
+		std::vector<XMFLOAT4X4> worlds(transformCount), inverseTransposes(transformCount);
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < transformCount; i++) {
+			XMMATRIX mT = XMMatrixTranslation(positions[i].x, positions[i].y, positions[i].z);
+			XMMATRIX mR = XMMatrixRotationQuaternion(XMLoadFloat4(&rotations[i]));
+			XMMATRIX mS = XMMatrixScaling(scales[i].x, scales[i].y, scales[i].z);
+			XMMATRIX mW = mS * mR * mT;
+			XMStoreFloat4x4(&worlds[i], mW);
+			XMStoreFloat4x4(&inverseTransposes[i], XMMatrixInverse(0, XMMatrixTranspose(mW)));
+		}
+		double perObjectMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		transformBenchResults.push_back({ "Per object", transformCount, perObjectMs, transformCount / (perObjectMs / 1000.0), 0.0f });
+
+		// the batched system, including its hierarchy pass
+		for (bool avx : { false, true }) {
+			if (avx && !TransformSystem::IsAVXSupported()) continue;
+			TransformSystem system;
+			system.SetAVX(avx);
+			std::vector<uint32_t> handles(transformCount);
+			for (int i = 0; i < transformCount; i++) {
+				handles[i] = system.Create();
+				system.SetPosition(handles[i], positions[i]);
+				system.SetRotation(handles[i], rotations[i]);
+				system.SetScale(handles[i], scales[i]);
+			}
+
+			TransformBenchResult r = { avx ? "TransformSystem (AVX)" : "TransformSystem (SSE)", transformCount };
+			start = std::chrono::steady_clock::now();
+			system.Update();
+			r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			r.matricesPerSec = transformCount / (r.ms / 1000.0);
+
+			for (int i = 0; i < transformCount; i++) {
+				const XMFLOAT4X4& world = system.GetWorld(handles[i]);
+				const XMFLOAT4X4& inverseTranspose = system.GetWorldInverseTranspose(handles[i]);
+				for (int e = 0; e < 16; e++) {
+					r.maxDifference = std::max<float>(r.maxDifference, fabsf((&world._11)[e] - (&worlds[i]._11)[e]));
+					r.maxDifference = std::max<float>(r.maxDifference, fabsf((&inverseTranspose._11)[e] - (&inverseTransposes[i]._11)[e]));
+				}
+			}
+			transformBenchResults.push_back(r);
+		}
+	}
+
+	if (!transformBenchResults.empty() && ImGui::BeginTable("##Matrices Results", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Path");
+		ImGui::TableSetupColumn("Time (ms)");
+		ImGui::TableSetupColumn("Matrices / s");
+		ImGui::TableSetupColumn("Max Difference");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : transformBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.path);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.ms);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f M", r.matricesPerSec / 1000000.0);
+			ImGui::TableNextColumn(); ImGui::Text("%g", r.maxDifference);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkRotations() {
+	if (!ImGui::TreeNode("Quaternion Rotations")) return;
+
+	static int callCount = 100000;
+	ImGui::SliderInt("Calls##Rotations", &callCount, 1000, 1000000);
+	if (ImGui::Button("Run##Rotations")) {
+		rotationBenchResults.clear();
+
+		// angle of the rotation from one to the other, from the sine
+		// since acos() of a dot product can't see small angles
+		auto errorDegrees = [](const XMFLOAT4& a, const XMFLOAT4& b) {
+			XMVECTOR delta = XMQuaternionMultiply(XMQuaternionConjugate(XMLoadFloat4(&a)), XMLoadFloat4(&b));
+			float s = XMVectorGetX(XMVector3Length(delta));
+			return XMConvertToDegrees(2.0f * asinf((std::min)(s, 1.0f)));
+		};
+		auto elapsedNs = [](std::chrono::steady_clock::time_point start, int calls) {
+			return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+		};
+
+		// mouse look style deltas, pitch kept well away from straight
+		// up/down where euler angles and quaternions part ways
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> dist(-0.01f, 0.01f);
+		std::vector<XMFLOAT2> deltas(callCount);
+		float pitch = 0;
+		for (int i = 0; i < callCount; i++) {
+			deltas[i] = XMFLOAT2(dist(rng), dist(rng));
+			if (fabsf(pitch + deltas[i].x) > 1.2f) deltas[i].x = -deltas[i].x;
+			pitch += deltas[i].x;
+		}
+
+		// what Rotate() used to do, add to the angles and rebuild the quaternion
+		Transform transform;
+		XMFLOAT3 euler(0, 0, 0);
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < callCount; i++) {
+			euler.x += deltas[i].x;
+			euler.y += deltas[i].y;
+			XMFLOAT4 q;
+			XMStoreFloat4(&q, XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&euler)));
+			transform.SetRotationQuaternion(q);
+		}
+		rotationBenchResults.push_back({ "Euler add + rebuild", callCount, elapsedNs(start, callCount), 0.0f });
+		XMFLOAT4 reference = transform.GetRotationQuaternion();
+
+		transform.SetRotationQuaternion(XMFLOAT4(0, 0, 0, 1));
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < callCount; i++) transform.Rotate(deltas[i].x, deltas[i].y, 0);
+		rotationBenchResults.push_back({ "Rotate()", callCount, elapsedNs(start, callCount),
+			errorDegrees(transform.GetRotationQuaternion(), reference) });
+
+		transform.SetRotationQuaternion(XMFLOAT4(0, 0, 0, 1));
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < callCount; i++) {
+			transform.RotateLocalAxisAngle(XMFLOAT3(1, 0, 0), deltas[i].x);
+			transform.RotateAxisAngle(XMFLOAT3(0, 1, 0), deltas[i].y);
+		}
+		rotationBenchResults.push_back({ "Local + parent axis angle", callCount, elapsedNs(start, callCount),
+			errorDegrees(transform.GetRotationQuaternion(), reference) });
+
+		// interpolation between random rotations
+		std::uniform_real_distribution<float> angle(-XM_PI, XM_PI), unit(0.0f, 1.0f);
+		std::vector<XMFLOAT4> from(callCount), to(callCount), perCall(callCount), batched(callCount);
+		std::vector<float> t(callCount);
+		for (int i = 0; i < callCount; i++) {
+			XMStoreFloat4(&from[i], XMQuaternionRotationRollPitchYaw(angle(rng), angle(rng), angle(rng)));
+			XMStoreFloat4(&to[i], XMQuaternionRotationRollPitchYaw(angle(rng), angle(rng), angle(rng)));
+			t[i] = unit(rng);
+		}
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < callCount; i++)
+			XMStoreFloat4(&perCall[i], XMQuaternionSlerp(XMLoadFloat4(&from[i]), XMLoadFloat4(&to[i]), t[i]));
+		rotationBenchResults.push_back({ "XMQuaternionSlerp", callCount, elapsedNs(start, callCount), 0.0f });
+
+		for (bool slerp : { true, false }) {
+			start = std::chrono::steady_clock::now();
+			if (slerp) Quaternions::Slerp(from.data(), to.data(), t.data(), batched.data(), callCount);
+			else Quaternions::Nlerp(from.data(), to.data(), t.data(), batched.data(), callCount);
+			RotationBenchResult r = { slerp ? "Batched slerp" : "Batched nlerp", callCount, elapsedNs(start, callCount), 0.0f };
+			for (int i = 0; i < callCount; i++)
+				r.maxErrorDegrees = (std::max)(r.maxErrorDegrees, errorDegrees(batched[i], perCall[i]));
+			rotationBenchResults.push_back(r);
+		}
+	}
+
+	if (!rotationBenchResults.empty() && ImGui::BeginTable("##Rotation Results", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Operation");
+		ImGui::TableSetupColumn("ns / call");
+		ImGui::TableSetupColumn("Max Error (deg)");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : rotationBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.operation);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", r.ns);
+			ImGui::TableNextColumn(); ImGui::Text("%g", r.maxErrorDegrees);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkObjectMatrices() {
+	if (!ImGui::TreeNode("Object Matrices")) return;
+
+	if (ImGui::Button("Run##ObjectMatrices")) {
+		objectMatrixBenchResults.clear();
+
+		// the scene's camera and light with random world matrices
+		XMFLOAT4X4 view = activeCamera->GetView();
+		XMFLOAT4X4 projection = activeCamera->GetProjection();
+		XMMATRIX mView = XMLoadFloat4x4(&view);
+		XMMATRIX mProjection = XMLoadFloat4x4(&projection);
+		// cascade 0's, as Draw() uses
+		XMMATRIX mLightView = XMLoadFloat4x4(&lightViewMatrix);
+		XMMATRIX mLightProjection = XMLoadFloat4x4(&lightProjectionMatrix);
+		XMFLOAT4X4 viewProjection, lightViewProjection;
+		XMStoreFloat4x4(&viewProjection, mView * mProjection);
+		XMStoreFloat4x4(&lightViewProjection, mLightView * mLightProjection);
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> scaleDist(0.25f, 4.0f);
+
+		for (int entityCount : { 10000, 100000 }) {
+			std::vector<XMFLOAT4X4> worlds(entityCount);
+			for (int i = 0; i < entityCount; i++) {
+				float s = scaleDist(rng);
+				XMStoreFloat4x4(&worlds[i], XMMatrixScaling(s, s, s) *
+					XMMatrixRotationRollPitchYaw(dist(rng) * XM_PI, dist(rng) * XM_PI, dist(rng) * XM_PI) *
+					XMMatrixTranslation(dist(rng) * 100.0f, dist(rng) * 100.0f, dist(rng) * 100.0f));
+			}
+
+			// the four multiplies the vertex shader used to do, once per entity
+			std::vector<PerObjectData> reference(entityCount);
+			auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < entityCount; i++) {
+				XMMATRIX world = XMLoadFloat4x4(&worlds[i]);
+				XMStoreFloat4x4(&reference[i].worldViewProj, world * mView * mProjection);
+				XMStoreFloat4x4(&reference[i].lightWorldViewProj, world * mLightView * mLightProjection);
+			}
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			objectMatrixBenchResults.push_back({ "Per entity, 4 multiplies", entityCount, ms, 0.0f });
+
+			for (bool avx : { false, true }) {
+				if (avx && !TransformSystem::IsAVXSupported()) continue;
+				std::vector<PerObjectData> matrices(entityCount);
+				ObjectMatrixBenchResult r = { avx ? "Batched (AVX)" : "Batched (SSE)", entityCount };
+				start = std::chrono::steady_clock::now();
+				ObjectMatrices::Build(worlds.data(), worlds.size(), viewProjection, lightViewProjection, matrices.data(), avx);
+				r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+				for (int i = 0; i < entityCount; i++) {
+					const float* a = &matrices[i].worldViewProj._11;
+					const float* b = &reference[i].worldViewProj._11;
+					for (int e = 0; e < 32; e++) {
+						float difference = fabsf(a[e] - b[e]) / std::max<float>(1.0f, fabsf(b[e]));
+						r.maxDifference = std::max<float>(r.maxDifference, difference);
+					}
+				}
+				objectMatrixBenchResults.push_back(r);
+			}
+		}
+	}
+
+	if (!objectMatrixBenchResults.empty() && ImGui::BeginTable("##Object Matrix Results", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Path");
+		ImGui::TableSetupColumn("Entities");
+		ImGui::TableSetupColumn("Time (ms)");
+		ImGui::TableSetupColumn("ns / Entity");
+		ImGui::TableSetupColumn("Max Difference");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : objectMatrixBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.path);
+			ImGui::TableNextColumn(); ImGui::Text("%d", r.entities);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.ms);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", r.ms * 1000000.0 / r.entities);
+			ImGui::TableNextColumn(); ImGui::Text("%g", r.maxDifference);
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkLightClusters() {
+	if (!ImGui::TreeNode("Light Clustering")) return;
+
+	if (ImGui::Button("Run##LightClusters")) {
+		clusterBenchResults.clear();
+
+		// a fixed camera over a field of random point and spot lights
+		const float nearClip = 0.1f, farClip = 100.0f;
+		XMFLOAT4X4 view, projection;
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0, 5, -20, 0),
+			XMVector3Normalize(XMVectorSet(0.1f, -0.2f, 1, 0)), XMVectorSet(0, 1, 0, 0)));
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, nearClip, farClip));
+		XMMATRIX inverseView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&view));
+		XMMATRIX inverseProjection = XMMatrixInverse(nullptr, XMLoadFloat4x4(&projection));
+
+		std::vector<unsigned int> threadCounts = { 1 };
+		if (std::thread::hardware_concurrency() > 1) threadCounts.push_back(std::thread::hardware_concurrency());
+		for (int lightCount : { 1000, 10000 }) {
+			std::mt19937 rng(1234);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			std::vector<Light> benchLights(lightCount);
+			for (Light& light : benchLights) {
+				light = {};
+				light.Type = rng() % 4 == 0 ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+				light.Position = XMFLOAT3(dist(rng) * 40.0f, dist(rng) * 5.0f + 3.0f, dist(rng) * 40.0f + 20.0f);
+				light.Direction = XMFLOAT3(dist(rng), -1.0f, dist(rng));
+				light.Range = dist(rng) * 2.0f + 3.0f;
+				light.SpotOuterAngle = dist(rng) * 0.3f + 0.5f;
+			}
+
+			LightClusters serial;
+			serial.SetProjection(projection, nearClip, farClip);
+			serial.Bin(view, benchLights.data(), benchLights.size(), 1);
+
+			for (unsigned int threads : threadCounts) {
+				// best of a few, the first also pays for the scratch space
+				LightClusters clusters;
+				clusters.SetProjection(projection, nearClip, farClip);
+				LightClusters::BinStats stats = {};
+				double best = DBL_MAX;
+				for (int run = 0; run < 5; run++) {
+					stats = clusters.Bin(view, benchLights.data(), benchLights.size(), threads);
+					best = (std::min)(best, stats.ms);
+				}
+
+				ClusterBenchResult r = { (uint32_t)lightCount, threads, best, stats.indices, stats.maxPerCluster, 0, 0, true };
+				r.matchesSerial = clusters.GetLightIndices() == serial.GetLightIndices();
+				for (uint32_t c = 0; c < LightClusters::CLUSTER_COUNT; c++)
+					r.matchesSerial &= clusters.GetRanges()[c].x == serial.GetRanges()[c].x && clusters.GetRanges()[c].y == serial.GetRanges()[c].y;
+
+				// random points in view, every light that reaches one has to
+				// be in its cluster's list
+				for (int sample = 0; sample < 2000; sample++) {
+					float ndcX = dist(rng), ndcY = dist(rng);
+					float depth = nearClip * powf(farClip / nearClip, (dist(rng) + 1.0f) * 0.5f);
+					XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0, 1), inverseProjection);
+					XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1, 1), inverseProjection);
+					float t = (depth - XMVectorGetZ(nearPoint)) / (XMVectorGetZ(farPoint) - XMVectorGetZ(nearPoint));
+					XMVECTOR world = XMVector3TransformCoord(XMVectorLerp(nearPoint, farPoint, t), inverseView);
+
+					XMUINT2 range = clusters.GetRanges()[clusters.GetCluster(ndcX, ndcY, depth)];
+					const uint32_t* listed = clusters.GetLightIndices().data() + range.x;
+					for (uint32_t i = 0; i < (uint32_t)lightCount; i++) {
+						const Light& light = benchLights[i];
+						XMVECTOR toPoint = world - XMLoadFloat3(&light.Position);
+						if (XMVectorGetX(XMVector3Length(toPoint)) >= light.Range) continue;
+						if (light.Type == LIGHT_TYPE_SPOT &&
+							XMVectorGetX(XMVector3Dot(XMVector3Normalize(toPoint), XMVector3Normalize(XMLoadFloat3(&light.Direction)))) < cosf(light.SpotOuterAngle))
+							continue;
+						r.checked++;
+						if (std::find(listed, listed + range.y, i) == listed + range.y) r.missing++;
+					}
+				}
+				clusterBenchResults.push_back(r);
+			}
+		}
+	}
+
+	if (!clusterBenchResults.empty() && ImGui::BeginTable("##Cluster Results", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Lights");
+		ImGui::TableSetupColumn("Threads");
+		ImGui::TableSetupColumn("Bin (ms)");
+		ImGui::TableSetupColumn("Indices");
+		ImGui::TableSetupColumn("Max/Cluster");
+		ImGui::TableSetupColumn("Missing");
+		ImGui::TableSetupColumn("Result");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : clusterBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.lights);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.threads);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.ms);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.indices);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.maxPerCluster);
+			ImGui::TableNextColumn(); ImGui::Text("%u / %u", r.missing, r.checked);
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.missing == 0 && r.matchesSerial ? "Pass" : "FAIL");
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkEntityLights() {
+	if (!ImGui::TreeNode("Entity Light Lists")) return;
+
+	if (ImGui::Button("Run##EntityLights")) {
+		entityLightBenchResults.clear();
+
+		// PointLight() from Lighting.hlsli on the CPU, as the cost of one
+		// light at one pixel - only the ratio of the two passes matters
+		auto shade = [](const Light& light, XMVECTOR normal, XMVECTOR worldPos, XMVECTOR camPos, float roughness) {
+			XMVECTOR toLight = XMLoadFloat3(&light.Position) - worldPos;
+			float dist = XMVectorGetX(XMVector3Length(toLight));
+			float atten = (std::max)(0.0f, (std::min)(1.0f, 1.0f - dist * dist / (light.Range * light.Range)));
+			float diffuse = (std::max)(0.0f, (std::min)(1.0f, XMVectorGetX(XMVector3Dot(normal, XMVector3Normalize(toLight)))));
+			XMVECTOR toCam = XMVector3Normalize(camPos - worldPos);
+			XMVECTOR reflected = XMVector3Reflect(XMLoadFloat3(&light.Direction), normal);
+			float spec = powf((std::max)(XMVectorGetX(XMVector3Dot(reflected, toCam)), 0.0f), (1.0f - roughness) * 256.0f);
+			return (diffuse + (diffuse > 0 ? spec : 0.0f)) * atten * atten * light.Intensity;
+		};
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		auto makeLights = [&](int count) {
+			std::vector<Light> made(count);
+			for (int i = 0; i < count; i++) {
+				Light& light = made[i];
+				light = {};
+				light.Type = i == 0 ? LIGHT_TYPE_DIRECTIONAL : rng() % 4 == 0 ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+				light.Position = XMFLOAT3(dist(rng) * 40.0f, dist(rng) * 2.0f + 3.0f, dist(rng) * 40.0f + 20.0f);
+				light.Direction = XMFLOAT3(dist(rng) * 0.5f, -1.0f, dist(rng) * 0.5f);
+				light.Range = dist(rng) * 2.0f + 5.0f;
+				light.Intensity = 1.0f;
+				light.Color = XMFLOAT3(1, 1, 1);
+				light.SpotOuterAngle = dist(rng) * 0.3f + 0.6f;
+			}
+			return made;
+		};
+
+		// cost model, a million light and pixel pairs
+		{
+			std::vector<Light> modelLights = makeLights(256);
+			std::vector<XMFLOAT3> positions(4096), normals(4096);
+			for (size_t i = 0; i < positions.size(); i++) {
+				positions[i] = XMFLOAT3(dist(rng) * 40.0f, dist(rng), dist(rng) * 40.0f + 20.0f);
+				XMStoreFloat3(&normals[i], XMVector3Normalize(XMVectorSet(dist(rng), 1.0f, dist(rng), 0)));
+			}
+			XMVECTOR camPos = XMVectorSet(0, 10, -20, 0);
+			volatile float sink = 0;
+			float total = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (size_t p = 0; p < positions.size(); p++) {
+				XMVECTOR worldPos = XMLoadFloat3(&positions[p]);
+				XMVECTOR normal = XMLoadFloat3(&normals[p]);
+				for (const Light& light : modelLights) total += shade(light, normal, worldPos, camPos, 0.5f);
+			}
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			sink = total;
+			entityLightShadeNs = ms * 1e6 / ((double)positions.size() * modelLights.size());
+		}
+
+		// a fixed camera over a field of entities, each covering the
+		// pixels of its projected bounding sphere
+		const float screenWidth = 1280, screenHeight = 720;
+		XMFLOAT4X4 view, projection, viewProjection;
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0, 10, -20, 0),
+			XMVector3Normalize(XMVectorSet(0, -0.4f, 1, 0)), XMVectorSet(0, 1, 0, 0)));
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, screenWidth / screenHeight, 0.1f, 100.0f));
+		XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+		const int entityCount = 1000;
+		FrustumCulling::Spheres bounds;
+		bounds.Resize(entityCount);
+		for (int i = 0; i < entityCount; i++)
+			bounds.Set(i, XMFLOAT3(dist(rng) * 40.0f, dist(rng) * 0.5f, dist(rng) * 40.0f + 20.0f), dist(rng) * 0.5f + 1.0f, identity);
+		std::vector<uint32_t> visible;
+		FrustumCulling::Cull(FrustumCulling::ExtractPlanes(viewProjection), bounds, visible, TransformSystem::Global().IsAVX());
+
+		std::vector<double> pixels(entityCount, 0);
+		double totalPixels = 0;
+		for (uint32_t e : visible) {
+			XMVECTOR center = XMVector3TransformCoord(XMVectorSet(bounds.x[e], bounds.y[e], bounds.z[e], 1), XMLoadFloat4x4(&view));
+			float depth = (std::max)(XMVectorGetZ(center), 0.1f);
+			float pixelRadius = bounds.radius[e] * projection._22 * screenHeight * 0.5f / depth;
+			pixels[e] = (std::min)((double)(XM_PI * pixelRadius * pixelRadius), (double)(screenWidth * screenHeight));
+			totalPixels += pixels[e];
+		}
+
+		for (int lightCount : { 16, 32, 1000 }) {
+			std::vector<Light> benchLights = makeLights(lightCount);
+
+			// best of a few, the first also pays for the lists
+			EntityLights::Lists lists;
+			EntityLights::Stats stats = {};
+			double best = DBL_MAX;
+			for (int run = 0; run < 5; run++) {
+				stats = EntityLights::Assign(bounds, visible, benchLights.data(), benchLights.size(), 8, 0, lists);
+				best = (std::min)(best, stats.ms);
+			}
+
+			EntityLightBenchResult r = {};
+			r.lights = (uint32_t)lightCount;
+			r.entities = (uint32_t)visible.size();
+			r.assignMs = best;
+			r.perEntity = visible.empty() ? 0.0f : (float)stats.assigned / visible.size();
+			double listedPixels = 0;
+			for (uint32_t e : visible) listedPixels += pixels[e] * lists.counts[e];
+			r.allMs = totalPixels * (std::min)(lightCount, MAX_LIGHTS) * entityLightShadeNs * 1e-6;
+			r.listedMs = listedPixels * entityLightShadeNs * 1e-6;
+
+			// random points in each sphere, every light that reaches one has
+			// to be listed unless the list filled up with brighter ones
+			for (uint32_t e : visible) {
+				const uint32_t* listed = lists.Get(e);
+				bool full = lists.counts[e] == lists.stride;
+				for (int sample = 0; sample < 4; sample++) {
+					XMVECTOR offset = XMVector3Normalize(XMVectorSet(dist(rng), dist(rng), dist(rng), 0)) * (bounds.radius[e] * fabsf(dist(rng)));
+					XMVECTOR point = XMVectorSet(bounds.x[e], bounds.y[e], bounds.z[e], 1) + offset;
+					for (uint32_t i = 0; i < (uint32_t)lightCount; i++) {
+						const Light& light = benchLights[i];
+						if (light.Type != LIGHT_TYPE_DIRECTIONAL) {
+							XMVECTOR toPoint = point - XMLoadFloat3(&light.Position);
+							if (XMVectorGetX(XMVector3Length(toPoint)) >= light.Range) continue;
+							if (light.Type == LIGHT_TYPE_SPOT &&
+								XMVectorGetX(XMVector3Dot(XMVector3Normalize(toPoint), XMVector3Normalize(XMLoadFloat3(&light.Direction)))) < cosf(light.SpotOuterAngle))
+								continue;
+						}
+						r.checked++;
+						if (!full && std::find(listed, listed + lists.counts[e], i) == listed + lists.counts[e]) r.missing++;
+					}
+				}
+			}
+			entityLightBenchResults.push_back(r);
+		}
+	}
+
+	if (!entityLightBenchResults.empty()) {
+		ImGui::Text("Cost model: %.2f ns per light per pixel", entityLightShadeNs);
+	}
+	if (!entityLightBenchResults.empty() && ImGui::BeginTable("##Entity Light Results", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Lights");
+		ImGui::TableSetupColumn("In View");
+		ImGui::TableSetupColumn("Assign (ms)");
+		ImGui::TableSetupColumn("Lights/Entity");
+		ImGui::TableSetupColumn("Shade All (ms)");
+		ImGui::TableSetupColumn("Shade Lists (ms)");
+		ImGui::TableSetupColumn("Saved (ms)");
+		ImGui::TableSetupColumn("Missing");
+		ImGui::TableSetupColumn("Result");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : entityLightBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.lights);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.entities);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.assignMs);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.perEntity);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.allMs);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.listedMs);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.allMs - r.listedMs - r.assignMs);
+			ImGui::TableNextColumn(); ImGui::Text("%u / %u", r.missing, r.checked);
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.missing == 0 ? "Pass" : "FAIL");
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkRenderQueue() {
+	if (!ImGui::TreeNode("Render Queue")) return;
+
+	if (ImGui::Button("Run##RenderQueue")) {
+		renderQueueBenchResults.clear();
+
+		// draws spread over a few shader pairs, more materials and more
+		// meshes still, at random depths and in no particular order
+		for (int itemCount : { 1000, 10000, 100000 }) {
+			std::mt19937 rng(1234);
+			std::vector<RenderQueue::Item> unsorted(itemCount);
+			for (int i = 0; i < itemCount; i++) {
+				uint32_t material = rng() % 64;
+				unsorted[i].key = RenderQueue::MakeKey(RenderQueue::PASS_OPAQUE, material % 4, material,
+					rng() % 256, rng() % (1u << RenderQueue::DEPTH_BITS));
+				unsorted[i].entity = (uint32_t)i;
+			}
+
+			// best of a few, the first also pays for the scratch space
+			RenderQueue queue;
+			RenderQueue::SortStats stats = {};
+			double best = DBL_MAX;
+			for (int run = 0; run < 5; run++) {
+				queue.Clear();
+				for (const RenderQueue::Item& item : unsorted) queue.Push(item.key, item.entity);
+				stats = queue.Sort();
+				best = (std::min)(best, stats.ms);
+			}
+
+			std::vector<RenderQueue::Item> expected = unsorted;
+			double bestStd = DBL_MAX;
+			for (int run = 0; run < 5; run++) {
+				expected = unsorted;
+				auto start = std::chrono::steady_clock::now();
+				std::stable_sort(expected.begin(), expected.end(),
+					[](const RenderQueue::Item& a, const RenderQueue::Item& b) { return a.key < b.key; });
+				bestStd = (std::min)(bestStd, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			RenderQueueBenchResult r = {};
+			r.items = (uint32_t)itemCount;
+			r.radixMs = best;
+			r.passes = stats.passes;
+			r.stdSortMs = bestStd;
+			r.unsorted = RenderQueue::CountChanges(unsorted.data(), unsorted.size());
+			r.sorted = RenderQueue::CountChanges(queue.GetItems().data(), queue.GetItems().size());
+			r.matches = true;
+			for (int i = 0; i < itemCount; i++)
+				r.matches &= queue.GetItems()[i].key == expected[i].key && queue.GetItems()[i].entity == expected[i].entity;
+			renderQueueBenchResults.push_back(r);
+		}
+	}
+
+	if (!renderQueueBenchResults.empty() && ImGui::BeginTable("##Render Queue Results", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Items");
+		ImGui::TableSetupColumn("Radix (ms)");
+		ImGui::TableSetupColumn("Passes");
+		ImGui::TableSetupColumn("std::stable_sort (ms)");
+		ImGui::TableSetupColumn("Unsorted Changes");
+		ImGui::TableSetupColumn("Sorted Changes");
+		ImGui::TableSetupColumn("Result");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : renderQueueBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.items);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.radixMs);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.passes);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.stdSortMs);
+			ImGui::TableNextColumn(); ImGui::Text("%u / %u / %u", r.unsorted.shaders, r.unsorted.materials, r.unsorted.meshes);
+			ImGui::TableNextColumn(); ImGui::Text("%u / %u / %u", r.sorted.shaders, r.sorted.materials, r.sorted.meshes);
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.matches ? "Pass" : "FAIL");
+		}
+		ImGui::EndTable();
+	}
+	if (!renderQueueBenchResults.empty()) {
+		ImGui::Text("Changes are shaders / materials / meshes");
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkInstancing() {
+	if (!ImGui::TreeNode("Instancing")) return;
+
+	if (ImGui::Button("Run##Instancing")) {
+		instancingBenchResults.clear();
+
+		// draws in random order over a number of mesh and material pairs,
+		// every tenth one can't be instanced
+		for (auto [drawCount, groupCount] : { std::pair{ 100, 10 }, std::pair{ 10000, 14 }, std::pair{ 10000, 1000 } }) {
+			std::mt19937 rng(1234);
+			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+			std::vector<uint64_t> keys(drawCount);
+			for (uint64_t& key : keys) key = rng() % 10 == 0 ? Instancing::NO_BATCH : rng() % groupCount;
+
+			std::vector<XMFLOAT4X4> worlds(drawCount), worldITs(drawCount);
+			std::vector<PerObjectData> objects(drawCount);
+			for (int i = 0; i < drawCount; i++) {
+				XMMATRIX world = XMMatrixScaling(dist(rng) + 2.0f, dist(rng) + 2.0f, dist(rng) + 2.0f) *
+					XMMatrixRotationRollPitchYaw(dist(rng), dist(rng), dist(rng)) *
+					XMMatrixTranslation(dist(rng) * 50.0f, dist(rng) * 50.0f, dist(rng) * 50.0f);
+				XMStoreFloat4x4(&worlds[i], world);
+				XMStoreFloat4x4(&worldITs[i], XMMatrixInverse(nullptr, XMMatrixTranspose(world)));
+				objects[i].worldViewProj = worlds[i];
+				objects[i].lightWorldViewProj = worldITs[i];
+			}
+
+			// best of a few
+			Instancing::Batches batches;
+			Instancing::Stats stats = {};
+			std::vector<uint32_t> entities(drawCount);
+			std::vector<InstanceData> instances(drawCount);
+			double bestBuild = DBL_MAX, bestPack = DBL_MAX;
+			for (int run = 0; run < 5; run++) {
+				stats = Instancing::Build(keys.data(), keys.size(), 1024, batches);
+				bestBuild = (std::min)(bestBuild, stats.ms);
+
+				auto start = std::chrono::steady_clock::now();
+				for (int k = 0; k < drawCount; k++) entities[k] = batches.draws[k];
+				Instancing::Pack(entities.data(), entities.size(), worlds.data(), worldITs.data(), objects.data(), instances.data());
+				bestPack = (std::min)(bestPack, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			InstancingBenchResult r = { (uint32_t)drawCount, (uint32_t)groupCount, stats.batches, bestBuild, bestPack, true };
+
+			// every draw once, in batches that follow on from each other
+			std::vector<int> seen(drawCount, 0);
+			for (uint32_t d : batches.draws) seen[d]++;
+			r.passed &= std::all_of(seen.begin(), seen.end(), [](int s) { return s == 1; });
+			uint32_t next = 0;
+			for (const Instancing::Batch& batch : batches.batches) {
+				r.passed &= batch.first == next && batch.count > 0 && batch.count <= 1024;
+				next += batch.count;
+				for (uint32_t k = batch.first; k < batch.first + batch.count; k++) {
+					r.passed &= keys[batches.draws[k]] == keys[batches.draws[batch.first]];
+					r.passed &= batch.count == 1 || keys[batches.draws[k]] != Instancing::NO_BATCH;
+				}
+			}
+			r.passed &= next == (uint32_t)drawCount;
+
+			// instance k holds draw k's matrices
+			for (int k = 0; k < drawCount; k++) {
+				uint32_t d = batches.draws[k];
+				r.passed &= memcmp(&instances[k].world, &worlds[d], sizeof(XMFLOAT4X4)) == 0;
+				r.passed &= memcmp(&instances[k].worldInverseTranspose, &worldITs[d], sizeof(XMFLOAT4X4)) == 0;
+				r.passed &= memcmp(&instances[k].worldViewProj, &objects[d].worldViewProj, sizeof(XMFLOAT4X4)) == 0;
+				r.passed &= memcmp(&instances[k].lightWorldViewProj, &objects[d].lightWorldViewProj, sizeof(XMFLOAT4X4)) == 0;
+			}
+			instancingBenchResults.push_back(r);
+		}
+	}
+
+	if (!instancingBenchResults.empty() && ImGui::BeginTable("##Instancing Results", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Draws");
+		ImGui::TableSetupColumn("Groups");
+		ImGui::TableSetupColumn("Draw Calls");
+		ImGui::TableSetupColumn("Build (ms)");
+		ImGui::TableSetupColumn("Pack (ms)");
+		ImGui::TableSetupColumn("Calls Saved");
+		ImGui::TableSetupColumn("Result");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : instancingBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.draws);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.groups);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.batches);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.buildMs);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.packMs);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.draws - r.batches);
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.passed ? "Pass" : "FAIL");
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
+
+void Game::UIBenchmarkCommandBuffers() {
+	if (!ImGui::TreeNode("Command Buffers")) return;
+
+	if (ImGui::Button("Run##CommandBuffers")) {
+		commandBufferBenchResults.clear();
+
+		// the commands of a main pass draw, with made up handles - a few
+		// shaders, more materials, constants the size of real ones
+		auto handle = [](uintptr_t kind, uint32_t n) { return (const void*)(kind << 24 | (uintptr_t)(n + 1) << 4); };
+		auto recordDraw = [&](CommandBuffer& commands, uint32_t d) {
+			uint8_t vsData[256], psData[512];
+			memset(vsData, (int)(d & 0xFF), sizeof(vsData));
+			memset(psData, (int)(d >> 8 & 0xFF), sizeof(psData));
+			uint32_t shader = d % 4, material = d % 64;
+			commands.SetVertexShader(handle(1, shader), handle(2, shader));
+			commands.SetPixelShader(handle(3, shader));
+			commands.UpdateConstants(handle(4, shader), vsData, sizeof(vsData));
+			commands.SetConstantBuffer(ShaderStage::Vertex, 0, handle(4, shader));
+			commands.UpdateConstants(handle(5, shader), psData, sizeof(psData));
+			commands.SetConstantBuffer(ShaderStage::Pixel, 0, handle(5, shader));
+			for (uint32_t t = 0; t < 4; t++) commands.SetShaderResource(ShaderStage::Pixel, t, handle(6, material * 4 + t));
+			commands.SetSampler(ShaderStage::Pixel, 0, handle(7, 0));
+			commands.SetVertexBuffer(0, handle(8, 0), 48);
+			commands.SetIndexBuffer(handle(9, 0));
+			commands.DrawIndexed(36 + d % 1000 * 3, d * 36, 0);
+		};
+
+		std::vector<unsigned int> threadCounts = { 1 };
+		if (std::thread::hardware_concurrency() > 1) threadCounts.push_back(std::thread::hardware_concurrency());
+		for (uint32_t drawCount : { 1000u, 10000u, 50000u }) {
+			CommandBuffer serial;
+			for (uint32_t d = 0; d < drawCount; d++) recordDraw(serial, d);
+
+			for (unsigned int threads : threadCounts) {
+				// a run of draws per thread, merged in order - best of a few,
+				// the first also grows the buffers
+				std::vector<CommandBuffer> buffers(threads);
+				CommandBuffer merged;
+				uint32_t chunkSize = (drawCount + threads - 1) / threads;
+				double best = DBL_MAX;
+				for (int run = 0; run < 5; run++) {
+					auto start = std::chrono::steady_clock::now();
+					ParallelFor(threads, threads, [&](size_t c) {
+						buffers[c].Clear();
+						uint32_t end = (std::min)(drawCount, (uint32_t)(c + 1) * chunkSize);
+						for (uint32_t d = (uint32_t)c * chunkSize; d < end; d++) recordDraw(buffers[c], d);
+					});
+					merged.Clear();
+					for (const CommandBuffer& buffer : buffers) merged.Append(buffer);
+					best = (std::min)(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+				}
+
+				NullCommandBackend null;
+				auto nullStart = std::chrono::steady_clock::now();
+				null.Execute(merged);
+				double nullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - nullStart).count();
+
+				ValidationCommandBackend validation;
+				validation.Execute(merged);
+
+				CommandBufferBenchResult r = {};
+				r.draws = drawCount;
+				r.threads = threads;
+				r.commands = merged.GetCount();
+				r.bytes = merged.GetSize();
+				r.recordMs = best;
+				r.nullMs = nullMs;
+				r.perThread = best > 0 ? r.commands / (best / 1000.0) / threads : 0;
+				r.passed = merged.GetSize() == serial.GetSize() && merged.GetCount() == serial.GetCount() &&
+					memcmp(merged.GetData(), serial.GetData(), serial.GetSize()) == 0 &&
+					null.GetTotal() == r.commands && null.GetCount(CommandType::DrawIndexed) == drawCount &&
+					validation.GetErrorCount() == 0 && validation.GetDraws() == drawCount;
+				commandBufferBenchResults.push_back(r);
+			}
+		}
+	}
+
+	if (!commandBufferBenchResults.empty() && ImGui::BeginTable("##Command Buffer Results", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+		ImGui::TableSetupColumn("Draws");
+		ImGui::TableSetupColumn("Threads");
+		ImGui::TableSetupColumn("Commands");
+		ImGui::TableSetupColumn("Size (MB)");
+		ImGui::TableSetupColumn("Record (ms)");
+		ImGui::TableSetupColumn("M Commands/s per Thread");
+		ImGui::TableSetupColumn("Null (ms)");
+		ImGui::TableSetupColumn("Result");
+		ImGui::TableHeadersRow();
+
+		for (const auto& r : commandBufferBenchResults) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.draws);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.threads);
+			ImGui::TableNextColumn(); ImGui::Text("%u", r.commands);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f", r.bytes / (1024.0 * 1024.0));
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.recordMs);
+			ImGui::TableNextColumn(); ImGui::Text("%.1f", r.perThread / 1e6);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f", r.nullMs);
+			ImGui::TableNextColumn(); ImGui::Text("%s", r.passed ? "Pass" : "FAIL");
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::TreePop();
+}
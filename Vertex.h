@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <DirectXPackedVector.h>
 
 // --------------------------------------------------------
 // A custom vertex definition
@@ -13,4 +14,16 @@ struct Vertex
 	DirectX::XMFLOAT2 UV;
 	DirectX::XMFLOAT3 Normal;
 	DirectX::XMFLOAT3 Tangent;
+};
+
+// --------------------------------------------------------
+// Compact (20 byte) alternative to Vertex
+// - See VertexPacking.h for the encoding and the matching
+//   PackedVertexShaderInput in ShaderStructs.hlsli
+// --------------------------------------------------------
+struct PackedVertex
+{
+	DirectX::PackedVector::XMUSHORTN4 Position;			// xyz quantized within the mesh bounds, w unused
+	DirectX::PackedVector::XMHALF2 UV;
+	DirectX::PackedVector::XMSHORTN4 NormalTangent;		// octahedral normal (xy) and tangent (zw)
 };
\ No newline at end of file
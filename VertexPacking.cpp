@@ -0,0 +1,165 @@
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// float -> unorm/snorm the same way the input assembler reads them back
+	inline uint16_t ToUnorm16(float f)
+	{
+		f = std::clamp(f, 0.0f, 1.0f);
+		return (uint16_t)(f * 65535.0f + 0.5f);
+	}
+
+	inline int16_t ToSnorm16(float f)
+	{
+		f = std::clamp(f, -1.0f, 1.0f);
+		return (int16_t)std::lround(f * 32767.0f);
+	}
+
+	inline float FromSnorm16(int16_t s)
+	{
+		return (std::max)(s / 32767.0f, -1.0f);
+	}
+
+	// angle between two directions, ignoring length
+	// - atan2 instead of acos, which can't resolve angles this small in floats
+	inline float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR va = XMVector3Normalize(XMLoadFloat3(&a));
+		XMVECTOR vb = XMVector3Normalize(XMLoadFloat3(&b));
+		float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(va, vb)));
+		float cosine = XMVectorGetX(XMVector3Dot(va, vb));
+		return XMConvertToDegrees(atan2f(sine, cosine));
+	}
+
+	// zero length or NaN directions (degenerate uvs can produce these)
+	// have no meaningful angle to measure
+	inline bool IsValidDirection(const XMFLOAT3& v)
+	{
+		float lengthSq = v.x * v.x + v.y * v.y + v.z * v.z;
+		return std::isfinite(lengthSq) && lengthSq > 1e-12f;
+	}
+}
+
+VertexPacking::Quantization VertexPacking::GetQuantization(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	Quantization q = {};
+	q.positionMin = boundsMin;
+	q.positionScale = XMFLOAT3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z);
+	return q;
+}
+
+XMFLOAT2 VertexPacking::OctEncode(const XMFLOAT3& n)
+{
+	float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (!(l1 > 0)) return XMFLOAT2(0, 0);
+
+	// project onto the octahedron, fold the lower half over the upper
+	float x = n.x / l1;
+	float y = n.y / l1;
+	if (n.z < 0) {
+		float fx = (1.0f - fabsf(y)) * (x >= 0 ? 1.0f : -1.0f);
+		float fy = (1.0f - fabsf(x)) * (y >= 0 ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	return XMFLOAT2(x, y);
+}
+
+XMFLOAT3 VertexPacking::OctDecode(const XMFLOAT2& e)
+{
+	// mirrors OctDecode() in VertexPacking.hlsli
+	XMFLOAT3 n(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+	float t = (std::max)(-n.z, 0.0f);
+	n.x += n.x >= 0 ? -t : t;
+	n.y += n.y >= 0 ? -t : t;
+
+	XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+	return n;
+}
+
+PackedVertex VertexPacking::Encode(const Vertex& v, const Quantization& q)
+{
+	PackedVertex p = {};
+
+	// empty axes (flat meshes) all land on the minimum
+	auto quantize = [](float value, float min, float scale) {
+		return scale > 0 ? ToUnorm16((value - min) / scale) : (uint16_t)0;
+	};
+	p.Position.x = quantize(v.Position.x, q.positionMin.x, q.positionScale.x);
+	p.Position.y = quantize(v.Position.y, q.positionMin.y, q.positionScale.y);
+	p.Position.z = quantize(v.Position.z, q.positionMin.z, q.positionScale.z);
+	p.Position.w = 0;
+
+	p.UV.x = XMConvertFloatToHalf(v.UV.x);
+	p.UV.y = XMConvertFloatToHalf(v.UV.y);
+
+	XMFLOAT2 normal = OctEncode(v.Normal);
+	XMFLOAT2 tangent = OctEncode(v.Tangent);
+	p.NormalTangent.x = ToSnorm16(normal.x);
+	p.NormalTangent.y = ToSnorm16(normal.y);
+	p.NormalTangent.z = ToSnorm16(tangent.x);
+	p.NormalTangent.w = ToSnorm16(tangent.y);
+	return p;
+}
+
+Vertex VertexPacking::Decode(const PackedVertex& p, const Quantization& q)
+{
+	Vertex v = {};
+	v.Position.x = q.positionMin.x + p.Position.x / 65535.0f * q.positionScale.x;
+	v.Position.y = q.positionMin.y + p.Position.y / 65535.0f * q.positionScale.y;
+	v.Position.z = q.positionMin.z + p.Position.z / 65535.0f * q.positionScale.z;
+
+	v.UV.x = XMConvertHalfToFloat(p.UV.x);
+	v.UV.y = XMConvertHalfToFloat(p.UV.y);
+
+	v.Normal = OctDecode(XMFLOAT2(FromSnorm16(p.NormalTangent.x), FromSnorm16(p.NormalTangent.y)));
+	v.Tangent = OctDecode(XMFLOAT2(FromSnorm16(p.NormalTangent.z), FromSnorm16(p.NormalTangent.w)));
+	return v;
+}
+
+void VertexPacking::PackVertices(const Vertex* vertices, size_t count, const Quantization& q, std::vector<PackedVertex>& out)
+{
+	out.resize(count);
+	for (size_t i = 0; i < count; i++) out[i] = Encode(vertices[i], q);
+}
+
+VertexPacking::PackingError VertexPacking::MeasureError(const Vertex* vertices, size_t count, const Quantization& q)
+{
+	PackingError error = {};
+	for (size_t i = 0; i < count; i++) {
+		const Vertex& original = vertices[i];
+		Vertex decoded = Decode(Encode(original, q), q);
+
+		error.position = (std::max)({ error.position,
+			fabsf(decoded.Position.x - original.Position.x),
+			fabsf(decoded.Position.y - original.Position.y),
+			fabsf(decoded.Position.z - original.Position.z) });
+		error.uv = (std::max)({ error.uv,
+			fabsf(decoded.UV.x - original.UV.x),
+			fabsf(decoded.UV.y - original.UV.y) });
+
+		if (IsValidDirection(original.Normal))
+			error.normalDegrees = (std::max)(error.normalDegrees, AngleDegrees(original.Normal, decoded.Normal));
+		if (IsValidDirection(original.Tangent))
+			error.tangentDegrees = (std::max)(error.tangentDegrees, AngleDegrees(original.Tangent, decoded.Tangent));
+	}
+
+	XMVECTOR diagonal = XMVector3Length(XMLoadFloat3(&q.positionScale));
+	float length = XMVectorGetX(diagonal);
+	error.positionRelative = length > 0 ? error.position / length : 0.0f;
+	return error;
+}
+
+bool VertexPacking::WithinTolerance(const PackingError& error, const PackingTolerance& tolerance)
+{
+	return
+		error.positionRelative <= tolerance.positionRelative &&
+		error.uv <= tolerance.uv &&
+		error.normalDegrees <= tolerance.normalDegrees &&
+		error.tangentDegrees <= tolerance.tangentDegrees;
+}
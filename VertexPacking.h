@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Encoding between Vertex and PackedVertex
+// - Positions are 16 bit unorm inside the mesh bounds
+// - UVs are half floats
+// - Normals/tangents are octahedral, 16 bit snorm per axis
+// - No D3D in here, the input layout is with Game::PackedVSHelper()
+// --------------------------------------------------------
+namespace VertexPacking
+{
+	// what the shader needs to turn a quantized position back into
+	// a local one: position = min + unorm * scale
+	struct Quantization
+	{
+		DirectX::XMFLOAT3 positionMin;
+		DirectX::XMFLOAT3 positionScale;
+	};
+
+	// Worst case difference between a set of vertices and their packed copies
+	struct PackingError
+	{
+		float position;			// largest axis error, in local units
+		float positionRelative;	// position error over the bounds diagonal
+		float uv;
+		float normalDegrees;
+		float tangentDegrees;
+	};
+
+	// Allowed error for PackingError, defaults sit well above what
+	// the encoding actually loses so only broken data fails
+	struct PackingTolerance
+	{
+		float positionRelative = 0.0001f;
+		float uv = 0.001f;
+		float normalDegrees = 0.1f;
+		float tangentDegrees = 0.1f;
+	};
+
+	Quantization GetQuantization(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+
+	PackedVertex Encode(const Vertex& v, const Quantization& q);
+	Vertex Decode(const PackedVertex& v, const Quantization& q);
+
+	// Unit vector <-> octahedral coordinates in [-1, 1]
+	DirectX::XMFLOAT2 OctEncode(const DirectX::XMFLOAT3& n);
+	DirectX::XMFLOAT3 OctDecode(const DirectX::XMFLOAT2& e);
+
+	void PackVertices(const Vertex* vertices, size_t count, const Quantization& q, std::vector<PackedVertex>& out);
+
+	// Packs and unpacks every vertex and reports the largest errors
+	PackingError MeasureError(const Vertex* vertices, size_t count, const Quantization& q);
+
+	bool WithinTolerance(const PackingError& error, const PackingTolerance& tolerance);
+}
@@ -0,0 +1,28 @@
+#ifndef __GGP_VERTEX_PACKING__
+#define __GGP_VERTEX_PACKING__
+
+#include "ShaderStructs.hlsli"
+
+// octahedral coordinates in [-1, 1] back to a unit vector
+// - Matches VertexPacking::OctDecode() in C++
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+// expands a packed vertex so the rest of a shader can stay the same
+// - positionMin/positionScale come from the mesh (Mesh::GetQuantization)
+VertexShaderInput UnpackVertex(PackedVertexShaderInput input, float3 positionMin, float3 positionScale)
+{
+    VertexShaderInput output;
+    output.localPosition = positionMin + input.quantizedPosition.xyz * positionScale;
+    output.uv = input.uv;
+    output.normal = OctDecode(input.octNormalTangent.xy);
+    output.tangent = OctDecode(input.octNormalTangent.zw);
+    return output;
+}
+
+#endif
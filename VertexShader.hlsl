@@ -1,14 +1,11 @@
 
 #include "ShaderStructs.hlsli"
+#include "PerObject.hlsli"
 
 cbuffer ExternalData : register(b0)
 {
 	matrix mWorld;
     matrix mWorldIT;
-    matrix mView;
-    matrix mProj;
-    matrix mViewLight;
-    matrix mProjLight;
 }
 
 // --------------------------------------------------------
@@ -23,8 +20,7 @@ VertexToPixel main( VertexShaderInput input )
 	// Set up output struct
 	VertexToPixel output;
 	
-    matrix wvp = mul(mProj, mul(mView, mWorld));
-    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+    output.screenPosition = mul(mWorldViewProj, float4(input.localPosition, 1.0f));
 
 	// pass through other data
     output.uv = input.uv;
@@ -32,8 +28,7 @@ VertexToPixel main( VertexShaderInput input )
     output.tangent = mul((float3x3) mWorld, input.tangent);
     output.worldPosition = mul(mWorld, float4(input.localPosition, 1)).xyz;
     
-    matrix shadowWVP = mul(mProjLight, mul(mViewLight, mWorld));
-    output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
+    output.shadowMapPos = mul(mWorldViewProjLight, float4(input.localPosition, 1.0f));
     
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)